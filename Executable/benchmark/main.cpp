@@ -0,0 +1,981 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/Db.h>
+#include <Visus/IdxDataset.h>
+#include <Visus/IdxDiskAccess.h>
+#include <Visus/Scheduler.h>
+#include <Visus/RamResource.h>
+#include <Visus/ModVisus.h>
+#include <Visus/ModVisusAccess.h>
+#include <Visus/NetServer.h>
+#include <Visus/MultiplexAccess.h>
+#include <Visus/Encoder.h>
+#include <Visus/DirectoryIterator.h>
+
+#include <sstream>
+
+#if VISUS_DATAFLOW
+#include <Visus/Nodes.h>
+#include <Visus/Dataflow.h>
+#include <Visus/DatasetNode.h>
+#include <Visus/QueryNode.h>
+#include <Visus/CpuPaletteNode.h>
+#include <Visus/StatisticsNode.h>
+#endif
+
+using namespace Visus;
+
+//////////////////////////////////////////////////////////////////////////////
+class Benchmark
+{
+public:
+
+  double seconds = 3.0;
+  String dir = "./tmp/visus_benchmark";
+
+  //synthetic dataset for the suites that accept one (see --dims --dtype --bitmask --bitsperblock --compression)
+  PointNi dims = PointNi(256, 256, 256);
+  DType   dtype = DTypes::UINT16;
+  String  bitmask;
+  int     bitsperblock = 16;
+  String  compression; //empty means the default for the suite
+
+  //one record for each measure, as (key,value) pairs
+  std::vector< std::vector< std::pair<String, String> > > results;
+
+  //report (as PrintInfo, but keeps the (key,value) pairs for saveJSON)
+  template <typename... Args>
+  void report(String suite, Args&&... args)
+  {
+    std::vector<String> values = { cstring(args)... };
+    VisusReleaseAssert(values.size() % 2 == 0);
+
+    std::vector< std::pair<String, String> > record = { std::make_pair(String("suite"), suite) };
+    for (int I = 0; I < (int)values.size(); I += 2)
+      record.push_back(std::make_pair(values[I], values[I + 1]));
+    results.push_back(record);
+
+    PrintInfo(suite, cstring(args...));
+  }
+
+  //saveJSON (so that the numbers can be tracked across commits)
+  void saveJSON(String filename)
+  {
+    auto quote = [](String value) {
+      return "\"" + StringUtils::replaceAll(StringUtils::replaceAll(value, "\\", "\\\\"), "\"", "\\\"") + "\"";
+    };
+
+    auto toJSONValue = [&](String value) {
+      if (value == "True" || value == "False")
+        return StringUtils::toLower(value);
+      try
+      {
+        size_t len = 0;
+        auto number = std::stod(value, &len);
+        if (len == value.size() && std::isfinite(number))
+          return value;
+      }
+      catch (...) {}
+      return quote(value);
+    };
+
+    std::ostringstream out;
+    out << "{" << std::endl;
+    out << "  \"version\": " << quote(OpenVisus_VERSION) << "," << std::endl;
+    out << "  \"git_revision\": " << quote(OpenVisus_GIT_REVISION) << "," << std::endl;
+    out << "  \"date\": " << quote(Time::now().getFormattedLocalTime()) << "," << std::endl;
+    out << "  \"seconds\": " << seconds << "," << std::endl;
+    out << "  \"nworkers\": " << Scheduler::getSingleton()->getNumWorkers() << "," << std::endl;
+    out << "  \"dataset\": {\"dims\": " << quote(dims.toString()) << ", \"dtype\": " << quote(dtype.toString())
+      << ", \"bitmask\": " << quote(bitmask) << ", \"bitsperblock\": " << bitsperblock << ", \"compression\": " << quote(compression) << "}," << std::endl;
+    out << "  \"results\": [";
+    for (int I = 0; I < (int)results.size(); I++)
+    {
+      out << (I ? "," : "") << std::endl << "    {";
+      for (int J = 0; J < (int)results[I].size(); J++)
+        out << (J ? ", " : "") << quote(results[I][J].first) << ": " << toJSONValue(results[I][J].second);
+      out << "}";
+    }
+    out << std::endl << "  ]" << std::endl << "}" << std::endl;
+
+    Utils::saveTextDocument(filename, out.str());
+    PrintInfo("Saved benchmark results to", filename);
+  }
+
+  //runHeapMemory (allocation/free of block-sized buffers, with and without the pools)
+  void runHeapMemory()
+  {
+    auto scheduler = Scheduler::getSingleton();
+    bool bPool = HeapMemory::Defaults::pool;
+
+    for (auto pool : { false, true })
+    {
+      HeapMemory::Defaults::pool = pool;
+      HeapMemory::trimPool();
+
+      for (Int64 size : { 4 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024 })
+      {
+        for (int nthreads : { 1, scheduler->getNumWorkers() })
+        {
+          std::atomic<Int64> nops(0);
+          auto t1 = Time::now();
+          scheduler->parallelFor(0, nthreads, [&](Int64) {
+            Int64 count = 0;
+            while (t1.elapsedSec() < seconds)
+            {
+              for (int I = 0; I < 1000; I++)
+              {
+                //same pattern of encoded/decoded block buffers: allocate, touch, release
+                auto heap = std::make_shared<HeapMemory>();
+                VisusReleaseAssert(heap->resize(size, __FILE__, __LINE__));
+                heap->c_ptr()[0] = heap->c_ptr()[size - 1] = (Uint8)I;
+              }
+              count += 1000;
+            }
+            nops += count;
+          });
+
+          report("heap-memory", "pool", pool, "size", StringUtils::getStringFromByteSize(size), "nthreads", nthreads,
+            "ops/sec", (Int64)(nops / t1.elapsedSec()));
+        }
+      }
+    }
+
+    HeapMemory::Defaults::pool = bPool;
+  }
+
+  //runReadBlock (IdxDiskAccess::readBlock of random blocks, with and without the pools)
+  void runReadBlock()
+  {
+    auto codecs = compression.empty() ? std::vector<String>({ "raw", "lz4", "zip" }) : std::vector<String>({ compression });
+    for (auto codec : codecs)
+    {
+      String filename = getDatasetFilename("read-block", codec);
+      if (!FileUtils::existsFile(filename))
+        createDataset(filename, dims, dtype, bitsperblock, codec, bitmask);
+
+      auto dataset = LoadIdxDataset(filename);
+      auto nblocks = (Int64)dataset->getTotalNumberOfBlocks();
+
+      bool bPool = HeapMemory::Defaults::pool;
+      for (auto pool : { false, true })
+      {
+        HeapMemory::Defaults::pool = pool;
+        HeapMemory::trimPool();
+
+        auto access = std::make_shared<IdxDiskAccess>(dataset.get());
+        access->disableAsync();
+        access->beginRead();
+
+        Int64 nread = 0, nbytes = 0;
+        auto t1 = Time::now();
+        while (t1.elapsedSec() < seconds)
+        {
+          auto blockid = (Int64)(Utils::getRandInteger(0, (int)nblocks - 1));
+          auto query = dataset->createBlockQuery(blockid, 'r');
+          dataset->executeBlockQueryAndWait(access, query);
+          VisusReleaseAssert(query->ok());
+          nread++;
+          nbytes += query->buffer.c_size();
+        }
+        access->endRead();
+
+        report("read-block", "compression", codec, "pool", pool,
+          "blocks/sec", (Int64)(nread / t1.elapsedSec()), 
+          "MB/sec", (Int64)(nbytes / (t1.elapsedSec() * 1024 * 1024)));
+      }
+      HeapMemory::Defaults::pool = bPool;
+    }
+  }
+
+  //runWriteBlock (IdxDiskAccess::writeBlock of the blocks of an empty dataset, in hz order)
+  void runWriteBlock()
+  {
+    auto codec = compression.empty() ? String("lz4") : compression;
+    String filename = getDatasetFilename("write-block", codec);
+    removeDataset(filename);
+    createDataset(filename, dims, dtype, bitsperblock, codec, bitmask, /*bWriteData*/false);
+
+    auto dataset = LoadIdxDataset(filename);
+    auto nblocks = (Int64)dataset->getTotalNumberOfBlocks();
+
+    auto block = Array(dataset->getBlockSamples(0).nsamples, dtype);
+    fillArray(block);
+
+    auto access = std::make_shared<IdxDiskAccess>(dataset.get());
+    access->disableAsync();
+    access->beginWrite();
+
+    Int64 nwritten = 0, nbytes = 0;
+    auto t1 = Time::now();
+    for (Int64 blockid = 0; blockid < nblocks && t1.elapsedSec() < seconds; blockid++)
+    {
+      auto query = dataset->createBlockQuery(blockid, 'w');
+      query->buffer = block;
+      dataset->executeBlockQueryAndWait(access, query);
+      VisusReleaseAssert(query->ok());
+      nwritten++;
+      nbytes += block.c_size();
+    }
+    access->endWrite();
+
+    report("write-block", "compression", codec,
+      "blocks/sec", (Int64)(nwritten / t1.elapsedSec()),
+      "MB/sec", (Int64)(nbytes / (t1.elapsedSec() * 1024 * 1024)));
+
+    access.reset();
+    dataset.reset();
+    removeDataset(filename);
+  }
+
+  //runBoxQuery (random crops of 1/2 of the domain in each dimension, latency for each end resolution)
+  void runBoxQuery()
+  {
+    auto codec = compression.empty() ? String("lz4") : compression;
+    String filename = getDatasetFilename("box-query", codec);
+    if (!FileUtils::existsFile(filename))
+      createDataset(filename, dims, dtype, bitsperblock, codec, bitmask);
+
+    auto dataset = LoadIdxDataset(filename);
+    auto logic_box = dataset->getLogicBox();
+    auto pdim = logic_box.getPointDim();
+    auto maxh = dataset->getMaxResolution();
+
+    auto access = dataset->createAccess();
+    access->beginRead();
+
+    for (int H = std::max(0, maxh - 4 * pdim); H <= maxh; H += pdim)
+    {
+      double query_msec = 0; Int64 nqueries = 0, nbytes = 0;
+      auto T = Time::now();
+      while (T.elapsedSec() < seconds / (4 + 1))
+      {
+        auto p1 = PointNi(pdim);
+        for (int D = 0; D < pdim; D++)
+          p1[D] = Utils::getRandInteger(0, (int)(logic_box.size()[D] / 2));
+
+        auto query = dataset->createBoxQuery(BoxNi(p1, p1 + logic_box.size().rightShift(1)), 'r');
+        query->setResolutionRange(0, H);
+        dataset->beginBoxQuery(query);
+        VisusReleaseAssert(query->isRunning());
+
+        auto t1 = Time::now();
+        VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+        query_msec += t1.elapsedMsec();
+        nbytes += query->buffer.c_size();
+        nqueries++;
+      }
+
+      report("box-query", "compression", codec, "resolution", H, "max-resolution", maxh,
+        "query msec", query_msec / nqueries, "MB/sec", (Int64)(nbytes / (T.elapsedSec() * 1024 * 1024)));
+    }
+
+    access->endRead();
+  }
+
+  //runPointQuery (random slices 256x256 at the max resolution, 3D datasets only)
+  void runPointQuery()
+  {
+    auto codec = compression.empty() ? String("lz4") : compression;
+    String filename = getDatasetFilename("box-query", codec);
+    if (!FileUtils::existsFile(filename))
+      createDataset(filename, dims, dtype, bitsperblock, codec, bitmask);
+
+    auto dataset = LoadIdxDataset(filename);
+    auto logic_box = dataset->getLogicBox().castTo<BoxNd>();
+    if (logic_box.getPointDim() != 3)
+    {
+      PrintWarning("point-query needs a 3D dataset, skipping");
+      return;
+    }
+
+    auto access = dataset->createAccess();
+    access->beginRead();
+
+    Int64 npoints = 0, nqueries = 0;
+    auto T = Time::now();
+    while (T.elapsedSec() < seconds)
+    {
+      //slice orthogonal to a random axis
+      auto axis = Utils::getRandInteger(0, 2);
+      auto slice = logic_box;
+      slice.p1[axis] = Utils::getRandDouble(logic_box.p1[axis], logic_box.p2[axis] - 1);
+      slice.p2[axis] = slice.p1[axis];
+
+      auto query = dataset->createPointQuery(Position(slice));
+      query->end_resolution = dataset->getMaxResolution();
+      auto nsamples = PointNi(256, 256, 256);
+      nsamples[axis] = 1;
+      VisusReleaseAssert(query->setPoints(nsamples));
+      dataset->beginPointQuery(query);
+      VisusReleaseAssert(dataset->executePointQuery(access, query));
+      npoints += nsamples.innerProduct();
+      nqueries++;
+    }
+
+    access->endRead();
+
+    report("point-query", "compression", codec, "queries/sec", nqueries / T.elapsedSec(), "points/sec", (Int64)(npoints / T.elapsedSec()));
+  }
+
+  //runCodec (encode/decode of a single block)
+  void runCodec()
+  {
+    auto block = Array(PointNi((Int64)1 << bitsperblock, 1), dtype);
+    fillArray(block);
+
+    auto codecs = compression.empty() ? std::vector<String>({ "lz4", "zip", "zstd", "shuffle+lz4", "delta+zip", "chunked-lz4" }) : std::vector<String>({ compression });
+    for (auto codec : codecs)
+    {
+      auto encoder = Encoders::getSingleton()->createEncoder(codec);
+      if (!encoder)
+      {
+        PrintWarning("codec", codec, "not available, skipping");
+        continue;
+      }
+
+      SharedPtr<HeapMemory> encoded;
+      Int64 nencoded = 0;
+      auto t1 = Time::now();
+      while (t1.elapsedSec() < seconds / 2)
+      {
+        encoded = encoder->encode(block.dims, block.dtype, block.heap);
+        VisusReleaseAssert(encoded);
+        nencoded++;
+      }
+      auto encode_sec = t1.elapsedSec();
+
+      Int64 ndecoded = 0;
+      auto t2 = Time::now();
+      while (t2.elapsedSec() < seconds / 2)
+      {
+        auto decoded = encoder->decode(block.dims, block.dtype, encoded);
+        VisusReleaseAssert(decoded && decoded->c_size() == block.c_size());
+        ndecoded++;
+      }
+      auto decode_sec = t2.elapsedSec();
+
+      report("codec", "compression", codec, "block", StringUtils::getStringFromByteSize(block.c_size()), "ratio", (double)block.c_size() / encoded->c_size(),
+        "encode MB/sec", (Int64)(nencoded * block.c_size() / (encode_sec * 1024 * 1024)),
+        "decode MB/sec", (Int64)(ndecoded * block.c_size() / (decode_sec * 1024 * 1024)));
+    }
+  }
+
+  //runCache (same random crops twice through a RAM cache in front of the disk: cold vs warm)
+  void runCache()
+  {
+    auto codec = compression.empty() ? String("lz4") : compression;
+    String filename = getDatasetFilename("box-query", codec);
+    if (!FileUtils::existsFile(filename))
+      createDataset(filename, dims, dtype, bitsperblock, codec, bitmask);
+
+    auto dataset = LoadIdxDataset(filename);
+    auto logic_box = dataset->getLogicBox();
+    auto pdim = logic_box.getPointDim();
+
+    StringTree config("access");
+    config.write("type", "multiplex");
+    auto ram = config.addChild("access");
+    ram->write("type", "ram");
+    ram->write("chmod", "rw");
+    ram->write("available", StringUtils::getStringFromByteSize(2 * dtype.getByteSize(dims)));
+    auto disk = config.addChild("access");
+    disk->write("type", "disk");
+
+    auto access = std::dynamic_pointer_cast<MultiplexAccess>(dataset->createAccess(config));
+    VisusReleaseAssert(access);
+
+    std::vector<BoxNi> crops;
+    for (int I = 0; I < 16; I++)
+    {
+      auto p1 = PointNi(pdim);
+      for (int D = 0; D < pdim; D++)
+        p1[D] = Utils::getRandInteger(0, (int)(logic_box.size()[D] / 2));
+      crops.push_back(BoxNi(p1, p1 + logic_box.size().rightShift(1)));
+    }
+
+    for (auto pass : { "cold", "warm" })
+    {
+      auto before = access->getStatistics(0);
+
+      auto T = Time::now();
+      access->beginRead();
+      for (auto crop : crops)
+      {
+        auto query = dataset->createBoxQuery(crop, 'r');
+        dataset->beginBoxQuery(query);
+        VisusReleaseAssert(query->isRunning());
+        VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+      }
+      access->endRead();
+      auto msec = T.elapsedMsec();
+
+      auto after = access->getStatistics(0);
+      auto nreads = after.num_reads - before.num_reads;
+      report("cache", "compression", codec, "pass", pass, "query msec", (double)msec / crops.size(),
+        "ram hit-rate", nreads ? (double)(after.num_hits - before.num_hits) / nreads : 0.0);
+    }
+  }
+
+  //runBatchRead (random 64^3 crops, one query at a time vs executeBoxQueries)
+  void runBatchRead()
+  {
+    String filename = concatenate(dir, "/batch-read/visus.idx");
+    if (!FileUtils::existsFile(filename))
+      createDataset(filename, PointNi(512, 512, 512), DTypes::UINT8, 16, "lz4");
+
+    auto dataset = LoadIdxDataset(filename);
+    auto logic_box = dataset->getLogicBox();
+
+    const int ncrops = 10000, batch_size = 1024;
+    std::vector<BoxNi> crops;
+    for (int I = 0; I < ncrops; I++)
+    {
+      auto p1 = PointNi(3);
+      for (int D = 0; D < 3; D++)
+        p1[D] = Utils::getRandInteger(0, (int)logic_box.size()[D] - 64);
+      crops.push_back(BoxNi(p1, p1 + PointNi(64, 64, 64)));
+    }
+
+    auto createQuery = [&](BoxNi box) {
+      auto query = dataset->createBoxQuery(box, 'r');
+      dataset->beginBoxQuery(query);
+      VisusReleaseAssert(query->isRunning());
+      return query;
+    };
+
+    for (auto batch : { false, true })
+    {
+      auto access = dataset->createAccess();
+      access->beginRead();
+
+      Int64 nbytes = 0;
+      auto t1 = Time::now();
+      for (int A = 0; A < ncrops; A += batch_size)
+      {
+        std::vector< SharedPtr<BoxQuery> > queries;
+        for (int I = A; I < std::min(A + batch_size, ncrops); I++)
+          queries.push_back(createQuery(crops[I]));
+
+        if (batch)
+        {
+          VisusReleaseAssert(dataset->executeBoxQueries(access, queries));
+        }
+        else
+        {
+          for (auto query : queries)
+            VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+        }
+
+        for (auto query : queries)
+          nbytes += query->buffer.c_size();
+      }
+      access->endRead();
+
+      report("batch-read", "batch", batch, "crops", ncrops, "msec", t1.elapsedMsec(),
+        "crops/sec", (Int64)(ncrops / t1.elapsedSec()), "MB/sec", (Int64)(nbytes / (t1.elapsedSec() * 1024 * 1024)));
+    }
+  }
+
+  //runOnDemand (external OnDemandAccess with a mock generator: one process for each block vs a pool of persistent generators)
+  void runOnDemand()
+  {
+    String filename = concatenate(dir, "/ondemand/visus.idx");
+    if (!FileUtils::existsFile(filename))
+    {
+      IdxFile idxfile;
+      idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(2048, 2048));
+      idxfile.bitsperblock = 12;
+      idxfile.fields.push_back(Field("data", DTypes::UINT8));
+      idxfile.save(filename);
+    }
+
+    auto dataset = LoadIdxDataset(filename);
+    auto nblocks = (Int64)dataset->getTotalNumberOfBlocks();
+
+    for (auto workers : { 0, 4 })
+    {
+      StringTree config("access");
+      config.write("type", "ondemandaccess");
+      config.write("ondemand", "external");
+      config.write("path", CommandLine::args[0] + " --mock-generator");
+      config.write("nthreads", workers ? 0 : 4);
+      config.write("workers", workers);
+      auto access = dataset->createAccess(config);
+      access->beginRead();
+
+      //each round asks for 64 consecutive missing blocks, twice (as two viewers looking at the same region)
+      Int64 nrequested = 0;
+      auto t1 = Time::now();
+      while (t1.elapsedSec() < seconds)
+      {
+        auto first = (Int64)Utils::getRandInteger(0, (int)nblocks - 64);
+        WaitAsync< Future<Void> > wait_async;
+        for (int viewer = 0; viewer < 2; viewer++)
+        {
+          for (Int64 blockid = first; blockid < first + 64; blockid++)
+          {
+            auto query = dataset->createBlockQuery(blockid, 'r');
+            dataset->executeBlockQuery(access, query);
+            wait_async.pushRunning(query->done);
+          }
+        }
+        wait_async.waitAllDone();
+        nrequested += 128;
+      }
+      access->endRead();
+
+      report("ondemand", "workers", workers, "requested blocks/sec", (Int64)(nrequested / t1.elapsedSec()));
+      access->printStatistics();
+    }
+  }
+
+  //runMockGenerator (fake external generator for runOnDemand: 50msec to start, 2msec for each call, 1msec for each block)
+  static int runMockGenerator(std::vector<String> args)
+  {
+    Thread::sleep(50);
+
+    //one block for each process
+    if (std::find(args.begin(), args.end(), "--serve") == args.end())
+    {
+      Thread::sleep(2 + 1);
+      return 0;
+    }
+
+    //persistent process, framed requests on stdin
+    char header[256];
+    while (fgets(header, sizeof(header), stdin))
+    {
+      long long id, size;
+      if (sscanf(header, "%lld %lld", &id, &size) != 2)
+        return 1;
+
+      String body(size, ' ');
+      if (size && fread(&body[0], 1, size, stdin) != (size_t)size)
+        return 1;
+
+      int nblocks = 0;
+      for (auto line : StringUtils::split(body, "\n"))
+        nblocks += StringUtils::startsWith(line, "box ") ? 1 : 0;
+
+      Thread::sleep(2 + nblocks);
+      printf("%lld 2\nok", id);
+      fflush(stdout);
+    }
+    return 0;
+  }
+
+  //runModVisus (box queries through a local mod_visus with artificial latency/bandwidth, fixed vs adaptive+streamed batches)
+  void runModVisus()
+  {
+    String filename = concatenate(dir, "/modvisus/visus.idx");
+    if (!FileUtils::existsFile(filename))
+      createDataset(filename, PointNi(1024, 1024), DTypes::UINT8, 12, "lz4");
+
+    //simulates the network: latency before the response, bandwidth while sending the body
+    class SlowModVisus : public ModVisus
+    {
+    public:
+      int    latency_msec = 0;
+      double bandwidth = 0; //bytes/sec
+
+      //throttle
+      void throttle(Int64 nbytes) {
+        if (bandwidth > 0) Thread::sleep((int)(1000.0 * nbytes / bandwidth));
+      }
+
+      //handleRequest
+      virtual NetResponse handleRequest(NetRequest request) override
+      {
+        Thread::sleep(latency_msec);
+        auto response = ModVisus::handleRequest(request);
+
+        if (auto body_stream = response.body_stream)
+        {
+          response.body_stream = [this, body_stream](std::function<bool(const Uint8*, Int64)> write) {
+            body_stream([this, write](const Uint8* data, Int64 size) {
+              throttle(size);
+              return write(data, size);
+            });
+          };
+        }
+        else if (response.body)
+        {
+          throttle(response.body->c_size());
+        }
+        return response;
+      }
+    };
+
+    int port = 10123;
+    auto modvisus = new SlowModVisus();
+    modvisus->configureDatasets(ConfigFile::fromString(concatenate("<visus><dataset name='benchmark' url='", filename, "' permissions='public' /></visus>")));
+    NetServer server(port, modvisus);
+    server.runInBackground();
+    Thread::sleep(100);
+
+    auto dataset = LoadDataset(concatenate("http://127.0.0.1:", port, "/mod_visus?dataset=benchmark"));
+    VisusReleaseAssert(dataset);
+
+    for (auto latency_msec : { 0, 20, 50 })
+    {
+      modvisus->latency_msec = latency_msec;
+      modvisus->bandwidth = 64.0 * 1024 * 1024;
+
+      for (auto adaptive : { false, true })
+      {
+        StringTree config("access");
+        config.write("type", "network");
+        config.write("streaming", adaptive);
+        config.write("adaptive", adaptive);
+        auto access = std::dynamic_pointer_cast<ModVisusAccess>(dataset->createAccess(config));
+        VisusReleaseAssert(access);
+
+        double query_msec = 0; Int64 nqueries = 0, nbytes = 0;
+        auto T = Time::now();
+        while (T.elapsedSec() < seconds)
+        {
+          auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'r');
+          dataset->beginBoxQuery(query);
+          VisusReleaseAssert(query->isRunning());
+
+          auto t1 = Time::now();
+          VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+          query_msec += t1.elapsedMsec();
+          nbytes += query->buffer.c_size();
+          nqueries++;
+        }
+
+        report("modvisus", "latency msec", latency_msec, "adaptive+streaming", adaptive,
+          "queries/sec", nqueries / T.elapsedSec(), "query msec", (Int64)(query_msec / nqueries), "MB/sec", (Int64)(nbytes / (T.elapsedSec() * 1024 * 1024)),
+          "num_queries_per_request", access->getNumQueriesPerRequest(), "rtt msec", (Int64)access->getRoundTripTime());
+      }
+    }
+
+    dataset.reset();
+    server.signalExit();
+    server.waitForExit();
+  }
+
+#if VISUS_DATAFLOW
+
+  //runDataflow (QueryNode->CpuPaletteNode->StatisticsNode, headless, the main thread dispatches as the viewer idle loop does)
+  void runDataflow()
+  {
+    String filename = concatenate(dir, "/dataflow/visus.idx");
+    if (!FileUtils::existsFile(filename))
+      createDataset(filename, PointNi(4096, 4096), DTypes::UINT16, 16, "lz4");
+
+    auto dataset = LoadIdxDataset(filename);
+    auto logic_box = dataset->getLogicBox().castTo<BoxNd>();
+
+    class FrameCounter : public DataflowListener
+    {
+    public:
+      Node* target = nullptr;
+      int   nframes = 0;
+      virtual void dataflowMessageHasBeenPublished(DataflowMessage msg) override {
+        if (msg.getSender() == target) nframes++;
+      }
+    };
+
+    Dataflow dataflow;
+
+    auto dataset_node = new DatasetNode();
+    dataset_node->setDataset(dataset, false);
+    dataflow.addNode(dataset_node);
+
+    auto query_node = new QueryNode();
+    dataflow.addNode(query_node);
+    dataflow.connectNodes(dataset_node, "dataset", query_node);
+
+    auto palette_node = new CpuPaletteNode(TransferFunction::getDefault("graytransparent"));
+    dataflow.addNode(palette_node);
+    dataflow.connectNodes(query_node, "array", palette_node);
+
+    auto statistics_node = new StatisticsNode();
+    dataflow.addNode(statistics_node);
+    dataflow.connectNodes(palette_node, "array", statistics_node);
+
+    FrameCounter counter;
+    counter.target = statistics_node;
+    dataflow.addListener(&counter);
+
+    std::vector<Node*> chain = { query_node, palette_node, statistics_node };
+    auto isIdle = [&]() {
+      for (auto node : chain)
+        if (node->isProcessing()) return false;
+      return true;
+    };
+
+    //a new region of interest, as when panning/zooming in the viewer (always overlapping the random half, on constant regions there are no statistics)
+    auto interact = [&]() {
+      auto size = logic_box.size() * (0.25 + 0.75 * Utils::getRandDouble(0, 1));
+      auto p1 = logic_box.p1 + (logic_box.size() - size) * Utils::getRandDouble(0, 0.5);
+      query_node->setQueryBounds(Position(BoxNd(p1, p1 + size)));
+      dataflow.needProcessInput(query_node);
+    };
+
+    //returns false when everything has been processed
+    auto dispatch = [&]() {
+      bool bIdle = isIdle(); //before dispatching, a job publishes before leaving the running set
+      if (!dataflow.dispatchPublishedMessages() && bIdle)
+        return false;
+      Thread::sleep(1);
+      return true;
+    };
+
+    //single interaction: latency to the first (coarse) and to the final frame at the end of the chain
+    {
+      double first_msec = 0, final_msec = 0; Int64 nframes = 0, ninteractions = 0;
+      auto T = Time::now();
+      while (T.elapsedSec() < seconds)
+      {
+        interact();
+        counter.nframes = 0;
+        auto t1 = Time::now();
+        double first = -1;
+        while (dispatch())
+        {
+          if (counter.nframes && first < 0)
+            first = t1.elapsedMsec();
+        }
+        first_msec += first >= 0 ? first : t1.elapsedMsec();
+        final_msec += t1.elapsedMsec();
+        nframes += counter.nframes;
+        ninteractions++;
+      }
+
+      report("dataflow", "mode", "interaction", "first-frame msec", (Int64)(first_msec / ninteractions), "final-frame msec", (Int64)(final_msec / ninteractions),
+        "frames/interaction", (double)nframes / ninteractions);
+    }
+
+    //continuous interaction (a new region every 16msec): frames reaching the end of the chain and the time to settle once the user stops
+    {
+      counter.nframes = 0;
+      Int64 ninteractions = 0;
+      auto T = Time::now();
+      while (T.elapsedSec() < seconds)
+      {
+        auto t1 = Time::now();
+        interact();
+        ninteractions++;
+        while (t1.elapsedMsec() < 16)
+          dispatch();
+      }
+
+      auto nframes = counter.nframes;
+      auto t1 = Time::now();
+      while (dispatch())
+        ;
+
+      report("dataflow", "mode", "drag", "interactions", ninteractions, "frames/sec", (Int64)(nframes / T.elapsedSec()), "settle msec", (Int64)t1.elapsedMsec());
+    }
+
+    dataflow.printJobStatistics();
+    dataflow.removeListener(&counter);
+  }
+
+#endif
+
+  //getDatasetFilename (one dataset for each suite and synthetic dataset parameters)
+  String getDatasetFilename(String suite, String codec) const
+  {
+    auto name = concatenate(suite, "-", StringUtils::replaceAll(dims.toString(), " ", "x"), "-", dtype.toString(), "-", bitsperblock, "-", codec);
+    if (!bitmask.empty())
+      name += "-" + bitmask;
+    return concatenate(dir, "/", StringUtils::replaceAll(name, "+", "_"), "/visus.idx");
+  }
+
+  //removeDataset
+  static void removeDataset(String filename)
+  {
+    std::vector<String> binfiles;
+    DirectoryIterator::findAllFilesEndingWith(binfiles, Path(filename).getParent().toString(), ".bin");
+    for (auto it : binfiles)
+      FileUtils::removeFile(it);
+    FileUtils::removeFile(filename);
+  }
+
+  //fillArray (half of the samples are random, half zeros)
+  static void fillArray(Array& array)
+  {
+    array.fillWithValue(0);
+    Uint8* p = array.c_ptr();
+    for (Int64 I = 0, N = array.c_size() / 2; I < N; I++)
+      p[I] = (Uint8)Utils::getRandInteger(0, 255);
+  }
+
+  //createDataset (kept on disk and reused by the next runs)
+  static void createDataset(String filename, PointNi dims, DType dtype, int bitsperblock, String compression, String bitmask = "", bool bWriteData = true)
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(dims.getPointDim()), dims);
+    idxfile.bitsperblock = bitsperblock;
+    if (!bitmask.empty())
+      idxfile.bitmask = DatasetBitmask::fromString(bitmask);
+    Field field("data", dtype);
+    field.default_compression = compression == "raw" ? "" : compression;
+    idxfile.fields.push_back(field);
+    idxfile.save(filename);
+
+    if (!bWriteData)
+      return;
+
+    auto dataset = LoadIdxDataset(filename);
+    auto access = dataset->createAccess();
+    auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'w');
+    dataset->beginBoxQuery(query);
+    VisusReleaseAssert(query->isRunning());
+    query->buffer = Array(query->getNumberOfSamples(), query->field.dtype);
+    fillArray(query->buffer);
+    VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+  }
+
+};
+
+
+//////////////////////////////////////////////////////////////////////////////
+/*
+visus_benchmark [--seconds 3] [--dir ./tmp/visus_benchmark] [--json results.json]
+  [--dims 256x256x256] [--dtype uint16] [--bitmask V012012...] [--bitsperblock 16] [--compression lz4]
+  [suite ...]
+
+Random numbers are seeded in the same way at each run, so the crops/blocks/points are the same.
+*/
+int main(int argn, const char* argv[])
+{
+  SetCommandLine(argn, argv);
+
+  if (argn > 1 && String(argv[1]) == "--mock-generator")
+    return Benchmark::runMockGenerator(CommandLine::args);
+
+  DbModule::attach();
+#if VISUS_DATAFLOW
+  NodesModule::attach();
+#endif
+
+  Benchmark benchmark;
+  std::vector<String> suites;
+  String json_filename;
+
+  auto args = std::vector<String>(CommandLine::args.begin() + 1, CommandLine::args.end());
+  for (int I = 0; I < (int)args.size(); I++)
+  {
+    if (args[I] == "--seconds" && I + 1 < (int)args.size())
+      benchmark.seconds = cdouble(args[++I]);
+
+    else if (args[I] == "--dir" && I + 1 < (int)args.size())
+      benchmark.dir = args[++I];
+
+    else if (args[I] == "--json" && I + 1 < (int)args.size())
+      json_filename = args[++I];
+
+    else if (args[I] == "--dims" && I + 1 < (int)args.size())
+      benchmark.dims = PointNi::fromString(StringUtils::replaceAll(args[++I], "x", " "));
+
+    else if (args[I] == "--dtype" && I + 1 < (int)args.size())
+      benchmark.dtype = DType::fromString(args[++I]);
+
+    else if (args[I] == "--bitmask" && I + 1 < (int)args.size())
+      benchmark.bitmask = args[++I];
+
+    else if (args[I] == "--bitsperblock" && I + 1 < (int)args.size())
+      benchmark.bitsperblock = cint(args[++I]);
+
+    else if (args[I] == "--compression" && I + 1 < (int)args.size())
+      benchmark.compression = args[++I];
+
+    else
+      suites.push_back(args[I]);
+  }
+
+  if (suites.empty())
+    suites = { "heap-memory", "codec", "write-block", "read-block", "box-query", "point-query", "cache", "batch-read", "ondemand", "modvisus", "dataflow" };
+
+  for (auto suite : suites)
+  {
+    if (suite == "heap-memory")
+      benchmark.runHeapMemory();
+
+    else if (suite == "codec")
+      benchmark.runCodec();
+
+    else if (suite == "write-block")
+      benchmark.runWriteBlock();
+
+    else if (suite == "read-block")
+      benchmark.runReadBlock();
+
+    else if (suite == "box-query")
+      benchmark.runBoxQuery();
+
+    else if (suite == "point-query")
+      benchmark.runPointQuery();
+
+    else if (suite == "cache")
+      benchmark.runCache();
+
+    else if (suite == "batch-read")
+      benchmark.runBatchRead();
+
+    else if (suite == "ondemand")
+      benchmark.runOnDemand();
+
+    else if (suite == "modvisus")
+      benchmark.runModVisus();
+
+#if VISUS_DATAFLOW
+    else if (suite == "dataflow")
+      benchmark.runDataflow();
+#endif
+
+    else
+      PrintWarning("unknown benchmark", suite, "(valid ones: heap-memory codec write-block read-block box-query point-query cache batch-read ondemand modvisus dataflow)");
+  }
+
+  if (!json_filename.empty())
+    benchmark.saveJSON(json_filename);
+
+#if VISUS_DATAFLOW
+  NodesModule::detach();
+#endif
+  DbModule::detach();
+  return 0;
+}
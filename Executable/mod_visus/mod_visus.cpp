@@ -265,6 +265,7 @@ public:
     }
 
     NetResponse response = mod_visus->handleRequest(visus_request);
+    response.readBodyStream();
 
     IHttpResponse * iis_response = pHttpContext->GetResponse();
     iis_response->Clear();
@@ -777,7 +778,16 @@ static int MyHookRequest(request_rec *apache_request)
   
   ap_set_content_type(apache_request,content_type);
   
-  if (visus_response.body && visus_response.body->c_size())
+  if (visus_response.body_stream)
+  {
+    //streamed body, flush each chunk to the client as soon as it's produced
+    visus_response.body_stream([apache_request](const Uint8* data, Int64 size) {
+      if (ap_rwrite(data, (int)size, apache_request) < 0) return false;
+      ap_rflush(apache_request);
+      return true;
+    });
+  }
+  else if (visus_response.body && visus_response.body->c_size())
     ap_rwrite(visus_response.body->c_ptr(),visus_response.body->c_size(),apache_request);
 
   return bOk? OK : visus_response.status;    
@@ -194,6 +194,9 @@ public:
   //joinProcessing
   void joinProcessing();
 
+  //printJobStatistics (slowest nodes first, to spot the bottlenecks)
+  void printJobStatistics();
+
   //guessLastPublished
   DataflowPortValue* guessLastPublished(DataflowPort* from);
 
@@ -284,6 +287,9 @@ private:
   //floodValueForward
   void floodValueForward(DataflowPort* port, SharedPtr<DataflowValue> value, const SharedPtr<ReturnReceipt>& return_receipt);
 
+  //canCoalesce (i.e. no input downstream wants to see all the values)
+  bool canCoalesce(DataflowPort* port) const;
+
 };
 
 
@@ -84,6 +84,20 @@ public:
     this->aborted.setTrue();
   }
 
+  //publishRefinement 
+  //credit-based backpressure: an intermediate result is published only if the previous one has been consumed downstream 
+  //(i.e. its return receipt is ready), otherwise it's skipped since a better one is coming; final results are always published
+  bool publishRefinement(Node* node, DataflowMessage msg, bool bFinal);
+
+  //getNumSkippedRefinements
+  int getNumSkippedRefinements() const {
+    return num_skipped_refinements;
+  }
+
+private:
+
+  SharedPtr<ReturnReceipt> credit;
+  int                      num_skipped_refinements = 0;
 
 };
 
@@ -94,6 +108,19 @@ public:
 
   VISUS_NON_COPYABLE_CLASS(Node)
 
+  //___________________________________________
+  class VISUS_DATAFLOW_API JobStatistics
+  {
+  public:
+
+    int    num_queued=0;   //jobs waiting for a scheduler worker (i.e. queue depth)
+    int    num_running=0;
+    Int64  num_done=0;
+    Int64  num_aborted=0;  //aborted before or while running (e.g. superseded by a newer job)
+    double run_msec=0;     //total time spent inside runJob
+    double max_run_msec=0;
+  };
+
   //input/outputs
   std::map<String,DataflowPort*> outputs;
   std::map<String,DataflowPort*> inputs;
@@ -184,6 +211,62 @@ public:
   //joinProcessing 
   virtual void joinProcessing();
 
+  //isProcessing (i.e. some job is still queued or running)
+  bool isProcessing() {
+    ScopedLock lock(running_lock);
+    return !running.empty();
+  }
+
+  //isSerial
+  bool isSerial() const {
+    return serial;
+  }
+
+  //setSerial (call it before the first job)
+  //a serial node runs one job at a time in the order they arrive, otherwise jobs run concurrently on all the scheduler workers
+  void setSerial(bool value) {
+    VisusAssert(!thread_pool);
+    this->serial = value;
+  }
+
+  //isLatestJobWins
+  bool isLatestJobWins() const {
+    return latest_job_wins;
+  }
+
+  //setLatestJobWins (default false)
+  //if enabled a new job aborts the queued and running ones
+  void setLatestJobWins(bool value) {
+    this->latest_job_wins = value;
+  }
+
+  //getJobPriority
+  int getJobPriority() const {
+    return job_priority;
+  }
+
+  //setJobPriority (see Scheduler::Priority, call it before the first job)
+  void setJobPriority(int value) {
+    VisusAssert(!thread_pool);
+    this->job_priority = value;
+  }
+
+  //getJobStatistics
+  JobStatistics getJobStatistics() {
+    ScopedLock lock(running_lock);
+    auto ret = job_statistics;
+    ret.num_queued = (int)running.size() - ret.num_running;
+    return ret;
+  }
+
+  //resetJobStatistics
+  void resetJobStatistics() {
+    ScopedLock lock(running_lock);
+    auto num_running = job_statistics.num_running;
+    job_statistics = JobStatistics();
+    job_statistics.num_running = num_running;
+  }
+
   // ********************************************************
   // IMPORTANT the following function are not thread safe.... 
   // make sure you use them only in the main thread
@@ -356,7 +439,11 @@ protected:
 
   CriticalSection                running_lock;
   std::set< SharedPtr<NodeJob> > running;
+  JobStatistics                  job_statistics;
 
+  bool                           serial = true;
+  bool                           latest_job_wins = false;
+  int                            job_priority = Scheduler::Interactive;
   SharedPtr<ThreadPool>          thread_pool;
 
   //processInput 
@@ -197,6 +197,9 @@ protected:
   std::deque<DataflowPortValue> values;
   int write_id;
   int read_id;
+
+  //clearValues (signing the return receipts of the dropped values)
+  void clearValues();
 };
 
 } //namespace Visus
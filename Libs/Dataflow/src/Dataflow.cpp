@@ -106,21 +106,70 @@ void Dataflow::joinProcessing()
     nodes[I]->joinProcessing();
 }
 
+//////////////////////////////////////////////////////////
+void Dataflow::printJobStatistics()
+{
+  VisusAssert(VisusHasMessageLock());
+
+  std::vector< std::pair<Node*, Node::JobStatistics> > v;
+  for (int I=0;I<nodes.size();I++)
+  {
+    auto stats=nodes[I]->getJobStatistics();
+    if (stats.num_done || stats.num_aborted || stats.num_queued || stats.num_running)
+      v.push_back(std::make_pair(nodes[I],stats));
+  }
+
+  std::sort(v.begin(),v.end(),[](const std::pair<Node*, Node::JobStatistics>& a,const std::pair<Node*, Node::JobStatistics>& b) {
+    return a.second.run_msec > b.second.run_msec;
+  });
+
+  for (auto it : v)
+  {
+    auto node=it.first;
+    auto stats=it.second;
+    PrintInfo(node->getName().empty()? node->getUUID() : node->getName(), node->isSerial()? "serial" : "concurrent",
+      "queued", stats.num_queued, "running", stats.num_running, "done", stats.num_done, "aborted", stats.num_aborted,
+      "run msec", (Int64)stats.run_msec, "max msec", (Int64)stats.max_run_msec);
+  }
+}
+
 ////////////////////////////////////////////////////////////////////
 void Dataflow::floodValueForward(DataflowPort* port,SharedPtr<DataflowValue> value,const SharedPtr<ReturnReceipt>& return_receipt)
 {
   VisusAssert(VisusHasMessageLock());
   Node* node=port->getNode();
   VisusAssert(containsNode(node));
-  port->writeValue(value,return_receipt);
 
+  //only inputs sign the receipt (nobody is going to read a value stored in an output port)
   if (node->getInputPort(port->getName())==port)
+  {
+    port->writeValue(value,return_receipt);
     need_processing.insert(node);
+  }
+  else
+  {
+    port->writeValue(value);
+  }
 
   for (auto it=port->outputs.begin();it!=port->outputs.end();it++)
     floodValueForward((*it),value,return_receipt);
 }
 
+////////////////////////////////////////////////////////////////////
+bool Dataflow::canCoalesce(DataflowPort* port) const
+{
+  if (port->getPolicy()==DataflowPort::StoreMultipleVolatileValues)
+    return false;
+
+  for (auto it=port->outputs.begin();it!=port->outputs.end();it++)
+  {
+    if (!canCoalesce(*it))
+      return false;
+  }
+
+  return true;
+}
+
 ////////////////////////////////////////////////////////////////////////
 /* 
 case OPORT_IPORT
@@ -242,17 +291,42 @@ bool Dataflow::dispatchPublishedMessages()
   if (published.empty() && this->need_processing.empty())
     return false;
 
+  //latest value wins: a (sender,port) value superseded by a later message of the same batch is not flooded at all
+  //(a slow consumer would otherwise get a job for every stale refinement); its receipt is signed anyway
+  std::vector< std::set<String> > superseded(published.size());
+  {
+    std::set< std::pair<Node*,String> > latest;
+    for (int I=(int)published.size()-1;I>=0;I--)
+    {
+      Node* sender=published[I].getSender();
+      if (!sender) continue;
+      for (auto it : published[I].getContent())
+      {
+        DataflowPort* port=sender->getOutputPort(it.first);
+        if (!latest.insert(std::make_pair(sender,it.first)).second && port && canCoalesce(port))
+          superseded[I].insert(it.first);
+      }
+    }
+  }
+
   //floodValues stored in the publish event
-  for (auto& msg : published)
+  for (int I=0;I<(int)published.size();I++)
   {
+    auto& msg=published[I];
+    bool bSuperseded=!superseded[I].empty() && superseded[I].size()==msg.getContent().size();
+
     //probably the node has been removed from the dataflow (see removeNode)
-    if (Node* sender=msg.getSender())
+    Node* sender=msg.getSender();
+    if (sender && !bSuperseded)
     {
       VisusAssert(containsNode(sender));
       for (auto it=msg.getContent().begin();it!=msg.getContent().end();it++)
       {
         String port_name=it->first;
 
+        if (superseded[I].count(port_name))
+          continue;
+
         SharedPtr<DataflowValue> value_to_flood=it->second;
         DataflowPort* port=sender->getOutputPort(port_name);
 
@@ -266,8 +340,11 @@ bool Dataflow::dispatchPublishedMessages()
       sender->messageHasBeenPublished(msg);
     }
 
-    for (auto listener : listeners)
-      listener->dataflowMessageHasBeenPublished(msg);
+    if (!bSuperseded)
+    {
+      for (auto listener : listeners)
+        listener->dataflowMessageHasBeenPublished(msg);
+    }
 
     //I promised to sign it in Dataflow::publish
     if (auto return_receipt=msg.getReturnReceipt())
@@ -294,10 +371,11 @@ bool Dataflow::publish(DataflowMessage msg)
   //I need the lock, I can be in any thread here
   {
     ScopedLock lock(published_lock);
-    published.push_back(msg);
 
     if (auto return_receipt = msg.getReturnReceipt())
       return_receipt->needSignature(this);
+
+    published.push_back(std::move(msg));
   }
 
   return true;
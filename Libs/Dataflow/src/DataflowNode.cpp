@@ -51,6 +51,18 @@ Node::Node() :  dataflow(nullptr),visible(true),parent(nullptr),uuid("")
 Node::~Node()
 {
   VisusAssert(!dataflow);
+
+  //the queued jobs reference this node, drain them before the members go away
+  if (thread_pool)
+  {
+    {
+      ScopedLock lock(running_lock);
+      for (auto it : running)
+        it->abort();
+    }
+    thread_pool->waitAll();
+  }
+
   for (auto it=inputs .begin();it!=inputs .end();it++) delete it->second;
   for (auto it=outputs.begin();it!=outputs.end();it++) delete it->second;
 }
@@ -237,6 +249,22 @@ void Node::exitFromDataflow()
   joinProcessing();
 }
 
+////////////////////////////////////////////////////////////
+bool NodeJob::publishRefinement(Node* node, DataflowMessage msg, bool bFinal)
+{
+  if (!bFinal && credit && !credit->isReady())
+  {
+    num_skipped_refinements++;
+    return false;
+  }
+
+  if (!msg.getReturnReceipt())
+    msg.setReturnReceipt(std::make_shared<ReturnReceipt>());
+
+  this->credit = msg.getReturnReceipt();
+  return node->publish(msg);
+}
+
 ////////////////////////////////////////////////////////////
 void Node::abortProcessing()
 {
@@ -265,9 +293,16 @@ void Node::addNodeJob(SharedPtr<NodeJob> job)
   VisusAssert(VisusHasMessageLock());
   VisusAssert(job && getDataflow()!=nullptr);
 
-  //create a thread for the jobs
+  if (latest_job_wins)
+    abortProcessing();
+
+  //jobs go to the shared scheduler, the pool only limits how many of them run at the same time
+  //(no scheduler before KernelModule::attach or after KernelModule::detach: one job at a time, like the old per-node thread)
   if (!thread_pool)
-    thread_pool=std::make_shared<ThreadPool>(name + " " + "Worker",1);
+  {
+    auto scheduler = Scheduler::getSingleton();
+    thread_pool=std::make_shared<ThreadPool>(name + " " + "Worker", serial || !scheduler ? 1 : scheduler->getNumWorkers(), job_priority);
+  }
 
   {
     ScopedLock lock(running_lock);
@@ -280,10 +315,32 @@ void Node::addNodeJob(SharedPtr<NodeJob> job)
     });
   }
 
-  ThreadPool::push(thread_pool,[job]()
+  ThreadPool::push(thread_pool,[this,job]()
   {
     if (!job->aborted())
+    {
+      {
+        ScopedLock lock(running_lock);
+        job_statistics.num_running++;
+      }
+
+      Time t1 = Time::now();
       job->runJob();
+      auto msec = (double)t1.elapsedMsec();
+
+      ScopedLock lock(running_lock);
+      job_statistics.num_running--;
+      job_statistics.run_msec += msec;
+      job_statistics.max_run_msec = std::max(job_statistics.max_run_msec, msec);
+    }
+
+    {
+      ScopedLock lock(running_lock);
+      if (job->aborted())
+        job_statistics.num_aborted++;
+      else
+        job_statistics.num_done++;
+    }
 
     job->done.set_value(1);
   });
@@ -47,8 +47,9 @@ void DataflowPort::writeValue(SharedPtr<DataflowValue> value,const SharedPtr<Ret
   if (policy==DoNotStoreValue) 
     return;
 
+  //latest value wins: a superseded value counts as consumed, otherwise its producer would wait forever
   if (policy!=StoreMultipleVolatileValues) 
-    values.clear();
+    clearValues();
 
   DataflowPortValue dataflow_port_stored_value;
   dataflow_port_stored_value.value=value;
@@ -102,6 +103,17 @@ DataflowPortValue* DataflowPort::previewValue()
   return &values.front();
 }
 
+//////////////////////////////////////////////////////////////////////////
+void DataflowPort::clearValues()
+{
+  for (auto& it : values)
+  {
+    if (auto return_receipt = it.return_receipt)
+      return_receipt->addSignature(this);
+  }
+  values.clear();
+}
+
 //////////////////////////////////////////////////////////////////////////
 bool DataflowPort::disconnect()
 {
@@ -126,7 +138,7 @@ bool DataflowPort::disconnect()
   this->outputs.clear();
 
   //also reset the internal value
-  this->values.clear();
+  clearValues();
   this->read_id=0;
   this->write_id=0;
   return true;
@@ -41,6 +41,8 @@ For support : support@visus.net
 
 #include <Visus/Db.h>
 #include <Visus/BlockQuery.h>
+#include <Visus/CriticalSection.h>
+#include <Visus/Time.h>
 
 namespace Visus {
 
@@ -59,6 +61,9 @@ public:
 
     Int64 rok=0,rfail=0;
     Int64 wok=0,wfail=0;
+
+    //blocks read by Dataset::executeBlockQuery: decoded bytes, and msec with at least one read in progress
+    Int64 rbytes=0, rmsec=0;
   };
 
   static const String DefaultChMod;
@@ -144,7 +149,7 @@ public:
     this->bWriting = mode == 'w';
   }
 
-  //endIO
+  //endIO (an access buffering the writes can still fail them here, they are counted in statistics.wfail)
   virtual void endIO() {
     VisusReleaseAssert(bReading || bWriting);
     this->bReading = false;
@@ -200,7 +205,7 @@ public:
   virtual void printStatistics() 
   {
     PrintInfo("type", typeid(*this).name(), "chmod", can_read ? "r" : "", can_write ? "w" : "", "bitsperblock", bitsperblock);
-    PrintInfo("rok", statistics.rok, "rfail", statistics.rfail);
+    PrintInfo("rok", statistics.rok, "rfail", statistics.rfail, "rbytes", statistics.rbytes, "rmsec", statistics.rmsec);
     PrintInfo("wok", statistics.wok, "wfail", statistics.wfail);
   }
 
@@ -240,11 +245,23 @@ public:
     query->setFailed();
   }
 
+  //beginReadBlock (see Dataset::executeBlockQuery)
+  void beginReadBlock();
+
+  //endReadBlock
+  void endReadBlock(Int64 nbytes);
+
 private:
 
   bool bReading = false;
   bool bWriting = false;
 
+#if !SWIG
+  CriticalSection read_block_lock;
+  int             num_read_blocks = 0; //in progress
+  Time            read_block_t1;
+#endif
+
 }; //end class
 
 } //namespace Visus
@@ -94,6 +94,9 @@ public:
   LogicSamples logic_samples;
   Future<Void> done;
 
+  //only the first samples (in hz order) are needed, the others can be left to zero (-1 means all; see coarse box queries)
+  Int64        num_needed_samples = -1;
+
   //constructor
   BlockQuery() {
   }
@@ -42,11 +42,13 @@ For support : support@visus.net
 #include <Visus/Db.h>
 #include <Visus/Query.h>
 #include <Visus/Frustum.h>
+#include <Visus/CriticalSection.h>
 
 namespace Visus {
 
 //predeclaration
 class IdxFilter;
+class IdxBoxQueryStream;
 class Dataset;
 class Access;
 
@@ -121,6 +123,11 @@ public:
   std::map<String, SharedPtr<BoxQuery> >  down_queries;
 #endif
 
+  //for remote idx (the open request streaming the samples of the next resolutions)
+#if !SWIG
+  SharedPtr<IdxBoxQueryStream> server_stream;
+#endif
+
   //internal use only
 #if !SWIG
   std::function<void(Array)> incrementalPublish;
@@ -231,6 +238,52 @@ public:
 };
 
 
+////////////////////////////////////////////////////////
+/*
+Cost of box queries for one access, learnt from past executions: for each end resolution
+a moving average of the bytes read by the access and of the msec it spent reading them.
+*/
+#if !SWIG
+class VISUS_DB_API BoxQueryCostModel
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(BoxQueryCostModel)
+
+  //constructor
+  BoxQueryCostModel() {
+  }
+
+  //hasHistory
+  bool hasHistory();
+
+  //addStep (a refinement step ending at resolution H)
+  void addStep(int H, double bytes, double msec);
+
+  //estimateMsec (uses the nearest level with some history, the finer one in case of ties; -1 if no history at all)
+  double estimateMsec(int H, double bytes);
+
+  //guessEndResolutions (getByteSize(H) is the size of the query up to resolution H)
+  //the first is the finest fitting in latency_budget msec, but never coarser than minh;
+  //each refinement fits in the budget too, and is at least step levels finer than the previous one
+  std::vector<int> guessEndResolutions(int minh, int endh, int step, double latency_budget, std::function<double(int)> getByteSize);
+
+private:
+
+  class Level
+  {
+  public:
+    double bytes = 0;
+    double msec = 0;
+    Int64  num = 0;
+  };
+
+  CriticalSection    lock;
+  std::vector<Level> levels;
+
+};
+#endif
+
 
 } //namespace Visus
 
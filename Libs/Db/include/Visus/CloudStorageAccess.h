@@ -43,12 +43,28 @@ For support : support@visus.net
 #include <Visus/Access.h>
 #include <Visus/CloudStorage.h>
 #include <Visus/NetService.h>
+#include <Visus/IdxFile.h>
+#include <Visus/CriticalSection.h>
+
+#include <atomic>
+#include <set>
 
 namespace Visus {
 
 class Dataset;
+class Encoder;
 
   ///////////////////////////////////////////////////////////////////////////////////////
+/*
+Two storage formats:
+  - one blob per block (default), named by <filename_template>
+  - packed=true: the IDX v6 binary files of an IdxDataset stored as-is in the bucket. 
+    The header table of each file is fetched once with a range request and cached, then
+    blocks are read with range requests (adjacent blocks of the same file are coalesced).
+    Written blocks are kept in memory and each file is uploaded (multipart if big) as soon as all its blocks
+    have been written, when the pending bytes exceed max_pending_size, or in endIO.
+    An upload failing in endIO is reported as failed writes (see Access::statistics.wfail)
+*/
 class VISUS_DB_API CloudStorageAccess : public Access
 {
 public:
@@ -70,14 +86,53 @@ public:
   //writeBlock
   virtual  void writeBlock(SharedPtr<BlockQuery> query) override;
 
+  //acquireWriteLock (object storage has no locks, a single writer is assumed)
+  virtual void acquireWriteLock(SharedPtr<BlockQuery> query) override {
+  }
+
+  //releaseWriteLock
+  virtual void releaseWriteLock(SharedPtr<BlockQuery> query) override {
+  }
+
+  //endIO
+  virtual void endIO() override {
+    flushBatch(); //packed range requests are grouped until here
+    flushWrites();
+    Access::endIO();
+  }
+
   //printStatistics
   virtual void printStatistics() override {
     PrintInfo(name,"hostname",url.getHostname(),"port",url.getPort(),"compression",compression, "url",url);
+    if (packed)
+      PrintInfo("packed","header_requests",num_header_requests.load(),"range_requests",num_range_requests.load(),"uploads",num_uploads.load(),"failed_uploads",num_failed_uploads.load());
     Access::printStatistics();
   }
 
+  //getNumHeaderRequests
+  Int64 getNumHeaderRequests() const {
+    return num_header_requests;
+  }
+
+  //getNumRangeRequests
+  Int64 getNumRangeRequests() const {
+    return num_range_requests;
+  }
+
+  //getNumUploads
+  Int64 getNumUploads() const {
+    return num_uploads;
+  }
+
+  //getNumFailedUploads
+  Int64 getNumFailedUploads() const {
+    return num_failed_uploads;
+  }
+
 private:
 
+  typedef std::vector< SharedPtr<BlockQuery> > Batch;
+
   StringTree               config;
   Url                      url;
   String                   compression;
@@ -88,6 +143,59 @@ private:
   SharedPtr<CloudStorage> cloud_storage;
   String                  filename_template;
 
+  //packed IDX v6 files
+  bool                    packed = false;
+  IdxFile                 idxfile;
+  String                  time_template;
+  Int64                   max_gap = 0;
+  Int64                   max_request_size = 0;
+  int                     max_batch_size = 0;
+  Batch                   batch;
+
+  CriticalSection                                        lock;
+  std::map<String, Future< SharedPtr<HeapMemory> > >     headers;
+  std::map<std::pair<HeapMemory*, String>, SharedPtr<Encoder> > dictionary_encoders;
+
+  struct PendingBlock
+  {
+    SharedPtr<HeapMemory> encoded;
+    String                compression;
+    String                layout;
+  };
+
+  //filename -> block header index -> encoded block
+  std::map<String, std::map<int, PendingBlock> > pending_writes;
+  Int64                                          pending_size = 0;
+  Int64                                          max_pending_size = 0;
+
+  std::atomic<Int64>      num_header_requests;
+  std::atomic<Int64>      num_range_requests;
+  std::atomic<Int64>      num_uploads;
+  std::atomic<Int64>      num_failed_uploads;
+
+  //flushBatch
+  void flushBatch();
+
+  //getHeaders
+  Future< SharedPtr<HeapMemory> > getHeaders(String filename);
+
+  //readPackedBlocks
+  void readPackedBlocks(String filename, SharedPtr<HeapMemory> headers, Batch batch);
+
+  //isMissingFile (only a confirmed 404 is cached as null headers)
+  bool isMissingFile(String filename);
+
+  //flushWrites (returns the files whose upload failed, all their blocks are counted in statistics.wfail)
+  std::set<String> flushWrites(std::set<String> filenames);
+
+  //flushWrites
+  std::set<String> flushWrites();
+
+  //getDictionaryEncoder
+  SharedPtr<Encoder> getDictionaryEncoder(const Field& field, String compression);
+
+  //decodePackedBlock
+  Array decodePackedBlock(const Field& field, String compression, PointNi dims, SharedPtr<HeapMemory> encoded);
 
 };
 
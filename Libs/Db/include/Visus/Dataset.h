@@ -396,6 +396,24 @@ public:
     return false;
   }
 
+  //reuseBoxQuery (copies the samples of a previous query overlapping a running one, reading only the newly exposed region; returns false if nothing was reused)
+  virtual bool reuseBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> query, SharedPtr<BoxQuery> prev) {
+    return false;
+  }
+
+  //getWriteCounter (number of blocks written by executeBlockQuery, including filter computations: query results kept from before a change are stale)
+  Int64 getWriteCounter() const {
+    return write_counter;
+  }
+
+  //executeBoxQueries (executes all the queries up to their end resolution, returns false if any of them failed)
+  virtual bool executeBoxQueries(SharedPtr<Access> access, std::vector< SharedPtr<BoxQuery> > queries) {
+    bool bOk = true;
+    for (auto query : queries)
+      bOk = executeBoxQuery(access, query) && bOk;
+    return bOk;
+  }
+
   //mergeBoxQueryWithBlockQuery
   virtual bool mergeBoxQueryWithBlockQuery(SharedPtr<BoxQuery> query, SharedPtr<BlockQuery> block_query){
     return false;
@@ -460,6 +478,10 @@ protected:
   int                     kdquery_mode = KdQueryMode::NotSpecified;
   bool                    bServerMode = false;
   int                     default_bitsperblock = 0;
+
+#if !SWIG
+  std::atomic<Int64>      write_counter{ 0 };
+#endif
 };
 
 ////////////////////////////////////////////////////////////////
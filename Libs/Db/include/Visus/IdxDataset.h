@@ -43,6 +43,9 @@ For support : support@visus.net
 #include <Visus/Dataset.h>
 #include <Visus/IdxFile.h>
 #include <Visus/IdxHzOrder.h>
+#include <Visus/CriticalSection.h>
+
+#include <atomic>
 
 namespace Visus {
 
@@ -51,6 +54,8 @@ class IdxBoxQueryHzAddressConversion;
 class IdxPointQueryHzAddressConversion;
 #endif
 
+class NetService;
+
 
   //////////////////////////////////////////////////////////////////////
 class VISUS_DB_API IdxDataset : public Dataset
@@ -98,12 +103,21 @@ public:
   //executeBoxQuery
   virtual bool executeBoxQuery(SharedPtr<Access> access,SharedPtr<BoxQuery> query) override;
 
+  //reuseBoxQuery (after it, executeBoxQuery reads only the levels <prev> did not have)
+  virtual bool reuseBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> query, SharedPtr<BoxQuery> prev) override;
+
+  //executeBoxQueries (each needed block is read, or read-modified-written, once for all the queries)
+  virtual bool executeBoxQueries(SharedPtr<Access> access, std::vector< SharedPtr<BoxQuery> > queries) override;
+
   //mergeBoxQueryWithBlockQuery
   virtual bool mergeBoxQueryWithBlockQuery(SharedPtr<BoxQuery> query,SharedPtr<BlockQuery> block_query) override;
 
   //createBoxQueryRequest
   virtual NetRequest createBoxQueryRequest(SharedPtr<BoxQuery> query) override;
 
+  //executeBoxQueryOnServer
+  virtual bool executeBoxQueryOnServer(SharedPtr<BoxQuery> query) override;
+
   //createEquivalentBoxQuery
   SharedPtr<BoxQuery> createEquivalentBoxQuery(int mode, SharedPtr<BlockQuery> block_query);
 
@@ -129,16 +143,21 @@ public:
   //compressDataset
   void compressDataset(std::vector<String> compression, Array data=Array());
 
+  //trainCompressionDictionary (train a dictionary per field on a sample of stored blocks, and save it in the idx file)
+  //blocks encoded with a previous dictionary are re-encoded with the new one
+  bool trainCompressionDictionary(String compression, int max_blocks = 1024, Int64 max_size = 110 * 1024);
+
 public:
 
   //createFilter
   SharedPtr<IdxFilter> createFilter(const Field& field);
 
-  //computeFilter
-  bool computeFilter(SharedPtr<IdxFilter> filter, double time, Field field, SharedPtr<Access> access, PointNi SlidingWindow, bool bVerbose=false) ;
+  //computeFilter (single pass over the data, in windows of SlidingWindow samples, restartable if checkpoint is not empty)
+  //NOTE: each SlidingWindow[D] is rounded up to a power of 2 (minimum 2) to keep the filter alignment
+  bool computeFilter(SharedPtr<IdxFilter> filter, double time, Field field, SharedPtr<Access> access, PointNi SlidingWindow, bool bVerbose=false, String checkpoint="") ;
 
-  //computeFilter
-  void computeFilter(const Field& field, int window_size, bool bVerbose = false);
+  //computeFilter (window_size is rounded up to a power of 2; if bCheckpoint, local datasets save the progress in <idx>.<field>.<time>.filter)
+  void computeFilter(const Field& field, int window_size, bool bVerbose = false, bool bCheckpoint = false);
 
 public:
 
@@ -157,9 +176,19 @@ private:
   // So use only when stricly necessary! 
   SharedPtr<IdxPointQueryHzAddressConversion> hzaddress_conversion_pointquery;
 
+  //does the server stream box queries (-1 means not known yet)
+  std::atomic<int> server_box_query_streaming{ -1 };
+
+  //shared by all the streamed box queries of the dataset
+  CriticalSection       server_stream_lock;
+  SharedPtr<NetService> server_stream_netservice;
+
   //getLevelSamples
   LogicSamples getLevelSamples(int H);
 
+  //getBoxQueryBlocks (blocks to read to go from the current to the end resolution of the query)
+  std::vector<BigInt> getBoxQueryBlocks(SharedPtr<BoxQuery> query, int bitsperblock);
+
   //setIdxFile
   void setIdxFile(IdxFile value);
 
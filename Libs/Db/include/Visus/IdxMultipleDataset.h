@@ -116,6 +116,21 @@ public:
   //executeBoxQuery
   virtual bool executeBoxQuery(SharedPtr<Access> ACCESS,SharedPtr<BoxQuery> QUERY) override;
 
+  //executeBoxQueryOnServer (no streaming, the output levels are computed from the children datasets and cannot be merged level by level)
+  virtual bool executeBoxQueryOnServer(SharedPtr<BoxQuery> QUERY) override {
+    return Dataset::executeBoxQueryOnServer(QUERY);
+  }
+
+  //reuseBoxQuery (not supported, the output is computed from the children datasets)
+  virtual bool reuseBoxQuery(SharedPtr<Access> ACCESS, SharedPtr<BoxQuery> QUERY, SharedPtr<BoxQuery> PREV) override {
+    return false;
+  }
+
+  //executeBoxQueries (queries are computed from the children datasets, one by one)
+  virtual bool executeBoxQueries(SharedPtr<Access> ACCESS, std::vector< SharedPtr<BoxQuery> > QUERIES) override {
+    return Dataset::executeBoxQueries(ACCESS, QUERIES);
+  }
+
 public:
 
   //getInputName
@@ -75,9 +75,13 @@ public:
 private:
 
   class Datasets;
+  class Metrics;
 
   SharedPtr<Datasets>  m_datasets;
 
+  //always on, see action=metrics
+  SharedPtr<Metrics>   metrics;
+
   //for dynamic mode
   bool                   dynamic = false;
   RWLock                 rw_lock;
@@ -100,6 +104,7 @@ private:
   NetResponse handleBlockQuery       (const NetRequest& request);
   NetResponse handleBoxQuery         (const NetRequest& request);
   NetResponse handlePointQuery       (const NetRequest& request);
+  NetResponse handleMetrics          (const NetRequest& request);
 
 };
 
@@ -42,6 +42,9 @@ For support : support@visus.net
 #include <Visus/Db.h>
 #include <Visus/Access.h>
 #include <Visus/NetService.h>
+#include <Visus/CriticalSection.h>
+
+#include <atomic>
 
 namespace Visus {
 
@@ -84,9 +87,28 @@ public:
   //printStatistics
   virtual void printStatistics() override {
     PrintInfo(name, "hostname", url.getHostname(), "port", url.getPort(), "compression", compression, "url", url.toString());
+    PrintInfo("streaming", streaming, "adaptive", adaptive, "num_queries_per_request", getNumQueriesPerRequest(), 
+      "rtt msec", (int)getRoundTripTime(), "bandwidth", StringUtils::getStringFromByteSize((Int64)getBandwidth()) + "/sec");
     Access::printStatistics();
   }
 
+  //getNumQueriesPerRequest (the current one, it changes with adaptive batching)
+  int getNumQueriesPerRequest() const {
+    return num_queries_per_request;
+  }
+
+  //getRoundTripTime (msec, estimated)
+  double getRoundTripTime() const {
+    ScopedLock lock(link_lock);
+    return link.rtt_msec;
+  }
+
+  //getBandwidth (bytes/sec of a single request, estimated)
+  double getBandwidth() const {
+    ScopedLock lock(link_lock);
+    return link.bandwidth;
+  }
+
 private:
 
   typedef std::vector< SharedPtr<BlockQuery> > Batch;
@@ -95,15 +117,43 @@ private:
   Url                    url;
   String                 compression;
   SharedPtr<NetService>  netservice;
+  int                    nconnections = 1;
 
   Batch batch;
 
   //num_queries_per_request
-  int num_queries_per_request=1;
+  std::atomic<int> num_queries_per_request;
+
+  //streaming (the server sends each block as soon as it's encoded)
+  bool streaming = false;
+
+  //adaptive (num_queries_per_request follows the observed round trip time and bandwidth, off by default if num_queries_per_request is in the config)
+  bool   adaptive = false;
+  int    min_queries_per_request = 1;
+  int    max_queries_per_request = 64;
+  double transfer_rtt_ratio = 2.0;
+
+  //estimated link, exponential moving averages 
+  struct
+  {
+    double rtt_msec = 0;
+    double bandwidth = 0;
+    double block_size = 0;
+  }
+  link;
+
+  mutable CriticalSection link_lock;
+  std::atomic<int>        num_running;
 
   //flushBatch
   void flushBatch();
 
+  //readBlockFromResponse
+  void readBlockFromResponse(SharedPtr<BlockQuery> query, NetResponse response);
+
+  //updateLink
+  void updateLink(double rtt_msec, double transfer_msec, Int64 nbytes, int nblocks);
+
 };
 
 } //namespace Visus
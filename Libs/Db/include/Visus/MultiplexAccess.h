@@ -56,11 +56,36 @@ public:
 
   VISUS_NON_COPYABLE_CLASS(MultiplexAccess)
 
+  //per-child counters
+  class Statistics
+  {
+  public:
+    Int64 num_reads = 0;  //reads dispatched to the child
+    Int64 num_hits = 0;
+    Int64 num_misses = 0;
+    Int64 num_writes = 0; //write-back (i.e. caching) of blocks found in lower children
+    Int64 read_msec = 0;  //total time spent waiting for reads
+
+    //getHitRate
+    double getHitRate() const {
+      return num_reads ? num_hits / (double)num_reads : 0.0;
+    }
+
+    //getAverageReadMsec
+    double getAverageReadMsec() const {
+      return num_reads ? read_msec / (double)num_reads : 0.0;
+    }
+  };
+
   Dataset* dataset = nullptr;
 
   //all the dw_access
   std::vector< SharedPtr<Access> > dw_access;
 
+  //if enabled, when a child hit rate is low (and the next child's is not) the read is dispatched to the next child too
+  bool   speculative = false;
+  double speculative_hit_rate = 0.5;
+
   //constructor
   MultiplexAccess(Dataset* dataset, StringTree config = StringTree());
 
@@ -70,10 +95,11 @@ public:
   //addChild
   void addChild(SharedPtr<Access> child);
 
+  //getStatistics
+  Statistics getStatistics(int index) const;
+
   //readBlock 
-  virtual void readBlock(SharedPtr<BlockQuery> up_query) override {
-    scheduleOp('r', 0, up_query);
-  }
+  virtual void readBlock(SharedPtr<BlockQuery> up_query) override;
 
   //writeBlock
   virtual void writeBlock(SharedPtr<BlockQuery> up_query) override {
@@ -87,32 +113,25 @@ public:
 
 private:
 
-  class Pending
-  {
-  public:
-    int index = 0;
-    SharedPtr<BlockQuery> up_query;
-    SharedPtr<BlockQuery> dw_query;
-  };
-
-  std::vector<Pending> pendings;
-  CriticalSection      lock;
-  Semaphore            something_happened;
-  bool                 bExit = false;
+  class Tier;
+  class Request;
 
-  SharedPtr<std::thread> thread;
+  //one per dw_access, each with its own queue and thread
+  std::vector< SharedPtr<Tier> > tiers;
 
   //isGoodIndex
   bool isGoodIndex(int index) const {
     return index >= 0 && index < (int)dw_access.size();
   }
 
-  //scheduleOp
-  void scheduleOp(int mode, int index, SharedPtr<BlockQuery> up_query);
-  
-  //runInBackground
-  void runInBackground();
+  //dispatchRead
+  void dispatchRead(SharedPtr<Request> request);
+
+  //onReadDone
+  void onReadDone(SharedPtr<Request> request, int index, SharedPtr<BlockQuery> dw_query);
 
+  //writeBack (i.e. cache the block read by dw_query)
+  void writeBack(int index, SharedPtr<BlockQuery> dw_query);
 
 };
 
@@ -72,6 +72,10 @@ public:
     //generateBlock
     virtual void generateBlock(SharedPtr<BlockQuery> block_query) = 0;
 
+    //printStatistics
+    virtual void printStatistics() {
+    }
+
   };
 
   //__________________________________________________
@@ -166,6 +170,8 @@ public:
   //printStatistics
   virtual void printStatistics() override {
     PrintInfo("OnDemandAccess::printStatistics....");
+    if (pimpl)
+      pimpl->printStatistics();
   }
 
 private:
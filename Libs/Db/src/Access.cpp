@@ -39,6 +39,25 @@ For support : support@visus.net
 #include <Visus/Access.h>
 
 namespace Visus {
+
 const String Access::DefaultChMod = "rw";
+
+///////////////////////////////////////////////////////////////////////////////////////
+void Access::beginReadBlock()
+{
+  ScopedLock lock(read_block_lock);
+  if (!num_read_blocks++)
+    read_block_t1 = Time::now();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void Access::endReadBlock(Int64 nbytes)
+{
+  ScopedLock lock(read_block_lock);
+  statistics.rbytes += nbytes;
+  if (num_read_blocks > 0 && !--num_read_blocks)
+    statistics.rmsec += read_block_t1.elapsedMsec();
+}
+
 } //namespace Visus
 
@@ -83,5 +83,67 @@ namespace Visus {
       //note: start_resolution/end_resolution do not change
       return true;
     }
+
+    ///////////////////////////////////////////////////////////////////////////
+    bool BoxQueryCostModel::hasHistory()
+    {
+      ScopedLock lock(this->lock);
+      for (auto& it : levels)
+        if (it.num) return true;
+      return false;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    void BoxQueryCostModel::addStep(int H, double bytes, double msec)
+    {
+      if (H < 0 || bytes <= 0 || msec < 0)
+        return;
+
+      const double alpha = 0.3;
+
+      ScopedLock lock(this->lock);
+      if (H >= (int)levels.size())
+        levels.resize(H + 1);
+
+      auto& level = levels[H];
+      level.bytes = level.num ? (1 - alpha) * level.bytes + alpha * bytes : bytes;
+      level.msec  = level.num ? (1 - alpha) * level.msec  + alpha * msec  : msec;
+      level.num++;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    double BoxQueryCostModel::estimateMsec(int H, double bytes)
+    {
+      ScopedLock lock(this->lock);
+      for (int D = 0; H - D >= 0 || H + D < (int)levels.size(); D++)
+      {
+        for (auto K : { H + D, H - D })
+        {
+          if (K >= 0 && K < (int)levels.size() && levels[K].num)
+            return std::max(0.0, bytes) * levels[K].msec / levels[K].bytes;
+        }
+      }
+      return -1;
+    }
+
+    ///////////////////////////////////////////////////////////////////////////
+    std::vector<int> BoxQueryCostModel::guessEndResolutions(int minh, int endh, int step, double latency_budget, std::function<double(int)> getByteSize)
+    {
+      minh = std::min(minh, endh);
+      step = std::max(1, step);
+
+      std::vector<int> ret;
+      double prev_bytes = 0;
+      while (ret.empty() || ret.back() < endh)
+      {
+        int H = ret.empty() ? minh : std::min(endh, ret.back() + step);
+        while (H < endh && estimateMsec(H + 1, getByteSize(H + 1) - prev_bytes) <= latency_budget)
+          H++;
+
+        ret.push_back(H);
+        prev_bytes = getByteSize(H);
+      }
+      return ret;
+    }
 } //namespace Visus
 
@@ -38,7 +38,12 @@ For support : support@visus.net
 
 #include <Visus/CloudStorageAccess.h>
 #include <Visus/Dataset.h>
+#include <Visus/IdxDataset.h>
 #include <Visus/Encoder.h>
+#include <Visus/ByteOrder.h>
+#include <Visus/Trace.h>
+
+#include "IdxFileV6.hxx"
 
 namespace Visus {
 
@@ -64,6 +69,44 @@ CloudStorageAccess::CloudStorageAccess(Dataset* dataset,StringTree config_)
     this->netservice = std::make_shared<NetService>(nconnections);
 
   this->cloud_storage=CloudStorage::createInstance(url); 
+
+  if (cloud_storage)
+  {
+    cloud_storage->setMultipartSize(StringUtils::getByteSizeFromString(config.readString("multipart_size", "8mb")));
+    cloud_storage->setMaxRetries(config.readInt("max_retries", 5));
+  }
+
+  this->num_header_requests = 0;
+  this->num_range_requests = 0;
+  this->num_uploads = 0;
+  this->num_failed_uploads = 0;
+
+  if (config.readBool("packed", false))
+  {
+    auto idx = dynamic_cast<IdxDataset*>(dataset);
+    if (!idx || idx->idxfile.version < 6)
+      ThrowException("CloudStorageAccess packed=true needs an IdxDataset in IDX version 6 format");
+
+    this->packed = true;
+    this->idxfile = idx->idxfile;
+    this->bitsperblock = idxfile.bitsperblock;
+    this->max_gap = StringUtils::getByteSizeFromString(config.readString("max_gap", "64kb")); //reading a small hole is cheaper than another request
+    this->max_request_size = StringUtils::getByteSizeFromString(config.readString("max_request_size", "8mb"));
+    this->max_batch_size = config.readInt("max_batch_size", 256);
+    this->max_pending_size = StringUtils::getByteSizeFromString(config.readString("max_pending_size", "256mb")); //written blocks waiting for the upload
+
+    //same aliases as IdxDiskAccess, "./" means the directory of the idx file inside the bucket
+    auto resolveAlias = [&](String value) {
+      String dir = url.getPath();
+      dir = dir.substr(0, dir.find_last_of('/') == String::npos ? 0 : dir.find_last_of('/'));
+      if (StringUtils::startsWith(value, "./"))
+        value = StringUtils::replaceFirst(value, ".", dir);
+      return StringUtils::replaceAll(value, "$(CurrentFileDirectory)", dir);
+    };
+
+    this->filename_template = resolveAlias(idxfile.filename_template);
+    this->time_template     = resolveAlias(idxfile.time_template);
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////
@@ -74,6 +117,9 @@ CloudStorageAccess::~CloudStorageAccess()
 ///////////////////////////////////////////////////////////////////////////////////////
 String CloudStorageAccess::getFilename(Field field, double time, BigInt blockid) const
 {
+  if (packed)
+    return GetFilenameV56(idxfile, time_template, filename_template, field, time, blockid);
+
   String fieldname = StringUtils::removeSpaces(field.name);
   String ret = filename_template;
 
@@ -97,8 +143,43 @@ String CloudStorageAccess::getFilename(Field field, double time, BigInt blockid)
 ///////////////////////////////////////////////////////////////////////////////////////
 void CloudStorageAccess::readBlock(SharedPtr<BlockQuery> query)
 {
+  VisusTrace("access", "CloudStorageAccess::readBlock");
+
   VisusAssert((int)query->getNumberOfSamples().innerProduct()==(1<<bitsperblock));
 
+  if (packed)
+  {
+    //written in this session but not uploaded yet
+    auto filename = Access::getFilename(query);
+    auto it = pending_writes.find(filename);
+    if (it != pending_writes.end())
+    {
+      auto jt = it->second.find(GetBlockHeaderIndexV6(idxfile, query->field, query->blockid));
+      if (jt != it->second.end())
+      {
+        auto decoded = decodePackedBlock(query->field, jt->second.compression, query->getNumberOfSamples(), jt->second.encoded);
+        if (!decoded)
+          return readFailed(query);
+
+        decoded.layout = jt->second.layout;
+        query->buffer = decoded;
+        return readOk(query);
+      }
+    }
+
+    //same as ModVisusAccess: queries sharing the same aborted go together
+    if (!batch.empty() && !(query->aborted == batch[0]->aborted))
+      flushBatch();
+
+    batch.push_back(query);
+
+    //when writing each block is read and waited (read-merge-write), cannot group
+    if (batch.size() >= max_batch_size || isWriting())
+      flushBatch();
+
+    return;
+  }
+
   cloud_storage->getBlob(netservice, Access::getFilename(query), query->aborted).when_ready([this, query](CloudStorageBlob blob) {
 
     blob.metadata.setValue("visus-compression", this->compression);
@@ -122,10 +203,418 @@ void CloudStorageAccess::readBlock(SharedPtr<BlockQuery> query)
 
 }
 
+///////////////////////////////////////////////////////////////////////////////////////
+void CloudStorageAccess::flushBatch()
+{
+  if (batch.empty())
+    return;
+
+  Batch batch;
+  std::swap(batch, this->batch);
+
+  std::map<String, Batch> files;
+  for (auto query : batch)
+    files[Access::getFilename(query)].push_back(query);
+
+  for (auto it : files)
+  {
+    auto filename = it.first;
+    auto queries  = it.second;
+    getHeaders(filename).when_ready([this, filename, queries](SharedPtr<HeapMemory> headers) {
+      readPackedBlocks(filename, headers, queries);
+    });
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+Future< SharedPtr<HeapMemory> > CloudStorageAccess::getHeaders(String filename)
+{
+  Promise< SharedPtr<HeapMemory> > promise;
+  {
+    ScopedLock lock(this->lock);
+    auto it = headers.find(filename);
+    if (it != headers.end())
+      return it->second;
+
+    //missing files are cached too (an idx dataset is usually sparse), failed requests are not (see below)
+    headers[filename] = promise.get_future();
+  }
+
+  ++num_header_requests;
+
+  //not using the query aborted, the headers are shared by all the queries
+  Int64 nbytes = GetHeadersSizeV6(idxfile);
+  auto ret = promise.get_future();
+  cloud_storage->getBlob(netservice, filename, Aborted(), 0, nbytes).when_ready([this, filename, ret, nbytes](CloudStorageBlob blob) {
+
+    SharedPtr<HeapMemory> headers;
+    if (blob.valid() && blob.body->c_size() >= nbytes)
+    {
+      headers = std::make_shared<HeapMemory>();
+      headers->resize(nbytes, __FILE__, __LINE__);
+      memcpy(headers->c_ptr(), blob.body->c_ptr(), (size_t)nbytes);
+
+      // network to host order
+      Uint32* ptr = (Uint32*)(headers->c_ptr());
+      for (int I = 0, Tot = (int)(nbytes / sizeof(Uint32)); I < Tot; I++)
+        ptr[I] = ByteOrder::fromNetworkByteOrder(ptr[I]);
+    }
+    //a transient error (e.g. 5xx, timeout) must not hide an existing file forever, the next query will retry
+    else if (!blob.notFound())
+    {
+      ScopedLock lock(this->lock);
+      auto it = this->headers.find(filename);
+      if (it != this->headers.end() && it->second.get_promise() == ret.get_promise())
+        this->headers.erase(it);
+    }
+
+    ret.get_promise()->set_value(headers);
+  });
+
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+void CloudStorageAccess::readPackedBlocks(String filename, SharedPtr<HeapMemory> headers, Batch batch)
+{
+  if (!headers)
+  {
+    for (auto query : batch)
+      readFailed(query);
+    return;
+  }
+
+  auto block_headers = (const IdxBlockHeaderV6*)(headers->c_ptr() + sizeof(IdxFileHeaderV6));
+
+  struct Item
+  {
+    SharedPtr<BlockQuery> query;
+    IdxBlockHeaderV6      header;
+  };
+
+  std::vector<Item> items;
+  for (auto query : batch)
+  {
+    auto header = block_headers[GetBlockHeaderIndexV6(idxfile, query->field, query->blockid)];
+    if (query->aborted() || !header.getOffset() || !header.getSize())
+      readFailed(query);
+    else
+      items.push_back(Item({ query, header }));
+  }
+
+  std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+    return a.header.getOffset() < b.header.getOffset();
+  });
+
+  //coalesce blocks stored close to each other into one range request
+  for (int A = 0, B; A < (int)items.size(); A = B)
+  {
+    Int64 begin = items[A].header.getOffset();
+    Int64 end   = begin + items[A].header.getSize();
+
+    for (B = A + 1; B < (int)items.size(); B++)
+    {
+      Int64 offset = items[B].header.getOffset();
+      Int64 next_end = std::max(end, offset + items[B].header.getSize());
+      if (offset - end > max_gap || next_end - begin > max_request_size)
+        break;
+      end = next_end;
+    }
+
+    ++num_range_requests;
+
+    std::vector<Item> range(items.begin() + A, items.begin() + B);
+    cloud_storage->getBlob(netservice, filename, range[0].query->aborted, begin, end - begin).when_ready([this, range, begin, end](CloudStorageBlob blob) {
+
+      //a server ignoring the Range header sends the whole file
+      Int64 shift = (blob.valid() && blob.body->c_size() != end - begin) ? begin : 0;
+      if (blob.valid() && blob.body->c_size() < shift + end - begin)
+        blob.body.reset();
+
+      for (auto item : range)
+      {
+        auto query = item.query;
+        if (query->aborted() || !blob.valid())
+        {
+          readFailed(query);
+          continue;
+        }
+
+        auto encoded = std::make_shared<HeapMemory>();
+        encoded->resize(item.header.getSize(), __FILE__, __LINE__);
+        memcpy(encoded->c_ptr(), blob.body->c_ptr() + shift + item.header.getOffset() - begin, (size_t)encoded->c_size());
+
+        auto decoded = decodePackedBlock(query->field, item.header.getCompression(), query->getNumberOfSamples(), encoded);
+        if (!decoded)
+        {
+          readFailed(query);
+          continue;
+        }
+
+        decoded.layout = item.header.getLayout();
+        VisusAssert(decoded.dims == query->getNumberOfSamples());
+        query->buffer = decoded;
+        readOk(query);
+      }
+    });
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+SharedPtr<Encoder> CloudStorageAccess::getDictionaryEncoder(const Field& field, String compression)
+{
+  //see IdxDiskAccess, loading the dictionary is expensive
+  ScopedLock lock(this->lock);
+  auto key = std::make_pair(field.compression_dictionary.get(), compression);
+  auto it = dictionary_encoders.find(key);
+  if (it != dictionary_encoders.end())
+    return it->second;
+
+  auto encoder = Encoders::getSingleton()->createEncoder(compression);
+  if (encoder)
+    encoder->setDictionary(field.compression_dictionary);
+  dictionary_encoders[key] = encoder;
+  return encoder;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+Array CloudStorageAccess::decodePackedBlock(const Field& field, String compression, PointNi dims, SharedPtr<HeapMemory> encoded)
+{
+  if (compression.empty() || !field.compression_dictionary)
+    return ArrayUtils::decodeArray(compression, dims, field.dtype, encoded);
+
+  auto decoder = getDictionaryEncoder(field, compression);
+  auto decoded = decoder ? decoder->decode(dims, field.dtype, encoded) : SharedPtr<HeapMemory>();
+  if (!decoded || decoded->c_size() != field.dtype.getByteSize(dims))
+    return Array();
+
+  return Array(dims, field.dtype, decoded);
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////
 void CloudStorageAccess::writeBlock(SharedPtr<BlockQuery> query)
 {
-  return query->setFailed();
+  VisusTrace("access", "CloudStorageAccess::writeBlock");
+
+  Int64 blockdim = query->field.dtype.getByteSize(((Int64)1) << bitsperblock);
+  if (!query->field.valid() || query->blockid < 0 || query->buffer.c_size() != blockdim)
+  {
+    VisusAssert(false);
+    return writeFailed(query);
+  }
+
+  //one blob per block
+  if (!packed)
+  {
+    auto decoded = query->buffer;
+    auto encoded = ArrayUtils::encodeArray(this->compression, decoded);
+    if (!encoded)
+      return writeFailed(query);
+
+    CloudStorageBlob blob(encoded);
+    blob.metadata.setValue("visus-compression", this->compression);
+    blob.metadata.setValue("visus-dtype", query->field.dtype.toString());
+    blob.metadata.setValue("visus-nsamples", query->getNumberOfSamples().toString());
+    blob.metadata.setValue("visus-layout", decoded.layout);
+
+    ++num_uploads;
+    cloud_storage->addBlob(netservice, blob, Access::getFilename(query), query->aborted).when_ready([this, query](bool bOk) {
+      if (!bOk) ++num_failed_uploads;
+      return bOk ? writeOk(query) : writeFailed(query);
+    });
+    return;
+  }
+
+  //packed: same encoding as IdxDiskAccess, the upload happens in endIO
+  PendingBlock block;
+  block.compression = query->field.default_compression;
+  block.layout = query->buffer.layout;
+  block.encoded = block.compression.empty() ? query->buffer.heap :
+    query->field.compression_dictionary ? getDictionaryEncoder(query->field, block.compression)->encode(query->buffer.dims, query->buffer.dtype, query->buffer.heap) :
+    ArrayUtils::encodeArray(block.compression, query->buffer);
+
+  if (!block.encoded)
+    return writeFailed(query);
+
+  auto filename = Access::getFilename(query);
+  auto& blocks = pending_writes[filename];
+  auto& pending = blocks[GetBlockHeaderIndexV6(idxfile, query->field, query->blockid)];
+  pending_size += block.encoded->c_size() - (pending.encoded ? pending.encoded->c_size() : 0);
+  pending = block;
+
+  //do not keep the whole dataset in memory
+  Int64 headers_size = GetHeadersSizeV6(idxfile);
+  bool bComplete = (Int64)blocks.size() == (Int64)((headers_size - sizeof(IdxFileHeaderV6)) / sizeof(IdxBlockHeaderV6));
+  auto failed = bComplete ? flushWrites({ filename }) : (pending_size >= max_pending_size ? flushWrites() : std::set<String>());
+  if (!failed.count(filename))
+    return writeOk(query);
+
+  //already counted in statistics.wfail by flushWrites, together with the other blocks of the file
+  query->setFailed("upload failed");
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+bool CloudStorageAccess::isMissingFile(String filename)
+{
+  ScopedLock lock(this->lock);
+  auto it = headers.find(filename);
+  return it != headers.end() && it->second.is_ready() && !it->second.get();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+std::set<String> CloudStorageAccess::flushWrites()
+{
+  std::set<String> filenames;
+  for (auto& it : pending_writes)
+    filenames.insert(it.first);
+  return flushWrites(filenames);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+std::set<String> CloudStorageAccess::flushWrites(std::set<String> filenames)
+{
+  std::map<String, std::map<int, PendingBlock> > pending_writes;
+  for (auto filename : filenames)
+  {
+    auto it = this->pending_writes.find(filename);
+    if (it == this->pending_writes.end())
+      continue;
+
+    for (auto& jt : it->second)
+      pending_size -= jt.second.encoded->c_size();
+
+    pending_writes[filename] = it->second;
+    this->pending_writes.erase(it);
+  }
+
+  Int64 headers_size = GetHeadersSizeV6(idxfile);
+
+  std::vector< std::pair<String, SharedPtr<HeapMemory> > > files;
+  std::vector< Future<bool> > uploads;
+  std::set<String> failed;
+  Int64 num_failed_blocks = 0;
+
+  for (auto& it : pending_writes)
+  {
+    String filename = it.first;
+    auto& blocks = it.second;
+
+    //objects cannot be modified in place: keep the blocks already stored in the existing object
+    auto existing = getHeaders(filename).get();
+
+    //only a confirmed 404 means a new file, uploading after a failed request would drop the stored blocks
+    if (!existing && !isMissingFile(filename))
+    {
+      PrintWarning("CloudStorageAccess cannot read the headers of", filename, "skipping its upload");
+      ++num_failed_uploads;
+      num_failed_blocks += blocks.size();
+      failed.insert(filename);
+      continue;
+    }
+
+    if (existing)
+    {
+      auto blob = cloud_storage->getBlob(netservice, filename).get();
+      if (!blob.valid())
+      {
+        PrintWarning("CloudStorageAccess cannot read existing", filename, "skipping its upload");
+        ++num_failed_uploads;
+        num_failed_blocks += blocks.size();
+        failed.insert(filename);
+        continue;
+      }
+
+      auto block_headers = (const IdxBlockHeaderV6*)(existing->c_ptr() + sizeof(IdxFileHeaderV6));
+      for (int I = 0, N = (int)((headers_size - sizeof(IdxFileHeaderV6)) / sizeof(IdxBlockHeaderV6)); I < N; I++)
+      {
+        const auto& header = block_headers[I];
+        if (!header.getOffset() || !header.getSize() || blocks.count(I) || header.getOffset() + header.getSize() > blob.body->c_size())
+          continue;
+
+        PendingBlock block;
+        block.compression = header.getCompression();
+        block.layout = header.getLayout();
+        block.encoded = std::make_shared<HeapMemory>();
+        block.encoded->resize(header.getSize(), __FILE__, __LINE__);
+        memcpy(block.encoded->c_ptr(), blob.body->c_ptr() + header.getOffset(), header.getSize());
+        blocks[I] = block;
+      }
+    }
+
+    //headers followed by the blocks in header order (i.e. hz order), nearby blocks can be read with one range request
+    Int64 total_size = headers_size;
+    for (auto& jt : blocks)
+      total_size += jt.second.encoded->c_size();
+
+    auto headers = std::make_shared<HeapMemory>();
+    headers->resize(headers_size, __FILE__, __LINE__);
+    headers->fill(0);
+
+    auto body = std::make_shared<HeapMemory>();
+    if (!body->resize(total_size, __FILE__, __LINE__))
+    {
+      PrintWarning("CloudStorageAccess cannot allocate", total_size, "bytes for", filename);
+      ++num_failed_uploads;
+      num_failed_blocks += blocks.size();
+      failed.insert(filename);
+      continue;
+    }
+
+    auto block_headers = (IdxBlockHeaderV6*)(headers->c_ptr() + sizeof(IdxFileHeaderV6));
+    Int64 offset = headers_size;
+    for (auto& jt : blocks)
+    {
+      auto& header = block_headers[jt.first];
+      header.setOffset(offset);
+      header.setSize((Int32)jt.second.encoded->c_size());
+      header.setCompression(jt.second.compression);
+      header.setLayout(jt.second.layout);
+      memcpy(body->c_ptr() + offset, jt.second.encoded->c_ptr(), (size_t)jt.second.encoded->c_size());
+      offset += jt.second.encoded->c_size();
+    }
+
+    // host to network order
+    Uint32* src = (Uint32*)headers->c_ptr();
+    Uint32* dst = (Uint32*)body->c_ptr();
+    for (int I = 0, Tot = (int)(headers_size / sizeof(Uint32)); I < Tot; I++)
+      dst[I] = ByteOrder::toNetworkByteOrder(src[I]);
+
+    //all files are uploaded concurrently
+    ++num_uploads;
+    files.push_back(std::make_pair(filename, headers));
+    uploads.push_back(cloud_storage->addBlob(netservice, CloudStorageBlob(body), filename));
+  }
+
+  for (int I = 0; I < (int)uploads.size(); I++)
+  {
+    String filename = files[I].first;
+    bool bOk = uploads[I].get();
+
+    if (!bOk)
+    {
+      PrintWarning("CloudStorageAccess failed to upload", filename);
+      ++num_failed_uploads;
+      num_failed_blocks += pending_writes[filename].size();
+      failed.insert(filename);
+    }
+
+    //what readers will see from now on
+    ScopedLock lock(this->lock);
+    if (bOk)
+    {
+      Promise< SharedPtr<HeapMemory> > promise;
+      promise.set_value(files[I].second);
+      headers[filename] = promise.get_future();
+    }
+    else
+    {
+      headers.erase(filename);
+    }
+  }
+
+  //the blocks have been acknowledged by writeBlock, the caller of endIO sees the failure here
+  statistics.wfail += num_failed_blocks;
+  return failed;
 }
 
 
@@ -362,11 +362,22 @@ void Dataset::executeBlockQuery(SharedPtr<Access> access,SharedPtr<BlockQuery> q
 
   if (mode == 'r')
   {
+    //the query is alive while its callbacks run
+    //the access is not: pending queries must not keep it alive (its destructor is what fails them)
+    access->beginReadBlock();
+    auto QUERY = query.get();
+    std::weak_ptr<Access> ACCESS = access;
+    query->done.when_ready([ACCESS, QUERY](Void) {
+      if (auto access = ACCESS.lock())
+        access->endReadBlock(QUERY->ok() ? QUERY->buffer.c_size() : 0);
+    });
+
     access->readBlock(query);
     BlockQuery::readBlockEvent();
   }
   else
   {
+    ++write_counter;
     access->writeBlock(query);
     BlockQuery::writeBlockEvent();
   }
@@ -40,6 +40,7 @@ For support : support@visus.net
 #include <Visus/Dataset.h>
 #include <Visus/File.h>
 #include <Visus/Encoder.h>
+#include <Visus/Trace.h>
 
 #include <cctype>
 
@@ -91,6 +92,8 @@ void DiskAccess::releaseWriteLock(SharedPtr<BlockQuery> query)
 ////////////////////////////////////////////////////////////////////
 void DiskAccess::readBlock(SharedPtr<BlockQuery> query)
 {
+  VisusTrace("access", "DiskAccess::readBlock");
+
   Int64  blockdim  = query->field.dtype.getByteSize(getSamplesPerBlock());
   String filename  = Access::getFilename(query);
 
@@ -127,6 +130,8 @@ void DiskAccess::readBlock(SharedPtr<BlockQuery> query)
 ////////////////////////////////////////////////////////////////////
 void DiskAccess::writeBlock(SharedPtr<BlockQuery> query)
 {
+  VisusTrace("access", "DiskAccess::writeBlock");
+
   Int64  blockdim        = query->field.dtype.getByteSize(getSamplesPerBlock());
   String filename        = Access::getFilename(query);
 
@@ -44,6 +44,12 @@ For support : support@visus.net
 #include <Visus/IdxMultipleDataset.h>
 #include <Visus/OnDemandAccess.h>
 #include <Visus/ModVisusAccess.h>
+#include <Visus/CloudStorageAccess.h>
+#include <Visus/Encoder.h>
+#include <Visus/NetService.h>
+#include <Visus/Scheduler.h>
+#include <Visus/Thread.h>
+#include <Visus/Trace.h>
 
 #ifdef WIN32
 #pragma warning(disable:4996) // 'sprintf': This function or variable may be unsafe
@@ -153,6 +159,96 @@ public:
 
 }; 
 
+////////////////////////////////////////////////////////
+class IdxBoxQueryStream
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(IdxBoxQueryStream)
+
+  //constructor (the request stays open, frames are queued as soon as they arrive)
+  //the transfer stops as soon as the query is aborted or the stream is dropped (e.g. the query moved on)
+  IdxBoxQueryStream(SharedPtr<NetService> netservice, NetRequest request) : frames(std::make_shared<Frames>()), aborted(request.aborted)
+  {
+    auto frames = this->frames;
+    auto parser = std::make_shared<NetResponseFrameParser>([frames](NetResponse frame) {
+      frames->push(frame, false);
+    });
+
+    auto aborted = this->aborted;
+    auto cancel = this->cancel;
+    request.aborted = cancel;
+    request.body_received = [parser, aborted, cancel](const Uint8* data, Int64 size) mutable {
+      if (aborted())
+        cancel.setTrue();
+      else
+        parser->push(data, size);
+    };
+
+    NetService::push(netservice, request).when_ready([frames](NetResponse response) {
+      if (response.isSuccessful())
+        response = NetResponse(HttpStatus::STATUS_MALFORMED, "stream ended");
+      frames->push(response, true);
+    });
+  }
+
+  //destructor
+  ~IdxBoxQueryStream() {
+    cancel.setTrue();
+  }
+
+  //nextFrame (blocking)
+  NetResponse nextFrame() 
+  {
+    Scheduler::BlockingScope blocking;
+    std::unique_lock<CriticalSection> lock(frames->lock);
+
+    //woken up by each frame, the abort flag cannot notify anybody so it's checked from time to time
+    while (frames->queue.empty())
+    {
+      if (aborted())
+      {
+        cancel.setTrue();
+        return NetResponse(HttpStatus::STATUS_SERVICE_UNAVAILABLE, "query aborted");
+      }
+      frames->arrived.wait_for(lock, std::chrono::milliseconds(100));
+    }
+
+    auto ret = frames->queue.front();
+
+    //keep the end of the stream for the next calls
+    if (frames->queue.size() > 1 || !frames->closed)
+      frames->queue.pop_front();
+    return ret;
+  }
+
+private:
+
+  struct Frames
+  {
+    CriticalSection         lock;
+    std::condition_variable arrived;
+    std::deque<NetResponse> queue;
+    bool                    closed = false;
+
+    //push
+    void push(NetResponse frame, bool bClose) {
+      {
+        ScopedLock lock(this->lock);
+        if (closed) return;
+        queue.push_back(frame);
+        closed = bClose;
+      }
+      arrived.notify_all();
+    }
+  };
+
+  SharedPtr<Frames>     frames;
+  Aborted               aborted;
+  Aborted               cancel;
+
+};
+
 ////////////////////////////////////////////////////////
 class IdxBoxQueryHzAddressConversion 
 {
@@ -780,6 +876,89 @@ void IdxDataset::compressDataset(std::vector<String> compression, Array data)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////
+bool IdxDataset::trainCompressionDictionary(String compression, int max_blocks, Int64 max_size)
+{
+  if (idxfile.version != 6)
+    ThrowException("unsupported");
+
+  auto access = std::make_shared<IdxDiskAccess>(this, idxfile);
+  access->disableAsync();
+  access->disableWriteLock();
+
+  BigInt total_blocks = getTotalNumberOfBlocks();
+  BigInt step = std::max((BigInt)1, total_blocks / std::max(1, max_blocks));
+
+  bool bOk = true;
+  auto old_fields = idxfile.fields;
+  access->beginRead();
+  for (auto& field : idxfile.fields)
+  {
+    //blocks evenly distributed in hz order, so that all levels are represented
+    //(read with the current dictionary, if any, since blocks could have been encoded with it)
+    std::vector< SharedPtr<HeapMemory> > samples;
+    for (BigInt blockid = 0; blockid < total_blocks && (int)samples.size() < max_blocks; blockid += step)
+    {
+      auto read_block = createBlockQuery(blockid, field, getTime(), 'r');
+      if (executeBlockQueryAndWait(access, read_block))
+        samples.push_back(read_block->buffer.heap);
+    }
+
+    auto dictionary = Encoders::getSingleton()->trainDictionary(compression, samples, max_size);
+    if (!dictionary)
+    {
+      PrintWarning("cannot train compression dictionary for field", field.name, "compression", compression, "num_samples", samples.size());
+      bOk = false;
+      continue;
+    }
+
+    field.compression_dictionary = dictionary;
+  }
+  access->endRead();
+
+  //blocks encoded with the previous dictionary would not be decodable anymore, re-encode them
+  for (int F = 0; F < (int)idxfile.fields.size(); F++)
+  {
+    auto Rfield = old_fields[F];
+    auto Wfield = idxfile.fields[F];
+    if (!Rfield.compression_dictionary || Rfield.compression_dictionary == Wfield.compression_dictionary)
+      continue;
+
+    for (auto time : idxfile.timesteps.asVector())
+    {
+      for (BigInt blockid = 0; blockid < total_blocks; blockid++)
+      {
+        access->beginRead();
+        auto read_block = createBlockQuery(blockid, Rfield, time, 'r');
+        bool bRead = executeBlockQueryAndWait(access, read_block);
+        access->endRead();
+
+        //block not stored
+        if (!bRead)
+          continue;
+
+        access->beginWrite();
+        auto write_block = createBlockQuery(blockid, Wfield, time, 'w');
+        write_block->buffer = read_block->buffer;
+        if (!executeBlockQueryAndWait(access, write_block))
+        {
+          PrintWarning("cannot re-encode block", blockid, "field", Wfield.name, "time", time);
+          bOk = false;
+        }
+        access->endWrite();
+      }
+    }
+  }
+
+  clearFields();
+  for (auto field : idxfile.fields)
+    addField(field);
+
+  idxfile.save(Url(getUrl()).getPath());
+  return bOk;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////
 BoxNi IdxDataset::adjustBoxQueryFilterBox(BoxQuery* query,IdxFilter* filter,BoxNi user_box,int H) 
 {
@@ -952,6 +1131,13 @@ SharedPtr<Access> IdxDataset::createAccess(StringTree config, bool bForBlockQuer
     {
       VisusAssert(url.isRemote());
 
+      //packed idx files stored in a bucket, no server to run queries (see CloudStorageAccess)
+      if (!midx && idxfile.version >= 6 && CloudStorage::createInstance(url))
+      {
+        config.write("packed", true);
+        return std::make_shared<CloudStorageAccess>(this, config);
+      }
+
       if (bForBlockQuery)
         return std::make_shared<ModVisusAccess>(this, config);
       else
@@ -1067,6 +1253,8 @@ void IdxDataset::setIdxFile(IdxFile value)
 //////////////////////////////////////////////////////////////////////////////////////////
 bool IdxDataset::mergeBoxQueryWithBlockQuery(SharedPtr<BoxQuery> query,SharedPtr<BlockQuery> block_query)
 {
+  VisusTrace("query", "merge");
+
   if (!query->allocateBufferIfNeeded())
     return false;
 
@@ -1169,36 +1357,22 @@ NetRequest IdxDataset::createBoxQueryRequest(SharedPtr<BoxQuery> query)
   /*
     *****NOTE FOR REMOTE QUERIES:*****
 
-    I always restart from scratch so I will do Query0[0,resolutions[0]], Query1[0,resolutions[1]], Query2[0,resolutions[2]]  without any merging
-    In this way I transfer a little more data on the network (without compression in the worst case the ratio is 2.0)
-    but I can use lossy compression and jump levels
-    in the old code I was using:
-
-      Query0[0,resolutions[0]  ]
-      Query1[0,resolutions[0]+1] <-- by merging prev_single and Query[resolutions[0]+1,resolutions[0]+1]
-      Query1[0,resolutions[0]+2] <-- by merging prev_single and Query[resolutions[0]+2,resolutions[0]+2]
-      ...
+    Two protocols, see executeBoxQueryOnServer:
 
-        -----------------------------
-        | overall     |single       |
-        | --------------------------|
-    Q0  | 2^0*T       |             |
-    Q1  | 2^1*T       | 2^0*T       |
-    ..  |             |             |
-    Qn  | 2^n*T       | 2^(n-1)*T   |
-        -----------------------------
+    (1) one request for each end resolution (Dataset::executeBoxQueryOnServer, used for filters, for merge modes
+        different from InsertSamples, for IdxMultipleDataset and for servers not supporting streaming).
+        Each request restarts from scratch, i.e. Query0[0,resolutions[0]], Query1[0,resolutions[1]], ... without merging.
+        In the worst case (no compression) this transfers twice the samples of the final resolution:
 
-    OLD CODE transfers singles = T*(2^0+2^1+...+2^(n-1))=T*2^n    (see http://it.wikipedia.org/wiki/Serie_geometrica)
-    NEW CODE transfers overall = T*(2^0+2^1+...+2^(n  ))=T*2^n+1
+          overall = T*(2^0+2^1+...+2^n) = T*2^(n+1)
 
-    RATIO:=overall_transfer/single_transfer=2.0
+        but it can jump levels, use lossy compression, and the filters are always applied on the server side.
 
-    With the new code I have the following advantages:
-
-        (*) I don't have to go level by level after Q0. By "jumping" levels I send less data
-        (*) I can use lossy compression (in the old code I needed lossless compression to rebuild the data for Qi with i>0)
-        (*) not all datasets support the merging (see IdxMultipleDataset and GoogleMapsDataset)
-        (*) the filters (example wavelets) are applied always on the server side (in the old code filters were applied on the server only for Q0)
+    (2) streaming (stream=1, same parameters plus first_toh): a single request stays open for all the end resolutions.
+        The server sends one frame with the samples of [0,min(bitsperblock,first_toh)] and then one frame for each new level
+        (visus-fromh/visus-toh headers, 204 if a level has no samples in the box), the client merges them.
+        In total it transfers the samples of the final resolution only.
+        The transfer is cancelled as soon as the query is aborted or dropped.
   */
 
 
@@ -1222,6 +1396,99 @@ NetRequest IdxDataset::createBoxQueryRequest(SharedPtr<BoxQuery> query)
   return ret;
 }
 
+/////////////////////////////////////////////////////////////////////////
+bool IdxDataset::executeBoxQueryOnServer(SharedPtr<BoxQuery> query)
+{
+  VisusTrace("query", "IdxDataset::executeBoxQueryOnServer");
+
+  /*
+    With a streaming server a single request stays open for all the end resolutions:
+    the server sends the samples of [0,bitsperblock] and then only the new samples of each level, 
+    I merge them here. In total I transfer the samples of the final resolution (instead of the sum of all of them)
+  */
+
+  Url url = this->getUrl();
+
+  //filters must be rebuilt level by level on the server, and without merging there is nothing to reuse
+  if (query->filter.dataset_filter || query->merge_mode != MergeMode::InsertSamples || !cbool(url.getParam("box_query_streaming", "1")))
+    return Dataset::executeBoxQueryOnServer(query);
+
+  if (server_box_query_streaming < 0)
+  {
+    auto response = NetService::getNetResponse(Url(url.getProtocol() + "://" + url.getHostname() + ":" + cstring(url.getPort()) + "/mod_visus?action=ping"));
+    server_box_query_streaming = cbool(response.getHeader("box-query-support-streaming", "0")) ? 1 : 0;
+  }
+
+  if (!server_box_query_streaming)
+    return Dataset::executeBoxQueryOnServer(query);
+
+  auto failed = [query](String errormsg) {
+    query->server_stream.reset();
+    query->setFailed(errormsg);
+    return false;
+  };
+
+  if (!query->server_stream)
+  {
+    auto request = createBoxQueryRequest(query);
+    request.url.setParam("stream", "1");
+    request.url.setParam("fromh", cstring(std::max(query->getCurrentResolution() + 1, query->start_resolution)));
+    request.url.setParam("toh", cstring(query->end_resolutions.back()));
+    request.url.setParam("first_toh", cstring(query->getEndResolution()));
+
+    SharedPtr<NetService> netservice;
+    {
+      ScopedLock lock(server_stream_lock);
+      if (!server_stream_netservice)
+        server_stream_netservice = std::make_shared<NetService>(cint(url.getParam("box_query_streams", "8")), /*bVerbose*/false);
+      netservice = server_stream_netservice;
+    }
+    query->server_stream = std::make_shared<IdxBoxQueryStream>(netservice, request);
+  }
+
+  if (!query->allocateBufferIfNeeded())
+    return failed("out of memory");
+
+  while (query->getCurrentResolution() < query->getEndResolution())
+  {
+    auto frame = query->server_stream->nextFrame();
+    if (!frame.isSuccessful())
+      return failed(cstring("network request failed", cnamed("errormsg", frame.getErrorMessage())));
+
+    int A = cint(frame.getHeader("visus-fromh"));
+    int B = cint(frame.getHeader("visus-toh"));
+    if (B > query->getEndResolution())
+      return failed("wrong resolution from server");
+
+    //no samples at these levels
+    if (frame.status != HttpStatus::STATUS_NO_CONTENT)
+    {
+      //same logic samples as the server
+      auto Lquery = createBoxQuery(query->logic_box, query->field, query->time, 'r', query->aborted);
+      Lquery->setResolutionRange(A, B);
+      Lquery->disableFilters();
+      beginBoxQuery(Lquery);
+      if (!Lquery->isRunning())
+        return failed("cannot get the samples of the streamed levels");
+
+      auto decoded = frame.getCompatibleArrayBody(Lquery->getNumberOfSamples(), query->field.dtype);
+      if (!decoded)
+        return failed("failed to decode body");
+
+      if (!LogicSamples::merge(query->logic_samples, query->buffer, Lquery->logic_samples, decoded, MergeMode::InsertSamples, query->aborted))
+        return failed(query->aborted() ? "query aborted" : "merging failed");
+    }
+
+    query->setCurrentResolution(B);
+  }
+
+  //release the connection
+  if (query->getEndResolution() == query->end_resolutions.back())
+    query->server_stream.reset();
+
+  return true;
+}
+
 /////////////////////////////////////////////////////////////////////////
 NetRequest IdxDataset::createPointQueryRequest(SharedPtr<PointQuery> query)
 {
@@ -1413,9 +1680,104 @@ void IdxDataset::nextBoxQuery(SharedPtr<BoxQuery> query)
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////
+std::vector<BigInt> IdxDataset::getBoxQueryBlocks(SharedPtr<BoxQuery> query, int bitsperblock)
+{
+  VisusTrace("query", "traversal");
+
+  int cur_resolution = query->getCurrentResolution();
+  int end_resolution = query->end_resolution;
+
+  FastLoopStack  item, * stack = NULL;
+  FastLoopStack  STACK[DatasetBitmaskMaxLen + 1];
+
+  DatasetBitmask bitmask = this->getBitmask();
+  HzOrder hzorder(bitmask);
+
+  int max_resolution = getMaxResolution();
+  std::vector<Int64> fldeltas(max_resolution + 1);
+  for (auto H = 0; H <= max_resolution; H++)
+    fldeltas[H] = H ? (hzorder.getLevelDelta(H)[bitmask[H]] >> 1) : 0;
+
+  auto aborted = query->aborted;
+
+  #define PUSH()  (*((stack)++))=(item)
+  #define POP()   (item)=(*(--(stack)))
+  #define EMPTY() ((stack)==(STACK))
+
+  //collect blocks
+  std::vector<BigInt> blocks;
+  for (int H = cur_resolution + 1; H <= end_resolution; H++)
+  {
+    if (aborted())
+      return std::vector<BigInt>();
+
+    LogicSamples Lsamples = this->getLevelSamples(H);
+    BoxNi box = Lsamples.alignBox(query->logic_samples.logic_box);
+    if (!box.isFullDim())
+      continue;
+
+    //push first item
+    BigInt hz = hzorder.getAddress(Lsamples.logic_box.p1);
+    {
+      item.box = Lsamples.logic_box;
+      item.H = H ? 1 : 0;
+      stack = STACK;
+      PUSH();
+    }
+
+    while (!EMPTY())
+    {
+      POP();
+
+      // no intersection
+      if (!item.box.strictIntersect(box))
+      {
+        hz += (((BigInt)1) << (H - item.H));
+        continue;
+      }
+
+      // intersection with hz-block!
+      if ((H - item.H) <= bitsperblock)
+      {
+        auto blockid = hz >> bitsperblock;
+        blocks.push_back(blockid);
+
+        // I know that block 0 convers several hz-levels from [0 to bitsperblock]
+        if (blockid == 0)
+        {
+          H = bitsperblock;
+          break;
+        }
+
+        hz += ((BigInt)1) << (H - item.H);
+        continue;
+      }
+
+      //kd-traversal code
+      int bit = bitmask[item.H];
+      Int64 delta = fldeltas[item.H];
+      ++item.H;
+      item.box.p1[bit] += delta;                            PUSH();
+      item.box.p1[bit] -= delta; item.box.p2[bit] -= delta; PUSH();
+
+    } //while (stack!=STACK)
+
+  } //for levels
+
+  #undef PUSH 
+  #undef POP  
+  #undef EMPTY 
+
+  return blocks;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////
 bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> query)
 {
+  VisusTrace("query", "IdxDataset::executeBoxQuery");
+
   if (!query)
     return false;
 
@@ -1490,7 +1852,10 @@ bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> q
       if (!this->executeBoxQuery(access, Wquery))
         return false;
 
-      filter->internalComputeFilter(Wquery.get(), /*bInverse*/true);
+      {
+        VisusTrace("query", "filter");
+        filter->internalComputeFilter(Wquery.get(), /*bInverse*/true);
+      }
 
       query->filter.query = Wquery;
     }
@@ -1514,86 +1879,10 @@ bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> q
   int bitsperblock = access->bitsperblock;
   VisusAssert(bitsperblock);
 
-  FastLoopStack  item, * stack = NULL;
-  FastLoopStack  STACK[DatasetBitmaskMaxLen + 1];
-
-  DatasetBitmask bitmask = this->getBitmask();
-  HzOrder hzorder(bitmask);
-
-  int max_resolution = getMaxResolution();
-  std::vector<Int64> fldeltas(max_resolution + 1);
-  for (auto H = 0; H <= max_resolution; H++)
-    fldeltas[H] = H ? (hzorder.getLevelDelta(H)[bitmask[H]] >> 1) : 0;
-
   auto aborted = query->aborted;
 
-  #define PUSH()  (*((stack)++))=(item)
-  #define POP()   (item)=(*(--(stack)))
-  #define EMPTY() ((stack)==(STACK))
-
   //collect blocks
-  std::vector<BigInt> blocks;
-  for (int H = cur_resolution + 1; H <= end_resolution; H++)
-  {
-    if (aborted())
-      return false;
-
-    LogicSamples Lsamples = this->getLevelSamples(H);
-    BoxNi box = Lsamples.alignBox(query->logic_samples.logic_box);
-    if (!box.isFullDim())
-      continue;
-
-    //push first item
-    BigInt hz = hzorder.getAddress(Lsamples.logic_box.p1);
-    {
-      item.box = Lsamples.logic_box;
-      item.H = H ? 1 : 0;
-      stack = STACK;
-      PUSH();
-    }
-
-    while (!EMPTY())
-    {
-      POP();
-
-      // no intersection
-      if (!item.box.strictIntersect(box))
-      {
-        hz += (((BigInt)1) << (H - item.H));
-        continue;
-      }
-
-      // intersection with hz-block!
-      if ((H - item.H) <= bitsperblock)
-      {
-        auto blockid = hz >> bitsperblock;
-        blocks.push_back(blockid);
-
-        // I know that block 0 convers several hz-levels from [0 to bitsperblock]
-        if (blockid == 0)
-        {
-          H = bitsperblock;
-          break;
-        }
-
-        hz += ((BigInt)1) << (H - item.H);
-        continue;
-      }
-
-      //kd-traversal code
-      int bit = bitmask[item.H];
-      Int64 delta = fldeltas[item.H];
-      ++item.H;
-      item.box.p1[bit] += delta;                            PUSH();
-      item.box.p1[bit] -= delta; item.box.p2[bit] -= delta; PUSH();
-
-    } //while (stack!=STACK)
-
-  } //for levels
-
-  #undef PUSH 
-  #undef POP  
-  #undef EMPTY 
+  auto blocks = getBoxQueryBlocks(query, bitsperblock);
 
   if (aborted())
     return false;
@@ -1605,6 +1894,7 @@ bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> q
   //waitAllDone
   auto  waitAsyncRead = [&]()
   {
+    VisusTrace("query", "wait");
     async_read.waitAllDone();
     //PrintInfo("aysnc read",concatenate(NREAD, "/", blocks.size()),"...");
   };
@@ -1640,6 +1930,10 @@ bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> q
 
     if (bReading)
     {
+      //the levels [0,end_resolution] are the first 2^end_resolution hz samples of the first block
+      if (blockid == 0 && query->end_resolution < bitsperblock)
+        read_block->num_needed_samples = ((Int64)1) << query->end_resolution;
+
       executeBlockQuery(access, read_block);
       async_read.pushRunning(read_block->done).when_ready([this, query, read_block, aborted](Void)
       {
@@ -1684,7 +1978,13 @@ bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> q
   }
 
   if (bWriting && !bWasWriting)
+  {
+    //buffered writes (e.g. CloudStorageAccess packed) are uploaded in endWrite
+    auto wfail = access->statistics.wfail;
     access->endWrite();
+    if (access->statistics.wfail > wfail)
+      return false;
+  }
 
   if (bReading && !bWasReading)
     access->endRead();
@@ -1704,6 +2004,291 @@ bool IdxDataset::executeBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> q
 }
 
 
+///////////////////////////////////////////////////////////////////////////////////////
+static std::vector<BoxNi> GetBoxDifference(BoxNi A, BoxNi B)
+{
+  //split A-B in (at most 2*pdim) disjoint boxes
+  B = B.getIntersection(A);
+  if (!B.isFullDim())
+    return { A };
+
+  std::vector<BoxNi> ret;
+  for (int D = 0; D < A.getPointDim(); D++)
+  {
+    if (A.p1[D] < B.p1[D])
+    {
+      auto box = A; box.p2[D] = B.p1[D];
+      ret.push_back(box);
+      A.p1[D] = B.p1[D];
+    }
+
+    if (B.p2[D] < A.p2[D])
+    {
+      auto box = A; box.p1[D] = B.p2[D];
+      ret.push_back(box);
+      A.p2[D] = B.p2[D];
+    }
+  }
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+bool IdxDataset::reuseBoxQuery(SharedPtr<Access> access, SharedPtr<BoxQuery> query, SharedPtr<BoxQuery> prev)
+{
+  VisusTrace("query", "IdxDataset::reuseBoxQuery");
+
+  if (!access || !query || !prev || query == prev)
+    return false;
+
+  if (!(query->isRunning() && query->getCurrentResolution() < query->getEndResolution()))
+    return false;
+
+  //filters need to go level by level on their own adjusted box
+  if (query->mode != 'r' || query->merge_mode != MergeMode::InsertSamples || query->start_resolution != 0 || query->filter.dataset_filter)
+    return false;
+
+  if (prev->start_resolution != 0 || prev->field.name != query->field.name || prev->field.dtype != query->field.dtype || prev->time != query->time)
+    return false;
+
+  if (!prev->buffer || !prev->logic_samples.valid() || prev->logic_samples.nsamples != prev->buffer.dims)
+    return false;
+
+  //all the samples of levels [0,prev_resolution] inside prev->logic_box are in prev->buffer
+  int prev_resolution = std::min(prev->getCurrentResolution(), query->getEndResolution());
+  if (prev_resolution <= query->getCurrentResolution())
+    return false;
+
+  if (!query->logic_box.getIntersection(prev->logic_box).isFullDim())
+    return false;
+
+  auto aborted = query->aborted;
+
+  //read the newly exposed region up to prev_resolution, starting from what the query already has
+  std::vector< SharedPtr<BoxQuery> > exposed;
+  for (auto box : GetBoxDifference(query->logic_box, prev->logic_box))
+  {
+    auto sub = createBoxQuery(box, query->field, query->time, 'r', aborted);
+    sub->setResolutionRange(0, prev_resolution);
+    sub->disableFilters();
+    sub->merge_mode = MergeMode::InsertSamples;
+    beginBoxQuery(sub);
+
+    //no samples of these levels in the box
+    if (!sub->isRunning())
+      continue;
+
+    if (query->getCurrentResolution() >= 0 && query->buffer && !sub->mergeWith(*query, aborted))
+    {
+      if (aborted())
+        return false;
+      sub->setCurrentResolution(-1);
+    }
+
+    if (sub->getCurrentResolution() < sub->getEndResolution())
+      exposed.push_back(sub);
+  }
+
+  if (!exposed.empty() && !executeBoxQueries(access, exposed))
+    return false;
+
+  if (aborted() || !query->allocateBufferIfNeeded())
+    return false;
+
+  //overlapping region (note: prev->logic_samples lie inside prev->logic_box)
+  if (!LogicSamples::merge(query->logic_samples, query->buffer, prev->logic_samples, prev->buffer, MergeMode::InsertSamples, aborted))
+    return false;
+
+  //newly exposed region (the samples of sub lie on the query grid, any failure means they would be missing)
+  for (auto sub : exposed)
+  {
+    if (!LogicSamples::merge(query->logic_samples, query->buffer, sub->logic_samples, sub->buffer, MergeMode::InsertSamples, aborted))
+      return false;
+  }
+
+  query->setCurrentResolution(prev_resolution);
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////
+bool IdxDataset::executeBoxQueries(SharedPtr<Access> access, std::vector< SharedPtr<BoxQuery> > queries)
+{
+  VisusTrace("query", "IdxDataset::executeBoxQueries");
+
+  //remote queries go one by one
+  if (!access)
+    return Dataset::executeBoxQueries(access, queries);
+
+  int bitsperblock = access->bitsperblock;
+  VisusAssert(bitsperblock);
+
+  bool bOk = true;
+
+  //union of the blocks needed by the queries, sorted so that the reads are sequential in the files
+  typedef std::tuple<String, double, BigInt> BlockKey;
+  std::map<BlockKey, std::vector<int> > rblocks, wblocks;
+
+  std::vector<int> batched;
+  std::vector<bool> failed(queries.size(), false);
+  for (int I = 0; I < (int)queries.size(); I++)
+  {
+    auto query = queries[I];
+
+    //filters or wrong status (executeBoxQuery will take care of them)
+    if (!query || query->filter.dataset_filter || !query->isRunning() || query->getCurrentResolution() >= query->getEndResolution() || query->aborted() || (query->mode == 'w' && !query->buffer))
+    {
+      bOk = executeBoxQuery(access, query) && bOk;
+      continue;
+    }
+
+    //allocate now, the scattering runs in parallel
+    if (!query->allocateBufferIfNeeded())
+    {
+      query->setFailed("out of memory");
+      bOk = false;
+      continue;
+    }
+
+    auto& blocks = query->mode == 'w' ? wblocks : rblocks;
+    for (auto blockid : getBoxQueryBlocks(query, bitsperblock))
+      blocks[BlockKey(query->field.name, query->time, blockid)].push_back(I);
+
+    batched.push_back(I);
+  }
+
+  //reading: each block is read once and merged into all the queries needing it
+  if (!rblocks.empty())
+  {
+    //rehentrant call...(just to not close the file too soon)
+    bool bWasReading = access->isReading();
+    if (!bWasReading)
+      access->beginRead();
+
+    WaitAsync< Future<Void> > async_read;
+    std::vector< std::pair<SharedPtr<BlockQuery>, const std::vector<int>* > > reading;
+
+    //wait for the running reads, then scatter each block into all its queries (different blocks write different samples)
+    auto flush = [&]()
+    {
+      async_read.waitAllDone();
+
+      std::vector< std::pair<SharedPtr<BlockQuery>, int> > merges;
+      for (auto it : reading)
+      {
+        if (it.first->ok())
+        {
+          for (auto I : *it.second)
+            merges.push_back(std::make_pair(it.first, I));
+        }
+      }
+      reading.clear();
+
+      Scheduler::getSingleton()->parallelFor(0, (Int64)merges.size(), [&](Int64 I) {
+        auto query = queries[merges[I].second];
+        if (!query->aborted())
+          mergeBoxQueryWithBlockQuery(query, merges[I].first);
+      });
+    };
+
+    for (auto& it : rblocks)
+    {
+      //all the queries needing the block have been aborted
+      auto& needed_by = it.second;
+      if (std::all_of(needed_by.begin(), needed_by.end(), [&](int I) {return queries[I]->aborted(); }))
+        continue;
+
+      auto query = queries[needed_by[0]];
+      auto read_block = createBlockQuery(std::get<2>(it.first), query->field, query->time, 'r');
+      executeBlockQuery(access, read_block);
+      async_read.pushRunning(read_block->done);
+      reading.push_back(std::make_pair(read_block, &needed_by));
+
+      //flush previous
+      if (reading.size() >= 1024)
+        flush();
+    }
+    flush();
+
+    if (!bWasReading)
+      access->endRead();
+  }
+
+  //writing: each block is read, modified by all the queries (in order) and written once
+  if (!wblocks.empty())
+  {
+    bool bWasWriting = access->isWriting();
+    if (!bWasWriting)
+      access->beginWrite();
+
+    for (auto& it : wblocks)
+    {
+      auto& needed_by = it.second;
+      auto query = queries[needed_by[0]];
+      auto blockid = std::get<2>(it.first);
+
+      //need a lease... so that I can read/merge/write like in a transaction mode
+      auto read_block = createBlockQuery(blockid, query->field, query->time, 'r');
+      access->acquireWriteLock(read_block);
+      executeBlockQueryAndWait(access, read_block);
+
+      auto write_block = createBlockQuery(blockid, query->field, query->time, 'w');
+
+      //I don't care if the read fails... maybe does not exist
+      if (read_block->ok())
+        write_block->buffer = read_block->buffer;
+      else
+        write_block->allocateBufferIfNeeded();
+
+      for (auto I : needed_by)
+      {
+        if (!queries[I]->aborted())
+          mergeBoxQueryWithBlockQuery(queries[I], write_block);
+      }
+
+      executeBlockQueryAndWait(access, write_block);
+      access->releaseWriteLock(read_block);
+
+      if (write_block->failed())
+      {
+        for (auto I : needed_by)
+          failed[I] = true;
+      }
+    }
+
+    if (!bWasWriting)
+    {
+      //buffered writes (e.g. CloudStorageAccess packed) are uploaded in endWrite
+      auto wfail = access->statistics.wfail;
+      access->endWrite();
+      if (access->statistics.wfail > wfail)
+        std::fill(failed.begin(), failed.end(), true);
+    }
+  }
+
+  for (auto I : batched)
+  {
+    auto query = queries[I];
+    if (query->aborted())
+    {
+      query->setFailed("query aborted");
+      bOk = false;
+      continue;
+    }
+
+    if (failed[I])
+    {
+      query->setFailed(query->mode == 'w' ? "write failed" : "read failed");
+      bOk = false;
+      continue;
+    }
+
+    VisusAssert(query->buffer.dims == query->getNumberOfSamples());
+    query->setCurrentResolution(query->end_resolution);
+  }
+
+  return bOk;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////////////
 void IdxDataset::beginPointQuery(SharedPtr<PointQuery> query)
 {
@@ -1904,7 +2489,16 @@ bool IdxDataset::executePointQuery(SharedPtr<Access> access,SharedPtr<PointQuery
 
 
 ///////////////////////////////////////////////////////////////////////////////
-bool IdxDataset::computeFilter(SharedPtr<IdxFilter> filter, double time, Field field, SharedPtr<Access> access, PointNi SlidingWindow, bool bVerbose )
+/*
+The filter is computed FINE TO COARSE in stages. In each stage the dataset is split in windows of
+SlidingWindow samples (at the finest resolution of the stage) aligned to the filter, so that all the
+levels whose filter pairs fit in the window are computed in memory with a single read and a single write.
+Windows are independent: they are read/written in batches (each block once per batch) and filtered in parallel.
+
+If checkpoint is not empty, the progress is saved there after each batch (with a journal of the filtered
+samples written while the batch is being stored), so that an interrupted computation can be restarted.
+*/
+bool IdxDataset::computeFilter(SharedPtr<IdxFilter> filter, double time, Field field, SharedPtr<Access> access, PointNi SlidingWindow, bool bVerbose, String checkpoint)
 {
   //this works only for filter_size==2, otherwise the building of the sliding_window is very difficult
   VisusAssert(filter->size == 2);
@@ -1914,121 +2508,239 @@ bool IdxDataset::computeFilter(SharedPtr<IdxFilter> filter, double time, Field f
 
   int pdim = bitmask.getPointDim();
 
-  //the window size must be multiple of 2, otherwise I loose the filter alignment
+  //the window size must be a power of 2, otherwise I loose the filter alignment
   for (int D = 0; D < pdim; D++)
   {
     Int64 size = SlidingWindow[D];
-    VisusAssert(size == 1 || (size / 2) * 2 == size);
+    SlidingWindow[D] = 2;
+    while (SlidingWindow[D] < size)
+      SlidingWindow[D] <<= 1;
+
+    if (SlidingWindow[D] != size)
+      PrintWarning("computeFilter sliding window", D, "rounded from", size, "to", SlidingWindow[D]);
   }
 
-  //convert the dataset  FINE TO COARSE, this can be really time consuming!!!!
-  for (int H = this->getMaxResolution(); H >= 1; H--)
+  auto saveCheckpoint = [&](int H, Int64 A, Int64 B)
   {
-    if (bVerbose)
-      PrintInfo("Applying filter to dataset resolution", H);
+    auto tmp = checkpoint + ".tmp";
+    Utils::saveTextDocument(tmp, concatenate(H, " ", A, " ", B, " ", SlidingWindow.toString()));
+    FileUtils::removeFile(checkpoint);
+    FileUtils::moveFile(tmp, checkpoint);
+  };
 
-    int bit = bitmask[H];
+  //H is the current stage, windows [A,B) are in the journal and need to be written again
+  int H = this->getMaxResolution();
+  Int64 A = 0, B = 0;
+  if (!checkpoint.empty())
+  {
+    String content = FileUtils::existsFile(checkpoint) ? Utils::loadTextDocument(checkpoint) :
+      (FileUtils::existsFile(checkpoint + ".tmp") ? Utils::loadTextDocument(checkpoint + ".tmp") : "");
 
-    Int64 FILTERSTEP = filter->getFilterStep(H)[bit];
+    if (!content.empty())
+    {
+      std::istringstream in(content);
+      String window;
+      in >> H >> A >> B;
+      std::getline(in, window);
+      if (PointNi::fromString(StringUtils::trim(window)) != SlidingWindow)
+      {
+        PrintWarning("cannot restart filter computation with a different window size", checkpoint);
+        return false;
+      }
+
+      if (bVerbose)
+        PrintInfo("Restarting filter computation", "H", H, "window", A);
+    }
+  }
+
+  while (H >= 1)
+  {
+    //logic size of the windows, the resolution H has the finest samples of the stage
+    auto full = createBoxQuery(box, field, time, 'r');
+    full->setResolutionRange(0, H);
+    beginBoxQuery(full);
+    if (!full->isRunning())
+      return false;
 
-    //need to align the from so that the first sample is filter-aligned
+    PointNi window_size = full->logic_samples.delta.innerMultiply(SlidingWindow);
+
+    //levels of the stage, all their filter pairs must fit inside the windows (the coarsest level can be used as Hend-1)
+    int Hend = H;
+    while (Hend > 1 && filter->getFilterStep(Hend - 1)[bitmask[Hend - 1]] <= window_size[bitmask[Hend - 1]])
+      Hend--;
+
+    VisusAssert(filter->getFilterStep(H)[bitmask[H]] <= window_size[bitmask[H]]);
+
+    std::vector<BoxNi> windows;
     PointNi From = box.p1;
+    for (int D = 0; D < pdim; D++)
+      From[D] = Utils::alignLeft(From[D], (Int64)0, window_size[D]);
+
+    for (auto P = ForEachPoint(From, box.p2, window_size); !P.end(); P.next())
+    {
+      //important! crop to the stored world box to be sure that the alignment with the filter is correct!
+      auto window = BoxNi(P.pos, P.pos + window_size).getIntersection(box);
+      if (window.isFullDim())
+        windows.push_back(window);
+    }
 
-    if (!Utils::isAligned(From[bit], (Int64)0, FILTERSTEP))
-      From[bit] = Utils::alignLeft(From[bit], (Int64)0, FILTERSTEP) + FILTERSTEP;
+    //createWriteQueries
+    auto createWriteQueries = [&](Int64 A, Int64 B)
+    {
+      std::vector< SharedPtr<BoxQuery> > ret;
+      for (Int64 I = A; I < B; I++)
+      {
+        auto write = createBoxQuery(windows[I], field, time, 'w');
+        write->setResolutionRange(0, H);
+        beginBoxQuery(write);
+        if (write->isRunning())
+          ret.push_back(write);
+      }
+      return ret;
+    };
 
-    PointNi To = box.p2;
-    for (auto P = ForEachPoint(From, To, SlidingWindow); !P.end(); P.next())
+    //the batch was filtered but not completely written, write it again from the journal
+    if (B > A)
     {
-      //this is the sliding window
-      BoxNi sliding_window(P.pos, P.pos + SlidingWindow);
+      auto journal = Utils::loadBinaryDocument(checkpoint + ".journal");
+      auto writes = createWriteQueries(A, B);
+      Int64 offset = 0;
+      for (auto write : writes)
+      {
+        write->buffer = Array(write->getNumberOfSamples(), field.dtype);
+        if (!journal || offset + write->buffer.c_size() > journal->c_size())
+        {
+          PrintWarning("filter computation journal is corrupted", checkpoint);
+          return false;
+        }
+        memcpy(write->buffer.c_ptr(), journal->c_ptr() + offset, write->buffer.c_size());
+        offset += write->buffer.c_size();
+      }
 
-      //important! crop to the stored world box to be sure that the alignment with the filter is correct!
-      sliding_window = sliding_window.getIntersection(box);
+      if (!executeBoxQueries(access, writes))
+        return false;
 
-      //no valid box since do not intersect with box 
-      if (!sliding_window.isFullDim())
-        continue;
+      A = B;
+      saveCheckpoint(H, A, B);
+      FileUtils::removeFile(checkpoint + ".journal");
+    }
+
+    //each batch keeps in memory about 256MB
+    Int64 window_bytes = std::max((Int64)1, field.dtype.getByteSize(SlidingWindow.innerProduct()));
+    Int64 batch_size = Utils::clamp((Int64)256 * 1024 * 1024 / window_bytes, (Int64)1, (Int64)1024);
 
-      //I'm sure that since the From is filter-aligned, then P must be already aligned
-      VisusAssert(Utils::isAligned(sliding_window.p1[bit], (Int64)0, FILTERSTEP));
+    for (; A < (Int64)windows.size(); A = B)
+    {
+      B = std::min(A + batch_size, (Int64)windows.size());
 
-      //important, i'm not using adjustBox because I'm sure it is already correct!
-      auto read = createBoxQuery(sliding_window, field, time, 'r');
-      read->setResolutionRange(0, H);
+      if (bVerbose)
+        PrintInfo("Applying filter to dataset resolutions", concatenate("[", Hend, ",", H, "]"), "windows", concatenate(A, "/", windows.size()));
 
-      beginBoxQuery(read);
+      std::vector< SharedPtr<BoxQuery> > reads;
+      for (Int64 I = A; I < B; I++)
+      {
+        //important, i'm not using adjustBox because I'm sure it is already correct!
+        auto read = createBoxQuery(windows[I], field, time, 'r');
+        read->setResolutionRange(0, H);
+        beginBoxQuery(read);
+        if (read->isRunning())
+          reads.push_back(read);
+      }
 
-      if (!executeBoxQuery(access, read))
+      if (!executeBoxQueries(access, reads))
         return false;
 
-      //if you want to debug step by step...
-#if 0
+      //coarser levels of each window (extracted from the finer level once it has been filtered)
+      std::vector< std::vector< SharedPtr<BoxQuery> > > levels(reads.size());
+      for (int I = 0; I < (int)reads.size(); I++)
       {
-        PrintInfo("Before");
-        int nx = (int)read->buffer->dims.x;
-        int ny = (int)read->buffer->dims.y;
-        Uint8* SRC = read->buffer->c_ptr();
-        std::ostringstream out;
-        for (int Y = 0; Y < ny; Y++)
+        levels[I].push_back(reads[I]);
+        for (int h = H - 1; h >= Hend; h--)
         {
-          for (int X = 0; X < nx; X++)
-          {
-            out << std::setw(3) << (int)SRC[((ny - Y - 1) * nx + X) * 2] << " ";
-          }
-          out << std::endl;
+          auto level = createBoxQuery(reads[I]->logic_box, field, time, 'r');
+          level->setResolutionRange(0, h);
+          beginBoxQuery(level);
+
+          //the window has no samples at this resolution (and at coarser ones), the chain is complete
+          if (level->failed() && level->errormsg.empty())
+            break;
+
+          //a partial chain would write unfiltered coarse samples, fail instead (the checkpoint stays valid for a restart)
+          if (!level->isRunning() || !level->allocateBufferIfNeeded())
+            return false;
+          level->setCurrentResolution(h);
+          levels[I].push_back(level);
         }
-        out << std::endl;
-        PrintInfo("\n" << out.str();
       }
-#endif
-
-      filter->internalComputeFilter(read.get(),/*bInverse*/false);
 
-      //if you want to debug step by step...
-#if 0 
+      Scheduler::getSingleton()->parallelFor(0, (Int64)reads.size(), [&](Int64 I)
       {
-        PrintInfo("After");
-        int nx = (int)read->buffer->dims.x;
-        int ny = (int)read->buffer->dims.y;
-        Uint8* SRC = read->buffer->c_ptr();
-        std::ostringstream out;
-        for (int Y = 0; Y < ny; Y++)
+        auto& chain = levels[I];
+        for (int L = 0; L < (int)chain.size(); L++)
         {
-          for (int X = 0; X < nx; X++)
-          {
-            out << std::setw(3) << (int)SRC[((ny - Y - 1) * nx + X) * 2] << " ";
-          }
-          out << std::endl;
+          if (L)
+            LogicSamples::merge(chain[L]->logic_samples, chain[L]->buffer, chain[L - 1]->logic_samples, chain[L - 1]->buffer, MergeMode::InsertSamples, Aborted());
+
+          filter->internalComputeFilter(chain[L].get(),/*bInverse*/false);
         }
-        out << std::endl;
-        PrintInfo("\n", out.str());
-      }
-#endif
 
-      auto write = createBoxQuery(sliding_window, field, time, 'w');
-      write->setResolutionRange(0, H);
+        //put the filtered coarser samples back
+        for (int L = (int)chain.size() - 1; L > 0; L--)
+          LogicSamples::merge(chain[L - 1]->logic_samples, chain[L - 1]->buffer, chain[L]->logic_samples, chain[L]->buffer, MergeMode::InsertSamples, Aborted());
+      });
 
-      beginBoxQuery(write);
+      auto writes = createWriteQueries(A, B);
+      VisusAssert(writes.size() == reads.size());
+      for (int I = 0; I < (int)writes.size(); I++)
+        writes[I]->buffer = reads[I]->buffer;
 
-      if (!write->isRunning())
-        return false;
+      if (!checkpoint.empty())
+      {
+        Int64 size = 0;
+        for (auto write : writes)
+          size += write->buffer.c_size();
 
-      write->buffer = read->buffer;
+        auto journal = std::make_shared<HeapMemory>();
+        if (!journal->resize(size, __FILE__, __LINE__))
+          return false;
+
+        size = 0;
+        for (auto write : writes)
+        {
+          memcpy(journal->c_ptr() + size, write->buffer.c_ptr(), write->buffer.c_size());
+          size += write->buffer.c_size();
+        }
 
-      if (!executeBoxQuery(access, write))
+        Utils::saveBinaryDocument(checkpoint + ".journal", journal);
+        saveCheckpoint(H, A, B);
+      }
+
+      if (!executeBoxQueries(access, writes))
         return false;
+
+      if (!checkpoint.empty())
+      {
+        saveCheckpoint(H, B, B);
+        FileUtils::removeFile(checkpoint + ".journal");
+      }
     }
 
-    //I'm going to write the next resolution, double the dimension along the current axis
-    //in this way I have the same number of samples!
-    SlidingWindow[bit] <<= 1;
+    //next stage
+    H = Hend - 1;
+    A = B = 0;
+
+    if (!checkpoint.empty())
+      saveCheckpoint(H, A, B);
   }
+
+  if (!checkpoint.empty())
+    FileUtils::removeFile(checkpoint);
+
   return true;
-}
-
-///////////////////////////////////////////////////////////////////////////////
-void IdxDataset::computeFilter(const Field& field, int window_size,bool bVerbose)
+}
+
+///////////////////////////////////////////////////////////////////////////////
+void IdxDataset::computeFilter(const Field& field, int window_size,bool bVerbose, bool bCheckpoint)
 {
   if (bVerbose)
     PrintInfo("starting filter computation...");
@@ -2040,9 +2752,15 @@ void IdxDataset::computeFilter(const Field& field, int window_size,bool bVerbose
   for (int D = 0; D < getPointDim(); D++)
     sliding_box[D] = window_size;
 
+  //local datasets can restart an interrupted computation (only if requested)
+  Url url(getUrl());
+
   auto acess = createAccess();
   for (auto time : getTimesteps().asVector())
-    computeFilter(filter, time, field, acess, sliding_box, bVerbose);
+  {
+    String checkpoint = bCheckpoint && url.isFile() ? concatenate(url.getPath(), ".", field.name, ".", time, ".filter") : "";
+    computeFilter(filter, time, field, acess, sliding_box, bVerbose, checkpoint);
+  }
 }
 
 
@@ -46,6 +46,7 @@ For support : support@visus.net
 #include <Visus/IdxHzOrder.h>
 #include <Visus/StringTree.h>
 #include <Visus/ByteOrder.h>
+#include <Visus/Trace.h>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -54,6 +55,8 @@ For support : support@visus.net
 #include <Visus/IdxDataset.h>
 #include <Visus/IdxMultipleDataset.h>
 
+#include "IdxFileV6.hxx"
+
 namespace Visus {
 
 
@@ -99,91 +102,6 @@ static String GetFilenameV1234(const IdxFile& idxfile, String TimeTemplate, Stri
   return out.str();
 }
 
-//////////////////////////////////////////////////////////////////////////////
-static String GetFilenameV56(const IdxFile& idxfile, String TimeTemplate, String FilenameTemplate, Field field, double time, BigInt blockid)
-{
-  //not really a template... one file contains all blocks
-  if (StringUtils::find(FilenameTemplate, "%")<0)
-    return FilenameTemplate;
-
-  /*
-  this version can be a little slower, but I don't think it could be the bottleneck
-  should produce exactly the same name of the old Visus code, the only difference is that
-  it creates filenames going from right to left instead of from left to right (in this way I can support regular expression!)
-
-  example:
-
-  idxdata/%03x/%02x/%01x.bin
-
-  then %01x represents the less significant 4 bits of the address  (____________________BBBB)
-  %02x represents about the middle 8 bits                     (____________BBBBBBBB____)
-  %03x represents the most significant 12 bits                (BBBBBBBBBBBB____________)
-  */
-
-  const int MaxFilenameLen = 1024;
-
-  const char hexdigits[16] = { '0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f' };
-  int digit, numbits, len, k;
-  BigInt address = idxfile.getFirstBlockInFile(blockid), partial_address;
-  char  filename[MaxFilenameLen];
-  int   N = MaxFilenameLen - 1;
-  int   S = (int)FilenameTemplate.length() - 1;
-  int   C = S;
-  int   LastC = -1;
-
-  //special case invalid block number
-  if (address<0)
-    return "";
-
-  filename[N--] = 0;
-  for (; C >= 0; C--) //going from right to left
-  {
-    if (FilenameTemplate[C] != '%') continue;
-    LastC = C;
-    digit = FilenameTemplate[C + 2] - '0';
-    numbits = digit * 4;
-    len = 1 + S - (C + 4);
-    partial_address = address & ((((BigInt)1) << numbits) - 1);
-
-    //IMPORTANT NOTE: do not use _snprintf or snprintf since they have different behaviour on windows and macosx (with the terminating zero!)
-    memcpy(filename + 1 + N - len, FilenameTemplate.c_str() + C + 4, len); N -= len;
-    for (k = 0; k<digit; k++, partial_address >>= 4) filename[N--] = hexdigits[cint64(partial_address & 0xf)];
-    address >>= numbits;
-    S = C - 1;
-  }
-
-  while (address != 0) //still address is non zero, must recycle the last template
-  {
-    C = LastC;
-    VisusAssert(LastC >= 0);
-    digit = FilenameTemplate[C + 2] - '0';
-    numbits = digit * 4;
-    partial_address = address & ((((BigInt)1) << numbits) - 1);
-    filename[N--] = '/'; //ignore what is in the template, use a simple separator!
-    for (k = 0; k<digit; k++, partial_address >>= 4) filename[N--] = hexdigits[cint64(partial_address & 0xf)];
-    address >>= numbits;
-  }
-
-  //time template
-  if (!TimeTemplate.empty())
-  {
-    char temp[1024] = { 0 }; //1024 seems enough only for the time!
-    int nwritten = sprintf(temp, TimeTemplate.c_str(), (int)time);
-    VisusAssert(nwritten<(sizeof(temp) - 1));
-    TimeTemplate = temp;
-
-    int len = (int)TimeTemplate.length();
-    memcpy(filename + 1 + N - len, TimeTemplate.c_str(), len);
-    N -= len;
-  }
-
-  //dump what is remained on the right
-  memcpy(filename + 1 + N - (1 + S), FilenameTemplate.c_str(), 1 + S);
-  return String(filename + N - S);
-}
-
-
-
 //////////////////////////////////////////////////////////////////////////////////
 class IdxDiskAccessV5 : public Access
 {
@@ -233,6 +151,8 @@ public:
   //readBlock
   virtual void readBlock(SharedPtr<BlockQuery> query) override
   {
+    VisusTrace("access", "IdxDiskAccess::readBlock");
+
     BigInt blockid = query->blockid;
 
     auto failed = [&](String reason) {
@@ -268,8 +188,12 @@ public:
     if (bVerbose)
       PrintInfo("Reading buffer: read block_offset",block_offset,"encoded->c_size",encoded->c_size());
 
-    if (!file.read(block_offset, encoded->c_size(), encoded->c_ptr()))
-      return failed("cannot read encoded buffer");
+    {
+      VisusTrace("access", "read");
+      Scheduler::BlockingScope blocking;
+      if (!file.read(block_offset, encoded->c_size(), encoded->c_ptr()))
+        return failed("cannot read encoded buffer");
+    }
 
     if (bVerbose)
       PrintInfo("Decoding buffer");
@@ -358,6 +282,9 @@ private:
     if (filename == this->file.getFilename() && "r" == this->file.getFileMode())
       return true;
 
+    VisusTrace("access", "open");
+    Scheduler::BlockingScope blocking; //opening and reading the headers hits the disk
+
     if (this->file.isOpen())
       closeFile("need to openFile");
 
@@ -411,7 +338,7 @@ public:
   {
     this->bVerbose = bVerbose;
     this->bitsperblock = idxfile.bitsperblock;
-    this->headers.resize(sizeof(FileHeader) + (idxfile.blocksperfile * (int)idxfile.fields.size()) * sizeof(BlockHeader), __FILE__, __LINE__);
+    this->headers.resize(GetHeadersSizeV6(idxfile), __FILE__, __LINE__);
     this->file_header   = (FileHeader* )(this->headers.c_ptr());
     this->block_headers = (BlockHeader*)(this->headers.c_ptr() + sizeof(FileHeader));
 
@@ -446,6 +373,8 @@ public:
   //readBlock
   virtual void readBlock(SharedPtr<BlockQuery> query) override
   {
+    VisusTrace("access", "IdxDiskAccess::readBlock");
+
     BigInt blockid = query->blockid;
 
     auto failed = [&](String reason) {
@@ -491,8 +420,12 @@ public:
     if (aborted())
       return failed("aborted");
 
-    if (!file->read(block_offset, encoded->c_size(), encoded->c_ptr()))
-      return failed("cannot read encoded buffer");
+    {
+      VisusTrace("access", "read");
+      Scheduler::BlockingScope blocking;
+      if (!file->read(block_offset, encoded->c_size(), encoded->c_ptr()))
+        return failed("cannot read encoded buffer");
+    }
 
     if (bVerbose)
       PrintInfo("Decoding buffer");
@@ -500,8 +433,13 @@ public:
     if (aborted())
       return failed("aborted");
 
+    //coarse queries: in hzorder the samples of the first levels are a prefix of the block, decode only the chunks containing them
+    Int64 num_samples = layout == "hzorder" ? query->num_needed_samples : -1;
+
     //TODO: noninterruptile
-    auto decoded = ArrayUtils::decodeArray(compression, query->getNumberOfSamples(), query->field.dtype, encoded);
+    auto decoded = query->field.compression_dictionary ?
+      decodeWithDictionary(query->field, compression, query->getNumberOfSamples(), encoded, num_samples) :
+      ArrayUtils::decodeArray(compression, query->getNumberOfSamples(), query->field.dtype, encoded, num_samples);
     if (!decoded)
       return failed("cannot decode the data");
 
@@ -519,6 +457,8 @@ public:
   //writeBlock
   virtual void writeBlock(SharedPtr<BlockQuery> query) override
   {
+    VisusTrace("access", "IdxDiskAccess::writeBlock");
+
     BigInt blockid = query->blockid;
 
     //NOTE: ignoring aborted in writing!
@@ -551,7 +491,9 @@ public:
     //encode the data
     String compression = query->field.default_compression;
     auto decoded = query->buffer;
-    auto encoded = ArrayUtils::encodeArray(compression, decoded);
+    auto encoded = query->field.compression_dictionary ?
+      encodeWithDictionary(query->field, compression, decoded) :
+      ArrayUtils::encodeArray(compression, decoded);
     if (!encoded)
     {
       VisusAssert(false);
@@ -589,7 +531,14 @@ public:
 
     VisusAssert(block_header.getSize() && block_header.getOffset());
 
-    if (!file->write(block_header.getOffset(), block_header.getSize(), encoded->c_ptr()))
+    bool bWritten;
+    {
+      VisusTrace("access", "write");
+      Scheduler::BlockingScope blocking;
+      bWritten = file->write(block_header.getOffset(), block_header.getSize(), encoded->c_ptr());
+    }
+
+    if (!bWritten)
     {
       VisusAssert(false);
       return failed("Failed to write block write failed");
@@ -613,6 +562,7 @@ public:
 
     if (++file_locks[filename] == 1)
     {
+      Scheduler::BlockingScope blocking;
       FileUtils::lock(filename);
 
       if (bVerbose)
@@ -640,144 +590,91 @@ public:
 
 private:
 
-  enum
-  {
-    NoCompression = 0,
-    ZipCompression = 0x03,
-    JpgCompression = 0x04,
-    //ExrCompression =0x05,
-    PngCompression = 0x06,
-    Lz4Compression = 0x07,
-    ZfpCompression = 0x08,    
-    CompressionMask = 0x0f
-  };
+  typedef IdxFileHeaderV6  FileHeader;
+  typedef IdxBlockHeaderV6 BlockHeader;
 
-  enum
-  {
-    FormatRowMajor = 0x10
-  };
+  IdxDiskAccess*  owner;
+  IdxFile         idxfile;
+  String          time_template;
+  String          filename_template;
+  HeapMemory      headers;
+  FileHeader*     file_header=nullptr;
+  BlockHeader*    block_headers = nullptr;
+  SharedPtr<File> file;
+  int             mode=0;
 
-  //___________________________________________
-  class FileHeader
-  {
-  public:
+  //re-entrant file lock
+  std::map<String, int> file_locks;
 
-    Uint32 preamble_0 = 0; //not used
-    Uint32 preamble_1 = 0;
-    Uint32 preamble_2 = 0;
-    Uint32 preamble_3 = 0;
-    Uint32 preamble_4 = 0;
-    Uint32 preamble_5 = 0;
-    Uint32 preamble_6 = 0;
-    Uint32 preamble_7 = 0;
-    Uint32 preamble_8 = 0;
-    Uint32 preamble_9 = 0;
-  };
+  //encoders with a pre-trained dictionary (loading the dictionary is expensive, so I'm caching them)
+  //(the dictionary is stored in the value too, so that the raw pointer in the key stays valid)
+  //(blocks can be read/written concurrently by scheduler workers, so the map is guarded)
+  std::map< std::pair<HeapMemory*, String>, std::pair< SharedPtr<HeapMemory>, SharedPtr<Encoder> > > dictionary_encoders;
+  CriticalSection dictionary_encoders_lock;
 
-  //___________________________________________
-  class BlockHeader
+  //getDictionaryEncoder
+  SharedPtr<Encoder> getDictionaryEncoder(const Field& field, String compression)
   {
-    Uint32  prefix_0    = 0; //not used
-    Uint32  prefix_1    = 0; 
-    Uint32  offset_low  = 0;
-    Uint32  offset_high = 0;
-    Uint32  size        = 0;
-    Uint32  flags       = 0;
-    Uint32  suffix_0    = 0; //not used
-    Uint32  suffix_1    = 0; //not used
-    Uint32  suffix_2    = 0; //not used
-    Uint32  suffix_3    = 0; //not used
-
-  public:
-
-    //getOffset
-    Int64 getOffset() const {
-      Uint64 ret = (Uint64(offset_high) << 32) | (Uint64(offset_low) << 0);
-      VisusAssert((Int64)ret==ret);
-      return (Int64)ret;
-    }
-
-    //setOffset
-    void setOffset(Int64 value) {
-      VisusAssert(value >= 0);
-      VisusAssert(Uint64(value)==value);
-      offset_low  = (Uint32)(Uint64(value) & 0xffffffff);
-      offset_high = (Uint32)(Uint64(value) >> 32);
-      VisusAssert(value == getOffset());
-    }
+    ScopedLock lock(dictionary_encoders_lock);
+    auto key = std::make_pair(field.compression_dictionary.get(), compression);
+    auto it = dictionary_encoders.find(key);
+    if (it != dictionary_encoders.end())
+      return it->second.second;
 
-    //getSize
-    Int32 getSize() const {
-      VisusAssert((Int32)size == size);
-      return (Int32)size;
-    }
-    
-    //setSize
-    void setSize(Int32 value) {
-      VisusAssert(value >= 0);
-      this->size = (Uint32)value; 
-    }
+    auto encoder = Encoders::getSingleton()->createEncoder(compression);
 
-    //getLayout
-    String getLayout() const {
-      return (flags & FormatRowMajor) ? "" : "hzorder";
-    }
+    //not all encoders support dictionaries (e.g. compression can change with the level)
+    if (encoder)
+      encoder->setDictionary(field.compression_dictionary);
 
-    //setLayout
-    void setLayout(String value) {
+    dictionary_encoders[key] = std::make_pair(field.compression_dictionary, encoder);
+    return encoder;
+  }
 
-      if (value.empty() || value == "rowmajor")
-        flags |= FormatRowMajor;
-      else 
-        VisusAssert(value=="hzorder");
+  //encodeWithDictionary
+  SharedPtr<HeapMemory> encodeWithDictionary(const Field& field, String compression, Array decoded)
+  {
+    if (compression.empty())
+      return decoded.heap;
 
-    }
+    VisusTrace("encoder", "encode");
+    auto encoder = getDictionaryEncoder(field, compression);
+    return encoder ? encoder->encode(decoded.dims, decoded.dtype, decoded.heap) : SharedPtr<HeapMemory>();
+  }
 
-    //getCompression
-    String getCompression() const {
+  //decodeWithDictionary (if num_samples>=0 only the first num_samples are decoded, the others are zero)
+  Array decodeWithDictionary(const Field& field, String compression, PointNi dims, SharedPtr<HeapMemory> encoded, Int64 num_samples = -1)
+  {
+    if (compression.empty())
+      return ArrayUtils::decodeArray(compression, dims, field.dtype, encoded);
 
-      switch (flags & CompressionMask)
-      {
-        case NoCompression: return ""; break;
-        case Lz4Compression:return "lz4"; break;
-        case ZipCompression:return "zip"; break;
-        case JpgCompression:return "jpg"; break;
-        case PngCompression:return "png"; break;
-        case ZfpCompression:return "zfp"; break;
-        default: VisusAssert(false); return "";
-      }
-    }
+    VisusTrace("encoder", "decode");
+    auto decoder = getDictionaryEncoder(field, compression);
+    if (!decoder)
+      return Array();
 
-    //setCompression
-    void setCompression(String value) 
+    Int64 tot_samples = dims.innerProduct();
+    if (num_samples > 0 && num_samples < tot_samples && !(field.dtype.getBitSize(num_samples) % 8))
     {
-      if      (value.empty())  flags |= NoCompression;
-      else if (StringUtils::startsWith(value, "lz4")) flags |= Lz4Compression;
-      else if (StringUtils::startsWith(value, "zip")) flags |= ZipCompression;
-      else if (StringUtils::startsWith(value, "jpg")) flags |= JpgCompression;
-      else if (StringUtils::startsWith(value, "png")) flags |= PngCompression;
-      else if (StringUtils::startsWith(value, "zfp")) flags |= ZfpCompression;
-      else VisusAssert(false);
+      auto prefix = decoder->decodeRange(dims, field.dtype, encoded, 0, num_samples);
+      Array ret;
+      if (!prefix || !ret.resize(dims, field.dtype, __FILE__, __LINE__))
+        return Array();
+      ret.fillWithValue(0);
+      memcpy(ret.c_ptr(), prefix->c_ptr(), (size_t)prefix->c_size());
+      return ret;
     }
 
-  };
-
-  IdxDiskAccess*  owner;
-  IdxFile         idxfile;
-  String          time_template;
-  String          filename_template;
-  HeapMemory      headers;
-  FileHeader*     file_header=nullptr;
-  BlockHeader*    block_headers = nullptr;
-  SharedPtr<File> file;
-  int             mode=0;
+    auto decoded = decoder->decode(dims, field.dtype, encoded);
+    if (!decoded || decoded->c_size() != field.dtype.getByteSize(dims))
+      return Array();
 
-  //re-entrant file lock
-  std::map<String, int> file_locks;
+    return Array(dims, field.dtype, decoded);
+  }
 
   //getBlockHeader
   BlockHeader& getBlockHeader(Field& field, Int64 blockid) {
-    return block_headers[cint(field.index)*idxfile.blocksperfile + idxfile.getBlockPositionInFile(blockid)];
+    return block_headers[GetBlockHeaderIndexV6(idxfile, field, blockid)];
   }
 
   //openFile
@@ -790,6 +687,9 @@ private:
     if (filename == this->file->getFilename() && file_mode == this->file->getFileMode())
       return true;
 
+    VisusTrace("access", "open");
+    Scheduler::BlockingScope blocking; //opening and reading the headers hits the disk
+
     if (this->file->isOpen())
       closeFile("need to openFile");
 
@@ -956,7 +856,7 @@ IdxDiskAccess::IdxDiskAccess(IdxDataset* dataset,IdxFile idxfile, StringTree con
   bool disable_async = config.readBool("disable_async", dataset->isServerMode());
   if (int nthreads = disable_async ? 0 : 1)
   {
-    async_tpool = std::make_shared<ThreadPool>("IdxDiskAccess Thread", nthreads);
+    async_tpool = std::make_shared<ThreadPool>("IdxDiskAccess Thread", nthreads, Scheduler::Interactive);
   }
 #endif
 
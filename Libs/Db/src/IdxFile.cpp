@@ -387,6 +387,10 @@ String IdxFile::writeToOldFormat() const
         out<<"default_compression("<<field.default_compression <<")"<<" ";
     }
 
+    //compression_dictionary(base64)
+    if (field.compression_dictionary && version>=6)
+      out<<"compression_dictionary("<<field.compression_dictionary->base64Encode() <<")"<<" ";
+
     //default_layout(...) (1 means row major, 0 means hzorder)
     out << "default_layout("<< (field.default_layout.empty()? "row_major" : field.default_layout) <<") ";
 
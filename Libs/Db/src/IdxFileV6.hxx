@@ -0,0 +1,325 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_IDX_FILE_V6_HXX
+#define __VISUS_IDX_FILE_V6_HXX
+
+#include <Visus/IdxFile.h>
+
+namespace Visus {
+
+/*
+Packed IDX v6 file layout (shared by IdxDiskAccess and CloudStorageAccess)
+
+  [IdxFileHeaderV6][IdxBlockHeaderV6 x (nfields*blocksperfile)][encoded blocks...]
+
+All header words are stored in network byte order.
+*/
+
+//////////////////////////////////////////////////////////////////////////////
+inline String GetFilenameV56(const IdxFile& idxfile, String TimeTemplate, String FilenameTemplate, Field field, double time, BigInt blockid)
+{
+  //not really a template... one file contains all blocks
+  if (StringUtils::find(FilenameTemplate, "%")<0)
+    return FilenameTemplate;
+
+  /*
+  this version can be a little slower, but I don't think it could be the bottleneck
+  should produce exactly the same name of the old Visus code, the only difference is that
+  it creates filenames going from right to left instead of from left to right (in this way I can support regular expression!)
+
+  example:
+
+  idxdata/%03x/%02x/%01x.bin
+
+  then %01x represents the less significant 4 bits of the address  (____________________BBBB)
+  %02x represents about the middle 8 bits                     (____________BBBBBBBB____)
+  %03x represents the most significant 12 bits                (BBBBBBBBBBBB____________)
+  */
+
+  const int MaxFilenameLen = 1024;
+
+  const char hexdigits[16] = { '0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f' };
+  int digit, numbits, len, k;
+  BigInt address = idxfile.getFirstBlockInFile(blockid), partial_address;
+  char  filename[MaxFilenameLen];
+  int   N = MaxFilenameLen - 1;
+  int   S = (int)FilenameTemplate.length() - 1;
+  int   C = S;
+  int   LastC = -1;
+
+  //special case invalid block number
+  if (address<0)
+    return "";
+
+  filename[N--] = 0;
+  for (; C >= 0; C--) //going from right to left
+  {
+    if (FilenameTemplate[C] != '%') continue;
+    LastC = C;
+    digit = FilenameTemplate[C + 2] - '0';
+    numbits = digit * 4;
+    len = 1 + S - (C + 4);
+    partial_address = address & ((((BigInt)1) << numbits) - 1);
+
+    //IMPORTANT NOTE: do not use _snprintf or snprintf since they have different behaviour on windows and macosx (with the terminating zero!)
+    memcpy(filename + 1 + N - len, FilenameTemplate.c_str() + C + 4, len); N -= len;
+    for (k = 0; k<digit; k++, partial_address >>= 4) filename[N--] = hexdigits[cint64(partial_address & 0xf)];
+    address >>= numbits;
+    S = C - 1;
+  }
+
+  while (address != 0) //still address is non zero, must recycle the last template
+  {
+    C = LastC;
+    VisusAssert(LastC >= 0);
+    digit = FilenameTemplate[C + 2] - '0';
+    numbits = digit * 4;
+    partial_address = address & ((((BigInt)1) << numbits) - 1);
+    filename[N--] = '/'; //ignore what is in the template, use a simple separator!
+    for (k = 0; k<digit; k++, partial_address >>= 4) filename[N--] = hexdigits[cint64(partial_address & 0xf)];
+    address >>= numbits;
+  }
+
+  //time template
+  if (!TimeTemplate.empty())
+  {
+    char temp[1024] = { 0 }; //1024 seems enough only for the time!
+    int nwritten = sprintf(temp, TimeTemplate.c_str(), (int)time);
+    VisusAssert(nwritten<(sizeof(temp) - 1));
+    TimeTemplate = temp;
+
+    int len = (int)TimeTemplate.length();
+    memcpy(filename + 1 + N - len, TimeTemplate.c_str(), len);
+    N -= len;
+  }
+
+  //dump what is remained on the right
+  memcpy(filename + 1 + N - (1 + S), FilenameTemplate.c_str(), 1 + S);
+  return String(filename + N - S);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+class IdxFileHeaderV6
+{
+public:
+
+  Uint32 preamble_0 = 0; //not used
+  Uint32 preamble_1 = 0;
+  Uint32 preamble_2 = 0;
+  Uint32 preamble_3 = 0;
+  Uint32 preamble_4 = 0;
+  Uint32 preamble_5 = 0;
+  Uint32 preamble_6 = 0;
+  Uint32 preamble_7 = 0;
+  Uint32 preamble_8 = 0;
+  Uint32 preamble_9 = 0;
+};
+
+//////////////////////////////////////////////////////////////////////////////
+class IdxBlockHeaderV6
+{
+public:
+
+  enum
+  {
+    NoCompression = 0,
+    ZipCompression = 0x03,
+    JpgCompression = 0x04,
+    //ExrCompression =0x05,
+    PngCompression = 0x06,
+    Lz4Compression = 0x07,
+    ZfpCompression = 0x08,    
+    ChunkedCompression = 0x09,
+    ZstdCompression = 0x0a,
+    CompressionMask = 0x0f
+  };
+
+  enum
+  {
+    FormatRowMajor = 0x10
+  };
+
+  //pre-filters applied before the codec (see FilteredEncoder)
+  enum
+  {
+    DeltaFilter      = 0x100,
+    XorFilter        = 0x200,
+    ShuffleFilter    = 0x400,
+    BitShuffleFilter = 0x800,
+    FilterMask       = 0xf00
+  };
+
+private:
+
+  Uint32  prefix_0    = 0; //not used
+  Uint32  prefix_1    = 0; 
+  Uint32  offset_low  = 0;
+  Uint32  offset_high = 0;
+  Uint32  size        = 0;
+  Uint32  flags       = 0;
+  Uint32  suffix_0    = 0; //not used
+  Uint32  suffix_1    = 0; //not used
+  Uint32  suffix_2    = 0; //not used
+  Uint32  suffix_3    = 0; //not used
+
+public:
+
+  //getOffset
+  Int64 getOffset() const {
+    Uint64 ret = (Uint64(offset_high) << 32) | (Uint64(offset_low) << 0);
+    VisusAssert((Int64)ret==ret);
+    return (Int64)ret;
+  }
+
+  //setOffset
+  void setOffset(Int64 value) {
+    VisusAssert(value >= 0);
+    VisusAssert(Uint64(value)==value);
+    offset_low  = (Uint32)(Uint64(value) & 0xffffffff);
+    offset_high = (Uint32)(Uint64(value) >> 32);
+    VisusAssert(value == getOffset());
+  }
+
+  //getSize
+  Int32 getSize() const {
+    VisusAssert((Int32)size == size);
+    return (Int32)size;
+  }
+  
+  //setSize
+  void setSize(Int32 value) {
+    VisusAssert(value >= 0);
+    this->size = (Uint32)value; 
+  }
+
+  //getLayout
+  String getLayout() const {
+    return (flags & FormatRowMajor) ? "" : "hzorder";
+  }
+
+  //setLayout
+  void setLayout(String value) {
+
+    if (value.empty() || value == "rowmajor")
+      flags |= FormatRowMajor;
+    else 
+      VisusAssert(value=="hzorder");
+
+  }
+
+  //getCompression
+  String getCompression() const 
+  {
+    String codec;
+    switch (flags & CompressionMask)
+    {
+      case NoCompression: codec = ""; break;
+      case Lz4Compression:codec = "lz4"; break;
+      case ZipCompression:codec = "zip"; break;
+      case JpgCompression:codec = "jpg"; break;
+      case PngCompression:codec = "png"; break;
+      case ZfpCompression:codec = "zfp"; break;
+      case ChunkedCompression:codec = "chunked"; break;
+      case ZstdCompression:codec = "zstd"; break;
+      default: VisusAssert(false); return "";
+    }
+
+    //filters in canonical order, followed by the codec
+    std::vector<String> ret;
+    if (flags & DeltaFilter     ) ret.push_back("delta");
+    if (flags & XorFilter       ) ret.push_back("xor");
+    if (flags & ShuffleFilter   ) ret.push_back("shuffle");
+    if (flags & BitShuffleFilter) ret.push_back("bitshuffle");
+
+    if (!codec.empty() || ret.empty())
+      ret.push_back(codec);
+
+    return StringUtils::join(ret, "+");
+  }
+
+  //setCompression
+  void setCompression(String value) 
+  {
+    //example: "delta+shuffle+lz4"
+    //note: "chunked-shuffle+lz4" is a single codec, the chunked container records its own inner specs
+    String codec;
+    for (auto it : StringUtils::split(value, "+"))
+    {
+      it = StringUtils::trim(it);
+      if (StringUtils::startsWith(it, "chunked"))
+      {
+        codec = it;
+        break;
+      }
+
+      if      (it == "delta"     ) flags |= DeltaFilter;
+      else if (it == "xor"       ) flags |= XorFilter;
+      else if (it == "shuffle"   ) flags |= ShuffleFilter;
+      else if (it == "bitshuffle") flags |= BitShuffleFilter;
+      else codec = it;
+    }
+    value = codec;
+
+    if      (value.empty())  flags |= NoCompression;
+    else if (StringUtils::startsWith(value, "lz4")) flags |= Lz4Compression;
+    else if (StringUtils::startsWith(value, "zip")) flags |= ZipCompression;
+    else if (StringUtils::startsWith(value, "jpg")) flags |= JpgCompression;
+    else if (StringUtils::startsWith(value, "png")) flags |= PngCompression;
+    else if (StringUtils::startsWith(value, "zfp")) flags |= ZfpCompression;
+    else if (StringUtils::startsWith(value, "chunked")) flags |= ChunkedCompression;
+    else if (StringUtils::startsWith(value, "zstd")) flags |= ZstdCompression;
+    else VisusAssert(false);
+  }
+
+};
+
+//////////////////////////////////////////////////////////////////////////////
+inline Int64 GetHeadersSizeV6(const IdxFile& idxfile) {
+  return (Int64)sizeof(IdxFileHeaderV6) + (Int64)idxfile.blocksperfile * (Int64)idxfile.fields.size() * (Int64)sizeof(IdxBlockHeaderV6);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+inline int GetBlockHeaderIndexV6(const IdxFile& idxfile, const Field& field, BigInt blockid) {
+  return cint(field.index) * idxfile.blocksperfile + (int)idxfile.getBlockPositionInFile(blockid);
+}
+
+} //namespace Visus
+
+#endif //__VISUS_IDX_FILE_V6_HXX
+
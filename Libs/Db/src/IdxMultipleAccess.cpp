@@ -38,6 +38,7 @@ For support : support@visus.net
 
 #include <Visus/IdxMultipleAccess.h>
 #include <Visus/IdxMultipleDataset.h>
+#include <Visus/Trace.h>
 
 namespace Visus {
 
@@ -69,7 +70,7 @@ IdxMultipleAccess::IdxMultipleAccess(IdxMultipleDataset* VF_, StringTree CONFIG_
   //  ;
 
   if (int nthreads = disable_async ? 0 : 3)
-    this->thread_pool = std::make_shared<ThreadPool>("IdxMultipleAccess Worker", nthreads);
+    this->thread_pool = std::make_shared<ThreadPool>("IdxMultipleAccess Worker", nthreads, Scheduler::Interactive);
 }
 
 //destructor
@@ -113,6 +114,8 @@ void IdxMultipleAccess::readBlock(SharedPtr<BlockQuery> BLOCKQUERY)
 {
   ThreadPool::push(thread_pool, [this, BLOCKQUERY]()
   {
+    VisusTrace("access", "IdxMultipleAccess::readBlock");
+
     if (BLOCKQUERY->aborted())
       return readFailed(BLOCKQUERY);
 
@@ -45,6 +45,11 @@ For support : support@visus.net
 #include <Visus/IdxDataset.h>
 #include <Visus/IdxMultipleDataset.h>
 #include <Visus/IdxFilter.h>
+#include <Visus/Trace.h>
+#include <Visus/LatencyHistogram.h>
+#include <Visus/MultiplexAccess.h>
+#include <Visus/ThreadPool.h>
+#include <Visus/RamResource.h>
 #include <Visus/IdxMultipleDataset.h>
 
 namespace Visus {
@@ -186,7 +191,233 @@ private:
 };
 
 ////////////////////////////////////////////////////////////////////////////////
-ModVisus::ModVisus()
+/*
+Request metrics, served in the Prometheus text format by action=metrics.
+
+Counters are atomics and histograms are lock-free, the lock is taken in write mode only
+the first time an (action,dataset) pair is seen.
+*/
+class ModVisus::Metrics
+{
+public:
+
+  //one per (action,dataset)
+  class Series
+  {
+  public:
+
+    VISUS_NON_COPYABLE_CLASS(Series)
+
+    String             action;
+    String             dataset;
+    LatencyHistogram   latency;
+    std::atomic<Int64> num_errors{ 0 };
+    std::atomic<Int64> sent_bytes{ 0 };    //response body
+    std::atomic<Int64> block_rok{ 0 };
+    std::atomic<Int64> block_rfail{ 0 };
+    std::atomic<Int64> cache_lookups{ 0 }; //blocks looked up in the first child of a MultiplexAccess
+    std::atomic<Int64> cache_hits{ 0 };    //blocks found in any child but the last one
+
+    //constructor
+    Series(String action_, String dataset_) : action(action_), dataset(dataset_) {
+    }
+  };
+
+  Int64 start_time = LatencyHistogram::now();
+
+  //constructor
+  Metrics() {
+  }
+
+  //getSeries
+  SharedPtr<Series> getSeries(String action, String dataset)
+  {
+    auto key = std::make_pair(action, dataset);
+    {
+      ScopedReadLock read_lock(lock);
+      auto it = series.find(key);
+      if (it != series.end())
+        return it->second;
+    }
+
+    ScopedWriteLock write_lock(lock);
+    auto& ret = series[key];
+    if (!ret)
+      ret = std::make_shared<Series>(action, dataset);
+    return ret;
+  }
+
+  //onAccessDone (call it when all the reads of the access are done)
+  void onAccessDone(String action, String dataset, SharedPtr<Access> access)
+  {
+    if (!access)
+      return;
+
+    auto series = getSeries(action, dataset);
+    series->block_rok   += access->statistics.rok;
+    series->block_rfail += access->statistics.rfail;
+
+    if (auto multiplex = std::dynamic_pointer_cast<MultiplexAccess>(access))
+    {
+      int N = (int)multiplex->dw_access.size();
+      if (N >= 2)
+      {
+        series->cache_lookups += multiplex->getStatistics(0).num_reads;
+        for (int I = 0; I < N - 1; I++)
+          series->cache_hits += multiplex->getStatistics(I).num_hits;
+      }
+    }
+  }
+
+  //toPrometheus
+  String toPrometheus();
+
+private:
+
+  VISUS_NON_COPYABLE_CLASS(Metrics)
+
+  RWLock lock;
+  std::map< std::pair<String, String>, SharedPtr<Series> > series;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+static String PrometheusEscape(String value)
+{
+  value = StringUtils::replaceAll(value, "\\", "\\\\");
+  value = StringUtils::replaceAll(value, "\"", "\\\"");
+  value = StringUtils::replaceAll(value, "\n", "\\n");
+  return value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+String ModVisus::Metrics::toPrometheus()
+{
+  std::vector< SharedPtr<Series> > series;
+  {
+    ScopedReadLock read_lock(lock);
+    for (auto it : this->series)
+      series.push_back(it.second);
+  }
+
+  std::ostringstream out;
+  out.precision(12);
+
+  auto header = [&out](String name, String type, String help) {
+    out << "# HELP " << name << " " << help << "\n";
+    out << "# TYPE " << name << " " << type << "\n";
+  };
+
+  auto labels = [](SharedPtr<Series> it, String extra) {
+    return "{action=\"" + PrometheusEscape(it->action) + "\",dataset=\"" + PrometheusEscape(it->dataset) + "\"" + extra + "}";
+  };
+
+  auto seconds = [](Int64 usec) {
+    std::ostringstream out;
+    out.precision(12);
+    out << usec / 1000000.0;
+    return out.str();
+  };
+
+  //latency (octave boundaries are exact bucket boundaries of the histogram, from 128us to ~67s)
+  header("visus_request_duration_seconds", "histogram", "ModVisus request latency.");
+  for (auto it : series)
+  {
+    auto series_labels = "action=\"" + PrometheusEscape(it->action) + "\",dataset=\"" + PrometheusEscape(it->dataset) + "\"";
+    out << it->latency.toPrometheus("visus_request_duration_seconds", series_labels, 7, 26);
+  }
+
+  header("visus_request_duration_quantile_seconds", "gauge", "ModVisus request latency quantiles since the server started.");
+  for (auto it : series)
+  {
+    for (auto q : { "0.5", "0.9", "0.99" })
+      out << "visus_request_duration_quantile_seconds" << labels(it, String(",quantile=\"") + q + "\"") << " " << seconds(it->latency.getQuantile(cdouble(q))) << "\n";
+  }
+
+  header("visus_request_errors_total", "counter", "ModVisus requests with a non 2xx status.");
+  for (auto it : series)
+    out << "visus_request_errors_total" << labels(it, "") << " " << it->num_errors << "\n";
+
+  header("visus_response_body_bytes_total", "counter", "ModVisus response body bytes sent.");
+  for (auto it : series)
+    out << "visus_response_body_bytes_total" << labels(it, "") << " " << it->sent_bytes << "\n";
+
+  header("visus_block_reads_total", "counter", "Blocks read by the accesses of ModVisus requests.");
+  for (auto it : series)
+  {
+    if (!it->block_rok && !it->block_rfail) continue;
+    out << "visus_block_reads_total" << labels(it, ",result=\"ok\"") << " " << it->block_rok << "\n";
+    out << "visus_block_reads_total" << labels(it, ",result=\"fail\"") << " " << it->block_rfail << "\n";
+  }
+
+  header("visus_block_cache_lookups_total", "counter", "Blocks looked up in the cache of a multiplex access.");
+  for (auto it : series)
+  {
+    if (it->cache_lookups)
+      out << "visus_block_cache_lookups_total" << labels(it, "") << " " << it->cache_lookups << "\n";
+  }
+
+  header("visus_block_cache_hits_total", "counter", "Blocks found in the cache of a multiplex access.");
+  for (auto it : series)
+  {
+    if (it->cache_lookups)
+      out << "visus_block_cache_hits_total" << labels(it, "") << " " << it->cache_hits << "\n";
+  }
+
+  header("visus_block_cache_hit_ratio", "gauge", "Block cache hit ratio since the server started.");
+  for (auto it : series)
+  {
+    Int64 lookups = it->cache_lookups;
+    if (lookups)
+      out << "visus_block_cache_hit_ratio" << labels(it, "") << " " << it->cache_hits / (double)lookups << "\n";
+  }
+
+  //process-wide
+  auto value = [&](String name, String type, String help, double value) {
+    header(name, type, help);
+    out << name << " " << value << "\n";
+  };
+
+  value("visus_uptime_seconds", "gauge", "Seconds since ModVisus started.", (LatencyHistogram::now() - start_time) / 1000000.0);
+
+  auto file_stats = File::global_stats();
+  value("visus_file_read_bytes_total", "counter", "Bytes read from files.", (double)file_stats->getReadBytes());
+  value("visus_file_write_bytes_total", "counter", "Bytes written to files.", (double)file_stats->getWriteBytes());
+  value("visus_file_opened_total", "counter", "Files opened.", (double)file_stats->getNumOpen());
+  value("visus_file_open", "gauge", "Files currently open.", (double)file_stats->getNumCurrentlyOpen());
+
+  auto net_stats = NetService::global_stats();
+  value("visus_net_requests_total", "counter", "Outgoing network requests.", (double)net_stats->getNumRequests());
+  value("visus_net_read_bytes_total", "counter", "Bytes received by outgoing network requests.", (double)net_stats->getReadBytes());
+  value("visus_net_write_bytes_total", "counter", "Bytes sent by outgoing network requests.", (double)net_stats->getWriteBytes());
+  value("visus_net_running_requests", "gauge", "Outgoing network requests in flight.", (double)net_stats->running_requests);
+
+  auto block_stats = BlockQuery::global_stats();
+  value("visus_block_queries_read_total", "counter", "Block queries for reading.", (double)block_stats->getNumRead());
+  value("visus_block_queries_write_total", "counter", "Block queries for writing.", (double)block_stats->getNumWrite());
+
+  value("visus_threads_running", "gauge", "Running threads.", (double)Thread::global_stats()->getNumRunningThreads());
+  value("visus_threadpool_jobs", "gauge", "Jobs queued or running in all thread pools.", (double)ThreadPool::global_stats()->getNumRunningJobs());
+  if (auto scheduler = Scheduler::getSingleton())
+  {
+    value("visus_scheduler_pending_jobs", "gauge", "Jobs pushed to the scheduler and not yet completed.", (double)scheduler->getNumPendingJobs());
+    value("visus_scheduler_workers", "gauge", "Scheduler worker threads.", (double)scheduler->getNumWorkers());
+  }
+
+  if (auto ram = RamResource::getSingleton())
+  {
+    value("visus_ram_used_bytes", "gauge", "Memory used by the process.", (double)ram->getVisusUsedMemory());
+    value("visus_ram_heap_bytes", "gauge", "Memory allocated by HeapMemory.", (double)ram->getHeapMemory());
+    value("visus_ram_pooled_bytes", "gauge", "Memory freed by HeapMemory but cached in its pools.", (double)ram->getPooledMemory());
+    value("visus_ram_os_used_bytes", "gauge", "Memory used by the operating system.", (double)ram->getOsUsedMemory());
+    value("visus_ram_os_total_bytes", "gauge", "Total memory of the operating system.", (double)ram->getOsTotalMemory());
+  }
+
+  return out.str();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+ModVisus::ModVisus() : metrics(std::make_shared<Metrics>())
 {
 }
 
@@ -466,6 +697,8 @@ NetResponse ModVisus::handleHtmlForPlugin(const NetRequest& request)
 ///////////////////////////////////////////////////////////////////////////
 NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
 {
+  VisusTrace("modvisus", "ModVisus::handleBlockQuery");
+
   auto datasets=getDatasets();
 
   String dataset_name = request.url.getParam("dataset");
@@ -500,7 +733,66 @@ NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
   if (!field.valid())
     return NetResponseError(HttpStatus::STATUS_NOT_FOUND, "Cannot find field(" + fieldname + ")");
 
-  bool bHasFilter = !field.filter.empty();
+  //encode data
+  auto encodeBlock = [dataset, compression](SharedPtr<BlockQuery> block_query)
+  {
+    if (block_query->failed())
+      return NetResponseError(HttpStatus::STATUS_NOT_FOUND, "block_query->executeAndWait failed");
+
+    NetResponse response(HttpStatus::STATUS_OK);
+    if (!response.setArrayBody(compression, block_query->buffer))
+    {
+      //maybe i need to convert to row major to compress
+      if (!(dataset->convertBlockQueryToRowMajor(block_query) && response.setArrayBody(compression, block_query->buffer)))
+        return NetResponseError(HttpStatus::STATUS_INTERNAL_SERVER_ERROR, "Encoding converting to row major failed");
+    }
+    return response;
+  };
+
+  //streamed: each block is sent as soon as it's encoded (in completion order, the client matches them by visus-blockid)
+  if (cbool(request.url.getParam("stream", "0")))
+  {
+    NetResponse RESPONSE(HttpStatus::STATUS_OK);
+    RESPONSE.setHeader("response-compose-stream", "1");
+    RESPONSE.setContentType("application/octet-stream");
+    auto metrics = this->metrics;
+    RESPONSE.body_stream = [datasets, dataset, dataset_name, field, time, blocks, encodeBlock, metrics](std::function<bool(const Uint8*, Int64)> write)
+    {
+      auto access = dataset->createAccessForBlockQuery();
+
+      CriticalSection write_lock;
+      bool bWriteOk = true;
+
+      WaitAsync< Future<Void> > wait_async;
+      access->beginRead();
+      Aborted aborted;
+      for (auto blockid : blocks)
+      {
+        auto block_query = dataset->createBlockQuery(blockid, field, time, 'r', aborted);
+        dataset->executeBlockQuery(access, block_query);
+        wait_async.pushRunning(block_query->done).when_ready([block_query, blockid, encodeBlock, write, &write_lock, &bWriteOk, &aborted](Void) {
+
+          auto response = encodeBlock(block_query);
+          response.setHeader("visus-blockid", cstring(blockid));
+          auto header = response.getFrameHeader();
+
+          ScopedLock lock(write_lock);
+          bWriteOk = bWriteOk
+            && write((const Uint8*)header.c_str(), (Int64)header.size())
+            && (!response.body || write(response.body->c_ptr(), response.body->c_size()));
+
+          //the client went away, no reason to read the other blocks
+          if (!bWriteOk)
+            aborted.setTrue();
+        });
+      }
+      access->endRead();
+
+      wait_async.waitAllDone();
+      metrics->onAccessDone("blockquery", dataset_name, access);
+    };
+    return RESPONSE;
+  }
 
   auto access = dataset->createAccessForBlockQuery();
 
@@ -508,37 +800,19 @@ NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
   access->beginRead();
   Aborted aborted;
 
-  std::vector<NetResponse> responses;
-  for (auto blockid : blocks)
+  std::vector<NetResponse> responses(blocks.size());
+  for (int I = 0; I < (int)blocks.size(); I++)
   {
-    auto block_query = dataset->createBlockQuery(blockid, field, time, 'r', aborted);
+    auto block_query = dataset->createBlockQuery(blocks[I], field, time, 'r', aborted);
     dataset->executeBlockQuery(access, block_query);
-    wait_async.pushRunning(block_query->done).when_ready([block_query, &responses, dataset, compression](Void) {
-
-      if (block_query->failed())
-      {
-        responses.push_back(NetResponseError(HttpStatus::STATUS_NOT_FOUND, "block_query->executeAndWait failed"));
-        return;
-      }
-
-      //encode data
-      NetResponse response(HttpStatus::STATUS_OK);
-      if (!response.setArrayBody(compression, block_query->buffer))
-      {
-        //maybe i need to convert to row major to compress
-        if (!(dataset->convertBlockQueryToRowMajor(block_query) && response.setArrayBody(compression, block_query->buffer)))
-        {
-          responses.push_back(NetResponseError(HttpStatus::STATUS_INTERNAL_SERVER_ERROR, "Encoding converting to row major failed"));
-          return;
-        }
-      }
-
-      responses.push_back(response);
+    wait_async.pushRunning(block_query->done).when_ready([block_query, I, &responses, encodeBlock](Void) {
+      responses[I] = encodeBlock(block_query);
     });
   }
   access->endRead();
 
   wait_async.waitAllDone();
+  metrics->onAccessDone("blockquery", dataset_name, access);
 
   return NetResponse::compose(responses);
 }
@@ -546,6 +820,8 @@ NetResponse ModVisus::handleBlockQuery(const NetRequest& request)
 ///////////////////////////////////////////////////////////////////////////
 NetResponse ModVisus::handleBoxQuery(const NetRequest& request)
 {
+  VisusTrace("modvisus", "ModVisus::handleBoxQuery");
+
   auto dataset_name = request.url.getParam("dataset");
   auto fromh = cint(request.url.getParam("fromh"));
   auto endh = cint(request.url.getParam("toh"));
@@ -566,6 +842,55 @@ NetResponse ModVisus::handleBoxQuery(const NetRequest& request)
   if (!field.valid())
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "Cannot find fieldname(" + fieldname + ")");
 
+  //streamed: the query stays open and sends only the new samples of each resolution, the client merges them
+  //first frame is [0,min(bitsperblock,first_toh)] (all in block 0), then one frame per level up to <toh>
+  if (cbool(request.url.getParam("stream", "0")))
+  {
+    auto logic_box = BoxNi::parseFromOldFormatString(pdim, request.url.getParam("box"));
+    auto first_toh = std::min(dataset->getDefaultBitsPerBlock(), cint(request.url.getParam("first_toh", cstring(endh))));
+
+    NetResponse RESPONSE(HttpStatus::STATUS_OK);
+    RESPONSE.setHeader("response-compose-stream", "1");
+    RESPONSE.setContentType("application/octet-stream");
+    auto metrics = this->metrics;
+    RESPONSE.body_stream = [datasets, dataset, dataset_name, field, time, logic_box, fromh, endh, first_toh, compression, metrics](std::function<bool(const Uint8*, Int64)> write)
+    {
+      auto access = dataset->createAccess();
+
+      //frame [A,B]: the first one can cover several levels, then one level each
+      int first_endh = fromh == 0 ? std::max(0, std::min(first_toh, endh)) : fromh;
+      for (int A = fromh, B = first_endh; A <= endh; A = B + 1, B = A)
+      {
+        auto query = dataset->createBoxQuery(logic_box, field, time, 'r', Aborted());
+        query->setResolutionRange(A, B);
+        query->disableFilters();
+        dataset->beginBoxQuery(query);
+
+        NetResponse response(HttpStatus::STATUS_NO_CONTENT);
+        if (query->isRunning())
+        {
+          if (!dataset->executeBoxQuery(access, query))
+            response = NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->executeBoxQuery() failed " + query->errormsg);
+          else if (!(response = NetResponse(HttpStatus::STATUS_OK)).setArrayBody(compression, query->buffer))
+            response = NetResponseError(HttpStatus::STATUS_INTERNAL_SERVER_ERROR, "NetResponse encodeBuffer failed");
+        }
+
+        response.setHeader("visus-fromh", cstring(A));
+        response.setHeader("visus-toh", cstring(B));
+
+        auto header = response.getFrameHeader();
+        bool bWriteOk = write((const Uint8*)header.c_str(), (Int64)header.size())
+          && (!response.body || write(response.body->c_ptr(), response.body->c_size()));
+
+        //client went away or no reason to continue
+        if (!bWriteOk || !(response.isSuccessful()))
+          break;
+      }
+      metrics->onAccessDone("boxquery", dataset_name, access);
+    };
+    return RESPONSE;
+  }
+
   //TODO: how can I get the aborted from network?
 
   Array buffer;
@@ -594,7 +919,9 @@ NetResponse ModVisus::handleBoxQuery(const NetRequest& request)
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->beginBoxQuery() failed " + query->errormsg);
 
   auto access = dataset->createAccess();
-  if (!dataset->executeBoxQuery(access, query))
+  bool bOk = dataset->executeBoxQuery(access, query);
+  metrics->onAccessDone("boxquery", dataset_name, access);
+  if (!bOk)
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->executeBoxQuery() failed " + query->errormsg);
 
   buffer = query->buffer;
@@ -651,6 +978,8 @@ NetResponse ModVisus::handleBoxQuery(const NetRequest& request)
 ///////////////////////////////////////////////////////////////////////////
 NetResponse ModVisus::handlePointQuery(const NetRequest& request)
 {
+  VisusTrace("modvisus", "ModVisus::handlePointQuery");
+
   auto dataset_name = request.url.getParam("dataset");
   auto fromh = cint(request.url.getParam("fromh"));
   auto endh = cint(request.url.getParam("toh"));
@@ -697,7 +1026,9 @@ NetResponse ModVisus::handlePointQuery(const NetRequest& request)
   if (!query->isRunning())
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->beginBoxQuery() failed " + query->errormsg);
 
-  if (!dataset->executePointQuery(access, query))
+  bool bOk = dataset->executePointQuery(access, query);
+  metrics->onAccessDone("pointquery", dataset_name, access);
+  if (!bOk)
     return NetResponseError(HttpStatus::STATUS_BAD_REQUEST, "dataset->executeBoxQuery() failed " + query->errormsg);
 
   buffer = query->buffer;
@@ -740,10 +1071,22 @@ NetResponse ModVisus::handlePointQuery(const NetRequest& request)
   return response;
 }
 
+///////////////////////////////////////////////////////////////////////////
+NetResponse ModVisus::handleMetrics(const NetRequest& request)
+{
+  NetResponse response(HttpStatus::STATUS_OK);
+  response.setTextBody(metrics->toPrometheus());
+  response.setContentType("text/plain; version=0.0.4");
+  return response;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 NetResponse ModVisus::handleRequest(NetRequest request)
 {
+  VisusTrace("modvisus", "ModVisus::handleRequest");
+
   Time t1 = Time::now();
+  Int64 t0 = LatencyHistogram::now();
 
   //default action
   if (request.url.getParam("action").empty())
@@ -766,6 +1109,14 @@ NetResponse ModVisus::handleRequest(NetRequest request)
 
   String action = request.url.getParam("action");
 
+  //aliases share the same metrics
+  String metrics_action = action;
+  if (action == "rangequery") metrics_action = "blockquery";
+  else if (action == "query") metrics_action = "boxquery";
+  else if (action == "read_dataset") metrics_action = "readdataset";
+  else if (action == "configure_datasets" || action == "configure") metrics_action = "reload";
+  else if (action == "AddDataset") metrics_action = "add_dataset";
+
   NetResponse response;
 
   if (action == "rangequery" || action == "blockquery")
@@ -789,14 +1140,62 @@ NetResponse ModVisus::handleRequest(NetRequest request)
   else if (action == "AddDataset" || action == "add_dataset")
     response = handleAddDataset(request);
 
+  //spans collected so far (Chrome trace JSON)
+  else if (action == "trace")
+  {
+    response = NetResponse(HttpStatus::STATUS_OK);
+    response.setJSONBody(Trace::toChromeJSON());
+    if (cbool(request.url.getParam("clear", "0")))
+      Trace::clear();
+  }
+
+  else if (action == "metrics")
+    response = handleMetrics(request);
+
   else if (action == "ping")
   {
     response = NetResponse(HttpStatus::STATUS_OK);
     response.setHeader("block-query-support-aggregation", "1");
+    response.setHeader("block-query-support-streaming", "1");
+    response.setHeader("box-query-support-streaming", "1");
   }
 
   else
+  {
     response = NetResponseError(HttpStatus::STATUS_NOT_FOUND, "unknown action(" + action + ")");
+    metrics_action = "unknown";
+  }
+
+  //keep the number of series bounded: only existing datasets get their own
+  {
+    String metrics_dataset = request.url.getParam("dataset");
+    auto datasets = getDatasets();
+    if (!metrics_dataset.empty() && !(datasets && datasets->findDataset(metrics_dataset)))
+      metrics_dataset = "";
+
+    auto series = metrics->getSeries(metrics_action, metrics_dataset);
+    if (!response.isSuccessful())
+      ++series->num_errors;
+
+    //a streamed body is produced while sending, the latency includes it
+    if (response.body_stream)
+    {
+      auto body_stream = response.body_stream;
+      response.body_stream = [body_stream, series, t0](std::function<bool(const Uint8*, Int64)> write)
+      {
+        body_stream([series, write](const Uint8* buffer, Int64 size) {
+          series->sent_bytes += size;
+          return write(buffer, size);
+        });
+        series->latency.record(LatencyHistogram::now() - t0);
+      };
+    }
+    else
+    {
+      series->sent_bytes += response.body ? response.body->c_size() : 0;
+      series->latency.record(LatencyHistogram::now() - t0);
+    }
+  }
 
   PrintInfo(
     "request", request.url,
@@ -39,13 +39,14 @@ For support : support@visus.net
 #include <Visus/ModVisusAccess.h>
 #include <Visus/Dataset.h>
 #include <Visus/NetService.h>
+#include <Visus/Trace.h>
 
 namespace Visus {
 
 
 ///////////////////////////////////////////////////////////////////////////////////////
 ModVisusAccess::ModVisusAccess(Dataset* dataset,StringTree config_)
-  : config(config_)
+  : config(config_), num_queries_per_request(1), num_running(0)
 {
   this->name = "ModVisusAccess";
   this->can_read  = StringUtils::find(config.readString("chmod", DefaultChMod), "r") >= 0;
@@ -64,6 +65,7 @@ ModVisusAccess::ModVisusAccess(Dataset* dataset,StringTree config_)
     url.setParam("action", "ping");
 
     auto request = NetRequest(url);
+    auto t1 = Time::now();
     auto response = NetService::getNetResponse(request);
     bool bSupportAggregation = cbool(response.getHeader("block-query-support-aggregation", "0"));
     if (!bSupportAggregation)
@@ -71,12 +73,24 @@ ModVisusAccess::ModVisusAccess(Dataset* dataset,StringTree config_)
       PrintInfo("Server does not support block-query-support-aggregation, so I'm overriding num_queries_per_request to be 1");
       num_queries_per_request = 1;
     }
+    else
+    {
+      //the ping is the first estimation of the round trip time (it includes the connection setup, as every request does)
+      link.rtt_msec = (double)t1.elapsedMsec();
+
+      this->streaming = config.readBool("streaming", cbool(response.getHeader("block-query-support-streaming", "0")));
+      //an explicit num_queries_per_request is kept as it is, unless adaptive is asked too
+      this->adaptive = config.readBool("adaptive", !this->config.hasAttribute("num_queries_per_request"));
+      this->min_queries_per_request = config.readInt("min_queries_per_request", 1);
+      this->max_queries_per_request = config.readInt("max_queries_per_request", 64);
+      this->transfer_rtt_ratio = cdouble(config.readString("transfer_rtt_ratio", "2.0"));
+    }
   }
 
   bool disable_async = dataset->isServerMode() || config.readBool("disable_async", false);
   if (!disable_async)
   {
-    int nconnections = config.readInt("nconnections", (num_queries_per_request == 1)? (8) : (2));
+    this->nconnections = config.readInt("nconnections", (num_queries_per_request == 1)? (8) : (4));
     this->netservice = std::make_shared<NetService>(nconnections);
   }
 
@@ -109,18 +123,70 @@ void ModVisusAccess::readBlock(SharedPtr<BlockQuery> query)
 }
 
 
+//////////////////////////////////////////////////////////////////////////////////////
+void ModVisusAccess::readBlockFromResponse(SharedPtr<BlockQuery> query, NetResponse response)
+{
+  VisusTrace("access", "ModVisusAccess::readBlockFromResponse");
+
+  if (!response.hasHeader("visus-dtype"))
+    response.setHeader("visus-dtype", query->field.dtype.toString());
+
+  if (!response.hasHeader("visus-nsamples"))
+    response.setHeader("visus-nsamples", query->getNumberOfSamples().toString());
+
+  if (query->aborted() || !response.isSuccessful())
+    return readFailed(query);
+
+  auto decoded = response.getCompatibleArrayBody(query->getNumberOfSamples(), query->field.dtype);
+  if (!decoded)
+    return readFailed(query);
+
+  query->buffer = decoded;
+  readOk(query);
+}
+
+//////////////////////////////////////////////////////////////////////////////////////
+void ModVisusAccess::updateLink(double rtt_msec, double transfer_msec, Int64 nbytes, int nblocks)
+{
+  if (!adaptive || !nblocks || !nbytes)
+    return;
+
+  const double alpha = 0.25;
+  auto ewma = [&](double& value, double sample) {
+    value = value ? (1.0 - alpha) * value + alpha * sample : sample;
+  };
+
+  ScopedLock lock(link_lock);
+
+  if (rtt_msec > 0)
+    ewma(link.rtt_msec, rtt_msec);
+
+  ewma(link.block_size, (double)nbytes / nblocks);
+
+  //too short to say anything about the bandwidth
+  if (transfer_msec >= 1)
+    ewma(link.bandwidth, nbytes / (transfer_msec / 1000.0));
+
+  if (!link.bandwidth)
+    return;
+
+  //the transfer of a batch should take transfer_rtt_ratio times the round trip, so that the latency is amortized
+  //and the first blocks still arrive early (the other connections keep more batches in flight)
+  double target = transfer_rtt_ratio * (link.rtt_msec / 1000.0) * link.bandwidth / link.block_size;
+  this->num_queries_per_request = Utils::clamp((int)target, min_queries_per_request, max_queries_per_request);
+}
+
 //////////////////////////////////////////////////////////////////////////////////////
 void ModVisusAccess::flushBatch()
 {
+  VisusTrace("access", "ModVisusAccess::flushBatch");
+
   if (batch.empty())
     return;
 
   Batch batch;
   std::swap(batch,this->batch);
 
-
-
-
   Url URL(this->url.getProtocol() + "://" + this->url.getHostname() + ":" + cstring(this->url.getPort()) + "/mod_visus");
   URL.setParam("action"      , "rangequery");
   URL.setParam("dataset"     , this->url.getParam("dataset"));
@@ -149,46 +215,84 @@ void ModVisusAccess::flushBatch()
     URL.setParam("to"  , StringUtils::join(to));
   }
 
+  if (streaming)
+    URL.setParam("stream", "1");
+
   auto REQUEST=NetRequest(URL);
   REQUEST.aborted=batch[0]->aborted;
 
-  NetService::push(netservice, REQUEST).when_ready([this,batch](NetResponse RESPONSE)
-  {
-    std::vector<NetResponse> responses = NetResponse::decompose(RESPONSE);
-    responses.resize(batch.size(), NetResponse(HttpStatus::STATUS_CANCELLED));
+  //the time to the first byte is a round trip only if the request does not wait for a connection
+  auto t1 = Time::now();
+  bool bMeasureRtt = ++num_running <= nconnections;
 
-    for (int I = 0; I < batch.size(); I++)
+  if (!streaming)
+  {
+    NetService::push(netservice, REQUEST).when_ready([this,batch,t1,bMeasureRtt](NetResponse RESPONSE)
     {
-      auto query    = batch[I];
-      auto response = responses[I];
+      --num_running;
 
-      if (!response.hasHeader("visus-dtype"))
-        response.setHeader("visus-dtype", query->field.dtype.toString());
+      std::vector<NetResponse> responses = NetResponse::decompose(RESPONSE);
+      responses.resize(batch.size(), NetResponse(HttpStatus::STATUS_CANCELLED));
 
-      if (!response.hasHeader("visus-nsamples"))
-        response.setHeader("visus-nsamples", query->getNumberOfSamples().toString());
+      //the body arrives all together, the bandwidth is what remains after the round trip
+      if (bMeasureRtt && RESPONSE.isSuccessful() && RESPONSE.body)
+        updateLink(0, t1.elapsedMsec() - getRoundTripTime(), RESPONSE.body->c_size(), (int)batch.size());
 
-      if (query->aborted() || !response.isSuccessful())
-      {
-        readFailed(query);
-        continue;
-      }
+      for (int I = 0; I < batch.size(); I++)
+        readBlockFromResponse(batch[I], responses[I]);
+    });
+    return;
+  }
 
-      auto decoded = response.getCompatibleArrayBody(query->getNumberOfSamples(), query->field.dtype);
-      if (!decoded)
+  //streamed response: decode each block as soon as its frame is complete
+  struct Stream
+  {
+    std::vector<bool> received;
+    double            first_msec = -1, last_msec = 0;
+    Int64             nbytes = 0;
+    UniquePtr<NetResponseFrameParser> parser;
+  };
+
+  auto stream = std::make_shared<Stream>();
+  stream->received.resize(batch.size(), false);
+  stream->parser.reset(new NetResponseFrameParser([this, batch, stream](NetResponse response) 
+  {
+    auto blockid = response.getHeader("visus-blockid");
+    for (int I = 0; I < batch.size(); I++)
+    {
+      if (!stream->received[I] && cstring(batch[I]->blockid) == blockid)
       {
-        readFailed(query);
-        continue;
+        stream->received[I] = true;
+        readBlockFromResponse(batch[I], response);
+        return;
       }
+    }
+  }));
 
-      query->buffer = decoded;
+  REQUEST.body_received = [stream, t1](const Uint8* data, Int64 size) 
+  {
+    auto msec = t1.elapsedMsec();
+    if (stream->first_msec < 0) stream->first_msec = (double)msec;
+    stream->last_msec = (double)msec;
+    stream->nbytes += size;
+    stream->parser->push(data, size);
+  };
+
+  NetService::push(netservice, REQUEST).when_ready([this, batch, stream, bMeasureRtt](NetResponse RESPONSE)
+  {
+    --num_running;
+
+    if (RESPONSE.isSuccessful() && stream->first_msec >= 0)
+      updateLink(bMeasureRtt ? stream->first_msec : 0, stream->last_msec - stream->first_msec, stream->nbytes, stream->parser->getNumFrames());
 
-      readOk(query);
+    for (int I = 0; I < batch.size(); I++)
+    {
+      if (!stream->received[I])
+        readFailed(batch[I]);
     }
   });
 
 }
 
 
-} //namespace Visus 
-
+} //namespace Visus
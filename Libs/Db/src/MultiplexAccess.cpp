@@ -40,8 +40,168 @@ For support : support@visus.net
 #include <Visus/BlockQuery.h>
 #include <Visus/Dataset.h>
 
+#include <deque>
+#include <atomic>
+
 namespace Visus {
 
+///////////////////////////////////////////////////////
+//NOTE: 
+//Access class are not thread-enabled, so each child has its own thread and all its 
+//readBlock/writeBlock are called from there. Children run in parallel, a miss goes immediately
+//to the next child's queue and caching (writes) never delays reads
+class MultiplexAccess::Tier
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(Tier)
+
+  Dataset*              dataset = nullptr;
+  SharedPtr<Access>     access;
+
+  std::atomic<Int64>    num_reads{ 0 }, num_hits{ 0 }, num_misses{ 0 }, num_writes{ 0 }, read_msec{ 0 };
+
+  //constructor
+  Tier(Dataset* dataset_, SharedPtr<Access> access_) : dataset(dataset_), access(access_) {
+    this->thread = Thread::start("Multiplex thread", [this]() {
+      runInBackground();
+    });
+  }
+
+  //destructor
+  ~Tier() {
+    stop();
+    join();
+  }
+
+  //stop
+  void stop() {
+    bExit = true;
+    something_happened.up();
+  }
+
+  //join
+  void join() {
+    Thread::join(this->thread);
+    this->thread.reset();
+  }
+
+  //push
+  void push(SharedPtr<BlockQuery> dw_query)
+  {
+    {
+      ScopedLock lock(this->lock);
+      if (!bExited)
+      {
+        (dw_query->mode == 'r' ? reads : writes).push_back(dw_query);
+        something_happened.up();
+        return;
+      }
+    }
+
+    //the thread is gone (i.e. we are exiting)
+    dw_query->setFailed();
+  }
+
+  //getStatistics
+  Statistics getStatistics() const
+  {
+    Statistics ret;
+    ret.num_reads = num_reads;
+    ret.num_hits = num_hits;
+    ret.num_misses = num_misses;
+    ret.num_writes = num_writes;
+    ret.read_msec = read_msec;
+    return ret;
+  }
+
+private:
+
+  CriticalSection                     lock;
+  std::deque< SharedPtr<BlockQuery> > reads;
+  std::deque< SharedPtr<BlockQuery> > writes;
+  Semaphore                           something_happened;
+  std::atomic<bool>                   bExit{ false };
+  bool                                bExited = false;
+  SharedPtr<std::thread>              thread;
+
+  //execute
+  void execute(int mode, const std::deque< SharedPtr<BlockQuery> >& queries)
+  {
+    if (queries.empty())
+      return;
+
+    auto cur_mode = access->getMode();
+    if (cur_mode != mode)
+    {
+      if (cur_mode)
+        access->endIO();
+
+      access->beginIO(mode);
+    }
+
+    for (auto query : queries)
+      dataset->executeBlockQuery(access, query);
+  }
+
+  //runInBackground
+  void runInBackground()
+  {
+    while (true)
+    {
+      std::deque< SharedPtr<BlockQuery> > reads, writes;
+      {
+        ScopedLock lock(this->lock);
+        reads.swap(this->reads);
+        writes.swap(this->writes);
+      }
+
+      if (reads.empty() && writes.empty())
+      {
+        //end IO only when there is no activity, otherwise it's better to 'group' IO in the same begin/end
+        if (access->getMode())
+          access->endIO();
+
+        if (bExit)
+        {
+          ScopedLock lock(this->lock);
+          if (this->reads.empty() && this->writes.empty())
+          {
+            bExited = true;
+            return;
+          }
+          continue;
+        }
+
+        something_happened.down();
+        continue;
+      }
+
+      //reads first
+      execute('r', reads);
+      execute('w', writes);
+    }
+  }
+
+};
+
+///////////////////////////////////////////////////////
+class MultiplexAccess::Request
+{
+public:
+
+  SharedPtr<BlockQuery> up_query;
+
+  CriticalSection lock;
+  int             next = 0;    //next child to try
+  int             running = 0; //reads dispatched and not returned yet
+  bool            done = false;
+
+  //constructor
+  Request(SharedPtr<BlockQuery> up_query_) : up_query(up_query_) {
+  }
+};
+
 ///////////////////////////////////////////////////////
 MultiplexAccess::MultiplexAccess(Dataset* dataset, StringTree config)
 {
@@ -50,6 +210,8 @@ MultiplexAccess::MultiplexAccess(Dataset* dataset, StringTree config)
   this->can_read = true;
   this->can_write = false;
   this->bitsperblock = 0;
+  this->speculative = config.readBool("speculative", this->speculative);
+  this->speculative_hit_rate = config.readDouble("speculative_hit_rate", this->speculative_hit_rate);
 
   for (auto child_config : config.childs)
   {
@@ -62,25 +224,19 @@ MultiplexAccess::MultiplexAccess(Dataset* dataset, StringTree config)
 
     this->addChild(child);
   }
-
-  //NOTE: 
-  //I must use a thread because Access class are not thread-enabled
-  //so I need to make sure that readBlock/writeBlock are called from the same thread 
-  //Counter-example: writeBlock for caching could happen in a diffeent thread 
-
-  this->thread = Thread::start("Multiplex thread", [this]() {
-    runInBackground();
-  });
 }
 
 ///////////////////////////////////////////////////////
 MultiplexAccess::~MultiplexAccess()
 {
-  //safe exit
-  bExit = true;
-  something_happened.up();
-  Thread::join(this->thread);
+  //safe exit (a child can still push to another child while exiting, so stop all of them first)
+  for (auto tier : tiers)
+    tier->stop();
 
+  for (auto tier : tiers)
+    tier->join();
+
+  tiers.clear();
 }
 
 ///////////////////////////////////////////////////////
@@ -89,7 +245,13 @@ void MultiplexAccess::addChild(SharedPtr<Access> child)
   int bpb = child->bitsperblock;
   this->bitsperblock = (dw_access.empty()) ? bpb : std::min(this->bitsperblock, bpb);
   this->dw_access.push_back(SharedPtr<Access>(child));
+  this->tiers.push_back(std::make_shared<Tier>(dataset, child));
+}
 
+///////////////////////////////////////////////////////
+MultiplexAccess::Statistics MultiplexAccess::getStatistics(int index) const
+{
+  return isGoodIndex(index) ? tiers[index]->getStatistics() : Statistics();
 }
 
 ///////////////////////////////////////////////////////
@@ -99,176 +261,160 @@ void MultiplexAccess::printStatistics()
 
   Access::printStatistics();
 
-  PrintInfo("nchilds", dw_access.size());
+  PrintInfo("nchilds", dw_access.size(), "speculative", speculative);
   for (int i = 0; i < (int)dw_access.size(); i++)
+  {
+    auto stats = getStatistics(i);
+    PrintInfo("child", i,
+      "reads", stats.num_reads,
+      "hits", stats.num_hits,
+      "misses", stats.num_misses,
+      "hit-rate", stats.getHitRate(),
+      "avg-read-msec", stats.getAverageReadMsec(),
+      "writes", stats.num_writes);
     dw_access[i]->printStatistics();
+  }
 }
 
 ///////////////////////////////////////////////////////
-void MultiplexAccess::scheduleOp(int mode, int index, SharedPtr<BlockQuery> up_query)
+void MultiplexAccess::readBlock(SharedPtr<BlockQuery> up_query)
 {
-  //find the first who can read
-  if (mode == 'r')
-  {
+  dispatchRead(std::make_shared<Request>(up_query));
+}
+
+///////////////////////////////////////////////////////
+void MultiplexAccess::dispatchRead(SharedPtr<Request> request)
+{
+  auto up_query = request->up_query;
+
+  auto nextReadable = [&](int index) {
     while (isGoodIndex(index) && !dw_access[index]->can_read)
       index++;
+    return index;
+  };
 
-    //invalid index
-    if (!isGoodIndex(index)) {
-      return readFailed(up_query);
-    }
-  }
-
-  //find the first who can write
-  else
+  std::vector<int> indices;
   {
-    VisusAssert(mode == 'w');
+    ScopedLock lock(request->lock);
+
+    if (request->done)
+      return;
+
+    int index = nextReadable(request->next);
+    if (!isGoodIndex(index))
+    {
+      //wait for the reads still running
+      if (request->running)
+        return;
 
-    while (isGoodIndex(index) && !dw_access[index]->can_write)
-      index--;
+      request->done = true;
+      indices.clear();
+    }
+    else
+    {
+      indices.push_back(index);
+
+      //overlap the read with the next child when this one is likely to miss and the next one is likely to hit
+      auto stats = tiers[index]->getStatistics();
+      if (speculative && stats.num_reads >= 16 && stats.getHitRate() < speculative_hit_rate)
+      {
+        int next = nextReadable(index + 1);
+        if (isGoodIndex(next))
+        {
+          auto next_stats = tiers[next]->getStatistics();
+          if (next_stats.num_reads >= 16 && next_stats.getHitRate() >= speculative_hit_rate)
+            indices.push_back(next);
+        }
+      }
 
-    //even if the writing fails, the return code for the reading is ok
-    if (!isGoodIndex(index)) {
-      return readOk(up_query);
+      //a speculative miss is not final, this child can be the one producing the block (e.g. ondemand followed by disk)
+      //so after a miss the remaining children are tried in order, the speculative one included
+      request->next = index + 1;
+      request->running += (int)indices.size();
     }
   }
 
-  auto dw_query = dataset->createBlockQuery(up_query->blockid, up_query->field, up_query->time, mode, up_query->aborted);
-  VisusAssert(dw_query->getNumberOfSamples() == up_query->getNumberOfSamples());
-  VisusAssert(dw_query->logic_samples == up_query->logic_samples);
-  dw_query->buffer = up_query->buffer;
+  if (indices.empty())
+    return readFailed(up_query);
 
+  for (auto index : indices)
   {
-    ScopedLock lock(this->lock);
-
-    Pending pending;
-    pending.index = index;
-    pending.up_query = up_query;
-    pending.dw_query = dw_query;
-    pendings.push_back(pending);
-    something_happened.up();
+    auto dw_query = dataset->createBlockQuery(up_query->blockid, up_query->field, up_query->time, 'r', up_query->aborted);
+    VisusAssert(dw_query->getNumberOfSamples() == up_query->getNumberOfSamples());
+    VisusAssert(dw_query->logic_samples == up_query->logic_samples);
+
+    auto tier = tiers[index];
+    auto t1 = Time::now();
+    dw_query->done.when_ready([this, request, index, dw_query, tier, t1](Void) {
+      tier->read_msec += t1.elapsedMsec();
+      onReadDone(request, index, dw_query);
+    });
+
+    ++tier->num_reads;
+    tier->push(dw_query);
   }
 }
 
-
 ///////////////////////////////////////////////////////
-void MultiplexAccess::runInBackground()
+void MultiplexAccess::onReadDone(SharedPtr<Request> request, int index, SharedPtr<BlockQuery> dw_query)
 {
-  while (true)
-  {
-    std::vector<Pending> pendings;
-
-    while (true)
-    {
-      this->lock.lock();
+  auto tier = tiers[index];
+  auto up_query = request->up_query;
 
-      if (this->pendings.empty())
-      {
-        this->lock.unlock();
-
-        if (bExit)
-          return;
-
-        something_happened.down();
-        continue;
-      }
-
-      pendings = this->pendings;
-      this->pendings.clear();
-      this->lock.unlock();
-      break;
-    }
-
-    std::vector<int> new_modes(dw_access.size(), 0);
-    for (auto pending : pendings)
-    {
-      VisusAssert(isGoodIndex(pending.index));
-      new_modes[pending.index] = pending.dw_query->mode;
-    }
+  if (dw_query->failed())
+  {
+    ++tier->num_misses;
 
-    for (int index = 0; index < (int)dw_access.size(); index++)
     {
-      auto cur_mode = dw_access[index]->getMode();
-      auto new_mode = new_modes[index];
+      ScopedLock lock(request->lock);
+      --request->running;
 
-      if (new_mode != cur_mode)
-      {
-        if (cur_mode)
-          dw_access[index]->endIO();
-
-        if (new_mode)
-          dw_access[index]->beginIO(new_mode);
-      }
+      //another child already returned the block, or a speculative read is still running
+      if (request->done || request->running)
+        return;
     }
 
-    for (auto it : pendings)
-    {
-      auto index = it.index;
-      auto up_query = it.up_query;
-      auto dw_query = it.dw_query;
+    return dispatchRead(request);
+  }
 
-      //need to read
-      if (dw_query->mode == 'r')
-      {
-        dataset->executeBlockQuery(dw_access[index], dw_query);
-        dw_query->done.when_ready([this, up_query, dw_query, index](Void)
-        {
-          //if fails try the next index
-          if (dw_query->failed())
-          {
-            scheduleOp('r', index + 1, up_query);
-          }
-          //I need to write to upper access (i.e. caching)
-          else
-          {
-            VisusAssert(dw_query->ok());
-            VisusAssert(up_query->blockid == dw_query->blockid);
-            VisusAssert(up_query->getNumberOfSamples() == dw_query->getNumberOfSamples());
-            VisusAssert(up_query->logic_samples == dw_query->logic_samples);
+  VisusAssert(dw_query->ok());
+  VisusAssert(up_query->blockid == dw_query->blockid);
+  VisusAssert(up_query->getNumberOfSamples() == dw_query->getNumberOfSamples());
+  VisusAssert(up_query->logic_samples == dw_query->logic_samples);
+  ++tier->num_hits;
 
-            up_query->buffer = dw_query->buffer;
-            scheduleOp('w', index - 1, up_query);
-          }
-        });
-      }
+  {
+    ScopedLock lock(request->lock);
+    --request->running;
 
-      //need to cache
-      else
-      {
-        VisusAssert(dw_query->mode == 'w');
+    //a speculative read already won
+    if (request->done)
+      return;
 
-        //if fails or not I don't care, I try to cache to upper levels anyway
-        dataset->executeBlockQuery(dw_access[index], dw_query);
-        dw_query->done.when_ready([this, up_query, dw_query, index](Void) {
-          scheduleOp('w', index - 1, up_query);
-        });
-      }
-    }
+    request->done = true;
+  }
 
-    //end IO only for down access that do not have activity in the next cycle
-    //otherwise it's better to 'group' IO in the same begin/end
-    {
-      ScopedLock lock(this->lock);
-      pendings = this->pendings;
-    }
+  //I need to write to upper access (i.e. caching), this is asynchronous and does not delay the reading
+  for (int I = index - 1; I >= 0; I--)
+  {
+    if (dw_access[I]->can_write)
+      writeBack(I, dw_query);
+  }
 
-    new_modes = std::vector<int>(dw_access.size(), 0);
-    for (auto pending : pendings)
-    {
-      VisusAssert(isGoodIndex(pending.index));
-      new_modes[pending.index] = pending.dw_query->mode;
-    }
+  up_query->buffer = dw_query->buffer;
+  readOk(up_query);
+}
 
-    for (int index = 0; index < (int)dw_access.size(); index++)
-    {
-      auto cur_mode = dw_access[index]->getMode();
-      auto new_mode = new_modes[index];
+///////////////////////////////////////////////////////
+void MultiplexAccess::writeBack(int index, SharedPtr<BlockQuery> dw_query)
+{
+  //if fails or not I don't care, the return code for the reading is ok
+  auto write_query = dataset->createBlockQuery(dw_query->blockid, dw_query->field, dw_query->time, 'w', dw_query->aborted);
+  write_query->buffer = dw_query->buffer;
 
-      if (!new_mode && cur_mode)
-        dw_access[index]->endIO();
-    }
-  }
+  auto tier = tiers[index];
+  ++tier->num_writes;
+  tier->push(write_query);
 }
 
-} //namespace Visus 
-
+} //namespace Visus
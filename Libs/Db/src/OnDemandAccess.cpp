@@ -43,6 +43,10 @@ For support : support@visus.net
 #include <Visus/Dataset.h>
 #include <Visus/Path.h>
 #include <Visus/StringTree.h>
+#include <Visus/Thread.h>
+
+#include <condition_variable>
+#include <set>
 
 #if WIN32
 
@@ -52,6 +56,7 @@ For support : support@visus.net
 
 #include <unistd.h>
 #include <signal.h>
+#include <fcntl.h>
 
 #if !__APPLE__
   #include <sys/types.h>
@@ -64,6 +69,114 @@ namespace Visus {
 
 int OnDemandAccess::Defaults::nconnections=8;
 
+#if !WIN32
+
+////////////////////////////////////////////////////////////////////////////
+/*
+A long-lived external generator, started once as:
+
+  <path> --idx <idx> --serve
+
+It receives framed requests on stdin and sends framed responses on stdout. A frame is a header line
+"<id> <body-size>\n" followed by body-size bytes. The request body has one "key value" per line:
+
+  field <name>
+  time <time>
+  box <box>           (one line for each block, box is interleaved: x1 x2 y1 y2 ...)
+
+The response body is "ok" when all the blocks have been generated (stored where the next layer of the
+multiplex can find them), otherwise an error message.
+*/
+class OnDemandGeneratorProcess
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(OnDemandGeneratorProcess)
+
+  pid_t pid = -1;
+  FILE* in = nullptr;  //process stdin
+  FILE* out = nullptr; //process stdout
+  Int64 next_id = 0;
+  bool  bBroken = false; //the protocol got out of sync, the process cannot be reused
+
+  //constructor
+  OnDemandGeneratorProcess(pid_t pid_, int stdin_, int stdout_) : pid(pid_) {
+    in = fdopen(stdin_, "w");
+    out = fdopen(stdout_, "r");
+  }
+
+  //destructor (closing stdin the generator should exit, a broken one is killed right away)
+  ~OnDemandGeneratorProcess()
+  {
+    if (in) fclose(in);
+
+    int status;
+    for (int I = 0; I < 100 && !bBroken && !waitpid(pid, &status, WNOHANG); I++)
+      Thread::sleep(10);
+
+    if (!waitpid(pid, &status, WNOHANG))
+    {
+      kill(-pid, SIGTERM); //the whole process group (see popen2)
+      waitpid(pid, &status, 0);
+    }
+
+    if (out) fclose(out);
+  }
+
+  //isRunning
+  bool isRunning() const {
+    return !bBroken && in && out && !ferror(in) && !feof(out);
+  }
+
+  //generate
+  bool generate(String field, double time, const std::vector<BoxNi>& boxes, String& errormsg)
+  {
+    auto id = next_id++;
+
+    std::ostringstream body;
+    body << "field " << field << "\n";
+    body << "time " << time << "\n";
+    for (auto box : boxes)
+      body << "box " << box.toString(/*bInterleave*/true) << "\n";
+
+    auto request = concatenate(id, " ", body.str().size(), "\n") + body.str();
+    if (fwrite(request.c_str(), 1, request.size(), in) != request.size() || fflush(in) != 0)
+    {
+      errormsg = "cannot write to the generator";
+      bBroken = true;
+      return false;
+    }
+
+    char header[256];
+    Int64 response_id = -1, size = -1;
+    if (!fgets(header, sizeof(header), out) || sscanf(header, "%lld %lld", (long long*)&response_id, (long long*)&size) != 2 || response_id != id || size < 0)
+    {
+      errormsg = "cannot read the generator response";
+      bBroken = true;
+      return false;
+    }
+
+    String response(size, ' ');
+    if (size && fread(&response[0], 1, size, out) != (size_t)size)
+    {
+      errormsg = "cannot read the generator response";
+      bBroken = true;
+      return false;
+    }
+
+    if (StringUtils::trim(response) != "ok")
+    {
+      errormsg = StringUtils::trim(response);
+      return false;
+    }
+
+    return true;
+  }
+
+};
+
+#endif
+
 ////////////////////////////////////////////////////////////////////////////
 class OnDemandAccessExternalPimpl : public OnDemandAccess::Pimpl
 {
@@ -71,8 +184,26 @@ public:
 
   SharedPtr<NetService> netservice;
 
+  //the same block asked by several queries while it's being generated is generated once
+  typedef std::tuple<String, double, BigInt> BlockKey;
+
+  int nworkers = 0;   //persistent generator processes (0 means one process for each block)
+  int max_batch = 16; //max number of neighbouring blocks in one generation call
+
+  CriticalSection                                          lock;
+  std::condition_variable                                  wakeup;
+  std::map<BlockKey, std::vector< SharedPtr<BlockQuery> > > waiting;
+  std::deque<BlockKey>                                     pending; //waiting for a worker
+  bool                                                     bExit = false;
+  std::vector< SharedPtr<std::thread> >                    threads;
+#if !WIN32
+  std::set<pid_t>                                          generator_pids; //running generators (workers can be stuck reading from them)
+#endif
+
+  std::atomic<Int64> num_blocks{ 0 }, num_coalesced{ 0 }, num_calls{ 0 }, num_failed_calls{ 0 };
+
   //constructor
-  OnDemandAccessExternalPimpl(OnDemandAccess* owner, Dataset* dataset)
+  OnDemandAccessExternalPimpl(OnDemandAccess* owner, Dataset* dataset, StringTree config)
     : OnDemandAccess::Pimpl(owner)
   {
     if (!dataset->isServerMode())
@@ -80,12 +211,53 @@ public:
       if (auto nconnections = OnDemandAccess::Defaults::nconnections)
         this->netservice = std::make_shared<NetService>(nconnections);
     }
+
+#if !WIN32
+    if (!StringUtils::startsWith(owner->getPath(), "http://"))
+    {
+      this->nworkers = config.readInt("workers", 0);
+      this->max_batch = std::max(1, config.readInt("batch", 16));
+    }
+
+    for (int I = 0; I < nworkers; I++)
+      threads.push_back(Thread::start("OnDemandAccess Generator", [this]() { workerEntryProc(); }));
+#endif
   }
 
   //destructor
   virtual ~OnDemandAccessExternalPimpl()
   {
+    {
+      ScopedLock lock(this->lock);
+      bExit = true;
+
+#if !WIN32
+      //a worker waiting for a response would never see bExit
+      //(the whole process group, children of the generator could keep the pipe open)
+      for (auto pid : generator_pids)
+        kill(-pid, SIGTERM);
+#endif
+    }
+    wakeup.notify_all();
+
+    for (auto thread : threads)
+      Thread::join(thread);
+
     netservice.reset();
+
+    //queries still waiting (pending for a worker, or coalesced) will never be finished
+    std::map<BlockKey, std::vector< SharedPtr<BlockQuery> > > waiting;
+    {
+      ScopedLock lock(this->lock);
+      std::swap(waiting, this->waiting);
+      pending.clear();
+    }
+
+    for (auto it : waiting)
+    {
+      for (auto query : it.second)
+        owner->readFailed(query);
+    }
   }
 
   #if !WIN32
@@ -98,15 +270,28 @@ public:
     int p_stdin[2], p_stdout[2];
     pid_t pid;
 
+    //close-on-exec from the start, so that the pipes never leak into processes forked by other threads
+    //(dup2 in the child clears the flag on stdin/stdout)
+#if __APPLE__
     if (pipe(p_stdin) != 0 || pipe(p_stdout) != 0)
       return -1;
 
+    for (auto fd : { p_stdin[0], p_stdin[1], p_stdout[0], p_stdout[1] })
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+#else
+    if (pipe2(p_stdin, O_CLOEXEC) != 0 || pipe2(p_stdout, O_CLOEXEC) != 0)
+      return -1;
+#endif
+
     pid = fork();
 
     if (pid < 0)
       return pid;
     else if (pid == 0)
     {
+      //own process group, so that the command can be killed with all its children
+      setpgid(0, 0);
+
       close(p_stdin[WRITE]);
       dup2(p_stdin[READ], READ);
       close(p_stdout[READ]);
@@ -117,6 +302,9 @@ public:
       exit(1);
     }
 
+    close(p_stdin[READ]);
+    close(p_stdout[WRITE]);
+
     if (infp == NULL)
       close(p_stdin[WRITE]);
     else
@@ -129,34 +317,218 @@ public:
 
     return pid;
   }
+
+  //startGenerator
+  SharedPtr<OnDemandGeneratorProcess> startGenerator()
+  {
+    auto path = Url(owner->getDataset()->getUrl()).getPath();
+    String command = owner->getPath() + " --idx " + path + " --serve";
+    PrintInfo(command);
+
+    //under lock, so that the destructor cannot miss a generator started while exiting
+    ScopedLock lock(this->lock);
+    if (bExit)
+      return SharedPtr<OnDemandGeneratorProcess>();
+
+    int stdin, stdout;
+    pid_t pid = popen2(command.c_str(), &stdin, &stdout);
+    if (pid < 0)
+      return SharedPtr<OnDemandGeneratorProcess>();
+
+    generator_pids.insert(pid);
+    return std::make_shared<OnDemandGeneratorProcess>(pid, stdin, stdout);
+  }
+
+  //stopGenerator
+  void stopGenerator(SharedPtr<OnDemandGeneratorProcess>& generator)
+  {
+    if (!generator)
+      return;
+
+    {
+      ScopedLock lock(this->lock);
+      generator_pids.erase(generator->pid);
+    }
+    generator.reset();
+  }
+
+  //popBatch (the first pending block and its pending neighbours with the same field and time)
+  std::vector<BlockKey> popBatch(std::vector<BlockKey>& aborted)
+  {
+    std::vector<BlockKey> ret;
+    while (!pending.empty() && ret.empty())
+    {
+      auto first = pending.front();
+      pending.pop_front();
+
+      auto isAborted = [&](const BlockKey& key) {
+        auto& queries = waiting[key];
+        return std::all_of(queries.begin(), queries.end(), [](SharedPtr<BlockQuery> query) {return query->aborted(); });
+      };
+
+      if (isAborted(first))
+      {
+        aborted.push_back(first);
+        continue;
+      }
+
+      ret.push_back(first);
+
+      std::vector<BlockKey> neighbours;
+      for (auto key : pending)
+      {
+        if (std::get<0>(key) == std::get<0>(first) && std::get<1>(key) == std::get<1>(first))
+          neighbours.push_back(key);
+      }
+
+      auto distance = [&](const BlockKey& key) {
+        auto delta = std::get<2>(key) - std::get<2>(first);
+        return delta >= 0 ? delta : -delta;
+      };
+
+      std::sort(neighbours.begin(), neighbours.end(), [&](const BlockKey& a, const BlockKey& b) {
+        return distance(a) < distance(b);
+      });
+
+      for (auto key : neighbours)
+      {
+        if ((int)ret.size() >= max_batch)
+          break;
+        pending.erase(std::find(pending.begin(), pending.end(), key));
+        if (isAborted(key))
+          aborted.push_back(key);
+        else
+          ret.push_back(key);
+      }
+    }
+
+    std::sort(ret.begin(), ret.end());
+    return ret;
+  }
+
+  //workerEntryProc
+  void workerEntryProc()
+  {
+    SharedPtr<OnDemandGeneratorProcess> generator;
+
+    for (;;)
+    {
+      std::vector<BlockKey> batch, aborted;
+      {
+        std::unique_lock<std::mutex> lock(this->lock);
+        wakeup.wait(lock, [this]() {return bExit || !pending.empty(); });
+        if (bExit)
+          break;
+        batch = popBatch(aborted);
+      }
+
+      for (auto key : aborted)
+        finished(key);
+
+      if (batch.empty())
+        continue;
+
+      auto dataset = owner->getDataset();
+      std::vector<BoxNi> boxes;
+      for (auto key : batch)
+        boxes.push_back(dataset->getBlockSamples(std::get<2>(key)).logic_box);
+
+      Time t1 = Time::now();
+
+      //a generator that exited or broke the protocol is replaced
+      if (!generator || !generator->isRunning())
+      {
+        stopGenerator(generator);
+        generator = startGenerator();
+      }
+
+      String errormsg = "cannot start the generator";
+      bool bOk = generator && generator->generate(std::get<0>(batch[0]), std::get<1>(batch[0]), boxes, errormsg);
+      num_calls++;
+
+      if (!bOk)
+      {
+        num_failed_calls++;
+        PrintWarning("OnDemandAccess generator failed", errormsg);
+        if (generator && !generator->isRunning())
+          stopGenerator(generator);
+      }
+
+      if (owner->bVerbose)
+        PrintInfo("path", owner->getPath(), "blocks", batch.size(), "time", t1.elapsedMsec());
+
+      for (auto key : batch)
+        finished(key);
+    }
+
+    stopGenerator(generator);
+  }
+
   #endif
 
+  //finished (as noted above, this stage always returns query failed. Third layer of multiplex will get data)
+  void finished(const BlockKey& key)
+  {
+    std::vector< SharedPtr<BlockQuery> > queries;
+    {
+      ScopedLock lock(this->lock);
+      auto it = waiting.find(key);
+      if (it == waiting.end())
+        return;
+      queries = it->second;
+      waiting.erase(it);
+    }
+
+    for (auto query : queries)
+      owner->readFailed(query);
+  }
+
   //generateBlock
   virtual void generateBlock(SharedPtr<BlockQuery> query) override
   {
     Dataset* dataset = owner->getDataset();
 
     // system process or network request (blocking)
-    // Be sure to set nthreads > 0 to ensure application doesn't hang
+    // Be sure to set nthreads > 0 (or workers > 0) to ensure application doesn't hang
     // We make only one request for the entire area (box).
     //
     // <!-- search ondemand (disk), generate if not found (ondemand), search disk again to get generated data --> 
     // <dataset name="Test OnDemand RO" url="file://$(data)/ondemand/visus.idx" >
     //   <access name="Multiplex" type="multiplex">
     //     <access type='disk'           chmod='r'  url="file://$(data)/ondemand/visus.idx"/>
-    //     <access type='ondemandaccess' chmod='r' type="external" path="file:///path/to/dataset.idx
+    //     <access type='ondemandaccess' chmod='r' type="external" path="file:///path/to/dataset.idx workers="4" batch="16"/>
     //     <access type='disk'           chmod='r'  url="file://$(data)/ondemand/visus.idx"/>
     //    </access>
     // </dataset>
 
     //where the samples will be in X Y Z, not a simply 1d array
 
-    auto bitmask = dataset->getBitmask();
     auto timestep = query->time;
     auto field = query->field.name;
-    auto dataset_box = dataset->getLogicBox();
     auto block_logicbox = query->getLogicBox();
 
+    //already being generated for another query
+    BlockKey key(field, timestep, query->blockid);
+    {
+      ScopedLock lock(this->lock);
+      auto& queries = waiting[key];
+      queries.push_back(query);
+      if (queries.size() > 1)
+      {
+        num_coalesced++;
+        return;
+      }
+
+      num_blocks++;
+
+      if (nworkers)
+      {
+        pending.push_back(key);
+        wakeup.notify_one();
+        return;
+      }
+    }
+
     Time t1 = Time::now();
 
     auto converter_url = owner->getPath();
@@ -175,10 +547,11 @@ public:
       NetRequest request(url);
       request.aborted = query->aborted;
 
-      NetService::push(netservice, request).when_ready([this,query](NetResponse response) {
+      num_calls++;
+      NetService::push(netservice, request).when_ready([this,key](NetResponse response) {
 
         // As noted above, this stage always returns query failed. Third layer of multiplex will get data
-        owner->readFailed(query);
+        finished(key);
       });
     }
     else
@@ -191,6 +564,11 @@ public:
       params += " --box \"" + block_logicbox.toString(/*bInterleave*/true) + "\"";
       PrintInfo(params);
 
+      num_calls++;
+
+      //this job is going to wait for the external app
+      Scheduler::BlockingScope blocking;
+
 #if WIN32
       //blocking call
       system(params.c_str());
@@ -199,26 +577,45 @@ public:
       //non-blocking call
       int stdin, stdout;
       pid_t pid = popen2(params.c_str(), &stdin, &stdout);
+      close(stdin);
+
+      //drain the output, so that the app never blocks writing to stdout
+      fcntl(stdout, F_SETFL, fcntl(stdout, F_GETFL) | O_NONBLOCK);
+      char discard[4096];
 
       int status;
       while (!waitpid(pid, &status, WNOHANG))
       {
         if (query->aborted())
         {
-          kill(pid, SIGTERM);
+          kill(-pid, SIGTERM);
+          waitpid(pid, &status, 0);
           break;
         }
-        sleep(1);
+
+        while (read(stdout, discard, sizeof(discard)) > 0)
+          ;
+
+        Thread::sleep(10);
       }
+
+      close(stdout);
 #endif
 
       PrintInfo("path",converter_url,"time",t1.elapsedMsec());
 
       // as noted above, this stage will return query failed, then depend on third layer of multiplex to get the data
-      return owner->readFailed(query);
+      finished(key);
     }
   }
 
+  //printStatistics
+  virtual void printStatistics() override
+  {
+    PrintInfo("OnDemandAccess external", "path", owner->getPath(), "workers", nworkers, "batch", max_batch,
+      "blocks", num_blocks.load(), "coalesced", num_coalesced.load(), "calls", num_calls.load(), "failed calls", num_failed_calls.load());
+  }
+
 };
 
 ////////////////////////////////////////////////////////////////////////////
@@ -291,6 +688,7 @@ public:
         params += String("1");
 
       //blocking call
+      Scheduler::BlockingScope blocking;
       system(params.c_str());
     }
 
@@ -454,10 +852,11 @@ OnDemandAccess::OnDemandAccess(Dataset* dataset, StringTree config)
   this->can_read = true;
   this->can_write = false;
   this->bitsperblock = dataset->getDefaultBitsPerBlock();
+  this->bVerbose = config.readInt("verbose", 0);
 
   //you can use a thread pool or not (default: no)
   if (int nthreads = cint(config.readString("nthreads", "0")))
-    this->thread_pool=std::make_shared<ThreadPool>("OnDemandAccess Worker",nthreads);
+    this->thread_pool=std::make_shared<ThreadPool>("OnDemandAccess Worker",nthreads,Scheduler::Interactive);
 
   switch (this->type)
   {
@@ -474,7 +873,7 @@ OnDemandAccess::OnDemandAccess(Dataset* dataset, StringTree config)
     break;
 
   case Type::External:
-    this->pimpl = new OnDemandAccessExternalPimpl(this,dataset);
+    this->pimpl = new OnDemandAccessExternalPimpl(this,dataset,config);
     break;
 
   case Type::ApplyFilter:
@@ -38,6 +38,7 @@ For support : support@visus.net
 
 #include <Visus/RamAccess.h>
 #include <Visus/Dataset.h>
+#include <Visus/Trace.h>
 
 namespace Visus {
 
@@ -228,12 +229,14 @@ void RamAccess::shareMemoryWith(SharedPtr<RamAccess> value)
 ////////////////////////////////////////////////////////////////////////////////
 void RamAccess::readBlock(SharedPtr<BlockQuery> query)  
 {
+  VisusTrace("access", "RamAccess::readBlock");
   return shared->read(query)? readOk(query):readFailed(query);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void RamAccess::writeBlock(SharedPtr<BlockQuery> query)  
 {
+  VisusTrace("access", "RamAccess::writeBlock");
   return shared->write(query)? writeOk(query):writeFailed(query);
 }
 
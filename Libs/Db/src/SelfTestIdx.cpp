@@ -38,6 +38,12 @@ For support : support@visus.net
 
 #include <Visus/Encoder.h>
 #include <Visus/IdxDataset.h>
+#include <Visus/IdxFilter.h>
+#include <Visus/MultiplexAccess.h>
+
+#include "IdxFileV6.hxx"
+
+#include <thread>
 
 namespace Visus {
 
@@ -122,6 +128,580 @@ static DType GetRandomDType()
 }
 
 
+////////////////////////////////////////////////////////////////////////////////////
+static SharedPtr<HeapMemory> CreateRandomSamples(DType dtype, Int64 nsamples)
+{
+  auto ret = std::make_shared<HeapMemory>();
+  VisusReleaseAssert(ret->resize(dtype.getByteSize(nsamples), __FILE__, __LINE__));
+
+  //slowly varying bytes with some noise, so that codecs and filters have something to do
+  for (Int64 I = 0; I < ret->c_size(); I++)
+    ret->c_ptr()[I] = (Uint8)((I >> 4) + Utils::getRandInteger(0, 3));
+
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestEncoder(String specs, DType dtype, Int64 nsamples)
+{
+  PointNi dims(std::vector<Int64>({ nsamples }));
+  auto decoded = CreateRandomSamples(dtype, nsamples);
+
+  auto encoder = Encoders::getSingleton()->createEncoder(specs);
+  VisusReleaseAssert(encoder);
+  auto encoded = encoder->encode(dims, dtype, decoded);
+  VisusReleaseAssert(encoded);
+
+  //decode with what the block header records, as IdxDiskAccess does
+  IdxBlockHeaderV6 header;
+  header.setCompression(specs);
+  auto decoder = Encoders::getSingleton()->createEncoder(header.getCompression());
+  VisusReleaseAssert(decoder);
+
+  auto check = decoder->decode(dims, dtype, encoded);
+  VisusReleaseAssert(check && check->c_size() == decoded->c_size());
+  VisusReleaseAssert(memcmp(check->c_ptr(), decoded->c_ptr(), (size_t)decoded->c_size()) == 0);
+
+  //decode a range of samples (chunked decodes only the chunks intersecting it)
+  for (auto range : { std::make_pair(0, 1), std::make_pair(0, 65536), std::make_pair(65536, 131072 + 5), std::make_pair(8, 200003) })
+  {
+    Int64 A = range.first, B = std::min((Int64)range.second, nsamples);
+    if (A >= B)
+      continue;
+
+    auto sub = decoder->decodeRange(dims, dtype, encoded, A, B);
+    VisusReleaseAssert(sub && sub->c_size() == dtype.getByteSize(B - A));
+    VisusReleaseAssert(memcmp(sub->c_ptr(), decoded->c_ptr() + dtype.getByteSize(A), (size_t)sub->c_size()) == 0);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestShuffle(DType dtype, Int64 nsamples)
+{
+  //the shuffle filter alone (i.e. raw codec) must produce exactly the byte planes, whatever the SSE path does
+  PointNi dims(std::vector<Int64>({ nsamples }));
+  auto decoded = CreateRandomSamples(dtype, nsamples);
+
+  auto encoder = Encoders::getSingleton()->createEncoder("shuffle");
+  VisusReleaseAssert(encoder);
+  auto encoded = encoder->encode(dims, dtype, decoded);
+  VisusReleaseAssert(encoded && encoded->c_size() == decoded->c_size());
+
+  int typesize = dtype.getByteSize();
+  for (Int64 I = 0; I < nsamples; I++)
+  {
+    for (int B = 0; B < typesize; B++)
+      VisusReleaseAssert(encoded->c_ptr()[B * nsamples + I] == decoded->c_ptr()[I * typesize + B]);
+  }
+
+  auto check = encoder->decode(dims, dtype, encoded);
+  VisusReleaseAssert(check && check->c_size() == decoded->c_size());
+  VisusReleaseAssert(memcmp(check->c_ptr(), decoded->c_ptr(), (size_t)decoded->c_size()) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestEncoders()
+{
+  //sizes not multiple of the 64 bytes SSE blocks too
+  for (auto dtype : { DTypes::UINT16, DTypes::UINT32, DTypes::FLOAT64, DTypes::UINT16_RGB })
+  {
+    for (auto nsamples : { 1, 31, 32, 1000, 4099 })
+      SelfTestShuffle(dtype, nsamples);
+  }
+
+  std::vector<String> specs = {
+    "lz4", "zip",
+    "shuffle", "bitshuffle", "delta+shuffle", "shuffle+lz4", "bitshuffle+lz4", "delta+zip", "xor+shuffle+lz4",
+    "chunked-lz4", "chunked-zip", "chunked-shuffle+lz4", "shuffle+chunked-lz4" 
+  };
+
+  for (auto dtype : { DTypes::UINT8, DTypes::UINT16, DTypes::UINT8_RGB, DTypes::FLOAT32, DTypes::FLOAT64 })
+  {
+    for (auto nsamples : { 1, 1000, 200003 })
+    {
+      for (auto it : specs)
+        SelfTestEncoder(it, dtype, nsamples);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestZstdDictionary()
+{
+  //not available (i.e. built without VISUS_ZSTD)
+  if (!Encoders::getSingleton()->createEncoder("zstd"))
+    return;
+
+  //blocks with a lot of shared content, so that a dictionary can be trained
+  auto CreateSample = [](int I) {
+    auto ret = std::make_shared<HeapMemory>();
+    String text = "<block id='" + cstring(I) + "' field='temperature' dtype='float32' compression='zstd'>";
+    for (int J = 0; J < 32; J++)
+      text = text + "<sample index='" + cstring(J) + "' value='" + cstring(Utils::getRandInteger(0, 9)) + "'/>";
+    VisusReleaseAssert(ret->resize((Int64)text.size(), __FILE__, __LINE__));
+    memcpy(ret->c_ptr(), text.c_str(), text.size());
+    return ret;
+  };
+
+  std::vector< SharedPtr<HeapMemory> > samples;
+  for (int I = 0; I < 256; I++)
+    samples.push_back(CreateSample(I));
+
+  auto dictionary = Encoders::getSingleton()->trainDictionary("zstd", samples, 4 * 1024);
+  VisusReleaseAssert(dictionary);
+
+  auto encoder = Encoders::getSingleton()->createEncoder("zstd");
+  VisusReleaseAssert(encoder->setDictionary(dictionary));
+
+  //the same encoder is shared by concurrent readers/writers (each thread reuses its own contexts)
+  std::vector<std::thread> threads;
+  for (int T = 0; T < 8; T++)
+  {
+    threads.push_back(std::thread([&, T]() {
+      for (int I = 0; I < 64; I++)
+      {
+        auto decoded = CreateSample(T * 64 + I);
+        PointNi dims(std::vector<Int64>({ decoded->c_size() }));
+        auto encoded = encoder->encode(dims, DTypes::UINT8, decoded);
+        VisusReleaseAssert(encoded);
+        auto check = encoder->decode(dims, DTypes::UINT8, encoded);
+        VisusReleaseAssert(check && check->c_size() == decoded->c_size());
+        VisusReleaseAssert(memcmp(check->c_ptr(), decoded->c_ptr(), (size_t)decoded->c_size()) == 0);
+      }
+    }));
+  }
+
+  for (auto& it : threads)
+    it.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestCoarseRead()
+{
+  //coarse queries decode only the prefix of the first block, the result must not change
+  for (auto compression : { "lz4", "chunked-lz4", "chunked-shuffle+zip" })
+  {
+    IdxFile idxfile;
+    idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(1024, 512));
+    idxfile.bitsperblock = 18; //several chunks in the first block
+    Field field("myfield", DTypes::UINT16);
+    field.default_compression = compression;
+    idxfile.fields.push_back(field);
+
+    String filename = "tmp/self_test_idx/coarse.idx";
+    idxfile.save(filename);
+    auto dataset = LoadIdxDataset(filename);
+
+    auto write = dataset->createBoxQuery(dataset->getLogicBox(), 'w');
+    dataset->beginBoxQuery(write);
+    VisusReleaseAssert(write->isRunning());
+    write->buffer = Array(write->getNumberOfSamples(), write->field.dtype);
+    for (Int64 I = 0, N = write->buffer.getTotalNumberOfSamples(); I < N; I++)
+      ((Uint16*)write->buffer.c_ptr())[I] = (Uint16)Utils::getRandInteger(0, 65535);
+    VisusReleaseAssert(dataset->executeBoxQuery(dataset->createAccess(), write));
+
+    //reference: the samples at resolution H are the ones of the full resolution buffer on the grid
+    for (int H = 0; H <= dataset->getMaxResolution(); H++)
+    {
+      auto read = dataset->createBoxQuery(dataset->getLogicBox(), 'r');
+      read->setResolutionRange(0, H);
+      dataset->beginBoxQuery(read);
+      VisusReleaseAssert(read->isRunning());
+      VisusReleaseAssert(dataset->executeBoxQuery(dataset->createAccess(), read));
+
+      auto samples = read->logic_samples;
+      int nsample = 0;
+      for (auto loc = ForEachPoint(read->buffer.dims); !loc.end(); loc.next(), nsample++)
+      {
+        PointNi P = samples.logic_box.p1 + loc.pos.leftShift(samples.shift);
+        Int64 pos = P[0] + P[1] * 1024;
+        VisusReleaseAssert(((Uint16*)read->buffer.c_ptr())[nsample] == ((Uint16*)write->buffer.c_ptr())[pos]);
+      }
+    }
+
+    dataset->removeFiles();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestMultiplexSpeculative()
+{
+  //blocks stored in memory (read only)
+  class StoreAccess : public Access
+  {
+  public:
+
+    CriticalSection         lock;
+    std::map<BigInt, Array> blocks;
+
+    StoreAccess(int bitsperblock) {
+      this->can_read = true;
+      this->can_write = false;
+      this->bitsperblock = bitsperblock;
+    }
+
+    virtual void readBlock(SharedPtr<BlockQuery> query) override
+    {
+      Array block;
+      {
+        ScopedLock lock(this->lock);
+        auto it = blocks.find(query->blockid);
+        if (it == blocks.end())
+          return readFailed(query);
+        block = it->second;
+      }
+      query->buffer = block;
+      readOk(query);
+    }
+
+    virtual void writeBlock(SharedPtr<BlockQuery> query) override {
+      writeFailed(query);
+    }
+  };
+
+  //stores the block in the next child and always misses (as an ondemand access followed by a disk access does)
+  class GeneratorAccess : public Access
+  {
+  public:
+
+    SharedPtr<StoreAccess> store;
+    std::atomic<int>       num_generated{ 0 };
+
+    GeneratorAccess(SharedPtr<StoreAccess> store_) : store(store_) {
+      this->can_read = true;
+      this->can_write = false;
+      this->bitsperblock = store->bitsperblock;
+    }
+
+    virtual void readBlock(SharedPtr<BlockQuery> query) override
+    {
+      Thread::sleep(5);
+      Array block;
+      VisusReleaseAssert(block.resize(query->getNumberOfSamples(), query->field.dtype, __FILE__, __LINE__));
+      block.fillWithValue((int)(query->blockid % 256));
+      {
+        ScopedLock lock(store->lock);
+        store->blocks[query->blockid] = block;
+      }
+      ++num_generated;
+      readFailed(query);
+    }
+
+    virtual void writeBlock(SharedPtr<BlockQuery> query) override {
+      writeFailed(query);
+    }
+  };
+
+  IdxFile idxfile;
+  idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(256, 256));
+  idxfile.bitsperblock = 10;
+  idxfile.fields.push_back(Field("myfield", DTypes::UINT8));
+
+  String filename = "tmp/self_test_idx/multiplex.idx";
+  idxfile.save(filename);
+  auto dataset = LoadIdxDataset(filename);
+
+  //cache (2/3 hit rate) -> generator (never hits) -> store
+  int nblocks = 96;
+  auto cache = std::make_shared<StoreAccess>(idxfile.bitsperblock);
+  auto store = std::make_shared<StoreAccess>(idxfile.bitsperblock);
+  auto generator = std::make_shared<GeneratorAccess>(store);
+  for (int blockid = 0; blockid < nblocks; blockid++)
+  {
+    if (blockid % 3 == 0) continue;
+    Array block;
+    VisusReleaseAssert(block.resize(dataset->createBlockQuery(blockid, 'r')->getNumberOfSamples(), DTypes::UINT8, __FILE__, __LINE__));
+    block.fillWithValue(blockid % 256);
+    cache->blocks[blockid] = block;
+  }
+
+  auto access = std::make_shared<MultiplexAccess>(dataset.get());
+  access->speculative = true;
+  access->addChild(cache);
+  access->addChild(generator);
+  access->addChild(store);
+
+  //once the statistics are known, the store is read speculatively while the generator is producing the block,
+  //it misses and must be read again in order
+  access->beginRead();
+  for (int blockid = 0; blockid < nblocks; blockid++)
+  {
+    auto query = dataset->createBlockQuery(blockid, 'r');
+    dataset->executeBlockQuery(access, query);
+    query->done.get();
+    VisusReleaseAssert(query->ok());
+    VisusReleaseAssert(query->buffer.c_ptr()[0] == (Uint8)(blockid % 256));
+  }
+  access->endRead();
+
+  //each missing block is generated once
+  VisusReleaseAssert(generator->num_generated == nblocks / 3);
+  VisusReleaseAssert(access->getStatistics(2).num_hits == nblocks / 3);
+
+  access.reset();
+  dataset->removeFiles();
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+//reference filter computation (level by level, one read and one write per window and per level)
+static bool ComputeFilterLevelByLevel(IdxDataset* dataset, SharedPtr<IdxFilter> filter, Field field, SharedPtr<Access> access, PointNi SlidingWindow)
+{
+  DatasetBitmask bitmask = dataset->getBitmask();
+  BoxNi          box = dataset->getLogicBox();
+  double         time = dataset->getTime();
+
+  for (int H = dataset->getMaxResolution(); H >= 1; H--)
+  {
+    int   bit = bitmask[H];
+    Int64 FILTERSTEP = filter->getFilterStep(H)[bit];
+
+    PointNi From = box.p1;
+    if (!Utils::isAligned(From[bit], (Int64)0, FILTERSTEP))
+      From[bit] = Utils::alignLeft(From[bit], (Int64)0, FILTERSTEP) + FILTERSTEP;
+
+    for (auto P = ForEachPoint(From, box.p2, SlidingWindow); !P.end(); P.next())
+    {
+      BoxNi window = BoxNi(P.pos, P.pos + SlidingWindow).getIntersection(box);
+      if (!window.isFullDim())
+        continue;
+
+      auto read = dataset->createBoxQuery(window, field, time, 'r');
+      read->setResolutionRange(0, H);
+      dataset->beginBoxQuery(read);
+      if (!read->isRunning())
+        continue;
+
+      if (!dataset->executeBoxQuery(access, read))
+        return false;
+
+      filter->internalComputeFilter(read.get(), /*bInverse*/false);
+
+      auto write = dataset->createBoxQuery(window, field, time, 'w');
+      write->setResolutionRange(0, H);
+      dataset->beginBoxQuery(write);
+      write->buffer = read->buffer;
+      if (!dataset->executeBoxQuery(access, write))
+        return false;
+    }
+
+    SlidingWindow[bit] <<= 1;
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestComputeFilter()
+{
+  struct TestCase
+  {
+    BoxNi   logic_box;
+    String  dtype;
+    String  filter;
+    int     bitsperblock;
+    PointNi sliding_window;
+  };
+
+  std::vector<TestCase> test_cases = {
+    { BoxNi(PointNi(12, 11), PointNi(112, 88)),         "uint16",    "dehaar", 8,  PointNi(32, 32) },
+    { BoxNi(PointNi(0, 0), PointNi(128, 128)),          "uint8[2]",  "max",    10, PointNi(16, 16) },
+    { BoxNi(PointNi(3, 0, 5), PointNi(43, 36, 25)),     "float32",   "dehaar", 10, PointNi(8, 8, 8) },
+    { BoxNi(PointNi(0, 0, 0), PointNi(33, 64, 17)),     "uint16[2]", "min",    12, PointNi(4, 4, 4) }
+  };
+
+  for (auto test_case : test_cases)
+  {
+    //same random samples in both datasets
+    Array samples(test_case.logic_box.size(), DType::fromString(test_case.dtype));
+    if (samples.dtype.isVectorOf(DTypes::FLOAT32))
+    {
+      for (Int64 I = 0, N = samples.getTotalNumberOfSamples() * samples.dtype.ncomponents(); I < N; I++)
+        ((Float32*)samples.c_ptr())[I] = (Float32)Utils::getRandInteger(0, 999) / 7;
+    }
+    else
+    {
+      for (Int64 I = 0; I < samples.c_size(); I++)
+        samples.c_ptr()[I] = (Uint8)Utils::getRandInteger(0, 49);
+    }
+
+    auto createDataset = [&](String filename)
+    {
+      IdxFile idxfile;
+      idxfile.logic_box = test_case.logic_box;
+      idxfile.bitsperblock = test_case.bitsperblock;
+      Field field("myfield", samples.dtype);
+      field.filter = test_case.filter;
+      field.default_compression = "lz4";
+      idxfile.fields.push_back(field);
+      idxfile.save(filename);
+
+      auto dataset = LoadIdxDataset(filename);
+      auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'w');
+      dataset->beginBoxQuery(query);
+      VisusReleaseAssert(query->isRunning());
+      query->buffer = samples;
+      VisusReleaseAssert(dataset->executeBoxQuery(dataset->createAccess(), query));
+      return dataset;
+    };
+
+    auto readRawSamples = [&](SharedPtr<IdxDataset> dataset)
+    {
+      auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'r');
+      query->disableFilters();
+      dataset->beginBoxQuery(query);
+      VisusReleaseAssert(query->isRunning());
+      VisusReleaseAssert(dataset->executeBoxQuery(dataset->createAccess(), query));
+      return query->buffer;
+    };
+
+    auto expected = createDataset("tmp/self_test_idx/filter_expected.idx");
+    auto field = expected->getField();
+    VisusReleaseAssert(ComputeFilterLevelByLevel(expected.get(), expected->createFilter(field), field, expected->createAccess(), test_case.sliding_window));
+
+    auto computed = createDataset("tmp/self_test_idx/filter_computed.idx");
+    VisusReleaseAssert(computed->computeFilter(computed->createFilter(field), computed->getTime(), field, computed->createAccess(), test_case.sliding_window));
+
+    //the filtered coefficients must be bit-identical
+    auto A = readRawSamples(expected);
+    auto B = readRawSamples(computed);
+    VisusReleaseAssert(A.c_size() == B.c_size() && memcmp(A.c_ptr(), B.c_ptr(), (size_t)A.c_size()) == 0);
+
+    expected->removeFiles();
+    computed->removeFiles();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestBoxQueryCostModel()
+{
+  //each level doubles the bytes of the query
+  auto getByteSize = [](int H) {
+    return std::pow(2.0, H);
+  };
+
+  const int minh = 8, endh = 20, step = 2;
+  const double latency_budget = 100;
+
+  //no history
+  {
+    BoxQueryCostModel cost_model;
+    VisusReleaseAssert(!cost_model.hasHistory());
+    VisusReleaseAssert(cost_model.estimateMsec(10, 1000) == -1);
+  }
+
+  //0.01 msec per byte: the first frame is the finest with at most 10000 bytes, then one step at a time
+  {
+    BoxQueryCostModel cost_model;
+    cost_model.addStep(10, 1000, 10);
+    VisusReleaseAssert(cost_model.hasHistory());
+    VisusReleaseAssert(cost_model.guessEndResolutions(minh, endh, step, latency_budget, getByteSize) == std::vector<int>({ 13, 15, 17, 19, 20 }));
+
+    //moving average (0.7*10+0.3*110=40 msec per 1000 bytes), the ladder gets longer
+    cost_model.addStep(10, 1000, 110);
+    VisusReleaseAssert(std::fabs(cost_model.estimateMsec(12, 1000) - 40) < 1e-6);
+    VisusReleaseAssert(cost_model.guessEndResolutions(minh, endh, step, latency_budget, getByteSize) == std::vector<int>({ 11, 13, 15, 17, 19, 20 }));
+  }
+
+  //slow access: never coarser than minh
+  {
+    BoxQueryCostModel cost_model;
+    cost_model.addStep(10, 1000, 1000);
+    VisusReleaseAssert(cost_model.guessEndResolutions(minh, endh, step, latency_budget, getByteSize) == std::vector<int>({ 8, 10, 12, 14, 16, 18, 20 }));
+  }
+
+  //fast access: a single step
+  {
+    BoxQueryCostModel cost_model;
+    cost_model.addStep(10, 1e9, 1);
+    VisusReleaseAssert(cost_model.guessEndResolutions(minh, endh, step, latency_budget, getByteSize) == std::vector<int>({ 20 }));
+  }
+
+  //the nearest level with history is used, the finer one in case of ties
+  {
+    BoxQueryCostModel cost_model;
+    cost_model.addStep(8, 1000, 100);
+    cost_model.addStep(12, 1000, 10);
+    VisusReleaseAssert(cost_model.estimateMsec(10, 1000) == 10);
+    VisusReleaseAssert(cost_model.estimateMsec(9, 1000) == 100);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestReuseBoxQuery()
+{
+  IdxFile idxfile;
+  idxfile.logic_box = BoxNi(PointNi(0, 0), PointNi(512, 512));
+  idxfile.bitsperblock = 10;
+  idxfile.fields.push_back(Field("myfield", DTypes::UINT32));
+
+  String filename = "tmp/self_test_idx/reuse.idx";
+  idxfile.save(filename);
+  auto dataset = LoadIdxDataset(filename);
+
+  {
+    auto query = dataset->createBoxQuery(dataset->getLogicBox(), 'w');
+    dataset->beginBoxQuery(query);
+    VisusReleaseAssert(query->isRunning());
+    query->buffer = Array(query->getNumberOfSamples(), query->field.dtype);
+    for (Int64 I = 0, N = query->buffer.getTotalNumberOfSamples(); I < N; I++)
+      ((Uint32*)query->buffer.c_ptr())[I] = (Uint32)Utils::getRandInteger(0, 1 << 30);
+    VisusReleaseAssert(dataset->executeBoxQuery(dataset->createAccess(), query));
+  }
+
+  int maxh = dataset->getMaxResolution();
+
+  //run all the refinement steps (as QueryNode does), reusing the samples of prev if any
+  auto runBoxQuery = [&](BoxNi logic_box, std::vector<int> end_resolutions, SharedPtr<BoxQuery> prev)
+  {
+    auto access = dataset->createAccess();
+    auto query = dataset->createBoxQuery(logic_box, 'r');
+    query->end_resolutions = end_resolutions;
+    dataset->beginBoxQuery(query);
+    VisusReleaseAssert(query->isRunning());
+
+    std::vector<Array> ret;
+    while (query->isRunning())
+    {
+      bool bReused = prev && dataset->reuseBoxQuery(access, query, prev);
+      VisusReleaseAssert(!bReused || query->getCurrentResolution() > -1);
+      if (query->getCurrentResolution() < query->getEndResolution())
+        VisusReleaseAssert(dataset->executeBoxQuery(access, query));
+      ret.push_back(query->buffer);
+      dataset->nextBoxQuery(query);
+    }
+    return std::make_pair(query, ret);
+  };
+
+  BoxNi prev_box(PointNi(100, 100), PointNi(300, 300));
+  auto prev = runBoxQuery(prev_box, { maxh - 4, maxh - 2 }, nullptr).first;
+
+  std::vector<BoxNi> boxes = {
+    prev_box,                                       //same view
+    prev_box.translate(PointNi(37, 11)),            //pan
+    prev_box.translate(PointNi(-100, 150)),         //pan (only a corner overlaps)
+    BoxNi(PointNi(150, 150), PointNi(250, 250)),    //zoom in
+    BoxNi(PointNi(0, 50), PointNi(512, 450)),       //zoom out
+    BoxNi(PointNi(400, 0), PointNi(512, 90))        //no overlap
+  };
+
+  for (auto box : boxes)
+  {
+    for (auto end_resolutions : { std::vector<int>({ maxh - 6, maxh - 2 }), std::vector<int>({ maxh - 3, maxh }) })
+    {
+      //pan/zoom must be byte-identical to a fresh query, at each refinement step
+      auto fresh = runBoxQuery(box, end_resolutions, nullptr).second;
+      auto reused = runBoxQuery(box, end_resolutions, prev).second;
+      VisusReleaseAssert(fresh.size() == reused.size());
+      for (int N = 0; N < (int)fresh.size(); N++)
+      {
+        VisusReleaseAssert(fresh[N].dims == reused[N].dims);
+        VisusReleaseAssert(fresh[N].c_size() == reused[N].c_size() && memcmp(fresh[N].c_ptr(), reused[N].c_ptr(), (size_t)fresh[N].c_size()) == 0);
+      }
+    }
+  }
+
+  dataset->removeFiles();
+}
 
 ////////////////////////////////////////////////////////////////////////////////////
 class SelfTest
@@ -323,6 +903,34 @@ void SelfTestIdx(int max_seconds)
   }
 #endif
 
+  PrintInfo("Running encoders self test...");
+  SelfTestEncoders();
+  PrintInfo("...done");
+
+  PrintInfo("Running zstd dictionary self test...");
+  SelfTestZstdDictionary();
+  PrintInfo("...done");
+
+  PrintInfo("Running coarse read self test...");
+  SelfTestCoarseRead();
+  PrintInfo("...done");
+
+  PrintInfo("Running compute filter self test...");
+  SelfTestComputeFilter();
+  PrintInfo("...done");
+
+  PrintInfo("Running box query cost model self test...");
+  SelfTestBoxQueryCostModel();
+  PrintInfo("...done");
+
+  PrintInfo("Running reuse box query self test...");
+  SelfTestReuseBoxQuery();
+  PrintInfo("...done");
+
+  PrintInfo("Running multiplex speculative read self test...");
+  SelfTestMultiplexSpeculative();
+  PrintInfo("...done");
+
   ////do self testing on random field
   PrintInfo("Running self test procedure max_seconds", max_seconds, "...");
 
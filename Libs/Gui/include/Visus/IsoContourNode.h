@@ -45,6 +45,7 @@ For support : support@visus.net
 #include <Visus/GLTexture.h>
 #include <Visus/GLMesh.h>
 #include <Visus/TransferFunction.h>
+#include <Visus/MarchingCubes.h>
 #include <Visus/Model.h>
 #include <Visus/QDoubleSlider.h>
 #include <Visus/GuiFactory.h>
@@ -66,6 +67,7 @@ public:
   Array                       second_field; //this is used to color the surface 
   Range                       range;        //field range
   Array                       voxel_used;   // 1 if a voxel contributes to the isosurface; 0 otherwise
+  SharedPtr<IsoSurface>       surface;      //indexed mesh (the batches contain the same triangles, unindexed)
 
   //cosntructor
   IsoContour() {
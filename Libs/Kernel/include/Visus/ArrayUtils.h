@@ -76,6 +76,9 @@ public:
   //decodeArray
   static Array decodeArray(String compression, PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded);
 
+  //decodeArray (only the first num_samples in storage order are decoded, the others are zero; think about coarse reads of hzorder blocks)
+  static Array decodeArray(String compression, PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded, Int64 num_samples);
+
   //decodeArray
   static Array decodeArray(StringMap metadata, SharedPtr<HeapMemory> encoded);
 
@@ -372,8 +375,9 @@ public:
 
 public:
 
-  //applyTransferFunction
-  static Array applyTransferFunction(SharedPtr<TransferFunction> tf, Array src, Aborted aborted= Aborted());
+  //applyTransferFunction (8/16 bit integer inputs go through a lookup table, the others through a quantized one unless bExact or tf->isExact())
+  //a valid input_range is used for all the components instead of the transfer function normalization (i.e. no range computation)
+  static Array applyTransferFunction(SharedPtr<TransferFunction> tf, Array src, Aborted aborted= Aborted(), bool bExact=false, Range input_range=Range::invalid());
 
 private:
 
@@ -44,6 +44,11 @@ For support : support@visus.net
 #include <Visus/CriticalSection.h>
 
 #include <list>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <type_traits>
 
 namespace Visus {
 
@@ -52,6 +57,112 @@ namespace Visus {
 //see http://stackoverflow.com/questions/19225372/waiting-for-multiple-futures
 
 ///////////////////////////////////////////////////////////
+//thread-local free list of fixed-size blocks (promises are created/destroyed at a very high rate, i.e. one per block query)
+template <size_t Size>
+class PooledBlocks
+{
+public:
+
+  //alloc
+  static void* alloc()
+  {
+    if (auto cache = getCache())
+    {
+      if (!cache->blocks.empty())
+      {
+        void* ret = cache->blocks.back();
+        cache->blocks.pop_back();
+        return ret;
+      }
+    }
+    return ::operator new(Size);
+  }
+
+  //release
+  static void release(void* p)
+  {
+    auto cache = getCache();
+    if (cache && cache->blocks.size() < MaxCached)
+      cache->blocks.push_back(p);
+    else
+      ::operator delete(p);
+  }
+
+private:
+
+  enum { MaxCached = 1024 };
+
+  //_______________________________________
+  class Cache
+  {
+  public:
+
+    std::vector<void*> blocks;
+
+    //constructor
+    Cache() {
+      getState() = Alive;
+    }
+
+    //destructor
+    ~Cache() {
+      getState() = Dead;
+      for (auto it : blocks)
+        ::operator delete(it);
+    }
+  };
+
+  enum { Uninitialized = 0, Alive, Dead };
+
+  //getState (trivially destructible, so it can still be checked while the thread exits)
+  static int& getState() {
+    static thread_local int ret = Uninitialized;
+    return ret;
+  }
+
+  //getCache
+  static Cache* getCache() {
+    if (getState() == Dead) return nullptr;
+    static thread_local Cache ret;
+    return &ret;
+  }
+
+};
+
+///////////////////////////////////////////////////////////
+template <typename T>
+class PooledAllocator
+{
+public:
+
+  typedef T value_type;
+
+  //constructor
+  PooledAllocator() {
+  }
+
+  //constructor
+  template <typename U>
+  PooledAllocator(const PooledAllocator<U>&) {
+  }
+
+  //allocate
+  T* allocate(std::size_t n) {
+    return n == 1 ? (T*)PooledBlocks<sizeof(T)>::alloc() : (T*)::operator new(n * sizeof(T));
+  }
+
+  //deallocate
+  void deallocate(T* p, std::size_t n) {
+    if (n == 1) PooledBlocks<sizeof(T)>::release(p); else ::operator delete(p);
+  }
+
+  template <typename U> bool operator==(const PooledAllocator<U>&) const { return true; }
+  template <typename U> bool operator!=(const PooledAllocator<U>&) const { return false; }
+
+};
+
+///////////////////////////////////////////////////////////
+//note: the value is constructed in place by set_value, so Value does not need a default constructor
 template <typename __Value__>
 class BasePromise
 {
@@ -59,62 +170,117 @@ public:
 
   typedef __Value__ Value;
 
-  CriticalSection  lock;
-  SharedPtr<Value> value;
-
   typedef std::function<void(Value)> Callback;
 
   //constructor
-  BasePromise() {
+  BasePromise() : state(Empty) {
+  }
+
+  //destructor
+  ~BasePromise() {
+    if (is_ready())
+      getValue().~Value();
+  }
+
+  //create (from the pool)
+  static SharedPtr<BasePromise> create() {
+    return std::allocate_shared<BasePromise>(PooledAllocator<BasePromise>());
   }
 
   //set_value
   void set_value(const Value& value)
   {
-    std::vector<Callback> callbacks;
+    Callback first;
+    std::vector<Callback> others;
     {
       ScopedLock lock(this->lock);
-      VisusAssert(!this->value);
-      this->value = std::make_shared<Value>(value);
-      callbacks =this->callbacks;
-      this->callbacks.clear(); //one shot
+      VisusAssert(state.load() == Empty);
+      new (&storage) Value(value);
+      state.store(Ready, std::memory_order_release);
+
+      //one shot
+      first = std::move(this->first);
+      others.swap(this->others);
+
+      for (; nwaiting > 0; --nwaiting)
+        waiting->up();
     }
 
-    for (auto fn : callbacks)
-      fn(value);
-  }
+    if (first)
+      first(value);
 
-  //addWhenDoneListener (must have the lock and value must not exists)
-  void addWhenDoneListener(Callback fn) {
-    VisusAssert(!value);
-    callbacks.push_back(fn);
+    for (auto& fn : others)
+      fn(value);
   }
 
-  //isDone
+  //is_ready (no lock needed)
   bool is_ready() const {
-    ScopedLock lock(const_cast<BasePromise*>(this)->lock);
-    return value? true : false;
+    return state.load(std::memory_order_acquire) == Ready;
   }
 
   //when_ready
-  void when_ready(Callback fn) {
-    this->lock.lock();
-    if (value) {
-      this->lock.unlock();
-      fn(*value);
+  void when_ready(Callback fn) 
+  {
+    if (!is_ready())
+    {
+      ScopedLock lock(this->lock);
+      if (!is_ready())
+      {
+        //most of the times there is only one listener, no need for the vector
+        if (!first)
+          first = std::move(fn);
+        else
+          others.push_back(std::move(fn));
+        return;
+      }
     }
-    else
+
+    fn(getValue());
+  }
+
+  //get (wait for the value)
+  const Value& get()
+  {
+    if (!is_ready())
     {
-      addWhenDoneListener(fn);
-      this->lock.unlock();
+      this->lock.lock();
+      if (!is_ready())
+      {
+        //the semaphore is created only if someone really needs to wait
+        if (!waiting)
+          waiting.reset(new Semaphore());
+        ++nwaiting;
+        this->lock.unlock();
+        waiting->down();
+      }
+      else
+      {
+        this->lock.unlock();
+      }
     }
+
+    VisusAssert(is_ready());
+    return getValue();
   }
 
 private:
 
   VISUS_NON_COPYABLE_CLASS(BasePromise)
 
-  std::vector< Callback > callbacks;
+  enum { Empty = 0, Ready };
+
+  CriticalSection                lock;
+  std::atomic<int>               state;
+  typename std::aligned_storage<sizeof(Value), alignof(Value)>::type storage;
+  Callback                       first;
+  std::vector<Callback>          others;
+  std::unique_ptr<Semaphore>     waiting;
+  int                            nwaiting = 0;
+
+  //getValue (valid only when ready)
+  const Value& getValue() const {
+    return *reinterpret_cast<const Value*>(&storage);
+  }
 
 };
 
@@ -134,38 +300,9 @@ public:
   Future(SharedPtr< BasePromise<Value> > promise_) : promise(promise_) {
   }
 
-  //copy constructor
-  Future(const Future& other) : Future(other.promise) {
-  }
-
-  //constructor
-  ~Future() {
-  }
-
-  //operator=
-  Future& operator=(const Future& other) {
-    this->promise=other.promise;
-    return *this;
-  }
-
   //get
-  Value get() const
-  {
-    ScopedLock lock(promise->lock);
-    
-    //need to wait?
-    if (!promise->value)
-    {
-      promise->addWhenDoneListener([this](Value){
-        const_cast<Future*>(this)->ready.up();
-      });
-      promise->lock.unlock();
-      const_cast<Future*>(this)->ready.down();
-      promise->lock.lock();
-      VisusAssert(promise->value);
-    }
-
-    return *(promise->value);
+  Value get() const {
+    return promise->get();
   }
 
   //get_promise
@@ -191,7 +328,6 @@ public:
 private:
 
   SharedPtr< BasePromise<Value> > promise;
-  Semaphore                       ready;
 
 };
 
@@ -229,12 +365,16 @@ public:
 
 private:
 
-  SharedPtr< BasePromise<Value> > base_promise =std::make_shared< BasePromise<Value> >() ;
+  SharedPtr< BasePromise<Value> > base_promise = BasePromise<Value>::create();
 
 }; 
 
 
 ///////////////////////////////////////////////////////////
+/*
+Latch for many futures. Callbacks registered with pushRunning(...).when_ready(...) 
+are executed by waitAllDone() in the waiting thread, in the order the futures become ready.
+*/
 template <typename Future>
 class WaitAsync 
 {
@@ -242,6 +382,29 @@ public:
 
   typedef typename Future::Value Value;
 
+  typedef std::function<void(Value)> Callback;
+
+  //________________________________________
+  class Running
+  {
+  public:
+
+    //constructor
+    Running(WaitAsync* owner_, size_t index_) : owner(owner_), index(index_) {
+    }
+
+    //when_ready
+    void when_ready(Callback fn) {
+      owner->callbacks[index] = std::move(fn);
+    }
+
+  private:
+
+    WaitAsync* owner;
+    size_t     index;
+
+  };
+
   //constructor
   WaitAsync()  {
   }
@@ -252,76 +415,85 @@ public:
   }
 
   //pushRunning
-  Future pushRunning(Future future)
+  Running pushRunning(Future future)
   {
-    Future ret = Promise<Value>().get_future();
-
-    auto promise = future.get_promise();
-    VisusAssert(promise);
+    VisusAssert(future.get_promise());
 
-    ScopedLock promise_lock(promise->lock);
-    {
-      ScopedLock this_lock(this->lock);
-
-      ++ninside;
+    size_t index = callbacks.size();
+    callbacks.push_back(Callback());
+    ++ninside;
 
-      //no need to wait
-      if (promise->value)
-      {
-        ready.push_front(std::make_pair(ret,*promise->value));
-        nready.up();
-      }
-      //need to wait, as soon as it becomes available I'm moving it to ready deque
-      else
-      {
-        promise->addWhenDoneListener(typename BasePromise<Value>::Callback([this, future, ret](Value value)
-        {
-          ScopedLock this_lock(this->lock);
-          ready.push_front(std::make_pair(ret, value));
-          nready.up();
-        }));
-      }
-    }
+    //note: [this,index] is small enough to be stored inside the std::function
+    future.when_ready([this, index](Value value) {
+      setReady(index, value);
+    });
 
-    return ret;
+    return Running(this, index);
   }
 
   //getNumRunning
-  int getNumRunning() const
-  {
-    ScopedLock lock(const_cast<WaitAsync*>(this)->lock);
+  int getNumRunning() const {
     return this->ninside;
   }
 
   //waitAllDone
   void waitAllDone() 
   {
-    for (int I = 0, N= getNumRunning(); I < N; I++)
+    std::vector<Ready> popped;
+    while (ninside > 0)
     {
-      Ready popped;
-      nready.down();
+      this->lock.lock();
+      if (ready.empty())
       {
-        ScopedLock lock(this->lock);
-        VisusAssert(!this->ready.empty());
-        popped = this->ready.back();
-        this->ready.pop_back();
-        --ninside;
+        bWaiting = true;
+        this->lock.unlock();
+        nready.down();
+        this->lock.lock();
       }
+      VisusAssert(!ready.empty());
+      popped.swap(ready);
+      this->lock.unlock();
 
-      popped.first.get_promise()->set_value(popped.second);
+      for (auto& it : popped)
+      {
+        --ninside;
+
+        //note: moved out, the callback could push other futures (i.e. resize callbacks)
+        auto fn = std::move(callbacks[it.first]);
+        if (fn)
+          fn(it.second);
+      }
+      popped.clear();
     }
+
+    callbacks.clear();
   }
 
 private:
 
   VISUS_NON_COPYABLE_CLASS(WaitAsync)
 
-  typedef std::pair<Future, Value > Ready;
+  typedef std::pair<size_t, Value > Ready;
+
+  int                    ninside = 0;
+  std::vector<Callback>  callbacks;
 
-  CriticalSection     lock;
-  int                 ninside = 0;
-  Semaphore           nready;
-  std::deque< Ready > ready;
+  CriticalSection        lock;
+  std::vector<Ready>     ready;
+  bool                   bWaiting = false;
+  Semaphore              nready;
+
+  //setReady (can be called from any thread)
+  void setReady(size_t index, const Value& value)
+  {
+    ScopedLock lock(this->lock);
+    ready.push_back(std::make_pair(index, value));
+    if (bWaiting)
+    {
+      bWaiting = false;
+      nready.up();
+    }
+  }
 
 };
 
@@ -330,4 +502,3 @@ private:
 } //namespace Visus
 
 #endif //_VISUS_ASYNC_H__
-
@@ -54,6 +54,9 @@ public:
   StringMap metadata;
   String content_type;
 
+  //http status of getBlob (0 if there was no response at all)
+  int status = 0;
+
   //constructor
   CloudStorageBlob(SharedPtr<HeapMemory> body_ = SharedPtr<HeapMemory>(), StringMap metadata_ = StringMap(), String content_type_ = "application/octet-stream")
     : metadata(metadata_), body(body_), content_type(content_type_) {
@@ -64,6 +67,11 @@ public:
     return body ? true : false;
   }
 
+  //notFound (the blob does not exist, as opposed to a failed request)
+  bool notFound() const {
+    return status == HttpStatus::STATUS_NOT_FOUND;
+  }
+
   //operator==
   bool operator==(const CloudStorageBlob& b) const
   {
@@ -91,6 +99,7 @@ public:
   //Typical url syntax: <host>/<container_name>/<blob_name> 
   //where for example:
   //  <host>      = visus.blob.core.windows.net | visus.s3.amazonaws.com
+  //                (any other S3-compatible endpoint with ?cloud=s3, e.g. localhost:9000)
   //  <container> = 2kbit1
   //  <blob>      = block0001.bin
 
@@ -107,9 +116,65 @@ public:
   //createInstance
   static SharedPtr<CloudStorage> createInstance(Url url);
   
-  //getBlob
-  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String name, Aborted aborted = Aborted()) = 0;
+  //getMultipartSize
+  Int64 getMultipartSize() const {
+    return multipart_size;
+  }
+
+  //setMultipartSize (blobs bigger than this are uploaded as concurrent parts, if the backend supports it)
+  void setMultipartSize(Int64 value) {
+    multipart_size = value;
+  }
+
+  //getMaxRetries
+  int getMaxRetries() const {
+    return max_retries;
+  }
+
+  //setMaxRetries
+  void setMaxRetries(int value) {
+    max_retries = value;
+  }
+
+  //getBlob (size>0 means read only the byte range [offset,offset+size))
+  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String name, Aborted aborted = Aborted(), Int64 offset = 0, Int64 size = 0) = 0;
 
+  //addBlob (replaces any existing blob with the same name)
+  virtual Future<bool> addBlob(SharedPtr<NetService> service, CloudStorageBlob blob, String name, Aborted aborted = Aborted()) = 0;
+
+protected:
+
+  Int64 multipart_size = 8 * 1024 * 1024; //S3 wants parts of at least 5MB
+  int   max_retries    = 5;
+
+  //pushWithRetry (transient failures are retried with exponential backoff, the request is signed again before each attempt)
+  Future<NetResponse> pushWithRetry(SharedPtr<NetService> service, NetRequest request, std::function<void(NetRequest&)> sign);
+
+  //getNumParts
+  int getNumParts(CloudStorageBlob blob) const {
+    Int64 size = blob.body ? blob.body->c_size() : 0;
+    return (multipart_size > 0 && size > multipart_size) ? (int)((size + multipart_size - 1) / multipart_size) : 1;
+  }
+
+  //getPart
+  static SharedPtr<HeapMemory> getPart(CloudStorageBlob blob, Int64 part_size, int part) {
+    Int64 offset = part * part_size;
+    return HeapMemory::createUnmanaged(blob.body->c_ptr() + offset, std::min(part_size, blob.body->c_size() - offset));
+  }
+
+  //getXmlValue
+  static String getXmlValue(String body, String tag) {
+    int A = StringUtils::find(body, "<" + tag + ">"); if (A < 0) return "";
+    A += (int)tag.length() + 2;
+    int B = StringUtils::find(body.substr(A), "</" + tag + ">"); if (B < 0) return "";
+    return body.substr(A, B);
+  }
+
+  //setRange
+  static void setRange(NetRequest& request, Int64 offset, Int64 size) {
+    if (size > 0)
+      request.setHeader("Range", "bytes=" + cstring(offset) + "-" + cstring(offset + size - 1));
+  }
 
 };
 
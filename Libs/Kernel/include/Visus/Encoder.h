@@ -70,6 +70,20 @@ public:
   //decode
   virtual SharedPtr<HeapMemory> decode(PointNi dims,DType dtype, SharedPtr<HeapMemory> encoded)=0;
 
+  //decodeRange (decode only the samples in [A,B) of the sample sequence, A must be aligned to byte)
+  //by default it decodes everything and copies the range, encoders storing independent chunks can do better
+  virtual SharedPtr<HeapMemory> decodeRange(PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded, Int64 A, Int64 B);
+
+  //setDictionary (return false if the encoder does not support pre-trained dictionaries)
+  virtual bool setDictionary(SharedPtr<HeapMemory> dictionary) {
+    return false;
+  }
+
+  //trainDictionary (return null if the encoder does not support pre-trained dictionaries)
+  virtual SharedPtr<HeapMemory> trainDictionary(const std::vector< SharedPtr<HeapMemory> >& samples, Int64 max_size) {
+    return SharedPtr<HeapMemory>();
+  }
+
 };
 
 
@@ -88,6 +102,9 @@ public:
   //getEncoder
   SharedPtr<Encoder> createEncoder(String specs) const;
 
+  //trainDictionary (train a dictionary on a sample of decoded blocks)
+  SharedPtr<HeapMemory> trainDictionary(String specs, const std::vector< SharedPtr<HeapMemory> >& samples, Int64 max_size = 110 * 1024) const;
+
 private:
 
   std::vector< std::pair<String, Creator > > creators;
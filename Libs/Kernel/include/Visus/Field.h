@@ -41,6 +41,7 @@ For support : support@visus.net
 
 #include <Visus/Kernel.h>
 #include <Visus/DType.h>
+#include <Visus/HeapMemory.h>
 
 namespace Visus {
 
@@ -66,6 +67,9 @@ public:
   // name of compression (for storage)
   String default_compression;
 
+  //compression_dictionary (pre-trained dictionary for encoders supporting it, see Encoders::trainDictionary)
+  SharedPtr<HeapMemory> compression_dictionary;
+
   // default_layout (empty means rowmajor)
   String default_layout;
 
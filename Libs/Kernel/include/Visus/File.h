@@ -55,17 +55,18 @@ public:
 
 #if !SWIG
   std::atomic<Int64> nopen;
+  std::atomic<Int64> nclose;
   std::atomic<Int64> rbytes;
   std::atomic<Int64> wbytes;
 #endif
 
   //constructor
-  FileGlobalStats() : nopen(0), rbytes(0), wbytes(0){
+  FileGlobalStats() : nopen(0), nclose(0), rbytes(0), wbytes(0){
   }
 
   //resetStats
   void resetStats() {
-    nopen = rbytes = wbytes = 0;
+    nopen = nclose = rbytes = wbytes = 0;
   }
 
   //getReadBytes
@@ -83,6 +84,11 @@ public:
     return nopen;
   }
 
+  //getNumCurrentlyOpen
+  Int64 getNumCurrentlyOpen() const {
+    return nopen - nclose;
+  }
+
 };
 
 /////////////////////////////////////////////////////////////////////////
@@ -145,6 +151,10 @@ public:
       File::global_stats()->nopen++;
     }
 
+    inline void onCloseEvent() {
+      File::global_stats()->nclose++;
+    }
+
     inline void onReadEvent(Int64 value) {
       File::global_stats()->rbytes += value;
     }
@@ -53,6 +53,16 @@ public:
 
   VISUS_NON_COPYABLE_CLASS(HeapMemory)
 
+  //all managed memory is aligned to this value (so that SIMD kernels can rely on it)
+  enum { Alignment = 64 };
+
+  class VISUS_KERNEL_API Defaults
+  {
+  public:
+    static bool pool;       //recycle block-sized allocations in size-class pools
+    static bool huge_pages; //ask for huge pages for big allocations (Linux only)
+  };
+
   //constructor
   HeapMemory();
 
@@ -74,9 +84,15 @@ public:
   //resize (i.e. change the c_size())
   bool resize(Int64 size, const char* file, int line);
 
-  //shrink (so that c_capacity()==c_size())
+  //shrink (so that c_capacity() is the smallest allocation able to contain c_size())
   bool shrink();
 
+  //trimPool (give back to the OS the memory cached in the central pool and in the calling thread cache)
+  static void trimPool();
+
+  //getPooledMemory (bytes freed but kept in the pools)
+  static Int64 getPooledMemory();
+
   //hasConstantValue
   bool hasConstantValue(Uint8 value) const;
 
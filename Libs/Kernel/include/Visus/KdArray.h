@@ -43,6 +43,8 @@ For support : support@visus.net
 #include <Visus/Array.h>
 #include <Visus/CriticalSection.h>
 
+#include <set>
+
 namespace Visus {
 
 ////////////////////////////////////////////////////////////
@@ -120,6 +122,93 @@ public:
 };
 
 
+//////////////////////////////////////////////
+/*
+Process-wide cache of kd nodes buffers (blockdata, fullres and displaydata), shared by all the KdArray with the same key
+(i.e. same dataset, field, time...) so that switching views or slices reuses the blocks already fetched.
+Buffers are shared, never copied. Eviction is LRU weighted by level: a node at level L is considered L*LevelPenalty 
+accesses older than the root, so that coarse levels (few and small) stay hot.
+*/
+class VISUS_KERNEL_API KdArrayCache
+{
+public:
+
+  VISUS_DECLARE_SINGLETON_CLASS(KdArrayCache)
+
+  enum { LevelPenalty = 256 };
+
+  //___________________________________________
+  class VISUS_KERNEL_API Statistics
+  {
+  public:
+
+    Int64 num_hits = 0, num_misses = 0, num_evictions = 0;
+    Int64 num_entries = 0;
+    Int64 used_memory = 0;
+  };
+
+  //constructor
+  KdArrayCache(Int64 max_memory_=0) : max_memory(max_memory_) {
+  }
+
+  //destructor
+  ~KdArrayCache() {
+  }
+
+  //getMaxMemory
+  Int64 getMaxMemory() const {
+    return max_memory;
+  }
+
+  //setMaxMemory
+  void setMaxMemory(Int64 value);
+
+  //store (insert or refresh the buffers of a node)
+  void store(String key, KdArrayNode* node);
+
+  //restore (the node gets the cached buffers, if any)
+  bool restore(String key, KdArrayNode* node);
+
+  //clear
+  void clear();
+
+  //getStatistics
+  Statistics getStatistics();
+
+  //printStatistics
+  void printStatistics();
+
+private:
+
+  typedef std::pair<String, BigInt> Key;
+
+  class Entry
+  {
+  public:
+    Array blockdata;
+    Array fullres;
+    Array displaydata;
+    Int64 c_size = 0;
+    int   level = 0;
+    Int64 priority = 0;
+  };
+
+  CriticalSection               lock;
+  Int64                         max_memory = 0;
+  Int64                         clock = 0;
+  std::map<Key, Entry>          entries;
+  std::set< std::pair<Int64,Key> > lru;
+  Statistics                    statistics;
+
+  //touch
+  void touch(const Key& key, Entry& entry);
+
+  //evict
+  void evict(Int64 limit);
+
+};
+
+
 //////////////////////////////////////////////
 class VISUS_KERNEL_API KdArray 
 {
@@ -166,15 +255,15 @@ public:
     return node->logic_box.strictIntersect(this->logic_box);
   }
 
-  //enableCaching
-  void enableCaching(int cutoff,Int64 fine_maxmemory);
+  //enableCaching (nodes leaving the tree go to the global KdArrayCache, see KdArrayCache for the key)
+  void enableCaching(String cache_key);
+
+  //restoreFromCache
+  bool restoreFromCache(KdArrayNode* node);
 
 private:
 
-  //in case you need some caching
-  class SingleCache;
-  class MultiCache;
-  SharedPtr<MultiCache> cache;
+  String cache_key;
 
   int pdim;
 
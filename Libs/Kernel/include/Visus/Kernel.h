@@ -445,6 +445,8 @@ private:
   CommandLine() = delete;
 };
 
+VISUS_KERNEL_API void SelfTestKernel();
+
 } //namespace Visus
 
 
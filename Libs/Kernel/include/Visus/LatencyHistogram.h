@@ -0,0 +1,160 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_LATENCY_HISTOGRAM_H
+#define __VISUS_LATENCY_HISTOGRAM_H
+
+#include <Visus/Kernel.h>
+#include <Visus/Utils.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace Visus {
+
+/////////////////////////////////////////////////////////////////////////////////////
+/*
+Lock-free log-linear (HDR-style) histogram of durations in microseconds.
+
+Values up to SubBuckets are counted exactly, bigger values fall in one of SubBuckets linear
+sub-buckets of their power-of-two octave (i.e. relative error <= 1/SubBuckets).
+Buckets are (lower,upper], so the powers of two are exact "<=" boundaries (i.e. Prometheus le buckets).
+Recording is a couple of relaxed atomic increments, so it can stay on in production.
+*/
+class VISUS_KERNEL_API LatencyHistogram
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(LatencyHistogram)
+
+  enum
+  {
+    SubBits    = 3,
+    SubBuckets = 1 << SubBits,
+    MaxBits    = 40, //~12 days, bigger values are clamped
+    NumBuckets = SubBuckets + (MaxBits - SubBits) * SubBuckets
+  };
+
+  //constructor
+  LatencyHistogram() {
+    reset();
+  }
+
+  //reset
+  void reset();
+
+  //record
+  void record(Int64 usec) 
+  {
+    usec = std::max((Int64)0, usec);
+    buckets[getBucket(usec)].fetch_add(1, std::memory_order_relaxed);
+    count.fetch_add(1, std::memory_order_relaxed);
+    sum.fetch_add(usec, std::memory_order_relaxed);
+  }
+
+  //now (microseconds, monotonic)
+  static Int64 now() {
+    return (Int64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  //getCount
+  Int64 getCount() const {
+    return count.load(std::memory_order_relaxed);
+  }
+
+  //getSum (microseconds)
+  Int64 getSum() const {
+    return sum.load(std::memory_order_relaxed);
+  }
+
+  //getCountAtMost (number of values <= usec, usec should be a power of two to be exact)
+  Int64 getCountAtMost(Int64 usec) const;
+
+  //getQuantile (q in [0,1], returns microseconds)
+  Int64 getQuantile(double q) const;
+
+  //toPrometheus (_bucket lines with le from 2^min_bits to 2^max_bits usec, then +Inf, _sum and _count; labels without braces)
+  String toPrometheus(String name, String labels, int min_bits, int max_bits) const;
+
+  //getBucket (0 goes to the first bucket)
+  static int getBucket(Int64 usec) 
+  {
+    Int64 value = std::max((Int64)0, usec - 1);
+    if (value < SubBuckets)
+      return (int)value;
+
+    int msb = Utils::getLog2(value);
+    if (msb >= MaxBits)
+      return NumBuckets - 1;
+
+    int sub = (int)((value >> (msb - SubBits)) & (SubBuckets - 1));
+    return SubBuckets + (msb - SubBits) * SubBuckets + sub;
+  }
+
+  //getBucketLowerBound (exclusive)
+  static Int64 getBucketLowerBound(int index) 
+  {
+    if (index < SubBuckets)
+      return index;
+
+    int msb = SubBits + (index - SubBuckets) / SubBuckets;
+    int sub = (index - SubBuckets) % SubBuckets;
+    return (Int64)(SubBuckets + sub) << (msb - SubBits);
+  }
+
+  //getBucketUpperBound (inclusive)
+  static Int64 getBucketUpperBound(int index) 
+  {
+    if (index < SubBuckets)
+      return index + 1;
+
+    int msb = SubBits + (index - SubBuckets) / SubBuckets;
+    return getBucketLowerBound(index) + ((Int64)1 << (msb - SubBits));
+  }
+
+private:
+
+  std::atomic<Int64> buckets[NumBuckets];
+  std::atomic<Int64> count;
+  std::atomic<Int64> sum;
+
+};
+
+} //namespace Visus
+
+#endif //__VISUS_LATENCY_HISTOGRAM_H
@@ -0,0 +1,105 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef VISUS_MARCHING_CUBES_H
+#define VISUS_MARCHING_CUBES_H
+
+#include <Visus/Kernel.h>
+#include <Visus/Array.h>
+#include <Visus/Range.h>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////////
+class VISUS_KERNEL_API IsoSurface
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(IsoSurface)
+
+  Array                field;      //the scalar field the surface has been extracted from
+  Range                range;      //field range
+  std::vector<Point3f> vertices;   //in field index space (i.e. vertex (x,y,z) is the sample field[x,y,z])
+  std::vector<Uint32>  triangles;  //3 indices into vertices for each triangle
+  Array                voxel_used; //(optional) 1 if a voxel contributes to the isosurface; 0 otherwise
+
+  //constructor
+  IsoSurface() {
+  }
+
+  //getNumberOfTriangles
+  Int64 getNumberOfTriangles() const {
+    return (Int64)triangles.size() / 3;
+  }
+
+};
+
+//////////////////////////////////////////////////////////////////
+/*
+Marching cubes on a 3d scalar field.
+
+The volume is split in slabs along z, extracted in parallel on the Scheduler. Vertices are shared between
+cells (each grid edge crossing the surface produces exactly one vertex) and the result is an indexed mesh.
+Blocks of cells whose [min,max] does not contain the isovalue are skipped.
+*/
+class VISUS_KERNEL_API MarchingCubes
+{
+public:
+
+  VISUS_CLASS(MarchingCubes)
+
+  Array    data;
+  double   isovalue = 0;
+  bool     enable_voxel_used = false;
+  int      block_size = 16; //cells for each side of the min/max blocks, also the thickness of the slabs
+  Aborted  aborted;
+
+  //constructor
+  MarchingCubes(Array data_, double isovalue_, Aborted aborted_ = Aborted())
+    : data(data_), isovalue(isovalue_), aborted(aborted_) {
+  }
+
+  //run
+  SharedPtr<IsoSurface> run();
+
+};
+
+
+} //namespace Visus
+
+#endif //VISUS_MARCHING_CUBES_H
@@ -327,6 +327,9 @@ public:
   //method DELETE,GET,HEAD,POST,PUT
   String method;
 
+  //body_received (optional): gets the response body chunk by chunk while downloading (and response.body stays empty)
+  std::function<void(const Uint8*, Int64)> body_received;
+
   struct
   {
   public:
@@ -378,6 +381,10 @@ public:
 
   int  status;
 
+  //body_stream (optional): produces the body while the response is being sent, calling <write> for each chunk
+  //(write returns false when the peer went away). The response has no Content-Length and ends with the connection
+  std::function<void(std::function<bool(const Uint8*, Int64)> write)> body_stream;
+
   //default constructor
   NetResponse() : status(HttpStatus::STATUS_NONE) {
   }
@@ -419,6 +426,62 @@ public:
   //decompose
   static std::vector<NetResponse> decompose(NetResponse RESPONSE);
 
+  //readBodyStream (for transports that can only send a complete body)
+  void readBodyStream();
+
+  //getFrameHeader 
+  //a streamed composition sends each response as soon as it's ready: "<status> <headers-size> <body-size>\r\n" <headers> <body>
+  String getFrameHeader() const;
+
+};
+
+///////////////////////////////////////////////////////////////////////////////////////
+class VISUS_KERNEL_API NetResponseFrameParser
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(NetResponseFrameParser)
+
+  //constructor
+  NetResponseFrameParser(std::function<void(NetResponse)> on_frame_) : on_frame(on_frame_) {
+  }
+
+  //push (returns false if the stream is malformed)
+  bool push(const Uint8* data, Int64 size);
+
+  //getNumFrames
+  int getNumFrames() const {
+    return num_frames;
+  }
+
+  //isComplete (i.e. not in the middle of a frame)
+  bool isComplete() const {
+    return !bMalformed && state == ReadingFrameHeader && line.empty();
+  }
+
+private:
+
+  enum State
+  {
+    ReadingFrameHeader,
+    ReadingHeaders,
+    ReadingBody
+  };
+
+  std::function<void(NetResponse)> on_frame;
+
+  State       state = ReadingFrameHeader;
+  bool        bMalformed = false;
+  int         num_frames = 0;
+  String      line;
+  NetResponse frame;
+  Int64       headers_size = 0;
+  Int64       body_size = 0;
+  Int64       body_offset = 0;
+
+  //emitFrame
+  void emitFrame();
+
 };
 
 } //namespace Visus
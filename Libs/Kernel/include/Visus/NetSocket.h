@@ -89,6 +89,9 @@ public:
   //sendResponse
   bool sendResponse(NetResponse response);
 
+  //sendBytes (for streamed bodies)
+  bool sendBytes(const Uint8* buffer, Int64 size);
+
   //receiveRequest
   NetRequest receiveRequest();
 
@@ -42,6 +42,8 @@ For support : support@visus.net
 #include <Visus/Kernel.h>
 #include <Visus/CriticalSection.h>
 
+#include <atomic>
+
 namespace Visus {
 
 //////////////////////////////////////////////////////////////////////////
@@ -73,15 +75,30 @@ public:
   //freeMemory
   bool freeMemory(Int64 reqsize);
 
+  //getHeapMemory (bytes currently accounted by allocateMemory/freeMemory)
+  Int64 getHeapMemory() const {
+    return heap_memory;
+  }
+
+  //getPooledMemory (bytes freed by HeapMemory but still cached in its pools, not included in getHeapMemory)
+  Int64 getPooledMemory() const;
+
 private:
 
   //constructor
   RamResource();
 
-  CriticalSection lock;
-  
   Int64 os_total_memory=0;
 
+  //lock-free accounting, the OS counters are sampled only from time to time (see allocateMemory)
+  std::atomic<Int64> heap_memory;
+  std::atomic<Int64> sampled_used_memory;
+  std::atomic<Int64> sampled_heap_memory;
+  std::atomic<Int64> sampled_time;
+  CriticalSection    sample_lock;
+
+  //sampleUsedMemory
+  void sampleUsedMemory();
   
 };
 
@@ -0,0 +1,199 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_SCHEDULER_H__
+#define __VISUS_SCHEDULER_H__
+
+#include <Visus/Kernel.h>
+#include <Visus/Thread.h>
+#include <Visus/Async.h>
+
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+
+namespace Visus {
+
+////////////////////////////////////////////////////////
+/*
+Process-wide work-stealing scheduler.
+
+Each worker owns one deque per priority class: it pops its own jobs LIFO (cache friendly for nested parallelism)
+and steals other workers' jobs FIFO. Jobs pushed from threads that are not workers go to a shared injection queue.
+Higher priority classes are always served first:
+
+  Interactive  someone is waiting for the result (dataflow node jobs, block I/O for queries, network requests)
+  Background   nobody is waiting right now (for example uploads to cloud storage)
+
+A job that blocks (see BlockingScope, used automatically by Semaphore::down and around disk/process I/O) is compensated
+by a spare worker when there are jobs nobody else can run, so that jobs waiting for other jobs cannot starve the scheduler.
+There are never more spare workers than blocked workers, and spares exit after being idle.
+
+Exceptions thrown by parallelFor bodies are rethrown in the calling thread.
+*/
+class VISUS_KERNEL_API Scheduler
+{
+public:
+
+  VISUS_DECLARE_SINGLETON_CLASS(Scheduler)
+
+  enum Priority
+  {
+    Interactive=0,
+    Background,
+    NumPriorities
+  };
+
+  typedef std::function<void()> Job;
+
+  //constructor (num_workers<=0 means the number of hardware threads, at least 2)
+  Scheduler(int num_workers=0);
+
+  //destructor (waits for all pending jobs)
+  ~Scheduler();
+
+  //getNumWorkers
+  int getNumWorkers() const {
+    return (int)workers.size();
+  }
+
+  //getNumPendingJobs
+  Int64 getNumPendingJobs() const {
+    return num_pending;
+  }
+
+  //push
+  void push(Job job, int priority = Interactive);
+
+  //pushDelayed (the job is pushed after msec, nobody is kept busy in the meantime; pending delayed jobs are pushed at exit)
+  void pushDelayed(Job job, int msec, int priority = Interactive);
+
+  //async
+  template <typename Value>
+  Future<Value> async(std::function<Value()> fn, int priority = Interactive)
+  {
+    auto promise = BasePromise<Value>::create();
+    push([promise, fn]() {
+      promise->set_value(fn());
+    }, priority);
+    return Future<Value>(promise);
+  }
+
+  //parallelFor (calls fn(I) for I in [A,B), the calling thread takes part in the loop)
+  void parallelFor(Int64 A, Int64 B, std::function<void(Int64)> fn, int priority = Interactive, Int64 grain = 1);
+
+  //isWorkerThread
+  static bool isWorkerThread();
+
+  //________________________________________________
+  class VISUS_KERNEL_API BlockingScope
+  {
+  public:
+
+    VISUS_NON_COPYABLE_CLASS(BlockingScope)
+
+    //constructor
+    BlockingScope() {
+      Scheduler::beginBlocking();
+    }
+
+    //destructor
+    ~BlockingScope() {
+      Scheduler::endBlocking();
+    }
+  };
+
+  //beginBlocking (the current job is going to wait, if it's a worker make sure someone else can run jobs)
+  static void beginBlocking();
+
+  //endBlocking
+  static void endBlocking();
+
+  //internal use only
+  class Worker;
+
+private:
+
+  std::vector<Worker*>     workers;
+  Worker*                  injection = nullptr;
+
+  std::atomic<Int64>       num_pending;
+  std::atomic<Int64>       num_pending_by_priority[NumPriorities];
+
+  CriticalSection          sleep_lock;
+  std::condition_variable  sleep_cond;
+  std::atomic<int>         num_sleeping;
+  bool                     bExit = false;
+
+  std::vector< SharedPtr<std::thread> > threads;
+
+  std::atomic<int>         num_blocked;
+  std::atomic<int>         num_spares;
+
+  //delayed jobs by due time (see pushDelayed), the timer thread is started on first use
+  typedef std::chrono::steady_clock::time_point TimePoint;
+  CriticalSection                                    delayed_lock;
+  std::condition_variable                            delayed_cond;
+  std::multimap<TimePoint, std::pair<Job, int> >     delayed;
+  SharedPtr<std::thread>                             timer_thread;
+  bool                                               bExitTimer = false;
+
+  //workerEntryProc
+  void workerEntryProc(Worker* worker);
+
+  //popJob
+  bool popJob(Worker* worker, Job& job);
+
+  //startSpareIfNeeded
+  void startSpareIfNeeded();
+
+  //wakeUp
+  void wakeUp();
+
+  //timerEntryProc
+  void timerEntryProc();
+
+};
+
+} //namespace Visus
+
+#endif  //__VISUS_SCHEDULER_H__
+
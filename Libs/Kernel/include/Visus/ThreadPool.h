@@ -41,11 +41,13 @@ For support : support@visus.net
 
 #include <Visus/Kernel.h>
 #include <Visus/Thread.h>
+#include <Visus/Scheduler.h>
 
 #include <vector>
 #include <set>
 #include <deque>
 #include <atomic>
+#include <condition_variable>
 
 namespace Visus {
 
@@ -72,6 +74,11 @@ public:
 };
 
 ////////////////////////////////////////////////////////
+/*
+A named queue of jobs executed by the global Scheduler, with at most num_workers jobs running at the same time
+(i.e. num_workers=1 gives a serial queue where jobs run in the same order they are pushed).
+No thread is owned by the pool.
+*/
 class VISUS_KERNEL_API ThreadPool
 {
 public:
@@ -85,11 +92,21 @@ public:
   }
 
   //constructor
-  ThreadPool(String basename,int num_workers);
+  ThreadPool(String basename,int num_workers,int priority=Scheduler::Interactive);
 
   //destructor
   virtual ~ThreadPool();
 
+  //getName
+  String getName() const {
+    return basename;
+  }
+
+  //getNumWorkers
+  int getNumWorkers() const {
+    return num_workers;
+  }
+
   //waitAll
   void waitAll();
 
@@ -98,30 +115,22 @@ public:
 
 private:
 
-  //___________________________________________
-  class WaitAll
-  {
-  public:
-    CriticalSection  lock;
-    int              num_inside = 0;
-    Semaphore        num_done;
-    WaitAll() : num_inside(0) {}
-  };
+  String                                basename;
+  int                                   num_workers = 1;
+  int                                   priority = Scheduler::Interactive;
 
-
-  CriticalSection                                   lock;
-  std::vector< SharedPtr<std::thread> >             threads;
-  Semaphore                                         nwaiting;
-  std::deque< SharedPtr<std::function<void()> > >   waiting;
-  std::set  < SharedPtr<std::function<void()> > >   running;
-  WaitAll                                           wait_all;
-
-  //workerEntryProc
-  void workerEntryProc(int worker);
+  CriticalSection                       lock;
+  std::deque< std::function<void()> >   waiting;
+  int                                   num_running = 0; //number of scheduler jobs draining the queue
+  int                                   num_pending = 0; //waiting + running
+  std::condition_variable               all_done;
 
   //asyncRun
   void asyncRun(std::function<void()> fn);
 
+  //drain
+  void drain();
+
 };
 
 } //namespace Visus
@@ -0,0 +1,157 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef __VISUS_TRACE_H
+#define __VISUS_TRACE_H
+
+#include <Visus/Kernel.h>
+
+#include <atomic>
+#include <vector>
+
+namespace Visus {
+
+/////////////////////////////////////////////////////////////////////////////////////
+/*
+Lightweight tracing of scoped spans.
+
+Each thread records its spans in its own ring buffer (oldest spans are overwritten), so
+recording never contends with other threads. When tracing is disabled a span costs only
+the check of an atomic flag.
+
+Names and categories must be string literals (they are stored as pointers).
+
+Enable it with:
+  Trace::setEnabled(true);
+or in visus.config:
+  <Configuration><Trace enabled="true" filename="trace.json" buffer_size="65536" max_exited_threads="64" /></Configuration>
+*/
+class VISUS_KERNEL_API Trace
+{
+public:
+
+  class Event
+  {
+  public:
+    const char* category = nullptr;
+    const char* name = nullptr;
+    int         tid = 0;
+    Int64       begin = 0; //nanoseconds
+    Int64       end = 0;   //nanoseconds
+  };
+
+  //number of spans kept per thread
+  static int buffer_size;
+
+  //number of exited threads whose spans are kept for export (the oldest are dropped)
+  static int max_exited_threads;
+
+  //isEnabled
+  static bool isEnabled() {
+    return bEnabled.load(std::memory_order_relaxed);
+  }
+
+  //setEnabled
+  static void setEnabled(bool value);
+
+  //now (nanoseconds, monotonic)
+  static Int64 now();
+
+  //addEvent
+  static void addEvent(const char* category, const char* name, Int64 begin, Int64 end);
+
+  //setThreadName
+  static void setThreadName(String name);
+
+  //getEvents (sorted by begin time)
+  static std::vector<Event> getEvents();
+
+  //clear
+  static void clear();
+
+  //toChromeJSON (chrome://tracing or https://ui.perfetto.dev)
+  static String toChromeJSON();
+
+  //saveChromeJSON
+  static bool saveChromeJSON(String filename);
+
+private:
+
+#if !SWIG
+  static std::atomic<bool> bEnabled;
+#endif
+
+  Trace() = delete;
+
+};
+
+/////////////////////////////////////////////////////////////////////////////////////
+#if !SWIG
+class ScopedTrace
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(ScopedTrace)
+
+  //constructor
+  ScopedTrace(const char* category_, const char* name_) : category(category_), name(name_) {
+    if (Trace::isEnabled())
+      begin = Trace::now();
+  }
+
+  //destructor
+  ~ScopedTrace() {
+    if (begin)
+      Trace::addEvent(category, name, begin, Trace::now());
+  }
+
+private:
+
+  const char* category;
+  const char* name;
+  Int64       begin = 0;
+
+};
+
+#define VisusTrace(category,name) Visus::ScopedTrace VISUS_JOIN_MACRO(__visus_trace__,__LINE__)(category,name)
+#endif
+
+} //namespace Visus
+
+#endif //__VISUS_TRACE_H
+
@@ -264,6 +264,16 @@ public:
     setProperty("SetOutputDType", this->output_dtype, value);
   }
 
+  //isExact (false means float/32/64 bit inputs go through a quantized lookup table)
+  bool isExact() const {
+    return exact;
+  }
+
+  //setExact
+  void setExact(bool value) {
+    setProperty("SetExact", this->exact, value);
+  }
+
   //getOutputRange
   Range getOutputRange() const {
     return output_range;
@@ -336,6 +346,9 @@ private:
   //how to map the range [0,1] to some user range
   Range output_range = Range(0, 255, 1);
 
+  //evaluate the functions for each sample
+  bool exact = false;
+
 };
 
 typedef TransferFunction Palette;
@@ -58,7 +58,10 @@ public:
   AmazonCloudStorage(Url url)
   {
     this->protocol = url.getProtocol();
-    this->hostname = url.getHostname();
+    this->hostname = url.getHostname() + (url.getPort() == 80 ? "" : ":" + cstring(url.getPort()));
+
+    //S3-compatible endpoints (e.g. a local stand-in) address buckets by path (http://host:port/bucket/key)
+    this->path_style = !StringUtils::contains(url.getHostname(), "s3.amazonaws") && !StringUtils::contains(url.getHostname(), "wasabisys.com");
 
     //optional for non-public
     this->username = url.getParam("username");
@@ -72,17 +75,19 @@ public:
 
 
   // getBlob 
-  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String blob_name, Aborted aborted = Aborted()) override
+  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String blob_name, Aborted aborted = Aborted(), Int64 offset = 0, Int64 size = 0) override
   {
     auto ret = Promise<CloudStorageBlob>().get_future();
 
     NetRequest request(this->protocol + "://" + this->hostname + blob_name, "GET");
     request.aborted = aborted;
+    setRange(request, offset, size);
     signRequest(request);
 
     NetService::push(service, request).when_ready([ret](NetResponse response) {
 
       CloudStorageBlob blob;
+      blob.status = response.status;
 
       if (response.isSuccessful())
       {
@@ -112,6 +117,105 @@ public:
   }
 
 
+  // addBlob 
+  virtual Future<bool> addBlob(SharedPtr<NetService> service, CloudStorageBlob blob, String blob_name, Aborted aborted = Aborted()) override
+  {
+    auto ret = Promise<bool>().get_future();
+    auto sign = [this](NetRequest& request) {signRequest(request); };
+    String url = this->protocol + "://" + this->hostname + blob_name;
+
+    //single request
+    int nparts = getNumParts(blob);
+    if (nparts == 1)
+    {
+      NetRequest request(url, "PUT");
+      request.aborted = aborted;
+      request.body = blob.body;
+      request.setContentType(blob.content_type);
+      for (auto it = blob.metadata.begin(); it != blob.metadata.end(); it++)
+        request.setHeader("x-amz-meta-" + it->first, it->second);
+
+      pushWithRetry(service, request, sign).when_ready([ret](NetResponse response) {
+        ret.get_promise()->set_value(response.isSuccessful());
+      });
+      return ret;
+    }
+
+    //multipart upload (see https://docs.aws.amazon.com/AmazonS3/latest/dev/mpuoverview.html)
+    NetRequest request(url + "?uploads", "POST");
+    request.aborted = aborted;
+    request.setContentType(blob.content_type);
+    for (auto it = blob.metadata.begin(); it != blob.metadata.end(); it++)
+      request.setHeader("x-amz-meta-" + it->first, it->second);
+
+    Int64 part_size = this->multipart_size;
+    std::weak_ptr<NetService> weak_service = service; //see PushWithRetry
+    pushWithRetry(service, request, sign).when_ready([this, weak_service, blob, url, aborted, sign, nparts, part_size, ret](NetResponse response) {
+
+      String upload_id = response.isSuccessful() ? getXmlValue(response.getTextBody(), "UploadId") : "";
+      if (upload_id.empty())
+      {
+        PrintWarning("Cannot initiate multipart upload", url, "status", response.status);
+        ret.get_promise()->set_value(false);
+        return;
+      }
+
+      auto etags = std::make_shared< std::vector<String> >(nparts);
+      auto nremaining = std::make_shared< std::atomic<int> >(nparts);
+      auto bFailed = std::make_shared< std::atomic<bool> >(false);
+
+      //upload all parts concurrently, the last one completes (or aborts) the upload
+      for (int part = 0; part < nparts; part++)
+      {
+        NetRequest request(url, "PUT");
+        request.url.setParam("partNumber", cstring(part + 1));
+        request.url.setParam("uploadId", upload_id);
+        request.aborted = aborted;
+        request.body = getPart(blob, part_size, part);
+
+        pushWithRetry(weak_service.lock(), request, sign).when_ready([this, weak_service, blob, url, aborted, sign, upload_id, part, etags, nremaining, bFailed, ret](NetResponse response) {
+
+          if (response.isSuccessful())
+            (*etags)[part] = response.getHeader("ETag", response.getHeader("etag"));
+          else
+            *bFailed = true;
+
+          if (--(*nremaining))
+            return;
+
+          if (*bFailed)
+          {
+            PrintWarning("Multipart upload", url, "failed, aborting it");
+            NetRequest request(url, "DELETE");
+            request.url.setParam("uploadId", upload_id);
+            pushWithRetry(weak_service.lock(), request, sign);
+            ret.get_promise()->set_value(false);
+            return;
+          }
+
+          std::ostringstream out;
+          out << "<CompleteMultipartUpload>";
+          for (int I = 0; I < (int)etags->size(); I++)
+            out << "<Part><PartNumber>" << (I + 1) << "</PartNumber><ETag>" << (*etags)[I] << "</ETag></Part>";
+          out << "</CompleteMultipartUpload>";
+
+          NetRequest request(url, "POST");
+          request.url.setParam("uploadId", upload_id);
+          request.aborted = aborted;
+          request.setTextBody(out.str());
+          request.setContentType("application/xml");
+          pushWithRetry(weak_service.lock(), request, sign).when_ready([ret](NetResponse response) {
+            //S3 can report an error inside a 200 response
+            ret.get_promise()->set_value(response.isSuccessful() && !StringUtils::contains(response.getTextBody(), "<Error>"));
+          });
+        });
+      }
+    });
+
+    return ret;
+  }
+
+
 private:
 
   String protocol;
@@ -120,12 +224,13 @@ private:
   String password;
 
   String container;
+  bool   path_style = false;
 
   //signRequest
   void signRequest(NetRequest& request)
   {
-    String bucket = StringUtils::split(request.url.getHostname(), ".")[0];
-    VisusAssert(!bucket.empty());
+    String bucket = path_style ? "" : "/" + StringUtils::split(request.url.getHostname(), ".")[0];
+    VisusAssert(path_style || bucket.length()>1);
 
     //sign the request
     if (!username.empty() && !password.empty())
@@ -135,7 +240,18 @@ private:
       struct tm* ptm = gmtime(&t);
       strftime(date_GTM, sizeof(date_GTM), "%a, %d %b %Y %H:%M:%S GMT", ptm);
 
-      String canonicalized_resource = "/" + bucket + request.url.getPath();
+      String canonicalized_resource = bucket + request.url.getPath();
+
+      //sub-resources are part of the signature (sorted by name)
+      {
+        std::ostringstream out;
+        int N = 0; for (auto it = request.url.params.begin(); it != request.url.params.end(); it++)
+        {
+          if (it->first == "partNumber" || it->first == "uploadId" || it->first == "uploads")
+            out << (N++ ? "&" : "?") << it->first << (it->second.empty() ? "" : "=" + it->second);
+        }
+        canonicalized_resource += out.str();
+      }
 
       String canonicalized_headers;
       {
@@ -155,7 +271,7 @@ private:
       signature += canonicalized_headers;
       signature += canonicalized_resource;
       signature = StringUtils::base64Encode(StringUtils::hmac_sha1(signature, password));
-      request.setHeader("Host", request.url.getHostname());
+      request.setHeader("Host", this->hostname);
       request.setHeader("Date", date_GTM);
       request.setHeader("Authorization", "AWS " + username + ":" + signature);
     }
@@ -42,6 +42,8 @@ For support : support@visus.net
 #include <Visus/Path.h>
 #include <Visus/File.h>
 #include <Visus/TransferFunction.h>
+#include <Visus/Scheduler.h>
+#include <Visus/Trace.h>
 
 namespace Visus {
 
@@ -145,6 +147,7 @@ SharedPtr<HeapMemory> ArrayUtils::encodeArray(String compression,Array array)
       return SharedPtr<HeapMemory>();
     }
     //if encoder fails, just copy the array
+    VisusTrace("encoder", "encode");
     encoded = encoder->encode(array.dims, array.dtype, array.heap);
   }
 
@@ -180,6 +183,7 @@ Array ArrayUtils::decodeArray(String compression,PointNi dims,DType dtype,Shared
       VisusAssert(false);
       return Array();
     }
+    VisusTrace("encoder", "decode");
     decoded = decoder->decode(dims, dtype, encoded);
   }
 
@@ -190,6 +194,39 @@ Array ArrayUtils::decodeArray(String compression,PointNi dims,DType dtype,Shared
   return Array(dims,dtype,decoded);
 }
 
+//////////////////////////////////////////////////////////////
+Array ArrayUtils::decodeArray(String compression, PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded, Int64 num_samples)
+{
+  Int64 tot_samples = dims.innerProduct();
+  if (compression.empty() || num_samples < 0 || num_samples >= tot_samples || !encoded || !dtype.valid() || dtype.getBitSize(num_samples) % 8)
+    return decodeArray(compression, dims, dtype, encoded);
+
+  auto decoder = Encoders::getSingleton()->createEncoder(compression);
+  if (!decoder) {
+    VisusAssert(false);
+    return Array();
+  }
+
+  SharedPtr<HeapMemory> prefix;
+  if (num_samples > 0)
+  {
+    VisusTrace("encoder", "decodeRange");
+    prefix = decoder->decodeRange(dims, dtype, encoded, 0, num_samples);
+    if (!prefix)
+      return Array();
+  }
+
+  Array ret;
+  if (!ret.resize(dims, dtype, __FILE__, __LINE__))
+    return Array();
+
+  ret.fillWithValue(0);
+  if (prefix)
+    memcpy(ret.c_ptr(), prefix->c_ptr(), (size_t)prefix->c_size());
+
+  return ret;
+}
+
 
 //////////////////////////////////////////////////////////////////////////////////////////
 Array ArrayUtils::decodeArray(StringMap metadata, SharedPtr<HeapMemory> encoded)
@@ -2955,8 +2992,47 @@ Array ArrayUtils::median(Array src,Array krn_size,int percent,Aborted aborted) {
 template <typename SrcType>
 struct ApplyTransferFunctionOp2
 {
+  //quantized table for inputs which cannot be indexed directly (float, 32/64 bit integers)
+  enum { QuantizedTableSize = 4096 };
+
+  //samples for each parallel job
+  enum { ChunkSize = 64 * 1024 };
+
+  //runParallel (in chunks, the caller takes part)
+  static bool runParallel(Int64 tot, Aborted aborted, std::function<void(Int64, Int64)> fn)
+  {
+    Int64 nchunks = (tot + ChunkSize - 1) / ChunkSize;
+    auto chunk = [&](Int64 I) {
+      if (!aborted()) fn(I * ChunkSize, std::min(tot, (I + 1) * ChunkSize));
+    };
+
+    auto scheduler = Scheduler::getSingleton();
+    if (nchunks <= 1 || !scheduler)
+    {
+      for (Int64 I = 0; I < nchunks; I++)
+        chunk(I);
+    }
+    else
+    {
+      scheduler->parallelFor(0, nchunks, chunk);
+    }
+    return !aborted();
+  }
+
+  //applyTable (N entries for each table index, dst and src are interleaved)
+  template <typename DstType, int N, typename Index>
+  static void applyTable(DstType* dst, const DstType* table, Int64 A, Int64 B, Index index)
+  {
+    for (Int64 I = A; I < B; I++)
+    {
+      const DstType* entry = table + index(I) * N;
+      for (int C = 0; C < N; C++)
+        dst[I * N + C] = entry[C];
+    }
+  }
+
   template <typename DstType>
-  bool execute(Array& dst, TransferFunction& tf, Array src, Aborted aborted)
+  bool execute(Array& dst, TransferFunction& tf, Array src, Aborted aborted, bool bExact, Range input_range)
   {
     int num_fn = (int)tf.functions.size();
     if (!num_fn)
@@ -2995,56 +3071,140 @@ struct ApplyTransferFunctionOp2
     if (!dst.resize(src.dims, dst_dtype, __FILE__, __LINE__))
       return false;
 
+    Range dst_range = tf.getOutputRange();
+    double dst_vs = dst_range.delta();
+    double dst_vt = dst_range.from;
+
+    //8/16 bit integers index the table directly, the others go through a quantized table (unless exact is requested)
+    const bool bDirectIndex = std::is_integral<SrcType>::value && sizeof(SrcType) <= 2;
+    const Int64 table_size = bDirectIndex ? ((Int64)1 << (8 * std::min(sizeof(SrcType), (size_t)2))) : (bExact ? 0 : (Int64)QuantizedTableSize);
+    const Int64 src_min = bDirectIndex ? (Int64)std::numeric_limits<SrcType>::min() : 0;
+
+    //not worth building a table bigger than the data
+    const bool bUseTable = table_size > 0 && table_size <= tot;
+
+    //(f,g,h)(a) shares the index for all the functions, so the table can be interleaved
+    const int table_ncomponents = src_ncomponents == 1 && dst_ncomponents <= 4 ? dst_ncomponents : 1;
+
+    //the input range depends only on the source component
+    std::vector<Range> input_ranges(src_ncomponents);
+    std::vector<bool>  has_input_range(src_ncomponents, false);
+
+    std::vector<DstType> table;
     for (int I = 0; I < dst_ncomponents; I++)
     {
       auto F = Utils::clamp(I, 0, num_fn - 1); auto FUN = tf.functions[F];
-      auto D = Utils::clamp(I, 0, dst_ncomponents - 1); auto DST = GetComponentSamples<DstType>(dst, D);
-      auto S = Utils::clamp(I, 0, src_ncomponents - 1); auto SRC = GetComponentSamples<SrcType>(src, S);
+      auto S = Utils::clamp(I, 0, src_ncomponents - 1);
 
       dst.dtype = dst.dtype.withDTypeRange(tf.getOutputRange(), I);
 
-      auto input_range = tf.computeRange(src, SRC.C, aborted);
-      auto  vs_t = input_range.getScaleTranslate();
-
-      Range dst_range = tf.getOutputRange();
+      if (!has_input_range[S])
+      {
+        input_ranges[S] = input_range.delta() > 0 ? input_range : tf.computeRange(src, S, aborted);
+        has_input_range[S] = true;
+      }
 
+      auto vs_t = input_ranges[S].getScaleTranslate();
       double src_vs = vs_t.first;
       double src_vt = vs_t.second;
 
-      double dst_vs = dst_range.delta();
-      double dst_vt = dst_range.from;
+      const SrcType* SRC = src.c_ptr<const SrcType*>() + S;
+      DstType*       DST = dst.c_ptr<DstType*>() + I;
 
-      for (int I = 0; I < tot; I++)
+      //slow path
+      if (!bUseTable)
       {
-        if (aborted())
+        if (!runParallel(tot, aborted, [&](Int64 A, Int64 B) {
+          for (Int64 K = A; K < B; K++)
+          {
+            double x = src_vs * SRC[K * src_ncomponents] + src_vt;
+            double y = FUN->getValue(x);
+            DST[K * dst_ncomponents] = (DstType)(dst_vs * y + dst_vt);
+          }
+        }))
           return false;
+        continue;
+      }
+
+      //fill the table
+      if (table.empty())
+        table.resize(table_size * table_ncomponents);
 
-        double x = src_vs * SRC[I] + src_vt;
+      int C = table_ncomponents > 1 ? I : 0;
+      for (Int64 K = 0; K < table_size; K++)
+      {
+        double x = bDirectIndex ? src_vs * (double)(K + src_min) + src_vt : K / (double)(table_size - 1);
         double y = FUN->getValue(x);
-        DST[I] = (DstType)(dst_vs * y + dst_vt);
+        table[K * table_ncomponents + C] = (DstType)(dst_vs * y + dst_vt);
       }
+
+      //all the interleaved functions are needed before applying the table
+      if (table_ncomponents > 1 && I < dst_ncomponents - 1)
+        continue;
+
+      const DstType* TABLE = &table[0];
+      DstType* dst_ptr = table_ncomponents > 1 ? dst.c_ptr<DstType*>() : DST;
+      double scale = (double)(table_size - 1);
+
+      if (!runParallel(tot, aborted, [&](Int64 A, Int64 B) {
+
+        //direct index
+        if (bDirectIndex)
+        {
+          applyTableN(dst_ptr, TABLE, A, B, table_ncomponents, dst_ncomponents, [&](Int64 K) {
+            return (Int64)SRC[K * src_ncomponents] - src_min;
+          });
+        }
+        //quantized index (NaN goes to the first entry)
+        else
+        {
+          applyTableN(dst_ptr, TABLE, A, B, table_ncomponents, dst_ncomponents, [&](Int64 K) {
+            double x = src_vs * SRC[K * src_ncomponents] + src_vt;
+            x = x >= 0.0 ? (x <= 1.0 ? x : 1.0) : 0.0;
+            return (Int64)(x * scale + 0.5);
+          });
+        }
+      }))
+        return false;
     }
 
     dst.shareProperties(src);
     return true;
   }
+
+  //applyTableN
+  template <typename DstType, typename Index>
+  static void applyTableN(DstType* dst, const DstType* table, Int64 A, Int64 B, int table_ncomponents, int dst_ncomponents, Index index)
+  {
+    switch (table_ncomponents)
+    {
+      case 2: return applyTable<DstType, 2>(dst, table, A, B, index);
+      case 3: return applyTable<DstType, 3>(dst, table, A, B, index);
+      case 4: return applyTable<DstType, 4>(dst, table, A, B, index);
+    }
+
+    //one component at a time (dst is already offsetted to the component)
+    for (Int64 K = A; K < B; K++)
+      dst[K * dst_ncomponents] = table[index(K)];
+  }
+
 };
 
 struct ApplyTransferFunctionOp
 {
   template <typename SrcType>
-  bool execute(Array& dst, TransferFunction& tf, Array src, Aborted aborted) {
+  bool execute(Array& dst, TransferFunction& tf, Array src, Aborted aborted, bool bExact, Range input_range) {
     ApplyTransferFunctionOp2<SrcType> op;
-    return ExecuteOnCppSamples(op, tf.getOutputDType(), dst, tf, src, aborted);
+    return ExecuteOnCppSamples(op, tf.getOutputDType(), dst, tf, src, aborted, bExact, input_range);
   }
 };
 
-Array ArrayUtils::applyTransferFunction(SharedPtr<TransferFunction> tf, Array src, Aborted aborted)
+Array ArrayUtils::applyTransferFunction(SharedPtr<TransferFunction> tf, Array src, Aborted aborted, bool bExact, Range input_range)
 {
   if (!src) return src;
   Array dst;
   ApplyTransferFunctionOp op;
-  return ExecuteOnCppSamples(op, src.dtype, dst, *tf, src, aborted) ? dst : Array();
+  return ExecuteOnCppSamples(op, src.dtype, dst, *tf, src, aborted, bExact || tf->isExact(), input_range) ? dst : Array();
 }
 
 
@@ -66,26 +66,29 @@ public:
   }
 
   // getBlob 
-  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String blob_name, Aborted aborted = Aborted()) override
+  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String blob_name, Aborted aborted = Aborted(), Int64 offset = 0, Int64 size = 0) override
   {
     auto ret = Promise<CloudStorageBlob>().get_future();
 
     NetRequest request(this->url.toString() + blob_name, "GET");
     request.aborted = aborted;
+    setRange(request, offset, size);
 
     if (!access_key.empty())
       signRequest(request);
 
     NetService::push(service, request).when_ready([ret](NetResponse response) {
 
+      CloudStorageBlob blob;
+      blob.status = response.status;
+
       if (!response.isSuccessful())
       {
-        ret.get_promise()->set_value(CloudStorageBlob());
+        ret.get_promise()->set_value(blob);
         return;
       }
 
       //parse metadata
-      CloudStorageBlob blob;
       String metatata_prefix = "x-ms-meta-";
       for (auto it = response.headers.begin(); it != response.headers.end(); it++)
       {
@@ -114,6 +117,91 @@ public:
     return ret;
   }
 
+  // addBlob 
+  virtual Future<bool> addBlob(SharedPtr<NetService> service, CloudStorageBlob blob, String blob_name, Aborted aborted = Aborted()) override
+  {
+    auto ret = Promise<bool>().get_future();
+    auto sign = [this](NetRequest& request) {signRequest(request); };
+    String url = this->url.toString() + blob_name;
+
+    auto setMetadata = [blob](NetRequest& request) {
+      for (auto it = blob.metadata.begin(); it != blob.metadata.end(); it++)
+        request.setHeader("x-ms-meta-" + StringUtils::replaceAll(it->first, "-", "_"), it->second); //trick: azure does not allow the "-" 
+    };
+
+    //single request
+    int nparts = getNumParts(blob);
+    if (nparts == 1)
+    {
+      NetRequest request(url, "PUT");
+      request.aborted = aborted;
+      request.body = blob.body;
+      request.setContentLength(blob.body->c_size());
+      request.setContentType(blob.content_type);
+      request.setHeader("x-ms-blob-type", "BlockBlob");
+      setMetadata(request);
+
+      pushWithRetry(service, request, sign).when_ready([ret](NetResponse response) {
+        ret.get_promise()->set_value(response.isSuccessful());
+      });
+      return ret;
+    }
+
+    //put all blocks concurrently, then commit the block list (see https://docs.microsoft.com/en-us/rest/api/storageservices/put-block-list)
+    //uncommitted blocks are garbage collected by azure, no need to abort
+    std::vector<String> block_ids;
+    for (int part = 0; part < nparts; part++)
+      block_ids.push_back(StringUtils::base64Encode(StringUtils::formatNumber("%08d", part)));
+
+    auto nremaining = std::make_shared< std::atomic<int> >(nparts);
+    auto bFailed = std::make_shared< std::atomic<bool> >(false);
+
+    for (int part = 0; part < nparts; part++)
+    {
+      NetRequest request(url, "PUT");
+      request.url.setParam("comp", "block");
+      request.url.setParam("blockid", block_ids[part]);
+      request.aborted = aborted;
+      request.body = getPart(blob, multipart_size, part);
+      request.setContentLength(request.body->c_size());
+
+      pushWithRetry(service, request, sign).when_ready([this, service, blob, url, aborted, sign, setMetadata, block_ids, nremaining, bFailed, ret](NetResponse response) {
+
+        if (!response.isSuccessful())
+          *bFailed = true;
+
+        if (--(*nremaining))
+          return;
+
+        if (*bFailed)
+        {
+          PrintWarning("Block upload", url, "failed");
+          ret.get_promise()->set_value(false);
+          return;
+        }
+
+        std::ostringstream out;
+        out << "<?xml version=\"1.0\" encoding=\"utf-8\"?><BlockList>";
+        for (auto block_id : block_ids)
+          out << "<Latest>" << block_id << "</Latest>";
+        out << "</BlockList>";
+
+        NetRequest request(url, "PUT");
+        request.url.setParam("comp", "blocklist");
+        request.aborted = aborted;
+        request.setTextBody(out.str());
+        request.setContentType("application/xml");
+        request.setHeader("x-ms-blob-content-type", blob.content_type);
+        setMetadata(request);
+        pushWithRetry(service, request, sign).when_ready([ret](NetResponse response) {
+          ret.get_promise()->set_value(response.isSuccessful());
+        });
+      });
+    }
+
+    return ret;
+  }
+
 private:
 
   Url    url;
@@ -39,6 +39,7 @@ For support : support@visus.net
 #include <Visus/CloudStorage.h>
 #include <Visus/NetService.h>
 #include <Visus/Path.h>
+#include <Visus/Scheduler.h>
 
 #include "AmazonCloudStorage.hxx"
 #include "AzureCloudStorage.hxx"
@@ -63,7 +64,8 @@ SharedPtr<CloudStorage> CloudStorage::createInstance(Url url)
     return std::make_shared<AzureCloudStorage>(url);
 
   if (StringUtils::contains(url.getHostname(), "s3.amazonaws") ||
-      StringUtils::contains(url.getHostname(), "wasabisys.com"))
+      StringUtils::contains(url.getHostname(), "wasabisys.com") ||
+      url.getParam("cloud") == "s3")
     return std::make_shared<AmazonCloudStorage>(url);
 
   if (StringUtils::contains(url.getHostname(), "googleapis"))
@@ -72,5 +74,46 @@ SharedPtr<CloudStorage> CloudStorage::createInstance(Url url)
   return SharedPtr<CloudStorage>();
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+//the callbacks keep a weak reference to the service: the last reference must not be released inside one of its own threads
+static void PushWithRetry(std::weak_ptr<NetService> service, NetRequest request, std::function<void(NetRequest&)> sign, int attempt, int max_retries, Future<NetResponse> ret)
+{
+  NetRequest signed_request = request;
+  if (sign)
+    sign(signed_request);
+
+  NetService::push(service.lock(), signed_request).when_ready([service, request, sign, attempt, max_retries, ret](NetResponse response) {
+
+    //connections failed before getting any response (status below 100), 5xx, throttling and timeouts
+    //any other error (e.g. a 400 from the server) would fail again
+    bool bTransient =
+      (response.status < 100 && response.status != HttpStatus::STATUS_CANCELLED) ||
+      response.status >= 500 ||
+      response.status == 429 || //too many requests
+      response.status == HttpStatus::STATUS_REQUEST_TIMEOUT;
+
+    if (response.isSuccessful() || !bTransient || request.aborted() || attempt >= max_retries)
+    {
+      ret.get_promise()->set_value(response);
+      return;
+    }
+
+    //do not sleep in the NetService thread (nor in a scheduler worker)
+    int msec = 100 << attempt;
+    PrintWarning("request", request.url, "failed with status", response.status, "retrying in", msec, "msec");
+    Scheduler::getSingleton()->pushDelayed([service, request, sign, attempt, max_retries, ret]() {
+      PushWithRetry(service, request, sign, attempt + 1, max_retries, ret);
+    }, msec, Scheduler::Background);
+  });
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+Future<NetResponse> CloudStorage::pushWithRetry(SharedPtr<NetService> service, NetRequest request, std::function<void(NetRequest&)> sign)
+{
+  auto ret = Promise<NetResponse>().get_future();
+  PushWithRetry(service, request, sign, 0, max_retries, ret);
+  return ret;
+}
+
 
 } //namespace Visus
@@ -45,6 +45,28 @@ namespace Visus {
 
 VISUS_IMPLEMENT_SINGLETON_CLASS(Encoders)
 
+////////////////////////////////////////////////////////////////
+SharedPtr<HeapMemory> Encoder::decodeRange(PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded, Int64 A, Int64 B)
+{
+  Int64 tot_samples = dims.innerProduct();
+  if (A < 0 || B > tot_samples || A >= B || dtype.getBitSize(A) % 8)
+    return SharedPtr<HeapMemory>();
+
+  auto decoded = decode(dims, dtype, encoded);
+  if (!decoded || decoded->c_size() != dtype.getByteSize(tot_samples))
+    return SharedPtr<HeapMemory>();
+
+  if (A == 0 && B == tot_samples)
+    return decoded;
+
+  auto ret = std::make_shared<HeapMemory>();
+  if (!ret->resize(dtype.getByteSize(B - A), __FILE__, __LINE__))
+    return SharedPtr<HeapMemory>();
+
+  memcpy(ret->c_ptr(), decoded->c_ptr() + dtype.getByteSize(A), (size_t)ret->c_size());
+  return ret;
+}
+
 
 ////////////////////////////////////////////////////////////////
 void Encoders::registerEncoder(String key, Creator creator)
@@ -82,6 +104,16 @@ SharedPtr<Encoder> Encoders::createEncoder(String specs) const
   return SharedPtr<Encoder>();
 }
 
+////////////////////////////////////////////////////////////////
+SharedPtr<HeapMemory> Encoders::trainDictionary(String specs, const std::vector< SharedPtr<HeapMemory> >& samples, Int64 max_size) const
+{
+  auto encoder = createEncoder(specs);
+  if (!encoder || samples.empty() || max_size <= 0)
+    return SharedPtr<HeapMemory>();
+
+  return encoder->trainDictionary(samples, max_size);
+}
+
 
 } //namespace Visus
 
@@ -0,0 +1,304 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef VISUS_CHUNKED_ENCODER_H
+#define VISUS_CHUNKED_ENCODER_H
+
+#include <Visus/Kernel.h>
+#include <Visus/Encoder.h>
+#include <Visus/Scheduler.h>
+#include <Visus/ByteOrder.h>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////
+/*
+Container of independently encoded sub-chunks (all integers in network byte order):
+
+  Uint32 num_chunks
+  Uint32 samples_per_chunk
+  Uint32 specs_len
+  char   specs[specs_len]           (inner encoder, for example "lz4" or "zip")
+  Uint32 offsets[num_chunks+1]      (relative to the start of the payload)
+  Uint8  payload[...]
+
+Chunks are encoded/decoded in parallel and a contiguous range of samples (i.e. an hz range) can be decoded
+without touching the other chunks.
+
+specs example: "chunked-lz4" "chunked-zip-Z_BEST_SPEED" "chunked-shuffle+lz4"
+*/
+class VISUS_KERNEL_API ChunkedEncoder : public Encoder
+{
+public:
+
+  VISUS_CLASS(ChunkedEncoder)
+
+  String inner_specs="lz4";
+
+  //number of samples per chunk (must be multiple of 8 for 1-bit dtypes)
+  Int64 samples_per_chunk = 64 * 1024;
+
+  //constructor
+  ChunkedEncoder(String specs)
+  {
+    auto sep = specs.find('-');
+    if (sep != String::npos)
+      inner_specs = StringUtils::trim(specs.substr(sep + 1));
+  }
+
+  //destructor
+  virtual ~ChunkedEncoder() {
+  }
+
+  //isLossy
+  virtual bool isLossy() const override {
+    return false;
+  }
+
+  //encode
+  virtual SharedPtr<HeapMemory> encode(PointNi dims, DType dtype, SharedPtr<HeapMemory> decoded) override
+  {
+    if (!decoded)
+      return SharedPtr<HeapMemory>();
+
+    auto inner = Encoders::getSingleton()->createEncoder(inner_specs);
+    if (!inner || inner->isLossy())
+      return SharedPtr<HeapMemory>();
+
+    Int64 tot_samples = dims.innerProduct();
+    if (decoded->c_size() != dtype.getByteSize(tot_samples))
+      return SharedPtr<HeapMemory>();
+
+    int num_chunks = (int)((tot_samples + samples_per_chunk - 1) / samples_per_chunk);
+    std::vector< SharedPtr<HeapMemory> > chunks(num_chunks);
+
+    runParallel(num_chunks, [&](int I) {
+      Int64 A = I * samples_per_chunk, B = std::min(tot_samples, A + samples_per_chunk);
+      auto chunk = HeapMemory::createUnmanaged(decoded->c_ptr() + dtype.getByteSize(A), dtype.getByteSize(B - A));
+      chunks[I] = inner->encode(getChunkDims(B - A), dtype, chunk);
+    });
+
+    Int64 header_size = 3 * sizeof(Uint32) + inner_specs.size() + (num_chunks + 1) * sizeof(Uint32);
+    Int64 payload_size = 0;
+    for (auto chunk : chunks)
+    {
+      if (!chunk)
+        return SharedPtr<HeapMemory>();
+      payload_size += chunk->c_size();
+    }
+
+    //offsets are Uint32
+    if (payload_size != (Uint32)payload_size)
+      return SharedPtr<HeapMemory>();
+
+    auto encoded = std::make_shared<HeapMemory>();
+    if (!encoded->resize(header_size + payload_size, __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    Uint8* cursor = encoded->c_ptr();
+    auto writeUint32 = [&](Uint32 value) {
+      value = ByteOrder::toNetworkByteOrder(value);
+      memcpy(cursor, &value, sizeof(Uint32));
+      cursor += sizeof(Uint32);
+    };
+
+    writeUint32((Uint32)num_chunks);
+    writeUint32((Uint32)samples_per_chunk);
+    writeUint32((Uint32)inner_specs.size());
+    memcpy(cursor, inner_specs.c_str(), inner_specs.size());
+    cursor += inner_specs.size();
+
+    Uint32 offset = 0;
+    writeUint32(offset);
+    for (auto chunk : chunks)
+      writeUint32(offset += (Uint32)chunk->c_size());
+
+    for (auto chunk : chunks)
+    {
+      memcpy(cursor, chunk->c_ptr(), (size_t)chunk->c_size());
+      cursor += chunk->c_size();
+    }
+
+    VisusAssert(cursor == encoded->c_ptr() + encoded->c_size());
+    return encoded;
+  }
+
+  //decode
+  virtual SharedPtr<HeapMemory> decode(PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded) override {
+    Int64 tot_samples = dims.innerProduct();
+    return decodeRange(dims, dtype, encoded, 0, tot_samples);
+  }
+
+  //decodeRange (only the chunks intersecting [A,B) are decoded)
+  virtual SharedPtr<HeapMemory> decodeRange(PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded, Int64 A, Int64 B) override
+  {
+    Int64 tot_samples = dims.innerProduct();
+    if (!encoded || A < 0 || B > tot_samples || A >= B || dtype.getBitSize(A) % 8)
+      return SharedPtr<HeapMemory>();
+
+    Container container;
+    if (!container.parse(encoded))
+      return SharedPtr<HeapMemory>();
+
+    auto inner = Encoders::getSingleton()->createEncoder(container.specs);
+    if (!inner)
+      return SharedPtr<HeapMemory>();
+
+    Int64 spc = container.samples_per_chunk;
+    if (!spc || container.num_chunks != (tot_samples + spc - 1) / spc)
+      return SharedPtr<HeapMemory>();
+
+    auto decoded = std::make_shared<HeapMemory>();
+    if (!decoded->resize(dtype.getByteSize(B - A), __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    int first = (int)(A / spc), last = (int)((B - 1) / spc);
+    std::atomic<int> num_failed(0);
+
+    runParallel(last - first + 1, [&](int I) {
+
+      int chunk_id = first + I;
+      Int64 chunk_A = chunk_id * spc, chunk_B = std::min(tot_samples, chunk_A + spc);
+      auto chunk = container.getChunk(chunk_id);
+      auto chunk_decoded = chunk ? inner->decode(getChunkDims(chunk_B - chunk_A), dtype, chunk) : SharedPtr<HeapMemory>();
+      if (!chunk_decoded || chunk_decoded->c_size() != dtype.getByteSize(chunk_B - chunk_A)) {
+        ++num_failed;
+        return;
+      }
+
+      //intersection with the requested range
+      Int64 from = std::max(A, chunk_A), to = std::min(B, chunk_B);
+      memcpy(
+        decoded->c_ptr() + dtype.getByteSize(from - A),
+        chunk_decoded->c_ptr() + dtype.getByteSize(from - chunk_A),
+        (size_t)dtype.getByteSize(to - from));
+    });
+
+    if (num_failed)
+      return SharedPtr<HeapMemory>();
+
+    return decoded;
+  }
+
+private:
+
+  //___________________________________________
+  class Container
+  {
+  public:
+
+    SharedPtr<HeapMemory> encoded;
+    Int64                 num_chunks = 0;
+    Int64                 samples_per_chunk = 0;
+    String                specs;
+    std::vector<Uint32>   offsets;
+    Int64                 payload = 0;
+
+    //parse
+    bool parse(SharedPtr<HeapMemory> encoded)
+    {
+      this->encoded = encoded;
+
+      const Uint8* cursor = encoded->c_ptr();
+      const Uint8* end    = cursor + encoded->c_size();
+
+      auto readUint32 = [&](Uint32& value) {
+        if (cursor + sizeof(Uint32) > end) return false;
+        memcpy(&value, cursor, sizeof(Uint32));
+        value = ByteOrder::fromNetworkByteOrder(value);
+        cursor += sizeof(Uint32);
+        return true;
+      };
+
+      Uint32 num_chunks = 0, samples_per_chunk = 0, specs_len = 0;
+      if (!readUint32(num_chunks) || !readUint32(samples_per_chunk) || !readUint32(specs_len) || cursor + specs_len > end)
+        return false;
+
+      this->num_chunks = num_chunks;
+      this->samples_per_chunk = samples_per_chunk;
+      this->specs = String((const char*)cursor, (size_t)specs_len);
+      cursor += specs_len;
+
+      this->offsets.resize((size_t)num_chunks + 1);
+      for (auto& it : offsets)
+      {
+        if (!readUint32(it))
+          return false;
+      }
+
+      this->payload = cursor - encoded->c_ptr();
+      return payload + offsets.back() == encoded->c_size();
+    }
+
+    //getChunk
+    SharedPtr<HeapMemory> getChunk(int I) const
+    {
+      if (I < 0 || I >= num_chunks || offsets[I] > offsets[I + 1])
+        return SharedPtr<HeapMemory>();
+      return HeapMemory::createUnmanaged(encoded->c_ptr() + payload + offsets[I], offsets[I + 1] - offsets[I]);
+    }
+
+  };
+
+  //getChunkDims
+  static PointNi getChunkDims(Int64 nsamples) {
+    return PointNi(std::vector<Int64>({ nsamples }));
+  }
+
+  //runParallel
+  static void runParallel(int N, std::function<void(int)> fn)
+  {
+    auto scheduler = Scheduler::getSingleton();
+    if (N <= 1 || !scheduler)
+    {
+      for (int I = 0; I < N; I++)
+        fn(I);
+      return;
+    }
+
+    scheduler->parallelFor(0, N, [&fn](Int64 I) {
+      fn((int)I);
+    });
+  }
+
+};
+
+} //namespace Visus
+
+#endif //VISUS_CHUNKED_ENCODER_H
+
@@ -0,0 +1,398 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef VISUS_FILTERED_ENCODER_H
+#define VISUS_FILTERED_ENCODER_H
+
+#include <Visus/Kernel.h>
+#include <Visus/Encoder.h>
+
+#include "EncoderId.hxx"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#  define VISUS_FILTERS_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////
+/*
+Pre-filters applied before a lossless codec, separated by '+'. The last token is the codec (empty means raw):
+
+  "shuffle+lz4"        byte-shuffle (i.e. sample bytes grouped by significance)
+  "bitshuffle+lz4"     bit-shuffle 
+  "delta+zstd"         delta between consecutive samples (per component)
+  "xor+shuffle+zip"    xor predictor, then byte-shuffle
+
+Filters are always applied in the canonical order delta/xor first, then shuffle/bitshuffle,
+so that the block header can record them as flags (see IdxDiskAccessV6::BlockHeader).
+*/
+class VISUS_KERNEL_API FilteredEncoder : public Encoder
+{
+public:
+
+  VISUS_CLASS(FilteredEncoder)
+
+  enum FilterType
+  {
+    DeltaFilter=0,
+    XorFilter,
+    ShuffleFilter,
+    BitShuffleFilter
+  };
+
+  std::vector<int>   filters;
+  String             codec_specs;
+  SharedPtr<Encoder> codec;
+
+  //constructor
+  FilteredEncoder(String specs)
+  {
+    for (auto it : StringUtils::split(specs, "+"))
+    {
+      it = StringUtils::trim(it);
+      int filter = getFilterType(it);
+      if (filter >= 0)
+        filters.push_back(filter);
+      else
+        codec_specs = it;
+    }
+
+    std::sort(filters.begin(), filters.end());
+    filters.erase(std::unique(filters.begin(), filters.end()), filters.end());
+
+    //empty codec means raw (i.e. filters only)
+    codec = codec_specs.empty() || codec_specs == "raw" ? std::make_shared<IdEncoder>(codec_specs) : Encoders::getSingleton()->createEncoder(codec_specs);
+  }
+
+  //destructor
+  virtual ~FilteredEncoder() {
+  }
+
+  //getFilterType
+  static int getFilterType(String name)
+  {
+    if (name == "delta"     ) return DeltaFilter;
+    if (name == "xor"       ) return XorFilter;
+    if (name == "shuffle"   ) return ShuffleFilter;
+    if (name == "bitshuffle") return BitShuffleFilter;
+    return -1;
+  }
+
+  //isLossy
+  virtual bool isLossy() const override {
+    return codec ? codec->isLossy() : false;
+  }
+
+  //setDictionary
+  virtual bool setDictionary(SharedPtr<HeapMemory> dictionary) override {
+    return codec ? codec->setDictionary(dictionary) : false;
+  }
+
+  //trainDictionary (note: samples are not filtered, the dtype is not known here)
+  virtual SharedPtr<HeapMemory> trainDictionary(const std::vector< SharedPtr<HeapMemory> >& samples, Int64 max_size) override {
+    return codec ? codec->trainDictionary(samples, max_size) : SharedPtr<HeapMemory>();
+  }
+
+  //encode
+  virtual SharedPtr<HeapMemory> encode(PointNi dims, DType dtype, SharedPtr<HeapMemory> decoded) override
+  {
+    //a lossy codec would make the predictors diverge
+    if (!decoded || !codec || codec->isLossy())
+      return SharedPtr<HeapMemory>();
+
+    auto filtered = decoded;
+    for (auto filter : filters)
+    {
+      filtered = applyFilter(filter, dtype, filtered, /*bInverse*/false);
+      if (!filtered)
+        return SharedPtr<HeapMemory>();
+    }
+
+    return codec->encode(dims, dtype, filtered);
+  }
+
+  //decode
+  virtual SharedPtr<HeapMemory> decode(PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded) override
+  {
+    if (!encoded || !codec)
+      return SharedPtr<HeapMemory>();
+
+    auto decoded = codec->decode(dims, dtype, encoded);
+    for (auto it = filters.rbegin(); decoded && it != filters.rend(); ++it)
+      decoded = applyFilter(*it, dtype, decoded, /*bInverse*/true);
+
+    return decoded;
+  }
+
+private:
+
+  //applyFilter
+  static SharedPtr<HeapMemory> applyFilter(int filter, DType dtype, SharedPtr<HeapMemory> src, bool bInverse)
+  {
+    auto dst = std::make_shared<HeapMemory>();
+    if (!dst->resize(src->c_size(), __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    const Uint8* SRC = src->c_ptr();
+    Uint8*       DST = dst->c_ptr();
+    Int64        nbytes = src->c_size();
+
+    //predictors work on components (when all components have the same byte-aligned type), otherwise on bytes
+    int word = 1, lag = 1;
+    {
+      int ncomponents = dtype.ncomponents();
+      int bitsize = ncomponents ? dtype.get(0).getBitSize() : 0;
+      if ((bitsize == 8 || bitsize == 16 || bitsize == 32 || bitsize == 64) && bitsize * ncomponents == dtype.getBitSize())
+      {
+        word = bitsize / 8;
+        lag = ncomponents;
+      }
+    }
+
+    //shuffles work on samples
+    int typesize = (dtype.getBitSize() % 8) ? 1 : dtype.getByteSize();
+
+    switch (filter)
+    {
+      case DeltaFilter:
+      case XorFilter:
+      {
+        bool bXor = filter == XorFilter;
+        switch (word)
+        {
+          case 1: predictor<Uint8 >(SRC, DST, nbytes, lag, bXor, bInverse); break;
+          case 2: predictor<Uint16>(SRC, DST, nbytes, lag, bXor, bInverse); break;
+          case 4: predictor<Uint32>(SRC, DST, nbytes, lag, bXor, bInverse); break;
+          case 8: predictor<Uint64>(SRC, DST, nbytes, lag, bXor, bInverse); break;
+        }
+        break;
+      }
+
+      case ShuffleFilter:
+        bInverse ? unshuffle(SRC, DST, nbytes, typesize) : shuffle(SRC, DST, nbytes, typesize);
+        break;
+
+      case BitShuffleFilter:
+        bInverse ? bitunshuffle(SRC, DST, nbytes, typesize) : bitshuffle(SRC, DST, nbytes, typesize);
+        break;
+
+      default:
+        VisusAssert(false);
+        return SharedPtr<HeapMemory>();
+    }
+
+    return dst;
+  }
+
+  //predictor (bytes not multiple of the word are just copied)
+  template <typename Word>
+  static void predictor(const Uint8* src, Uint8* dst, Int64 nbytes, int lag, bool bXor, bool bInverse)
+  {
+    Int64 N = nbytes / sizeof(Word);
+    auto SRC = (const Word*)src;
+    auto DST = (Word*)dst;
+
+    Int64 I = 0;
+    for (; I < std::min(N, (Int64)lag); I++)
+      DST[I] = SRC[I];
+
+    if (bXor)
+    {
+      if (bInverse)
+        for (; I < N; I++) DST[I] = SRC[I] ^ DST[I - lag];
+      else
+        for (; I < N; I++) DST[I] = SRC[I] ^ SRC[I - lag];
+    }
+    else
+    {
+      if (bInverse)
+        for (; I < N; I++) DST[I] = (Word)(SRC[I] + DST[I - lag]);
+      else
+        for (; I < N; I++) DST[I] = (Word)(SRC[I] - SRC[I - lag]);
+    }
+
+    memcpy(dst + N * sizeof(Word), src + N * sizeof(Word), (size_t)(nbytes - N * sizeof(Word)));
+  }
+
+#if VISUS_FILTERS_SSE2
+
+  //transposeStage (a rotate-left by one bit of the 6-bit byte address inside a 64 bytes block)
+  static inline void transposeStage(__m128i* a)
+  {
+    __m128i n0 = _mm_unpacklo_epi8(a[0], a[2]);
+    __m128i n1 = _mm_unpackhi_epi8(a[0], a[2]);
+    __m128i n2 = _mm_unpacklo_epi8(a[1], a[3]);
+    __m128i n3 = _mm_unpackhi_epi8(a[1], a[3]);
+    a[0] = n0; a[1] = n1; a[2] = n2; a[3] = n3;
+  }
+
+  //transposeBlock
+  static inline void transposeBlock(const Uint8* src, Uint8* dst, int nstages)
+  {
+    __m128i a[4];
+    for (int K = 0; K < 4; K++) 
+      a[K] = _mm_loadu_si128((const __m128i*)(src + 16 * K));
+
+    for (int S = 0; S < nstages; S++)
+      transposeStage(a);
+
+    for (int K = 0; K < 4; K++)
+      _mm_storeu_si128((__m128i*)(dst + 16 * K), a[K]);
+  }
+
+  //getLog2
+  static inline int getLog2(int typesize) {
+    return typesize == 2 ? 1 : (typesize == 4 ? 2 : (typesize == 8 ? 3 : -1));
+  }
+
+#endif
+
+  //shuffle (dst[b*N+i]=src[i*typesize+b])
+  static void shuffle(const Uint8* src, Uint8* dst, Int64 nbytes, int typesize)
+  {
+    Int64 N = nbytes / typesize, I = 0;
+
+#if VISUS_FILTERS_SSE2
+    //64 bytes at a time, the element/byte address bits [e|b] rotated to [b|e]
+    int k = getLog2(typesize);
+    if (k > 0)
+    {
+      const int G = 64 / typesize;
+      Uint8 tmp[64];
+      for (; I + G <= N; I += G)
+      {
+        transposeBlock(src + I * typesize, tmp, 6 - k);
+        for (int B = 0; B < typesize; B++)
+          memcpy(dst + B * N + I, tmp + B * G, G);
+      }
+    }
+#endif
+
+    for (; I < N; I++)
+      for (int B = 0; B < typesize; B++)
+        dst[B * N + I] = src[I * typesize + B];
+
+    memcpy(dst + N * typesize, src + N * typesize, (size_t)(nbytes - N * typesize));
+  }
+
+  //unshuffle
+  static void unshuffle(const Uint8* src, Uint8* dst, Int64 nbytes, int typesize)
+  {
+    Int64 N = nbytes / typesize, I = 0;
+
+#if VISUS_FILTERS_SSE2
+    int k = getLog2(typesize);
+    if (k > 0)
+    {
+      const int G = 64 / typesize;
+      Uint8 tmp[64];
+      for (; I + G <= N; I += G)
+      {
+        for (int B = 0; B < typesize; B++)
+          memcpy(tmp + B * G, src + B * N + I, G);
+        transposeBlock(tmp, dst + I * typesize, k);
+      }
+    }
+#endif
+
+    for (; I < N; I++)
+      for (int B = 0; B < typesize; B++)
+        dst[I * typesize + B] = src[B * N + I];
+
+    memcpy(dst + N * typesize, src + N * typesize, (size_t)(nbytes - N * typesize));
+  }
+
+  //transpose8x8 (byte K bit T <-> byte T bit K, it's an involution)
+  static inline void transpose8x8(const Uint8* src, Int64 src_stride, Uint8* dst, Int64 dst_stride)
+  {
+    Uint64 x = 0;
+    for (int K = 0; K < 8; K++)
+      x |= ((Uint64)src[K * src_stride]) << (8 * K);
+
+    x = (x & 0xAA55AA55AA55AA55ULL) | ((x & 0x00AA00AA00AA00AAULL) << 7 ) | ((x >> 7 ) & 0x00AA00AA00AA00AAULL);
+    x = (x & 0xCCCC3333CCCC3333ULL) | ((x & 0x0000CCCC0000CCCCULL) << 14) | ((x >> 14) & 0x0000CCCC0000CCCCULL);
+    x = (x & 0xF0F0F0F00F0F0F0FULL) | ((x & 0x00000000F0F0F0F0ULL) << 28) | ((x >> 28) & 0x00000000F0F0F0F0ULL);
+
+    for (int K = 0; K < 8; K++)
+      dst[K * dst_stride] = (Uint8)(x >> (8 * K));
+  }
+
+  //bitshuffle (byte-shuffle of the first N8 samples, then each byte plane is split into 8 bit planes)
+  static void bitshuffle(const Uint8* src, Uint8* dst, Int64 nbytes, int typesize)
+  {
+    Int64 N8 = (nbytes / typesize) & ~((Int64)7);
+    Int64 nbytes8 = N8 * typesize;
+
+    std::vector<Uint8> tmp((size_t)nbytes8);
+    if (nbytes8)
+      shuffle(src, &tmp[0], nbytes8, typesize);
+
+    for (Int64 P = 0; P < typesize; P++)
+      for (Int64 G = 0; G < N8 / 8; G++)
+        transpose8x8(&tmp[0] + P * N8 + G * 8, 1, dst + P * N8 + G, N8 / 8);
+
+    memcpy(dst + nbytes8, src + nbytes8, (size_t)(nbytes - nbytes8));
+  }
+
+  //bitunshuffle
+  static void bitunshuffle(const Uint8* src, Uint8* dst, Int64 nbytes, int typesize)
+  {
+    Int64 N8 = (nbytes / typesize) & ~((Int64)7);
+    Int64 nbytes8 = N8 * typesize;
+
+    std::vector<Uint8> tmp((size_t)nbytes8);
+    for (Int64 P = 0; P < typesize; P++)
+      for (Int64 G = 0; G < N8 / 8; G++)
+        transpose8x8(src + P * N8 + G, N8 / 8, &tmp[0] + P * N8 + G * 8, 1);
+
+    if (nbytes8)
+      unshuffle(&tmp[0], dst, nbytes8, typesize);
+
+    memcpy(dst + nbytes8, src + nbytes8, (size_t)(nbytes - nbytes8));
+  }
+
+};
+
+} //namespace Visus
+
+#endif //VISUS_FILTERED_ENCODER_H
+
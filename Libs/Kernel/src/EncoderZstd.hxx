@@ -0,0 +1,254 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#ifndef VISUS_ZSTD_ENCODER_H
+#define VISUS_ZSTD_ENCODER_H
+
+#include <Visus/Kernel.h>
+#include <Visus/Encoder.h>
+
+#include <zstd.h>
+#include <zdict.h>
+
+namespace Visus {
+
+//////////////////////////////////////////////////////////////
+/*
+specs example:
+  "zstd"          default level
+  "zstd-19"       compression level 19
+  "zstd-3-mt4"    compression level 3 using 4 compression workers (needs a multithreaded libzstd)
+
+A pre-trained dictionary can be set with setDictionary (see Field::compression_dictionary)
+*/
+class VISUS_KERNEL_API ZstdEncoder : public Encoder
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(ZstdEncoder)
+
+  int compression_level = ZSTD_CLEVEL_DEFAULT;
+
+  int num_workers = 0;
+
+  //constructor
+  ZstdEncoder(String specs)
+  {
+    auto options = StringUtils::split(specs, "-");
+    for (int I = 1; I < (int)options.size(); I++)
+    {
+      auto it = options[I];
+      int value = 0;
+
+      if (StringUtils::startsWith(it, "mt") && StringUtils::tryParse(it.substr(2), value))
+        num_workers = value;
+
+      else if (StringUtils::tryParse(it, value))
+        compression_level = std::max(ZSTD_minCLevel(), std::min(ZSTD_maxCLevel(), value));
+    }
+  }
+
+  //destructor
+  virtual ~ZstdEncoder() 
+  {
+    if (cdict) ZSTD_freeCDict(cdict);
+    if (ddict) ZSTD_freeDDict(ddict);
+  }
+
+  //isLossy
+  virtual bool isLossy() const override {
+    return false;
+  }
+
+  //setDictionary
+  virtual bool setDictionary(SharedPtr<HeapMemory> dictionary) override
+  {
+    if (cdict) { ZSTD_freeCDict(cdict); cdict = nullptr; }
+    if (ddict) { ZSTD_freeDDict(ddict); ddict = nullptr; }
+
+    if (!dictionary || !dictionary->c_size())
+      return true;
+
+    cdict = ZSTD_createCDict(dictionary->c_ptr(), (size_t)dictionary->c_size(), compression_level);
+    ddict = ZSTD_createDDict(dictionary->c_ptr(), (size_t)dictionary->c_size());
+    return cdict && ddict;
+  }
+
+  //trainDictionary
+  virtual SharedPtr<HeapMemory> trainDictionary(const std::vector< SharedPtr<HeapMemory> >& samples, Int64 max_size) override
+  {
+    std::vector<size_t> sizes;
+    auto concatenated = std::make_shared<HeapMemory>();
+    for (auto sample : samples)
+    {
+      if (!sample || !sample->c_size())
+        continue;
+
+      OutputBinaryStream(*concatenated).write(sample->c_ptr(), sample->c_size());
+      sizes.push_back((size_t)sample->c_size());
+    }
+
+    if (sizes.empty())
+      return SharedPtr<HeapMemory>();
+
+    auto ret = std::make_shared<HeapMemory>();
+    if (!ret->resize(max_size, __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    auto dict_size = ZDICT_trainFromBuffer(ret->c_ptr(), (size_t)ret->c_size(), concatenated->c_ptr(), &sizes[0], (unsigned)sizes.size());
+    if (ZDICT_isError(dict_size))
+    {
+      PrintWarning("ZDICT_trainFromBuffer failed", ZDICT_getErrorName(dict_size));
+      return SharedPtr<HeapMemory>();
+    }
+
+    if (!ret->resize((Int64)dict_size, __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    ret->shrink();
+    return ret;
+  }
+
+  //encode
+  virtual SharedPtr<HeapMemory> encode(PointNi dims, DType dtype, SharedPtr<HeapMemory> decoded) override
+  {
+    if (!decoded)
+      return SharedPtr<HeapMemory>();
+
+    auto encoded = std::make_shared<HeapMemory>();
+    if (!encoded->resize(ZSTD_compressBound((size_t)decoded->c_size()), __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    auto cctx = getThreadContexts().getCCtx();
+    if (!cctx)
+      return SharedPtr<HeapMemory>();
+
+    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compression_level);
+
+    //this fails if libzstd has been built without multithreading support, in which case compression is single threaded
+    if (num_workers > 0)
+      ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, num_workers);
+
+    if (cdict)
+      ZSTD_CCtx_refCDict(cctx, cdict);
+
+    auto encoded_size = ZSTD_compress2(cctx, encoded->c_ptr(), (size_t)encoded->c_size(), decoded->c_ptr(), (size_t)decoded->c_size());
+
+    if (ZSTD_isError(encoded_size))
+      return SharedPtr<HeapMemory>();
+
+    if (!encoded->resize((Int64)encoded_size, __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    return encoded;
+  }
+
+  //decode
+  virtual SharedPtr<HeapMemory> decode(PointNi dims, DType dtype, SharedPtr<HeapMemory> encoded) override
+  {
+    if (!encoded)
+      return SharedPtr<HeapMemory>();
+
+    auto decoded = std::make_shared<HeapMemory>();
+    if (!decoded->resize(dtype.getByteSize(dims), __FILE__, __LINE__))
+      return SharedPtr<HeapMemory>();
+
+    auto dctx = getThreadContexts().getDCtx();
+    if (!dctx)
+      return SharedPtr<HeapMemory>();
+
+    auto nbytes = ddict ?
+      ZSTD_decompress_usingDDict(dctx, decoded->c_ptr(), (size_t)decoded->c_size(), encoded->c_ptr(), (size_t)encoded->c_size(), ddict) :
+      ZSTD_decompressDCtx       (dctx, decoded->c_ptr(), (size_t)decoded->c_size(), encoded->c_ptr(), (size_t)encoded->c_size());
+
+    if (ZSTD_isError(nbytes))
+      return SharedPtr<HeapMemory>();
+
+    if ((Int64)nbytes != decoded->c_size()) {
+      VisusAssert(false);
+      return SharedPtr<HeapMemory>();
+    }
+
+    return decoded;
+  }
+
+private:
+
+  //dictionaries are digested once per encoder (see setDictionary)
+  ZSTD_CDict* cdict = nullptr;
+  ZSTD_DDict* ddict = nullptr;
+
+  //contexts are expensive to create, each thread reuses its own (they are reset before every use)
+  class ThreadContexts
+  {
+  public:
+
+    ~ThreadContexts() {
+      if (cctx) ZSTD_freeCCtx(cctx);
+      if (dctx) ZSTD_freeDCtx(dctx);
+    }
+
+    ZSTD_CCtx* getCCtx() {
+      if (!cctx) cctx = ZSTD_createCCtx();
+      if (cctx) ZSTD_CCtx_reset(cctx, ZSTD_reset_session_and_parameters);
+      return cctx;
+    }
+
+    ZSTD_DCtx* getDCtx() {
+      if (!dctx) dctx = ZSTD_createDCtx();
+      if (dctx) ZSTD_DCtx_reset(dctx, ZSTD_reset_session_and_parameters);
+      return dctx;
+    }
+
+  private:
+    ZSTD_CCtx* cctx = nullptr;
+    ZSTD_DCtx* dctx = nullptr;
+  };
+
+  //getThreadContexts
+  static ThreadContexts& getThreadContexts() {
+    static thread_local ThreadContexts ret;
+    return ret;
+  }
+
+};
+
+} //namespace Visus
+
+#endif //VISUS_ZSTD_ENCODER_H
+
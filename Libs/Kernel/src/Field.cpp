@@ -89,6 +89,13 @@ Field Field::fromString(String sfield)
       compression = "zip";
   }
 
+  //compression_dictionary(base64)
+  {
+    auto dictionary = parseRoundBracketArgument(sfield, "compression_dictionary");
+    if (!dictionary.empty())
+      ret.compression_dictionary = HeapMemory::base64Decode(dictionary);
+  }
+
   //default_layout
   {
     if (StringUtils::contains(sfield, "default_layout"))
@@ -134,6 +141,8 @@ void Field::write(Archive& ar) const
   ar.write("description", description);
   ar.write("index", index);
   ar.write("default_compression", default_compression);
+  if (compression_dictionary)
+    ar.write("compression_dictionary", compression_dictionary->base64Encode());
   ar.write("default_layout", default_layout);
   ar.write("default_value", default_value);
   ar.write("filter", filter);
@@ -155,6 +164,10 @@ void Field::read(Archive& ar)
   ar.read("description", description);
   ar.read("index", index);
   ar.read("default_compression", default_compression);
+
+  String dictionary;
+  ar.read("compression_dictionary", dictionary);
+  this->compression_dictionary = dictionary.empty() ? SharedPtr<HeapMemory>() : HeapMemory::base64Decode(dictionary);
   ar.read("default_layout", default_layout);
   ar.read("default_value", default_value);
   ar.read("filter", filter);
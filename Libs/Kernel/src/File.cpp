@@ -196,6 +196,8 @@ public:
     if (!isOpen())
       return;
 
+    onCloseEvent();
+
 #if WIN32
     ::_close(this->handle);
 #else
@@ -425,6 +427,8 @@ public:
     if (!isOpen())
       return;
 
+    onCloseEvent();
+
     CloseHandle(handle);
     this->handle = INVALID_HANDLE_VALUE;
     this->can_read  = false;
@@ -687,6 +691,8 @@ public:
     if (!isOpen())
       return;
 
+    onCloseEvent();
+
 #if defined(WIN32)
     {
       if (mem)
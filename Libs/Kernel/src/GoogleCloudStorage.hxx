@@ -71,30 +71,105 @@ public:
   }
 
   // getBlob 
-  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String blob_name, Aborted aborted = Aborted()) override
+  virtual Future<CloudStorageBlob> getBlob(SharedPtr<NetService> service, String blob_name, Aborted aborted = Aborted(), Int64 offset = 0, Int64 size = 0) override
   {
     auto ret = Promise<CloudStorageBlob>().get_future();
 
     NetRequest request("https://storage.googleapis.com" + blob_name +"?alt=media", "GET");
     request.aborted = aborted;
+    setRange(request, offset, size);
     signRequest(request);
 
     NetService::push(service, request).when_ready([ret, aborted](NetResponse response) {
 
+      CloudStorageBlob blob;
+      blob.status = response.status;
+
       if (!response.isSuccessful())
       {
         PrintWarning("ERROR. Cannot get blob status",response.status,"errormsg",response.getErrorMessage());
-        ret.get_promise()->set_value(CloudStorageBlob());
+        ret.get_promise()->set_value(blob);
         return;
       }
 
-      CloudStorageBlob blob;
+      //parse metadata
+      String metatata_prefix = "x-goog-meta-";
+      for (auto it = response.headers.begin(); it != response.headers.end(); it++)
+      {
+        String name = StringUtils::toLower(it->first);
+        if (StringUtils::startsWith(name, metatata_prefix))
+          blob.metadata.setValue(name.substr(metatata_prefix.length()), it->second);
+      }
+
       blob.body = response.body;
       ret.get_promise()->set_value(blob);
     });
 
     return ret;
   }
+
+  // addBlob (single request upload, multipart size is ignored)
+  virtual Future<bool> addBlob(SharedPtr<NetService> service, CloudStorageBlob blob, String blob_name, Aborted aborted = Aborted()) override
+  {
+    auto ret = Promise<bool>().get_future();
+
+    //blob_name is /<bucket>/<object>
+    auto v = StringUtils::split(blob_name, "/");
+    if (v.size() < 2)
+    {
+      ret.get_promise()->set_value(false);
+      return ret;
+    }
+
+    String bucket = v[0];
+    String object_name = blob_name.substr(bucket.length() + 2);
+
+    NetRequest request("https://storage.googleapis.com/upload/storage/v1/b/" + bucket + "/o", "POST");
+    request.aborted = aborted;
+
+    if (blob.metadata.empty())
+    {
+      request.url.setParam("uploadType", "media");
+      request.url.setParam("name", object_name);
+      request.body = blob.body;
+      request.setContentType(blob.content_type);
+    }
+    else
+    {
+      //metadata and body in the same request (see https://cloud.google.com/storage/docs/uploading-objects#uploading-an-object)
+      nlohmann::json json;
+      json["name"] = object_name;
+      json["contentType"] = blob.content_type;
+      for (auto it = blob.metadata.begin(); it != blob.metadata.end(); it++)
+        json["metadata"][it->first] = it->second;
+
+      String boundary = "visus_" + StringUtils::computeChecksum(object_name);
+      String header = "--" + boundary + "\r\nContent-Type: application/json; charset=UTF-8\r\n\r\n" + json.dump() + "\r\n--" + boundary + "\r\nContent-Type: " + blob.content_type + "\r\n\r\n";
+      String footer = "\r\n--" + boundary + "--\r\n";
+
+      auto body = std::make_shared<HeapMemory>();
+      if (!body->resize(header.size() + blob.body->c_size() + footer.size(), __FILE__, __LINE__))
+      {
+        ret.get_promise()->set_value(false);
+        return ret;
+      }
+      memcpy(body->c_ptr(), header.c_str(), header.size());
+      memcpy(body->c_ptr() + header.size(), blob.body->c_ptr(), (size_t)blob.body->c_size());
+      memcpy(body->c_ptr() + header.size() + blob.body->c_size(), footer.c_str(), footer.size());
+
+      request.url.setParam("uploadType", "multipart");
+      request.body = body;
+      request.setContentType("multipart/related; boundary=" + boundary);
+    }
+
+    request.setContentLength(request.body->c_size());
+
+    pushWithRetry(service, request, [this](NetRequest& request) {signRequest(request); }).when_ready([ret](NetResponse response) {
+      ret.get_promise()->set_value(response.isSuccessful());
+    });
+
+    return ret;
+  }
   
 private:
 
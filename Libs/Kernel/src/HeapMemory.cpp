@@ -38,11 +38,309 @@ For support : support@visus.net
 
 #include <Visus/HeapMemory.h>
 #include <Visus/RamResource.h>
+#include <Visus/CriticalSection.h>
 
 #include <algorithm>
+#include <vector>
+#include <atomic>
+
+#if WIN32
+#include <malloc.h>
+#elif __linux__
+#include <sys/mman.h>
+#endif
 
 namespace Visus {
 
+bool HeapMemory::Defaults::pool = true;
+bool HeapMemory::Defaults::huge_pages = false;
+
+////////////////////////////////////////////////////////
+/*
+Size-class pools for block-sized allocations (from 4KB to 4MB, 4 classes for each power of 2, so the
+waste is at most 25%). Each thread keeps a small cache (at most MaxLocalBytes), exceeding blocks go to a central pool
+(at most MaxCentralBytes) protected by a lock per class. Everything else goes directly to the aligned allocator.
+
+Pooled bytes are not accounted as used by RamResource (see RamResource::getPooledMemory), 
+and the pools are trimmed when RamResource refuses an allocation.
+*/
+class HeapMemoryPool
+{
+public:
+
+  enum
+  {
+    MinLog2 = 12,
+    MaxLog2 = 22,
+    NumClasses = (MaxLog2 - MinLog2) * 4 + 1,
+    HugePageSize = 2 * 1024 * 1024
+  };
+
+  //getSizeClass (-1 if the size is not pooled)
+  static int getSizeClass(Int64 size, Int64& class_size)
+  {
+    class_size = size;
+    if (size < ((Int64)1 << MinLog2) || size > ((Int64)1 << MaxLog2))
+      return -1;
+
+    int e = MinLog2;
+    while (((Int64)1 << (e + 1)) <= size) e++;
+
+    Int64 base = (Int64)1 << e, step = base / 4;
+    Int64 q = (size - base + step - 1) / step;
+    if (q == 4) { e++; q = 0; base <<= 1; step <<= 1; }
+
+    class_size = base + q * step;
+    return (e - MinLog2) * 4 + (int)q;
+  }
+
+  //alloc
+  static void* alloc(Int64 size, Int64& capacity)
+  {
+    int C = HeapMemory::Defaults::pool ? getSizeClass(size, capacity) : -1;
+    if (C < 0)
+    {
+      capacity = size;
+      return alignedAlloc(size);
+    }
+
+    //thread cache
+    auto local = getLocal();
+    if (local && !local->blocks[C].empty())
+    {
+      void* ret = local->blocks[C].back();
+      local->blocks[C].pop_back();
+      local->cached_bytes -= capacity;
+      getPooledBytes() -= capacity;
+      return ret;
+    }
+
+    //central pool
+    if (auto central = getCentral())
+    {
+      ScopedLock lock(central->locks[C]);
+      auto& blocks = central->blocks[C];
+      if (!blocks.empty())
+      {
+        void* ret = blocks.back();
+        blocks.pop_back();
+        central->cached_bytes -= capacity;
+        getPooledBytes() -= capacity;
+        return ret;
+      }
+    }
+
+    return alignedAlloc(capacity);
+  }
+
+  //release
+  static void release(void* p, Int64 capacity)
+  {
+    Int64 class_size;
+    int C = HeapMemory::Defaults::pool ? getSizeClass(capacity, class_size) : -1;
+
+    //not allocated from a pool
+    if (C < 0 || class_size != capacity)
+      return alignedFree(p);
+
+    auto local = getLocal();
+    if (local && (int)local->blocks[C].size() < MaxLocalBlocksPerClass && local->cached_bytes + capacity <= MaxLocalBytes)
+    {
+      local->blocks[C].push_back(p);
+      local->cached_bytes += capacity;
+      getPooledBytes() += capacity;
+      return;
+    }
+
+    if (auto central = getCentral())
+    {
+      ScopedLock lock(central->locks[C]);
+      auto& blocks = central->blocks[C];
+      if ((int)blocks.size() < getCentralLimit(capacity) && central->cached_bytes + capacity <= MaxCentralBytes)
+      {
+        blocks.push_back(p);
+        central->cached_bytes += capacity;
+        getPooledBytes() += capacity;
+        return;
+      }
+    }
+
+    alignedFree(p);
+  }
+
+  //trim (the caches of other threads are not touched)
+  static void trim()
+  {
+    if (auto local = getLocal())
+      local->clear();
+
+    if (auto central = getCentral())
+      central->clear();
+  }
+
+  //getPooledBytes
+  static std::atomic<Int64>& getPooledBytes() {
+    static std::atomic<Int64> ret(0);
+    return ret;
+  }
+
+private:
+
+  static const Int64 MaxLocalBytes   = (Int64)4 * 1024 * 1024;
+  static const Int64 MaxCentralBytes = (Int64)64 * 1024 * 1024;
+
+  enum { MaxLocalBlocksPerClass = 4 };
+
+  //getCentralLimit
+  static int getCentralLimit(Int64 class_size) {
+    return (int)std::max((Int64)2, std::min((Int64)64, ((Int64)64 * 1024 * 1024) / class_size));
+  }
+
+  //alignedAlloc
+  static void* alignedAlloc(Int64 size)
+  {
+    size_t alignment = HeapMemory::Alignment;
+    bool bHugePages = HeapMemory::Defaults::huge_pages && size >= HugePageSize;
+    if (bHugePages)
+      alignment = HugePageSize;
+
+#if WIN32
+    return _aligned_malloc((size_t)size, alignment);
+#else
+    void* ret = nullptr;
+    if (posix_memalign(&ret, alignment, (size_t)size) != 0)
+      return nullptr;
+#if __linux__ && defined(MADV_HUGEPAGE)
+    if (bHugePages)
+      madvise(ret, (size_t)size, MADV_HUGEPAGE);
+#endif
+    return ret;
+#endif
+  }
+
+  //alignedFree
+  static void alignedFree(void* p)
+  {
+#if WIN32
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+  }
+
+  //_______________________________________
+  class Central
+  {
+  public:
+    CriticalSection     locks[NumClasses];
+    std::vector<void*>  blocks[NumClasses];
+    std::atomic<Int64>  cached_bytes;
+
+    //constructor
+    Central() : cached_bytes(0) {
+      getCentralState() = Alive;
+    }
+
+    //destructor
+    ~Central() {
+      clear();
+      getCentralState() = Dead;
+    }
+
+    //clear
+    void clear() {
+      for (int C = 0; C < NumClasses; C++)
+      {
+        ScopedLock lock(locks[C]);
+        for (auto it : blocks[C])
+        {
+          alignedFree(it);
+          cached_bytes -= getClassSize(C);
+          getPooledBytes() -= getClassSize(C);
+        }
+        blocks[C].clear();
+      }
+    }
+  };
+
+  //_______________________________________
+  class Local
+  {
+  public:
+    std::vector<void*> blocks[NumClasses];
+    Int64              cached_bytes = 0;
+
+    //constructor
+    Local() {
+      getLocalState() = Alive;
+    }
+
+    //destructor (give the blocks back to the central pool)
+    ~Local() {
+      getLocalState() = Dead;
+      for (int C = 0; C < NumClasses; C++)
+      {
+        for (auto it : blocks[C])
+        {
+          getPooledBytes() -= getClassSize(C);
+          release(it, getClassSize(C));
+        }
+        blocks[C].clear();
+      }
+      cached_bytes = 0;
+    }
+
+    //clear
+    void clear() {
+      for (int C = 0; C < NumClasses; C++)
+      {
+        for (auto it : blocks[C])
+        {
+          alignedFree(it);
+          getPooledBytes() -= getClassSize(C);
+        }
+        blocks[C].clear();
+      }
+      cached_bytes = 0;
+    }
+  };
+
+  enum { Uninitialized = 0, Alive, Dead };
+
+  //getClassSize
+  static Int64 getClassSize(int C) {
+    Int64 base = (Int64)1 << (MinLog2 + C / 4);
+    return base + (C % 4) * (base / 4);
+  }
+
+  //getLocalState (trivially destructible, can be checked while the thread exits)
+  static int& getLocalState() {
+    static thread_local int ret = Uninitialized;
+    return ret;
+  }
+
+  //getCentralState
+  static int& getCentralState() {
+    static int ret = Uninitialized;
+    return ret;
+  }
+
+  //getLocal
+  static Local* getLocal() {
+    if (getLocalState() == Dead) return nullptr;
+    static thread_local Local ret;
+    return &ret;
+  }
+
+  //getCentral
+  static Central* getCentral() {
+    if (getCentralState() == Dead) return nullptr;
+    static Central ret;
+    return &ret;
+  }
+
+};
+
 ////////////////////////////////////////////////////////
 HeapMemory::HeapMemory() : unmanaged(false),n(0),m(0),p(nullptr)
 {}
@@ -131,6 +429,9 @@ bool HeapMemory::myRealloc(Int64 new_m,const char* file,int line)
   Uint8* old_p=this->p;
   Uint8* new_p=0;
 
+  //note: static buffers can be released after the kernel detach (no more accounting)
+  auto ram=RamResource::getSingleton();
+
   //wrong call
   if (new_m<0)
   {
@@ -152,14 +453,11 @@ bool HeapMemory::myRealloc(Int64 new_m,const char* file,int line)
     return true;
   }
 
-  //reached memory limit
-  if (!((new_m-old_m)>0? RamResource::getSingleton()->allocateMemory(new_m-old_m) : RamResource::getSingleton()->freeMemory(old_m-new_m))) 
-    return false;
-
   //free
   if (!new_m)
   {
-    free(this->p);
+    HeapMemoryPool::release(this->p, old_m);
+    if (ram) ram->freeMemory(old_m);
 
     this->p=0;
     this->m=0;
@@ -167,31 +465,67 @@ bool HeapMemory::myRealloc(Int64 new_m,const char* file,int line)
     return true;
   }
 
-  //malloc
-  if (!old_p)
-  {
-    new_p=(Uint8*)malloc((size_t)new_m);
-  }
-  //realloc
-  else
+  //the pools round up the capacity to the size class
+  Int64 new_capacity = new_m;
+  HeapMemoryPool::getSizeClass(new_m, new_capacity);
+  if (!Defaults::pool)
+    new_capacity = new_m;
+
+  //nothing to do
+  if (new_capacity == old_m)
+    return true;
+
+  //reached memory limit (try again after giving back the pooled memory)
+  auto accountMemory = [&]() {
+    return (new_capacity - old_m) > 0 ? ram->allocateMemory(new_capacity - old_m) : ram->freeMemory(old_m - new_capacity);
+  };
+
+  if (ram && !accountMemory())
   {
-    new_p=(Uint8*)realloc(old_p,(size_t)new_m);
+    if (!HeapMemoryPool::getPooledBytes())
+      return false;
+
+    HeapMemoryPool::trim();
+    if (!accountMemory())
+      return false;
   }
 
+  new_p=(Uint8*)HeapMemoryPool::alloc(new_m, new_capacity);
+
   //failed
   if (!new_p) 
   {
-    RamResource::getSingleton()->freeMemory(new_m-old_m);
+    if (ram && new_capacity > old_m)
+      ram->freeMemory(new_capacity - old_m);
+    else if (ram)
+      ram->allocateMemory(old_m - new_capacity);
     VisusAssert(false);
     return false;
   }
 
-  this->m=new_m;
+  //same as realloc (note: aligned memory cannot be realloc-ed)
+  if (old_p)
+  {
+    memcpy(new_p, old_p, (size_t)std::min(old_m, new_capacity));
+    HeapMemoryPool::release(old_p, old_m);
+  }
+
+  this->m=new_capacity;
   this->p=new_p;
   this->n=std::min(this->n,this->m);
   return true;
 }
 
+////////////////////////////////////////////////////////////////////////////////////////
+void HeapMemory::trimPool() {
+  HeapMemoryPool::trim();
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+Int64 HeapMemory::getPooledMemory() {
+  return HeapMemoryPool::getPooledBytes();
+}
+
 
 ////////////////////////////////////////////////////////////////////////////
 //see http://en.wikibooks.org/wiki/Algorithm_Implementation/Miscellaneous/Base64
@@ -38,119 +38,118 @@ For support : support@visus.net
 
 #include <Visus/KdArray.h>
 
-#include <list>
-
 namespace Visus {
 
+VISUS_IMPLEMENT_SINGLETON_CLASS(KdArrayCache)
+
 //////////////////////////////////////////////
-class KdArray::SingleCache
+void KdArrayCache::setMaxMemory(Int64 value)
 {
-public:
-
-  class Cached
-  {
-  public:
-    BigInt           id =0;
-    Int64            c_size=0;
-    Array            blockdata;
-    Array            fullres;
-    Array            displaydata;
-  };
-
-  Int64                                          max_memory=0;
-  Int64                                          used_memory=0;
-  std::list<Cached>                              list;
-  std::map< BigInt, std::list<Cached>::iterator> map;
-
-  //constructor
-  SingleCache() {
-  }
+  ScopedLock lock(this->lock);
+  this->max_memory = value;
+  evict(value);
+}
 
-  //contains
-  bool contains(KdArrayNode* node) const {
-    return map.find(node->id)!=map.end();
-  }
+//////////////////////////////////////////////
+void KdArrayCache::touch(const Key& key, Entry& entry)
+{
+  lru.erase(std::make_pair(entry.priority, key));
+  entry.priority = ++clock - (Int64)entry.level * LevelPenalty;
+  lru.insert(std::make_pair(entry.priority, key));
+}
 
-  //push
-  void push(KdArrayNode* node)
+//////////////////////////////////////////////
+void KdArrayCache::evict(Int64 limit)
+{
+  while (statistics.used_memory > limit && !lru.empty())
   {
-    //PrintInfo("push",max_memory?"fine":"coarse",node->id);
-    VisusAssert(!contains(node));
-
-    Cached cached;
-    cached.c_size=node->c_size();
-    if (!cached.c_size) return; //nothing to cache
-
-    cached.id             = node->id;
-    cached.blockdata      = node->blockdata;
-    cached.fullres        = node->fullres;
-    cached.displaydata    = node->displaydata;
-
-    //there is a limit
-    if (max_memory>0)
-    {
-      while ((cached.c_size+used_memory)>=(max_memory))
-      {
-        auto it=list.end();--it;
-        used_memory-=it->c_size;
-        map.erase(it->id);
-        list.erase(it);
-      }
-    }
-
-    list.push_front(cached);
-    map[cached.id]=list.begin();
-    used_memory+=cached.c_size;
+    auto key = lru.begin()->second;
+    lru.erase(lru.begin());
+    auto it = entries.find(key);
+    statistics.used_memory -= it->second.c_size;
+    entries.erase(it);
+    statistics.num_evictions++;
   }
+  statistics.num_entries = (Int64)entries.size();
+}
 
-  //pop
-  void pop(KdArrayNode* node)
-  {
-    //PrintInfo("pop",max_memory?"fine":"coarse",node->id);
+//////////////////////////////////////////////
+void KdArrayCache::store(String key_, KdArrayNode* node)
+{
+  auto c_size = node->c_size();
+  if (!c_size)
+    return; //nothing to cache
 
-    auto it=map.find(node->id);
+  auto key = Key(key_, node->id);
 
-    //not found
-    if (it==map.end()) 
-      return; 
+  ScopedLock lock(this->lock);
 
-    const Cached& cached=*(it->second);
+  if (max_memory > 0 && c_size > max_memory)
+    return;
 
-    VisusAssert(cached.id ==node->id);
-    node->blockdata   = cached.blockdata;
-    node->fullres     = cached.fullres;
-    node->displaydata = cached.displaydata;
+  auto& entry = entries[key];
+  statistics.used_memory += c_size - entry.c_size;
+  entry.blockdata   = node->blockdata;
+  entry.fullres     = node->fullres;
+  entry.displaydata = node->displaydata;
+  entry.c_size      = c_size;
+  entry.level       = node->level;
+  touch(key, entry);
 
-    used_memory-=cached.c_size;
-    list.erase(it->second);
-    map.erase(it);
-    VisusAssert(!contains(node));
-  }
-};
+  if (max_memory > 0)
+    evict(max_memory);
+
+  statistics.num_entries = (Int64)entries.size();
+}
 
 //////////////////////////////////////////////
-class KdArray::MultiCache
+bool KdArrayCache::restore(String key_, KdArrayNode* node)
 {
-public:
+  auto key = Key(key_, node->id);
 
-  int         cutoff;
-  SingleCache coarse_cache;
-  SingleCache fine_cache;
+  ScopedLock lock(this->lock);
 
-  //constructor
-  MultiCache() : cutoff(0) {
+  auto it = entries.find(key);
+  if (it == entries.end())
+  {
+    statistics.num_misses++;
+    return false;
   }
 
-  //push
-  void push(KdArrayNode* node) {
-    (node->level < cutoff ? coarse_cache : fine_cache).push(node);
-  }
+  auto& entry = it->second;
+  node->blockdata   = entry.blockdata;
+  node->fullres     = entry.fullres;
+  node->displaydata = entry.displaydata;
+  touch(key, entry);
+  statistics.num_hits++;
+  return true;
+}
 
-  //pop
-  void pop(KdArrayNode* node) {
-    (node->level < cutoff ? coarse_cache : fine_cache).pop(node);
-  }
-};
+//////////////////////////////////////////////
+void KdArrayCache::clear()
+{
+  ScopedLock lock(this->lock);
+  entries.clear();
+  lru.clear();
+  statistics.used_memory = 0;
+  statistics.num_entries = 0;
+}
+
+//////////////////////////////////////////////
+KdArrayCache::Statistics KdArrayCache::getStatistics()
+{
+  ScopedLock lock(this->lock);
+  return statistics;
+}
+
+//////////////////////////////////////////////
+void KdArrayCache::printStatistics()
+{
+  auto stats = getStatistics();
+  auto nrestore = stats.num_hits + stats.num_misses;
+  PrintInfo("KdArrayCache hits", stats.num_hits, "misses", stats.num_misses, "hit-rate", nrestore ? (double)stats.num_hits / nrestore : 0.0,
+    "evictions", stats.num_evictions, "entries", stats.num_entries, "used", StringUtils::getStringFromByteSize(stats.used_memory), "max", StringUtils::getStringFromByteSize(max_memory));
+}
 
 
 ////////////////////////////////////////////////////////////////
@@ -159,12 +158,16 @@ KdArray::KdArray(int pdim_) : pdim(pdim_)
 
 ////////////////////////////////////////////////////////////////
 KdArray::~KdArray()
-{}
+{
+  //the nodes still alive can be reused by the next KdArray with the same key
+  if (root && !cache_key.empty())
+    onNodeExit(root.get());
+}
 
 ////////////////////////////////////////////////////////////////
 void KdArray::onNodeEnter(KdArrayNode* node)
 {
-  if (cache)  cache->pop(node);
+  restoreFromCache(node);
   if (node->left ) onNodeEnter (node->left.get ());
   if (node->right) onNodeEnter (node->right.get()); //IMPORTANT THE ORDER... node and then childs
 }
@@ -175,7 +178,8 @@ void KdArray::onNodeExit(KdArrayNode* node)
 {
   if (node->left ) onNodeExit(node->left.get ()); //IMPORTANT THE ORDER... childs and then node
   if (node->right) onNodeExit(node->right.get());
-  if (cache)  cache->push(node);
+  if (!cache_key.empty() && KdArrayCache::getSingleton())
+    KdArrayCache::getSingleton()->store(cache_key, node);
 }
 
 ////////////////////////////////////////////////////////////////
@@ -210,13 +214,18 @@ void KdArray::split(KdArrayNode* node,int split_bit)
 
 
 ////////////////////////////////////////////////////////////////
-void KdArray::enableCaching(int cutoff,Int64 fine_maxmemory)
+void KdArray::enableCaching(String cache_key)
 {
-  if (cache) return;
-  cache=std::make_shared<MultiCache>();
-  cache->cutoff=cutoff;
-  cache->coarse_cache.max_memory=0;
-  cache->fine_cache.max_memory=fine_maxmemory;
+  this->cache_key = cache_key;
+}
+
+////////////////////////////////////////////////////////////////
+bool KdArray::restoreFromCache(KdArrayNode* node)
+{
+  if (cache_key.empty() || !KdArrayCache::getSingleton())
+    return false;
+
+  return KdArrayCache::getSingleton()->restore(cache_key, node);
 }
 
 
@@ -39,6 +39,7 @@ For support : support@visus.net
 #include <Visus/Kernel.h>
 
 #include <Visus/Thread.h>
+#include <Visus/Scheduler.h>
 #include <Visus/NetService.h>
 #include <Visus/RamResource.h>
 #include <Visus/Path.h>
@@ -47,6 +48,7 @@ For support : support@visus.net
 #include <Visus/StringTree.h>
 #include <Visus/NetService.h>
 #include <Visus/SharedLibrary.h>
+#include <Visus/Trace.h>
 
 #include <assert.h>
 #include <type_traits>
@@ -94,6 +96,8 @@ For support : support@visus.net
 #include "EncoderLz4.hxx"
 #include "EncoderZip.hxx"
 #include "EncoderZfp.hxx"
+#include "EncoderChunked.hxx"
+#include "EncoderFilters.hxx"
 
 #include "ArrayPluginDevnull.hxx"
 #include "ArrayPluginRawArray.hxx"
@@ -114,6 +118,10 @@ For support : support@visus.net
 
 #endif
 
+#if VISUS_ZSTD
+#  include "EncoderZstd.hxx"
+#endif
+
 //this solve a problem of old Linux distribution (like Centos 5)
 #if __GNUC__ && !__APPLE__
 	#include <arpa/inet.h>
@@ -447,9 +455,11 @@ void KernelModule::attach()
     "CurrentWorkingDirectory ", KnownPaths::CurrentWorkingDirectory());
 #endif
 
+  Scheduler::setSingleton(new Scheduler(config->readInt("Configuration/Scheduler/nworkers", 0)));
   ArrayPlugins::allocSingleton();
   Encoders::allocSingleton();
   RamResource::allocSingleton();
+  KdArrayCache::setSingleton(new KdArrayCache(StringUtils::getByteSizeFromString(config->readString("Configuration/KdArrayCache/max_memory", "256mb"))));
 
   //in case the user whant to simulate I have a certain amount of RAM
   if (Int64 total = StringUtils::getByteSizeFromString(config->readString("Configuration/RamResource/total", "0")))
@@ -462,6 +472,13 @@ void KernelModule::attach()
   NetSocket::Defaults::recv_buffer_size = config->readInt("Configuration/NetSocket/recv_buffer_size");
   NetSocket::Defaults::tcp_no_delay = config->readBool("Configuration/NetSocket/tcp_no_delay", "1");
 
+  HeapMemory::Defaults::pool = config->readBool("Configuration/HeapMemory/pool", true);
+  HeapMemory::Defaults::huge_pages = config->readBool("Configuration/HeapMemory/huge_pages", false);
+
+  Trace::buffer_size = config->readInt("Configuration/Trace/buffer_size", Trace::buffer_size);
+  Trace::max_exited_threads = config->readInt("Configuration/Trace/max_exited_threads", Trace::max_exited_threads);
+  Trace::setEnabled(config->readBool("Configuration/Trace/enabled", false));
+
   //array plugins
   {
     ArrayPlugins::getSingleton()->values.push_back(std::make_shared<DevNullArrayPlugin>());
@@ -480,6 +497,15 @@ void KernelModule::attach()
     Encoders::getSingleton()->registerEncoder("lz4", [](String specs) {return std::make_shared<LZ4Encoder>(specs); });
     Encoders::getSingleton()->registerEncoder("zip", [](String specs) {return std::make_shared<ZipEncoder>(specs); });
     Encoders::getSingleton()->registerEncoder("zfp", [](String specs) {return std::make_shared<ZfpEncoder>(specs); });
+    Encoders::getSingleton()->registerEncoder("chunked", [](String specs) {return std::make_shared<ChunkedEncoder>(specs); });
+    Encoders::getSingleton()->registerEncoder("shuffle", [](String specs) {return std::make_shared<FilteredEncoder>(specs); });
+    Encoders::getSingleton()->registerEncoder("bitshuffle", [](String specs) {return std::make_shared<FilteredEncoder>(specs); });
+    Encoders::getSingleton()->registerEncoder("delta", [](String specs) {return std::make_shared<FilteredEncoder>(specs); });
+    Encoders::getSingleton()->registerEncoder("xor", [](String specs) {return std::make_shared<FilteredEncoder>(specs); });
+
+#if VISUS_ZSTD
+    Encoders::getSingleton()->registerEncoder("zstd", [](String specs) {return std::make_shared<ZstdEncoder>(specs); });
+#endif
 
 #if VISUS_IMAGE
     Encoders::getSingleton()->registerEncoder("png", [](String specs) {return std::make_shared<FreeImageEncoder>(specs); });
@@ -510,12 +536,20 @@ void KernelModule::detach()
   
   bAttached = false;
 
+  //wait for pending jobs before releasing what they may use
+  Scheduler::releaseSingleton();
   ArrayPlugins::releaseSingleton();
   Encoders::releaseSingleton();
+  KdArrayCache::releaseSingleton();
   RamResource::releaseSingleton();
 
   NetService::detach();
 
+  //dump the trace collected during the session
+  auto trace_filename = getModuleConfig()->readString("Configuration/Trace/filename");
+  if (Trace::isEnabled() && !trace_filename.empty())
+    Trace::saveChromeJSON(trace_filename);
+
   Private::VisusConfig::releaseSingleton();
 
 #if __APPLE__
@@ -0,0 +1,123 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/LatencyHistogram.h>
+
+#include <sstream>
+
+namespace Visus {
+
+////////////////////////////////////////////////////////////////
+void LatencyHistogram::reset()
+{
+  for (auto& it : buckets)
+    it.store(0, std::memory_order_relaxed);
+  count.store(0, std::memory_order_relaxed);
+  sum.store(0, std::memory_order_relaxed);
+}
+
+////////////////////////////////////////////////////////////////
+Int64 LatencyHistogram::getCountAtMost(Int64 usec) const
+{
+  Int64 ret = 0;
+  for (int I = 0; I < NumBuckets && getBucketUpperBound(I) <= usec; I++)
+    ret += buckets[I].load(std::memory_order_relaxed);
+  return ret;
+}
+
+////////////////////////////////////////////////////////////////
+Int64 LatencyHistogram::getQuantile(double q) const
+{
+  //note: buckets are read one by one while other threads record, the result is approximate anyway
+  Int64 tot = 0;
+  for (auto& it : buckets)
+    tot += it.load(std::memory_order_relaxed);
+
+  if (!tot)
+    return 0;
+
+  Int64 rank = std::max((Int64)1, (Int64)std::ceil(Utils::clamp(q, 0.0, 1.0) * tot));
+  Int64 cumulative = 0;
+  for (int I = 0; I < NumBuckets; I++)
+  {
+    auto N = buckets[I].load(std::memory_order_relaxed);
+    if (!N)
+      continue;
+
+    cumulative += N;
+    if (cumulative >= rank)
+    {
+      //interpolate inside the bucket
+      auto lower = getBucketLowerBound(I);
+      auto upper = getBucketUpperBound(I);
+      auto alpha = (rank - (cumulative - N)) / (double)N;
+      return lower + 1 + (Int64)(alpha * (upper - 1 - lower));
+    }
+  }
+
+  return getBucketUpperBound(NumBuckets - 1);
+}
+
+////////////////////////////////////////////////////////////////
+String LatencyHistogram::toPrometheus(String name, String labels, int min_bits, int max_bits) const
+{
+  auto seconds = [](Int64 usec) {
+    std::ostringstream out;
+    out.precision(12);
+    out << usec / 1000000.0;
+    return out.str();
+  };
+
+  auto prefix = labels.empty() ? String() : labels + ",";
+
+  std::ostringstream out;
+  out.precision(12);
+  for (int K = min_bits; K <= max_bits; K++)
+  {
+    Int64 upper = (Int64)1 << K;
+    out << name << "_bucket{" << prefix << "le=\"" << seconds(upper) << "\"} " << getCountAtMost(upper) << "\n";
+  }
+
+  auto count = getCountAtMost(std::numeric_limits<Int64>::max());
+  out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << count << "\n";
+  out << name << "_sum{" << labels << "} " << seconds(getSum()) << "\n";
+  out << name << "_count{" << labels << "} " << count << "\n";
+  return out.str();
+}
+
+} //namespace Visus
@@ -351,5 +351,119 @@ std::vector<NetResponse> NetResponse::decompose(NetResponse RESPONSE)
   return responses;
 }
 
+///////////////////////////////////////////////////////////////////
+void NetResponse::readBodyStream()
+{
+  if (!body_stream)
+    return;
+
+  auto producer = body_stream;
+  this->body_stream = nullptr;
+
+  this->body = std::make_shared<HeapMemory>();
+  producer([this](const Uint8* data, Int64 size) {
+    Int64 offset = this->body->c_size();
+    if (!this->body->resize(offset + size, __FILE__, __LINE__))
+      return false;
+    memcpy(this->body->c_ptr() + offset, data, size);
+    return true;
+  });
+
+  setContentLength(body->c_size());
+}
+
+///////////////////////////////////////////////////////////////////
+String NetResponse::getFrameHeader() const
+{
+  std::ostringstream headers;
+  for (auto it : this->headers)
+    headers << it.first << ": " << it.second << "\r\n";
+
+  auto HEADERS = headers.str();
+  return cstring(status, (Int64)HEADERS.size(), body ? body->c_size() : 0) + "\r\n" + HEADERS;
+}
+
+///////////////////////////////////////////////////////////////////
+void NetResponseFrameParser::emitFrame()
+{
+  NetResponse ret;
+  std::swap(ret, frame);
+  state = ReadingFrameHeader;
+  num_frames++;
+  on_frame(ret);
+}
+
+///////////////////////////////////////////////////////////////////
+bool NetResponseFrameParser::push(const Uint8* data, Int64 size)
+{
+  const Uint8* end = data + size;
+
+  while (!bMalformed && data < end)
+  {
+    if (state == ReadingFrameHeader)
+    {
+      //accumulate until "\r\n"
+      while (data < end && !StringUtils::endsWith(line, "\r\n"))
+        line.push_back((char)*data++);
+
+      if (!StringUtils::endsWith(line, "\r\n"))
+        return true;
+
+      std::istringstream parser(line);
+      line.clear();
+
+      parser >> frame.status >> headers_size >> body_size;
+      if (parser.fail() || headers_size < 0 || body_size < 0)
+        return !(bMalformed = true);
+
+      state = ReadingHeaders;
+      continue;
+    }
+
+    if (state == ReadingHeaders)
+    {
+      Int64 N = std::min(headers_size - (Int64)line.size(), (Int64)(end - data));
+      line.append((const char*)data, (size_t)N);
+      data += N;
+
+      if ((Int64)line.size() < headers_size)
+        return true;
+
+      for (auto it : StringUtils::split(line, "\r\n"))
+      {
+        auto sep = it.find(':');
+        if (sep != String::npos)
+          frame.setHeader(StringUtils::trim(it.substr(0, sep)), StringUtils::trim(it.substr(sep + 1)));
+      }
+      line.clear();
+
+      if (!body_size)
+      {
+        emitFrame();
+        continue;
+      }
+
+      frame.body = std::make_shared<HeapMemory>();
+      if (!frame.body->resize(body_size, __FILE__, __LINE__))
+        return !(bMalformed = true);
+
+      body_offset = 0;
+      state = ReadingBody;
+      continue;
+    }
+
+    //ReadingBody
+    Int64 N = std::min(body_size - body_offset, (Int64)(end - data));
+    memcpy(frame.body->c_ptr() + body_offset, data, (size_t)N);
+    body_offset += N;
+    data += N;
+
+    if (body_offset == body_size)
+      emitFrame();
+  }
+
+  return !bMalformed;
+}
+
 } //namespace Visus
 
@@ -91,6 +91,34 @@ bool NetServer::writeResponse(NetSocket* client, NetResponse response)
   response.setHeader("Connection", "Close");//in this debug version I don't keep the connections alive!
   response.setHeader("NetServer", "Visus debugging server");//just as double check
   response.setHeader("Access-Control-Allow-Origin", "*");//accept connections from localhost
+
+  //streamed body: send the headers now and each chunk as soon as it's produced (the body ends when the connection closes)
+  if (auto body_stream = response.body_stream)
+  {
+    response.body_stream = nullptr;
+    response.body.reset();
+    response.eraseHeader("Content-Length");
+
+    bool bOk;
+    {
+      Scheduler::BlockingScope blocking;
+      bOk = client->sendResponse(response);
+    }
+
+    if (bOk)
+    {
+      body_stream([&](const Uint8* data, Int64 size) {
+        Scheduler::BlockingScope blocking;
+        return bOk = bOk && client->sendBytes(data, size);
+      });
+    }
+
+    client->shutdownSend();
+    return bOk;
+  }
+
+  //waiting for the network, let other scheduler jobs run
+  Scheduler::BlockingScope blocking;
   client->sendResponse(response);
   client->shutdownSend();
   return true;
@@ -111,7 +139,7 @@ void NetServer::runInThisThread()
     return;
   }
 
-  auto thread_pool = std::make_shared<ThreadPool>("HttpServer Worker", nthreads);
+  auto thread_pool = std::make_shared<ThreadPool>("HttpServer Worker", nthreads, Scheduler::Interactive);
 
   //loop accept connections/handle operation
   while (!bExitThread)
@@ -127,7 +155,11 @@ void NetServer::runInThisThread()
         }
         else
         {
-          NetRequest request = client->receiveRequest();
+          NetRequest request;
+          {
+            Scheduler::BlockingScope blocking;
+            request = client->receiveRequest();
+          }
           if (!request.valid())
           {
             writeResponse(client.get(), NetResponse(HttpStatus::STATUS_BAD_REQUEST));
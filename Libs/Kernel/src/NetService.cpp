@@ -42,6 +42,7 @@ For support : support@visus.net
 #include <Visus/File.h>
 #include <Visus/StringTree.h>
 #include <Visus/Thread.h>
+#include <Visus/Trace.h>
 
 #include <thread>
 #include <list>
@@ -73,6 +74,7 @@ public:
   Promise<NetResponse>             promise;
   NetResponse                      response;
   bool                             first_byte = false;
+  Int64                            trace_begin = 0;
 
   CURLM*                           multi_handle;
   CURL*                            handle = nullptr;
@@ -237,6 +239,13 @@ public:
     size_t tot = size * nmemb;
     NetService::global_stats()->wbytes+=tot;
 
+    //the caller consumes the body while it's downloading
+    if (connection->request.body_received)
+    {
+      connection->request.body_received((const Uint8*)chunk, (Int64)tot);
+      return tot;
+    }
+
     Int64 oldsize = connection->response.body->c_size();
     if (!connection->response.body->resize(oldsize + tot, __FILE__, __LINE__))
     {
@@ -251,6 +260,10 @@ public:
   {
     connection->first_byte = true;
 
+    //example: POST without a body
+    if (!connection->request.body)
+      return 0;
+
     size_t& offset = connection->buffer_offset;
     size_t tot = std::min((size_t)connection->request.body->c_size() - offset, size * nmemb);
     NetService::global_stats()->rbytes+=tot;
@@ -331,8 +344,22 @@ public:
           long response_code = 0;
           curl_easy_getinfo(msg->easy_handle, CURLINFO_RESPONSE_CODE, &response_code);
 
-          //in case the request fails before being sent, the response_code is zero. 
-          connection->response.status = response_code ? response_code : HttpStatus::STATUS_BAD_REQUEST;
+          //in case the request fails before getting a response, the response_code is zero
+          //(mapped to the connection statuses, so that it can be told apart from an error returned by the server)
+          if (response_code)
+            connection->response.status = (int)response_code;
+          else if (msg->data.result == CURLE_OK)
+            connection->response.status = HttpStatus::STATUS_BAD_REQUEST;
+          else if (msg->data.result == CURLE_COULDNT_RESOLVE_HOST)
+            connection->response.status = HttpStatus::STATUS_CANT_RESOLVE;
+          else if (msg->data.result == CURLE_COULDNT_RESOLVE_PROXY)
+            connection->response.status = HttpStatus::STATUS_CANT_RESOLVE_PROXY;
+          else if (msg->data.result == CURLE_COULDNT_CONNECT)
+            connection->response.status = HttpStatus::STATUS_CANT_CONNECT;
+          else if (msg->data.result == CURLE_SSL_CONNECT_ERROR)
+            connection->response.status = HttpStatus::STATUS_SSL_FAILED;
+          else
+            connection->response.status = HttpStatus::STATUS_IO_ERROR;
 
           if (msg->data.result != CURLE_OK)
             connection->response.setErrorMessage(String(connection->errbuf));
@@ -445,6 +472,7 @@ public:
 
           request->statistics.wait_msec = wait_msec;
           request->statistics.run_t1 = Time::now();
+          connection->trace_begin = Trace::isEnabled() ? Trace::now() : 0;
           connection->first_byte = false;
           connection->setNetRequest(*request, promise);
         }
@@ -472,6 +500,9 @@ public:
 
           connection->request.statistics.run_msec = (int)connection->request.statistics.run_t1.elapsedMsec();
 
+          if (connection->trace_begin)
+            Trace::addEvent("net", "NetService::request", connection->trace_begin, Trace::now());
+
           if (owner->verbose > 0 && !connection->request.aborted())
             owner->printStatistics(connection->id, connection->request, connection->response);
 
@@ -313,6 +313,28 @@ public:
     return response;
   }
 
+  //sendBytes
+  bool sendBytes(const unsigned char *buf, int len)
+  {
+    if (socketfd<0) 
+      return false;
+
+    int flags=0;
+  
+    while (len)
+    {
+      int n = (int)::send(socketfd, (const char*)buf, len, flags);
+      if (n <= 0)
+      {
+        PrintError("Failed to send data to socket errdescr",getSocketErrorDescription(n));
+        return false;
+      }
+      buf += n;
+      len -= n;
+    }
+    return true;
+  }
+
 private:
 
   //configureOptions
@@ -347,28 +369,6 @@ private:
     setsockopt(this->socketfd, SOL_SOCKET, SO_RCVBUF, (const char*)&value, sizeof(value));
   }
 
-  //sendBytes
-  bool sendBytes(const unsigned char *buf, int len)
-  {
-    if (socketfd<0) 
-      return false;
-
-    int flags=0;
-  
-    while (len)
-    {
-      int n = (int)::send(socketfd, (const char*)buf, len, flags);
-      if (n <= 0)
-      {
-        PrintError("Failed to send data to socket errdescr",getSocketErrorDescription(n));
-        return false;
-      }
-      buf += n;
-      len -= n;
-    }
-    return true;
-  }
-
   //receiveBytes
   bool receiveBytes(unsigned char *buf, int len)
   {
@@ -480,6 +480,10 @@ bool NetSocket::sendResponse(NetResponse response) {
   return pimpl->sendResponse(response);
 }
 
+bool NetSocket::sendBytes(const Uint8* buffer, Int64 size) {
+  return pimpl->sendBytes(buffer, (int)size);
+}
+
 NetRequest NetSocket::receiveRequest() {
   return pimpl->receiveRequest();
 }
@@ -37,10 +37,13 @@ For support : support@visus.net
 -----------------------------------------------------------------------------*/
 
 #include <Visus/RamResource.h>
+#include <Visus/HeapMemory.h>
 #include <Visus/Utils.h>
 #include <Visus/StringTree.h>
 #include <Visus/StringUtils.h>
 
+#include <chrono>
+
 #if WIN32
 #include <Windows.h>
 #include <Psapi.h>
@@ -67,6 +70,7 @@ VISUS_IMPLEMENT_SINGLETON_CLASS(RamResource)
 
 ///////////////////////////////////////////////////////////////////////////
 RamResource::RamResource() 
+  : heap_memory(0), sampled_used_memory(0), sampled_heap_memory(0), sampled_time(0)
 {
   //os_total_memory
   {
@@ -128,6 +132,11 @@ Int64 RamResource::getVisusUsedMemory() const
   #endif
 }
 
+///////////////////////////////////////////////////////////////////////////
+Int64 RamResource::getPooledMemory() const {
+  return HeapMemory::getPooledMemory();
+}
+
 ///////////////////////////////////////////////////////////////////////////
 Int64 RamResource::getOsUsedMemory() const
 {
@@ -186,40 +195,66 @@ void RamResource::setOsTotalMemory(Int64 value)
   os_total_memory=value;
 }
 
+//////////////////////////////////////////////////////////////////
+void RamResource::sampleUsedMemory()
+{
+  //only one thread at a time, the others go on with the previous sample
+  if (!sample_lock.try_lock())
+    return;
+
+  Int64 heap = heap_memory;
+  sampled_used_memory = getVisusUsedMemory();
+  sampled_heap_memory = heap;
+  sampled_time = (Int64)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  sample_lock.unlock();
+}
+
 //////////////////////////////////////////////////////////////////
 bool RamResource::allocateMemory(Int64 reqsize)
 {
   VisusAssert(reqsize>=0);
 
+  if (!reqsize)
+    return true;
+
+  Int64 heap = (heap_memory += reqsize);
+
   //NOTE if os_total_memory==0 means that no limit is imposed by the visus.config
-  if (!reqsize || !os_total_memory)
-  {
+  if (!os_total_memory)
     return true;
-  }
-  else
+
+  //reading the OS counters is expensive: estimate the used memory from the last sample plus what has been allocated since then
+  const Int64 max_sample_age = 1000;
+  Int64 limit = (Int64)(getOsTotalMemory() * 0.80);
+  Int64 now = (Int64)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  Int64 estimated = sampled_used_memory + (heap - sampled_heap_memory);
+
+  if (estimated <= limit && (now - sampled_time) < max_sample_age)
+    return true;
+
+  sampleUsedMemory();
+  estimated = sampled_used_memory + (heap_memory - sampled_heap_memory);
+  if (estimated > limit)
   {
-    ScopedLock lock(this->lock);
-    Int64 os_free_memory=((Int64)(getOsTotalMemory()*0.80))-getVisusUsedMemory();
-    if (reqsize>os_free_memory)
-    {
 #if 0
-      PrintWarning("RamResource out of memory ",
-                    "reqsize(",StringUtils::getStringFromByteSize(reqsize),
-                    "visus_used_memory", StringUtils::getStringFromByteSize(getVisusUsedMemory()),
-                    "os_used_memory", StringUtils::getStringFromByteSize(getOsUsedMemory()),
-                    "os_total_memory", StringUtils::getStringFromByteSize(getOsTotalMemory()),
-                    "visus_free_memory", StringUtils::getStringFromByteSize(os_free_memory));
+    PrintWarning("RamResource out of memory ",
+                  "reqsize(",StringUtils::getStringFromByteSize(reqsize),
+                  "visus_used_memory", StringUtils::getStringFromByteSize(getVisusUsedMemory()),
+                  "os_used_memory", StringUtils::getStringFromByteSize(getOsUsedMemory()),
+                  "os_total_memory", StringUtils::getStringFromByteSize(getOsTotalMemory()));
 #endif
-      return false;
-    }
-    return true;
+    heap_memory -= reqsize;
+    return false;
   }
+
+  return true;
 }
 
 //////////////////////////////////////////////////////////////////
 bool RamResource::freeMemory(Int64 reqsize)
 {
   VisusAssert(reqsize>=0);
+  heap_memory -= reqsize;
   return true;
 }
 
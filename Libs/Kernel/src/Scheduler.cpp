@@ -0,0 +1,456 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/Scheduler.h>
+#include <Visus/Utils.h>
+
+namespace Visus {
+
+VISUS_IMPLEMENT_SINGLETON_CLASS(Scheduler)
+
+////////////////////////////////////////////////////////////
+class Scheduler::Worker
+{
+public:
+
+  Scheduler*       owner;
+  int              index; //-1 for the injection queue and for spare workers
+  CriticalSection  lock;
+  std::deque<Job>  jobs[NumPriorities];
+
+  //constructor
+  Worker(Scheduler* owner_, int index_) : owner(owner_), index(index_) {
+  }
+
+  //popBack (owner side)
+  bool popBack(int priority, Job& job)
+  {
+    ScopedLock lock(this->lock);
+    auto& deque = jobs[priority];
+    if (deque.empty()) return false;
+    job = std::move(deque.back());
+    deque.pop_back();
+    return true;
+  }
+
+  //popFront (thief side)
+  bool popFront(int priority, Job& job)
+  {
+    ScopedLock lock(this->lock);
+    auto& deque = jobs[priority];
+    if (deque.empty()) return false;
+    job = std::move(deque.front());
+    deque.pop_front();
+    return true;
+  }
+
+};
+
+static thread_local Scheduler::Worker* __current_worker__ = nullptr;
+static thread_local int                __blocking_depth__ = 0;
+
+////////////////////////////////////////////////////////////
+Scheduler::Scheduler(int num_workers) 
+  : num_pending(0), num_sleeping(0), num_blocked(0), num_spares(0)
+{
+  if (num_workers <= 0)
+    num_workers = std::max(2, (int)std::thread::hardware_concurrency());
+
+  for (int P = 0; P < NumPriorities; P++)
+    num_pending_by_priority[P] = 0;
+
+  injection = new Worker(this, -1);
+
+  for (int I = 0; I < num_workers; I++)
+    workers.push_back(new Worker(this, I));
+
+  for (auto worker : workers)
+  {
+    threads.push_back(Thread::start("Scheduler Worker " + cstring(worker->index), [this, worker]() {
+      workerEntryProc(worker);
+    }));
+  }
+}
+
+////////////////////////////////////////////////////////////
+Scheduler::~Scheduler()
+{
+  //the timer pushes the remaining delayed jobs, they run as the others
+  {
+    ScopedLock lock(delayed_lock);
+    bExitTimer = true;
+    delayed_cond.notify_all();
+  }
+
+  if (timer_thread)
+    Thread::join(timer_thread);
+
+  {
+    ScopedLock lock(sleep_lock);
+    bExit = true;
+    sleep_cond.notify_all();
+  }
+
+  for (auto thread : threads)
+    Thread::join(thread);
+
+  while (num_spares > 0)
+    Thread::sleep(10);
+
+  VisusAssert(num_pending == 0);
+
+  for (auto worker : workers)
+    delete worker;
+
+  delete injection;
+}
+
+////////////////////////////////////////////////////////////
+bool Scheduler::isWorkerThread() {
+  return __current_worker__ ? true : false;
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::wakeUp()
+{
+  if (num_sleeping > 0)
+  {
+    ScopedLock lock(sleep_lock);
+    sleep_cond.notify_one();
+  }
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::push(Job job, int priority)
+{
+  VisusAssert(job);
+  priority = Utils::clamp(priority, 0, NumPriorities - 1);
+
+  //jobs pushed by a worker go to its own deque, otherwise to the injection queue
+  auto worker = __current_worker__;
+  auto target = (worker && worker->owner == this && worker->index >= 0) ? worker : injection;
+
+  //increment before pushing so that the counters never go negative
+  ++num_pending_by_priority[priority];
+  ++num_pending;
+
+  {
+    ScopedLock lock(target->lock);
+    target->jobs[priority].push_back(std::move(job));
+  }
+
+  wakeUp();
+
+  //all running workers could be blocked waiting for this job
+  if (num_blocked > 0)
+    startSpareIfNeeded();
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::pushDelayed(Job job, int msec, int priority)
+{
+  VisusAssert(job);
+
+  ScopedLock lock(delayed_lock);
+  if (bExitTimer)
+    return push(job, priority);
+
+  if (!timer_thread)
+    timer_thread = Thread::start("Scheduler Timer", [this]() { timerEntryProc(); });
+
+  delayed.insert(std::make_pair(std::chrono::steady_clock::now() + std::chrono::milliseconds(std::max(msec, 0)), std::make_pair(std::move(job), priority)));
+  delayed_cond.notify_all();
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::timerEntryProc()
+{
+  std::unique_lock<CriticalSection> lock(delayed_lock);
+
+  while (!bExitTimer)
+  {
+    if (delayed.empty())
+    {
+      delayed_cond.wait(lock);
+      continue;
+    }
+
+    auto due = delayed.begin()->first;
+    if (std::chrono::steady_clock::now() < due)
+    {
+      delayed_cond.wait_until(lock, due);
+      continue;
+    }
+
+    auto job = std::move(delayed.begin()->second);
+    delayed.erase(delayed.begin());
+
+    lock.unlock();
+    push(std::move(job.first), job.second);
+    lock.lock();
+  }
+
+  //exiting, nothing is delayed anymore
+  auto jobs = std::move(delayed);
+  delayed.clear();
+  lock.unlock();
+
+  for (auto& it : jobs)
+    push(std::move(it.second.first), it.second.second);
+}
+
+////////////////////////////////////////////////////////////
+bool Scheduler::popJob(Worker* worker, Job& job)
+{
+  const int N = (int)workers.size();
+
+  for (int P = 0; P < NumPriorities; P++)
+  {
+    if (num_pending_by_priority[P] <= 0)
+      continue;
+
+    bool bFound =
+      (worker->index >= 0 && worker->popBack(P, job)) ||
+      injection->popFront(P, job);
+
+    //steal, starting from the next worker to spread the contention
+    for (int K = 1; !bFound && K <= N; K++)
+    {
+      auto victim = workers[(std::max(worker->index, 0) + K) % N];
+      if (victim != worker)
+        bFound = victim->popFront(P, job);
+    }
+
+    if (bFound)
+    {
+      --num_pending_by_priority[P];
+      --num_pending;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::workerEntryProc(Worker* worker)
+{
+  __current_worker__ = worker;
+
+  bool bSpare = worker->index < 0;
+
+  Job job;
+  while (true)
+  {
+    if (popJob(worker, job))
+    {
+      job();
+      job = Job();
+      continue;
+    }
+
+    std::unique_lock<CriticalSection> lock(sleep_lock);
+
+    //note: num_sleeping must be incremented before checking num_pending (see wakeUp)
+    ++num_sleeping;
+
+    if (num_pending > 0)
+    {
+      --num_sleeping;
+      continue;
+    }
+
+    if (bExit)
+    {
+      --num_sleeping;
+      break;
+    }
+
+    //a spare is not needed anymore when no more workers are blocked
+    if (bSpare && num_spares > num_blocked)
+    {
+      --num_sleeping;
+      break;
+    }
+
+    if (bSpare)
+      sleep_cond.wait_for(lock, std::chrono::milliseconds(100));
+    else
+      sleep_cond.wait(lock);
+
+    --num_sleeping;
+  }
+
+  __current_worker__ = nullptr;
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::startSpareIfNeeded()
+{
+  //a spare is needed only if there are jobs nobody can run (i.e. no sleeping worker and blocked workers not compensated)
+  if (num_pending <= 0 || num_sleeping > 0 || num_spares >= num_blocked)
+    return;
+
+  //never more spares than blocked workers (a cap below that could starve jobs waiting for other jobs)
+  if (++num_spares > num_blocked)
+  {
+    --num_spares;
+    return;
+  }
+
+  auto spare = new Worker(this, -1);
+  auto thread = Thread::start("Scheduler Spare Worker", [this, spare]() {
+    workerEntryProc(spare);
+    delete spare;
+    --num_spares;
+  });
+  thread->detach();
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::beginBlocking()
+{
+  auto worker = __current_worker__;
+  if (!worker || __blocking_depth__++)
+    return;
+
+  //keep getNumWorkers() threads able to run jobs (see also push)
+  auto owner = worker->owner;
+  ++owner->num_blocked;
+  owner->startSpareIfNeeded();
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::endBlocking()
+{
+  auto worker = __current_worker__;
+  if (!worker || --__blocking_depth__)
+    return;
+
+  --worker->owner->num_blocked;
+}
+
+////////////////////////////////////////////////////////////
+void Scheduler::parallelFor(Int64 A, Int64 B, std::function<void(Int64)> fn, int priority, Int64 grain)
+{
+  if (B <= A)
+    return;
+
+  grain = std::max(grain, (Int64)1);
+  Int64 nchunks = (B - A + grain - 1) / grain;
+
+  //not worth to go parallel
+  if (nchunks == 1 || workers.size() <= 1)
+  {
+    for (Int64 I = A; I < B; I++)
+      fn(I);
+    return;
+  }
+
+  //___________________________________________
+  class Loop
+  {
+  public:
+    std::function<void(Int64)> fn;
+    Int64                      A, B, grain, nchunks;
+    std::atomic<Int64>         next, ndone;
+    CriticalSection            lock;
+    std::condition_variable    done;
+    std::exception_ptr         error;
+    std::atomic<bool>          bFailed;
+
+    Loop() : next(0), ndone(0), bFailed(false) {}
+
+    //run (chunks are claimed one by one, whoever comes first)
+    void run()
+    {
+      Int64 count = 0;
+      for (Int64 C = next++; C < nchunks; C = next++, count++)
+      {
+        //after an exception the remaining chunks are just counted as done
+        if (bFailed)
+          continue;
+
+        try
+        {
+          for (Int64 I = A + C * grain, End = std::min(B, A + (C + 1) * grain); I < End; I++)
+            fn(I);
+        }
+        catch (...)
+        {
+          ScopedLock lock(this->lock);
+          if (!error)
+            error = std::current_exception();
+          bFailed = true;
+        }
+      }
+
+      if (count && (ndone += count) == nchunks)
+      {
+        ScopedLock lock(this->lock);
+        done.notify_all();
+      }
+    }
+  };
+
+  auto loop = std::make_shared<Loop>();
+  loop->fn = fn;
+  loop->A = A;
+  loop->B = B;
+  loop->grain = grain;
+  loop->nchunks = nchunks;
+
+  //the calling thread takes part in the loop, helpers arriving late will find no chunk
+  Int64 nhelpers = std::min((Int64)workers.size(), nchunks) - 1;
+  for (Int64 I = 0; I < nhelpers; I++)
+    push([loop]() { loop->run(); }, priority);
+
+  loop->run();
+
+  //just wait for the chunks already running on other threads (no need to compensate)
+  {
+    std::unique_lock<CriticalSection> lock(loop->lock);
+    loop->done.wait(lock, [&loop]() {return loop->ndone == loop->nchunks; });
+  }
+
+  if (loop->error)
+    std::rethrow_exception(loop->error);
+}
+
+} //namespace Visus
+
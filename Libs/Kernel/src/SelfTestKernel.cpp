@@ -0,0 +1,285 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/ArrayUtils.h>
+#include <Visus/KdArray.h>
+#include <Visus/LatencyHistogram.h>
+#include <Visus/MarchingCubes.h>
+#include <Visus/TransferFunction.h>
+
+namespace Visus {
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestTransferFunction()
+{
+  //one linear and one non linear function
+  auto tf = std::make_shared<TransferFunction>();
+  std::vector<double> ramp(256), bump(256);
+  for (int I = 0; I < 256; I++)
+  {
+    double x = I / 255.0;
+    ramp[I] = x;
+    bump[I] = std::sin(x * 3.14159265358979) * std::sin(x * 3.14159265358979);
+  }
+  tf->addFunction(std::make_shared<SingleTransferFunction>("Red"  , Colors::Red  , ramp));
+  tf->addFunction(std::make_shared<SingleTransferFunction>("Green", Colors::Green, bump));
+
+  auto maxDiff = [](Array a, Array b) {
+    VisusReleaseAssert(a && b && a.dims == b.dims && a.dtype == b.dtype && a.c_size() == b.c_size());
+    int ret = 0;
+    for (Int64 I = 0; I < a.c_size(); I++)
+      ret = std::max(ret, std::abs((int)a.c_ptr()[I] - (int)b.c_ptr()[I]));
+    return ret;
+  };
+
+  //float input: the quantized table must be within one unit of the per-sample evaluation
+  const Int64 N = 100000;
+  Array src(N, DTypes::FLOAT32);
+  for (Int64 I = 0; I < N; I++)
+    ((float*)src.c_ptr())[I] = (float)std::cos(I * 0.001) * 1000.0f;
+
+  auto exact = ArrayUtils::applyTransferFunction(tf, src, Aborted(), /*bExact*/true);
+  auto table = ArrayUtils::applyTransferFunction(tf, src);
+  VisusReleaseAssert(exact.dtype == DType(2, DTypes::UINT8));
+  VisusReleaseAssert(maxDiff(table, exact) <= 1);
+
+  //the transfer function can ask for the exact evaluation too
+  tf->setExact(true);
+  VisusReleaseAssert(maxDiff(ArrayUtils::applyTransferFunction(tf, src), exact) == 0);
+  tf->setExact(false);
+
+  //a supplied input range replaces the range computation
+  auto range = ArrayUtils::computeRange(src, 0);
+  VisusReleaseAssert(maxDiff(ArrayUtils::applyTransferFunction(tf, src, Aborted(), false, range), table) == 0);
+  auto half = ArrayUtils::applyTransferFunction(tf, src, Aborted(), true, Range(range.from, 2 * range.to - range.from, 0));
+  VisusReleaseAssert(maxDiff(half, exact) > 0);
+
+  //16 bit input: the table has one entry for each value, so it is exact
+  Array src16(N, DTypes::UINT16), src16f(N, DTypes::FLOAT32);
+  for (Int64 I = 0; I < N; I++)
+    ((float*)src16f.c_ptr())[I] = ((Uint16*)src16.c_ptr())[I] = (Uint16)((I * 7919) & 0xffff);
+
+  auto range16 = Range(0, 65535, 1);
+  VisusReleaseAssert(maxDiff(ArrayUtils::applyTransferFunction(tf, src16, Aborted(), false, range16), ArrayUtils::applyTransferFunction(tf, src16f, Aborted(), true, range16)) == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestMarchingCubes()
+{
+  //sphere of radius 6 in a 16^3 grid
+  const int N = 16;
+  const double isovalue = 36.0;
+  Array data(PointNi(N, N, N), DTypes::FLOAT32);
+  auto value = [&](int x, int y, int z) {
+    return (float)((x - 7.5) * (x - 7.5) + (y - 7.5) * (y - 7.5) + (z - 7.5) * (z - 7.5));
+  };
+
+  Int64 I = 0;
+  for (int z = 0; z < N; z++)
+    for (int y = 0; y < N; y++)
+      for (int x = 0; x < N; x++)
+        ((float*)data.c_ptr())[I++] = value(x, y, z);
+
+  //one vertex for each grid edge crossing the surface, a closed genus 0 triangulation has 2*V-4 triangles
+  Int64 nvertices = 0;
+  for (int z = 0; z < N; z++)
+    for (int y = 0; y < N; y++)
+      for (int x = 0; x < N; x++)
+      {
+        bool inside = value(x, y, z) < isovalue;
+        if (x + 1 < N && inside != (value(x + 1, y, z) < isovalue)) nvertices++;
+        if (y + 1 < N && inside != (value(x, y + 1, z) < isovalue)) nvertices++;
+        if (z + 1 < N && inside != (value(x, y, z + 1) < isovalue)) nvertices++;
+      }
+  VisusReleaseAssert(nvertices == 672);
+
+  //the result must not depend on the block decomposition
+  for (auto block_size : { 1, 3, 16 })
+  {
+    MarchingCubes marching_cubes(data, isovalue);
+    marching_cubes.block_size = block_size;
+    auto surface = marching_cubes.run();
+    VisusReleaseAssert(surface);
+    VisusReleaseAssert((Int64)surface->vertices.size() == nvertices);
+    VisusReleaseAssert(surface->getNumberOfTriangles() == 2 * nvertices - 4);
+
+    //closed: each edge is shared by exactly two triangles
+    std::map< std::pair<Uint32, Uint32>, int> edges;
+    for (Int64 T = 0; T < surface->getNumberOfTriangles(); T++)
+    {
+      for (int K = 0; K < 3; K++)
+      {
+        auto a = surface->triangles[T * 3 + K];
+        auto b = surface->triangles[T * 3 + (K + 1) % 3];
+        VisusReleaseAssert(a != b && a < surface->vertices.size() && b < surface->vertices.size());
+        edges[std::make_pair(std::min(a, b), std::max(a, b))]++;
+      }
+    }
+
+    for (auto it : edges)
+      VisusReleaseAssert(it.second == 2);
+
+    //vertices on the sphere (up to the linear interpolation error)
+    for (auto it : surface->vertices)
+    {
+      auto r = std::sqrt((it[0] - 7.5) * (it[0] - 7.5) + (it[1] - 7.5) * (it[1] - 7.5) + (it[2] - 7.5) * (it[2] - 7.5));
+      VisusReleaseAssert(std::fabs(r - 6.0) < 0.05);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestKdArrayCache()
+{
+  const Int64 block_size = 1024;
+  KdArrayCache cache(3 * block_size);
+
+  auto createNode = [&](BigInt id) {
+    auto ret = std::make_shared<KdArrayNode>(id);
+    VisusReleaseAssert(ret->blockdata.resize(block_size, DTypes::UINT8, __FILE__, __LINE__));
+    return ret;
+  };
+
+  auto canRestore = [&](String key, BigInt id) {
+    KdArrayNode node(id);
+    return cache.restore(key, &node);
+  };
+
+  std::vector< SharedPtr<KdArrayNode> > nodes;
+  for (int I = 1; I <= 4; I++)
+    nodes.push_back(createNode(I));
+
+  for (int I = 0; I < 3; I++)
+    cache.store("a", nodes[I].get());
+
+  //hit (buffers are shared, not copied), the key is part of the identity
+  KdArrayNode restored(1);
+  VisusReleaseAssert(cache.restore("a", &restored) && restored.blockdata.heap == nodes[0]->blockdata.heap);
+  VisusReleaseAssert(!canRestore("b", 1));
+  VisusReleaseAssert(cache.getStatistics().num_hits == 1 && cache.getStatistics().num_misses == 1);
+
+  //eviction at the byte cap: node 2 is the least recently used (node 1 has just been restored)
+  cache.store("a", nodes[3].get());
+  auto stats = cache.getStatistics();
+  VisusReleaseAssert(stats.num_evictions == 1 && stats.num_entries == 3 && stats.used_memory == 3 * block_size);
+  VisusReleaseAssert(canRestore("a", 1) && !canRestore("a", 2) && canRestore("a", 3) && canRestore("a", 4));
+
+  //a node bigger than the cap is not cached
+  auto big = std::make_shared<KdArrayNode>(5);
+  VisusReleaseAssert(big->blockdata.resize(4 * block_size, DTypes::UINT8, __FILE__, __LINE__));
+  cache.store("a", big.get());
+  VisusReleaseAssert(!canRestore("a", 5) && cache.getStatistics().used_memory == 3 * block_size);
+
+  //invalidation
+  cache.clear();
+  stats = cache.getStatistics();
+  VisusReleaseAssert(stats.num_entries == 0 && stats.used_memory == 0);
+  VisusReleaseAssert(!canRestore("a", 1) && !canRestore("a", 3) && !canRestore("a", 4));
+
+  //still usable after the invalidation
+  cache.store("a", nodes[1].get());
+  VisusReleaseAssert(canRestore("a", 2) && cache.getStatistics().used_memory == block_size);
+}
+
+////////////////////////////////////////////////////////////////////////////////////
+static void SelfTestLatencyHistogram()
+{
+  //powers of two are the last value of their bucket
+  for (int K = 0; K < LatencyHistogram::MaxBits; K++)
+  {
+    Int64 value = (Int64)1 << K;
+    VisusReleaseAssert(LatencyHistogram::getBucketUpperBound(LatencyHistogram::getBucket(value)) == value);
+    VisusReleaseAssert(LatencyHistogram::getBucket(value + 1) == LatencyHistogram::getBucket(value) + 1);
+  }
+
+  LatencyHistogram histogram;
+  for (auto usec : { 0, 1, 2, 8, 9, 127, 128, 129, 255, 256, 257, 1 << 20 })
+    histogram.record(usec);
+  histogram.record((Int64)1 << 50);
+
+  VisusReleaseAssert(histogram.getCount() == 13);
+  VisusReleaseAssert(histogram.getCountAtMost(1) == 2);
+  VisusReleaseAssert(histogram.getCountAtMost(2) == 3);
+  VisusReleaseAssert(histogram.getCountAtMost(8) == 4);
+  VisusReleaseAssert(histogram.getCountAtMost(128) == 7);
+  VisusReleaseAssert(histogram.getCountAtMost(256) == 10);
+  VisusReleaseAssert(histogram.getCountAtMost((Int64)1 << 20) == 12);
+  VisusReleaseAssert(histogram.getCountAtMost(std::numeric_limits<Int64>::max()) == 13);
+
+  //quantiles within the relative error
+  LatencyHistogram constant;
+  for (int I = 0; I < 100; I++)
+    constant.record(1000);
+  for (auto q : { 0.0, 0.5, 1.0 })
+    VisusReleaseAssert(std::abs(constant.getQuantile(q) - 1000) <= 1000 / LatencyHistogram::SubBuckets);
+
+  //exported text (values equal to a le boundary are in the bucket)
+  LatencyHistogram exported;
+  for (auto usec : { 100, 128, 129, 1000000 })
+    exported.record(usec);
+
+  auto text = exported.toPrometheus("visus_test_seconds", "action=\"read\"", 7, 8);
+  VisusReleaseAssert(text ==
+    "visus_test_seconds_bucket{action=\"read\",le=\"0.000128\"} 2\n"
+    "visus_test_seconds_bucket{action=\"read\",le=\"0.000256\"} 3\n"
+    "visus_test_seconds_bucket{action=\"read\",le=\"+Inf\"} 4\n"
+    "visus_test_seconds_sum{action=\"read\"} 1.000357\n"
+    "visus_test_seconds_count{action=\"read\"} 4\n");
+}
+
+/////////////////////////////////////////////////////
+void SelfTestKernel()
+{
+  PrintInfo("Running transfer function self test...");
+  SelfTestTransferFunction();
+  PrintInfo("...done");
+
+  PrintInfo("Running latency histogram self test...");
+  SelfTestLatencyHistogram();
+  PrintInfo("...done");
+
+  PrintInfo("Running kdarray cache self test...");
+  SelfTestKdArrayCache();
+  PrintInfo("...done");
+
+  PrintInfo("Running marching cubes self test...");
+  SelfTestMarchingCubes();
+  PrintInfo("...done");
+}
+
+} //namespace Visus
@@ -37,6 +37,7 @@ For support : support@visus.net
 -----------------------------------------------------------------------------*/
 
 #include <Visus/Semaphore.h>
+#include <Visus/Scheduler.h>
 
 #if WIN32
 #include <Windows.h>
@@ -184,6 +185,11 @@ Semaphore::~Semaphore(){
 }
 
 void Semaphore::down(){
+  if (pimpl->tryDown())
+    return;
+
+  //a scheduler job is going to wait, let another thread run jobs in the meantime
+  Scheduler::BlockingScope blocking;
   pimpl->down();
 }
 
@@ -37,6 +37,7 @@ For support : support@visus.net
 -----------------------------------------------------------------------------*/
 
 #include <Visus/Thread.h>
+#include <Visus/Trace.h>
 
 
 namespace Visus {
@@ -48,6 +49,7 @@ SharedPtr<std::thread> Thread::start(String thread_name,std::function<void()> en
   
   return std::make_shared<std::thread>(([entry_proc, thread_name]()
   {
+    Trace::setThreadName(thread_name);
     entry_proc(); 
     --Thread::global_stats()->running_threads;
   }));
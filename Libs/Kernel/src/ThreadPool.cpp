@@ -41,129 +41,99 @@ For support : support@visus.net
 namespace Visus {
 
 ////////////////////////////////////////////////////////////
-ThreadPool::ThreadPool(String basename,int num_workers) 
-  : nwaiting(0)
+ThreadPool::ThreadPool(String basename_,int num_workers_,int priority_) 
+  : basename(basename_),num_workers(std::max(1,num_workers_)),priority(priority_)
 {
-  for (int I=0;I<num_workers;I++)
-  {
-    String thread_name = basename + " " + cstring(I);
-
-    this->threads.push_back(Thread::start(thread_name, [this,I]() {
-      workerEntryProc(I);
-    }));
-  }
 }
 
 ////////////////////////////////////////////////////////////
 ThreadPool::~ThreadPool()
 {
-  //each worker should get only one!
-  for (auto thread : threads)
-    asyncRun(std::function<void()>());
-
-  for (auto thread : threads) 
-    Thread::join(thread);
-
-  #ifdef _DEBUG
-  {
-    ScopedLock lock(this->lock);
-    int total_jobs=(int)waiting.size()+(int)running.size();
-    VisusAssert(total_jobs==0);
-  }
-  #endif
+  waitAll();
 }
 
-
 ////////////////////////////////////////////////////////////
-void ThreadPool::asyncRun(std::function<void()> run)
+void ThreadPool::asyncRun(std::function<void()> fn)
 {
-  {
-    ScopedLock lock(wait_all.lock);
-    wait_all.num_inside++;
-  }
-
   ThreadPool::global_stats()->running_jobs++;
 
-  {
-    ScopedLock lock(this->lock);
-    waiting.push_back(std::make_shared<std::function<void()>>(run));
-  }
-
-  nwaiting.up();
-}
+  //null before KernelModule::attach or after KernelModule::detach
+  auto scheduler = Scheduler::getSingleton();
 
-////////////////////////////////////////////////////////////
-void ThreadPool::push(SharedPtr<ThreadPool> pool, std::function<void()> fn) {
-  if (pool)
-    pool->asyncRun(fn);
-  else
-    fn();
-}
-
-
-////////////////////////////////////////////////////////////
-void ThreadPool::waitAll() {
-  while (true)
+  bool bDrain = false;
   {
+    ScopedLock lock(this->lock);
+    waiting.push_back(fn);
+    ++num_pending;
+    if (num_running < num_workers || !scheduler)
     {
-      ScopedLock lock(wait_all.lock);
-      if (!wait_all.num_inside)
-        return;
+      ++num_running;
+      bDrain = true;
     }
+  }
 
-    wait_all.num_done.down();
-
-    {
-      ScopedLock lock(wait_all.lock);
-      --wait_all.num_inside;
-    }
+  if (!bDrain)
+    return;
 
-  }
-};
+  if (!scheduler)
+    return drain();
 
+  scheduler->push([this]() {
+    drain();
+  }, priority);
+}
 
 ////////////////////////////////////////////////////////////
-void ThreadPool::workerEntryProc(int worker)
+void ThreadPool::drain()
 {
+  std::function<void()> fn;
   while (true)
   {
-    this->nwaiting.down();
-
-    //waiting->running
-    SharedPtr<std::function<void()> > fn;
     {
       ScopedLock lock(this->lock);
-      fn = this->waiting.front();
-      this->waiting.pop_front();
-      this->running.insert(fn);
-    }
 
-    bool bExit = *fn ? false : true;
-
-    if (!bExit)
-      (*fn)();
-
-    //remove from running
-    {
-      ScopedLock lock(this->lock);
-      VisusAssert(running.find(fn) != running.end());
-      this->running.erase(fn);
-    }
-
-    ThreadPool::global_stats()->running_jobs--;
+      if (fn)
+      {
+        ThreadPool::global_stats()->running_jobs--;
+        --num_pending;
+      }
+
+      if (waiting.empty())
+      {
+        //note: must be the last time I access 'this' (see waitAll)
+        --num_running;
+        if (!num_pending && !num_running)
+          all_done.notify_all();
+        return;
+      }
 
-    //for the wait all function
-    {
-      ScopedLock lock(wait_all.lock);
-      wait_all.num_done.up();
+      fn = waiting.front();
+      waiting.pop_front();
     }
 
-    if (bExit)
-      break;
+    fn();
   }
 }
 
+////////////////////////////////////////////////////////////
+void ThreadPool::push(SharedPtr<ThreadPool> pool, std::function<void()> fn) {
+  if (pool)
+    pool->asyncRun(fn);
+  else
+    fn();
+}
 
-} //namespace Visus
-
+////////////////////////////////////////////////////////////
+void ThreadPool::waitAll() 
+{
+  std::unique_lock<CriticalSection> lock(this->lock);
+  if (!num_pending && !num_running)
+    return;
+
+  Scheduler::BlockingScope blocking;
+  all_done.wait(lock, [this]() {
+    return !num_pending && !num_running;
+  });
+}
 
+} //namespace Visus
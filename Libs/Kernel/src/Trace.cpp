@@ -0,0 +1,319 @@
+/*-----------------------------------------------------------------------------
+Copyright(c) 2010 - 2018 ViSUS L.L.C.,
+Scientific Computing and Imaging Institute of the University of Utah
+
+ViSUS L.L.C., 50 W.Broadway, Ste. 300, 84101 - 2044 Salt Lake City, UT
+University of Utah, 72 S Central Campus Dr, Room 3750, 84112 Salt Lake City, UT
+
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met :
+
+* Redistributions of source code must retain the above copyright notice, this
+list of conditions and the following disclaimer.
+
+* Redistributions in binary form must reproduce the above copyright notice,
+this list of conditions and the following disclaimer in the documentation
+and/or other materials provided with the distribution.
+
+* Neither the name of the copyright holder nor the names of its
+contributors may be used to endorse or promote products derived from
+this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED.IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+DAMAGES(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+OR TORT(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+For additional information about this project contact : pascucci@acm.org
+For support : support@visus.net
+-----------------------------------------------------------------------------*/
+
+#include <Visus/Trace.h>
+#include <Visus/CriticalSection.h>
+#include <Visus/Utils.h>
+
+#include <chrono>
+#include <sstream>
+#include <algorithm>
+
+namespace Visus {
+
+int Trace::buffer_size = 65536;
+
+int Trace::max_exited_threads = 64;
+
+std::atomic<bool> Trace::bEnabled(false);
+
+///////////////////////////////////////////////////////////////////////
+class TraceThreadBuffer
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(TraceThreadBuffer)
+
+  CriticalSection           lock; //only contended when someone is collecting the events
+  int                       tid = 0;
+  String                    name;
+  std::vector<Trace::Event> events;
+  Int64                     num_events = 0; //total, the ring keeps the last buffer_size
+  bool                      bExited = false;
+
+  //constructor
+  TraceThreadBuffer() {
+  }
+};
+
+///////////////////////////////////////////////////////////////////////
+class TraceRegistry
+{
+public:
+
+  CriticalSection                             lock;
+  std::vector< SharedPtr<TraceThreadBuffer> > buffers;
+  int                                         next_tid = 1;
+
+  //getSingleton
+  static TraceRegistry* getSingleton() {
+    static TraceRegistry ret;
+    return &ret;
+  }
+
+  //threadExited (keep the buffer for export, but only for the last max_exited_threads threads)
+  void threadExited(SharedPtr<TraceThreadBuffer> buffer)
+  {
+    ScopedLock lock(this->lock);
+    {
+      ScopedLock buffer_lock(buffer->lock);
+      buffer->bExited = true;
+      if (buffer->events.empty())
+        buffers.erase(std::remove(buffers.begin(), buffers.end(), buffer), buffers.end());
+    }
+
+    int num_exited = (int)std::count_if(buffers.begin(), buffers.end(), [](const SharedPtr<TraceThreadBuffer>& it) {return it->bExited; });
+    for (auto it = buffers.begin(); it != buffers.end() && num_exited > std::max(0, Trace::max_exited_threads); )
+    {
+      if ((*it)->bExited)
+      {
+        it = buffers.erase(it);
+        num_exited--;
+      }
+      else
+      {
+        ++it;
+      }
+    }
+  }
+};
+
+///////////////////////////////////////////////////////////////////////
+class TraceThreadBufferHolder
+{
+public:
+
+  VISUS_NON_COPYABLE_CLASS(TraceThreadBufferHolder)
+
+  SharedPtr<TraceThreadBuffer> buffer;
+
+  //constructor
+  TraceThreadBufferHolder() {
+  }
+
+  //destructor
+  ~TraceThreadBufferHolder() {
+    if (buffer)
+      TraceRegistry::getSingleton()->threadExited(buffer);
+  }
+};
+
+///////////////////////////////////////////////////////////////////////
+static String& ThreadName() {
+  thread_local String ret;
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////
+static TraceThreadBuffer* GetThreadBuffer()
+{
+  //the registry keeps the buffer alive after the thread has gone, so its events can still be exported
+  thread_local TraceThreadBufferHolder holder;
+  auto& ret = holder.buffer;
+  if (!ret)
+  {
+    ret = std::make_shared<TraceThreadBuffer>();
+    ret->name = ThreadName();
+    auto registry = TraceRegistry::getSingleton();
+    ScopedLock lock(registry->lock);
+    ret->tid = registry->next_tid++;
+    registry->buffers.push_back(ret);
+  }
+  return ret.get();
+}
+
+///////////////////////////////////////////////////////////////////////
+void Trace::setEnabled(bool value) {
+  bEnabled = value;
+}
+
+///////////////////////////////////////////////////////////////////////
+Int64 Trace::now() {
+  return (Int64)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+///////////////////////////////////////////////////////////////////////
+void Trace::setThreadName(String name) {
+  ThreadName() = name;
+}
+
+///////////////////////////////////////////////////////////////////////
+void Trace::addEvent(const char* category, const char* name, Int64 begin, Int64 end)
+{
+  if (!isEnabled())
+    return;
+
+  auto buffer = GetThreadBuffer();
+
+  Event event;
+  event.category = category;
+  event.name = name;
+  event.tid = buffer->tid;
+  event.begin = begin;
+  event.end = end;
+
+  ScopedLock lock(buffer->lock);
+  int capacity = std::max(1, buffer_size);
+  if ((int)buffer->events.size() < capacity)
+    buffer->events.push_back(event);
+  else
+    buffer->events[buffer->num_events % buffer->events.size()] = event;
+  buffer->num_events++;
+}
+
+///////////////////////////////////////////////////////////////////////
+std::vector<Trace::Event> Trace::getEvents()
+{
+  std::vector< SharedPtr<TraceThreadBuffer> > buffers;
+  {
+    auto registry = TraceRegistry::getSingleton();
+    ScopedLock lock(registry->lock);
+    buffers = registry->buffers;
+  }
+
+  std::vector<Event> ret;
+  for (auto buffer : buffers)
+  {
+    ScopedLock lock(buffer->lock);
+    ret.insert(ret.end(), buffer->events.begin(), buffer->events.end());
+  }
+
+  std::sort(ret.begin(), ret.end(), [](const Event& a, const Event& b) {
+    return a.begin < b.begin;
+  });
+
+  return ret;
+}
+
+///////////////////////////////////////////////////////////////////////
+void Trace::clear()
+{
+  auto registry = TraceRegistry::getSingleton();
+  ScopedLock lock(registry->lock);
+
+  std::vector< SharedPtr<TraceThreadBuffer> > alive;
+  for (auto& buffer : registry->buffers)
+  {
+    {
+      ScopedLock lock(buffer->lock);
+      buffer->events.clear();
+      buffer->num_events = 0;
+    }
+
+    //not used anymore by its thread
+    if (!buffer->bExited)
+      alive.push_back(buffer);
+  }
+  registry->buffers = alive;
+}
+
+///////////////////////////////////////////////////////////////////////
+static String EscapeJSON(String value)
+{
+  std::ostringstream out;
+  for (auto c : value)
+  {
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if ((unsigned char)c < 0x20)
+      out << ' ';
+    else
+      out << c;
+  }
+  return out.str();
+}
+
+///////////////////////////////////////////////////////////////////////
+String Trace::toChromeJSON()
+{
+  std::vector<std::pair<int, String> > names;
+  {
+    auto registry = TraceRegistry::getSingleton();
+    ScopedLock lock(registry->lock);
+    for (auto buffer : registry->buffers)
+      names.push_back(std::make_pair(buffer->tid, buffer->name.empty() ? "Thread " + cstring(buffer->tid) : buffer->name));
+  }
+
+  auto events = getEvents();
+  Int64 t0 = events.empty() ? 0 : events[0].begin;
+
+  std::ostringstream out;
+  out.precision(3);
+  out << std::fixed;
+  out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+  bool bFirst = true;
+  for (auto it : names)
+  {
+    out << (bFirst ? "" : ",") << "\n"
+      << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << it.first
+      << ",\"args\":{\"name\":\"" << EscapeJSON(it.second) << "\"}}";
+    bFirst = false;
+  }
+
+  for (auto event : events)
+  {
+    out << (bFirst ? "" : ",") << "\n"
+      << "{\"name\":\"" << EscapeJSON(event.name) << "\""
+      << ",\"cat\":\"" << EscapeJSON(event.category) << "\""
+      << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.tid
+      << ",\"ts\":" << (event.begin - t0) / 1000.0
+      << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+    bFirst = false;
+  }
+
+  out << "\n]}\n";
+  return out.str();
+}
+
+///////////////////////////////////////////////////////////////////////
+bool Trace::saveChromeJSON(String filename)
+{
+  try
+  {
+    Utils::saveTextDocument(filename, toChromeJSON());
+    return true;
+  }
+  catch (const std::exception& ex)
+  {
+    PrintWarning("cannot save trace", filename, ex.what());
+    return false;
+  }
+}
+
+} //namespace Visus
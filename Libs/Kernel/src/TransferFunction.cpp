@@ -136,6 +136,14 @@ void TransferFunction::execute(Archive& ar)
     return;
   }
 
+  if (ar.name == "SetExact")
+  {
+    bool value;
+    ar.read("value", value);
+    setExact(value);
+    return;
+  }
+
   if (ar.name == "SetAttenutation")
   {
     double value;
@@ -522,6 +530,7 @@ void TransferFunction::write(Archive& ar) const
   ar.write("input_normalization_mode", input_normalization_mode);
   ar.write("output_dtype", output_dtype);
   ar.write("output_range", output_range);
+  ar.write("exact", exact);
 
   if (!isDefault())
   {
@@ -544,6 +553,7 @@ void TransferFunction::read(Archive& ar)
   ar.read("input_normalization_mode", input_normalization_mode);
   ar.read("output_dtype", output_dtype);
   ar.read("output_range", output_range);
+  ar.read("exact", exact, false);
 
   if (this->default_name.empty())
   {
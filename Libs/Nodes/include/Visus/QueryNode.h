@@ -97,6 +97,7 @@ public:
   //setAccess
   void setAccess(SharedPtr<Access> value) {
     this->access=value;
+    this->cost_model.reset(); //costs are learnt per access
   }
 
   //getProgression
@@ -119,6 +120,16 @@ public:
     setProperty("SetQuality", this->quality, value);
   }
 
+  //getLatencyBudget (msec, 0 means the fixed progression/quality ladder)
+  int getLatencyBudget() const {
+    return latency_budget;
+  }
+
+  //setLatencyBudget
+  void setLatencyBudget(int value) {
+    setProperty("SetLatencyBudget", this->latency_budget, value);
+  }
+
   //getBounds
   virtual Position getBounds() override {
     return node_bounds;
@@ -197,14 +208,29 @@ private:
   bool               view_dependent_enabled = false;
   int                progression = QueryGuessProgression;
   int                quality = QueryDefaultQuality;
+  int                latency_budget = 0;
   Position           node_bounds = Position::invalid();
 
   //run time derived properties
   Frustum            node_to_screen;
   Position           query_bounds;
+  SharedPtr<BoxQueryCostModel> cost_model;
+
+  //last box query results, reused when panning/zooming (see Dataset::reuseBoxQuery)
+  //it keeps alive the buffer of the last published refinement (no copy, but as much memory as the last output array)
+  //and it is dropped when the dataset is written (writes or filter computation, see Dataset::getWriteCounter) or the node is hidden
+  CriticalSection      last_query_lock;
+  SharedPtr<Dataset>   last_query_dataset;
+  Int64                last_query_write_counter = 0;
+  SharedPtr<BoxQuery>  last_query;
+
+  //dropLastBoxQuery
+  void dropLastBoxQuery();
 
   //modelChanged
   virtual void modelChanged() override {
+    if (!isVisible())
+      dropLastBoxQuery();
     if (dataflow)
       dataflow->needProcessInput(this);
   }
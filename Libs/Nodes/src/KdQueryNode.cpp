@@ -118,6 +118,22 @@ public:
         std::min(bitsperblock + 1,max_resolution) : //I'm reading block 0+1 for block mode when the blocks are not fullres
         bitsperblock;
 
+    //already fetched by some other kdarray?
+    {
+      auto root = std::make_shared<KdArrayNode>(1);
+      root->resolution = end_resolution;
+      root->logic_box = pow2_box;
+      if (kdarray->restoreFromCache(root.get()))
+      {
+        {
+          ScopedWriteLock wlock(rlock);
+          kdarray->root = root;
+        }
+        publish(/*bForce*/true);
+        return true;
+      }
+    }
+
     //I use a box query to get the data
     auto query=dataset->createBoxQuery(pow2_box, field, time,'r', this->aborted);
     query->setResolutionRange(0,end_resolution);
@@ -435,7 +451,12 @@ public:
     publish(/*bForce*/true);
 
     if (verbose)
-      this->access->printStatistics();
+    {
+      if (this->access)
+        this->access->printStatistics();
+      if (auto cache = KdArrayCache::getSingleton())
+        cache->printStatistics();
+    }
   }
 
   //runJobUsingQuery
@@ -559,7 +580,12 @@ public:
     publish(/*bForce*/true);
 
     if (verbose)
-      this->access->printStatistics();
+    {
+      if (this->access)
+        this->access->printStatistics();
+      if (auto cache = KdArrayCache::getSingleton())
+        cache->printStatistics();
+    }
   }
 
   //runJob
@@ -656,7 +682,10 @@ bool KdQueryNode::processInput()
   job->logic_to_screen = this->logicToScreen();
   job->maxh = dataset->getMaxResolution();
   job->pdim = dataset->getPointDim();
-  job->bitmask= dataset->getBitmask();
+  job->bitmask= dataset->getBitmask();
+
+  if (auto config = DbModule::getModuleConfig())
+    job->verbose = config->readBool("Configuration/KdQueryNode/verbose", false);
 
   //need write lock here
   {
@@ -672,14 +701,8 @@ bool KdQueryNode::processInput()
 
     job->bBlocksAreFullRes = std::dynamic_pointer_cast<GoogleMapsDataset>(dataset) ? true : false;
 
-    //TODO enable also for UseBlockQuery?
-    if (kdquery_mode == KdQueryMode::UseBoxQuery)
-    {
-      //all levels from [0,cutoff) will be cached without any memory limitations
-      //there will be 2^cutoff-1 kdnodes  (8->255 , 9->511, 10->1024)
-      const int caching_cutoff = 10;
-      kdarray->enableCaching(caching_cutoff, StringUtils::getByteSizeFromString("20mb"));
-    }
+    //nodes are shared (see KdArrayCache) with all the kdarrays reading the same data, the mode and bitsperblock change the content of the nodes
+    kdarray->enableCaching(concatenate(dataset->getUrl(), " ", field.name, " ", time, " ", kdquery_mode, " ", job->bitsperblock));
   }
 
   addNodeJob(job);
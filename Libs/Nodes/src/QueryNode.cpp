@@ -44,7 +44,6 @@ For support : support@visus.net
 
 namespace Visus {
 
-
 ///////////////////////////////////////////////////////////////////////////
 class QueryNode::MyJob : public NodeJob
 {
@@ -63,6 +62,10 @@ public:
   Frustum                  logic_to_screen;
   int                      quality;
   int                      progression;
+  int                      latency_budget;
+  SharedPtr<BoxQueryCostModel> cost_model;
+  SharedPtr<BoxQuery>      prev_query;
+  Int64                    write_counter = 0; //of the dataset when the job was created
 
   bool                     verbose;
 
@@ -76,6 +79,14 @@ public:
     this->logic_to_screen = node->logicToScreen();
     this->quality = node->getQuality();
     this->progression = node->getProgression();
+    this->latency_budget = node->getLatencyBudget();
+    this->cost_model = node->cost_model;
+    {
+      ScopedLock lock(node->last_query_lock);
+      this->write_counter = dataset->getWriteCounter();
+      if (node->last_query_dataset == dataset && node->last_query_write_counter == write_counter)
+        this->prev_query = node->last_query;
+    }
     this->verbose = node->isVerbose();
     this->pdim = dataset->getPointDim();
     this->maxh = dataset->getMaxResolution();
@@ -109,6 +120,40 @@ public:
     return ret;
   }
 
+  //getBoxQueryEndResolutions
+  std::vector<int> getBoxQueryEndResolutions(int endh)
+  {
+    if (latency_budget <= 0 || !cost_model || !cost_model->hasHistory())
+      return getEndResolutions(endh);
+
+    endh = Utils::clamp(endh + quality, 0, maxh);
+
+    //estimated bytes of the query up to resolution H (each level doubles the samples)
+    auto logic_box = logic_position.toDiscreteAxisAlignedBox();
+    double nsamples = 1.0;
+    for (int D = 0; D < pdim; D++)
+      nsamples *= std::max((Int64)1, logic_box.size()[D]);
+    auto getByteSize = [&](int H) {
+      return field.dtype.getByteSize(1) * nsamples * std::pow(2.0, H - maxh);
+    };
+
+    //first frame: the finest resolution fitting in the budget (but not less than one block, it would not save anything)
+    //refinements: each one fitting in the budget too, and refining every axis at least once (i.e. adding real detail)
+    auto ret = cost_model->guessEndResolutions(dataset->getDefaultBitsPerBlock(), endh, pdim, latency_budget, getByteSize);
+
+    if (auto google = dynamic_cast<GoogleMapsDataset*>(dataset.get()))
+    {
+      for (auto& it : ret)
+        it = (it >> 1) << 1; //TODO: google maps does not have odd resolutions
+      ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+    }
+
+    if (verbose)
+      PrintInfo("QueryNode latency_budget", latency_budget, "end_resolutions", StringUtils::join(ret, " "));
+
+    return ret;
+  }
+
   //guessPointQueryEndResolutions
   std::vector<int> guessPointQueryEndResolutions()
   {
@@ -201,7 +246,7 @@ public:
       DataflowMessage msg;
       output.bounds = dataset->logicToPhysic(query->logic_position);
       msg.writeValue("array", output);
-      node->publish(msg);
+      publishRefinement(node, msg, /*bFinal*/N == (int)resolutions.size() - 1);
     }
   }
 
@@ -214,7 +259,7 @@ public:
     auto endh = maxh;
 
     if (!logic_to_screen.valid())
-      return getEndResolutions(endh);
+      return getBoxQueryEndResolutions(endh);
 
     //important to work with orthogonal box
     auto logic_box = logic_position.toAxisAlignedBox();
@@ -270,7 +315,7 @@ public:
       --endh;
     }
 
-    return getEndResolutions(endh);
+    return getBoxQueryEndResolutions(endh);
   }
 
   //runBoxQueryJob
@@ -287,7 +332,7 @@ public:
     query->end_resolutions = resolutions;
 
     query->incrementalPublish = [&](Array output) {
-      doPublish(output, query);
+      doPublish(output, query, /*bFinal*/false);
     };
 
     dataset->beginBoxQuery(query);
@@ -298,18 +343,34 @@ public:
     for (int N = 0; N < (int)resolutions.size(); N++)
     {
       Time t1 = Time::now();
+      auto statistics = access ? access->statistics : Access::Statistics();
 
       if (aborted() || !query->isRunning())
         return;
 
       PrintInfo("BoxQuery msec", t1.elapsedMsec(), "level", N, "/", resolutions.size(), "/", resolutions[N], "/", dataset->getMaxResolution());
 
-      if (!dataset->executeBoxQuery(access, query))
+      //copy the overlapping samples of the previous query, only the newly exposed region/levels will be read
+      bool bReused = prev_query && dataset->reuseBoxQuery(access, query, prev_query);
+      if (bReused && verbose)
+        PrintInfo("BoxQuery reused previous samples up to level", query->getCurrentResolution());
+
+      if (query->getCurrentResolution() < query->getEndResolution() && !dataset->executeBoxQuery(access, query))
         return;
 
       if (aborted())
         return;
 
+      setLastBoxQuery(query);
+
+      //learn the cost of this refinement step from what the access really read (reused samples cost nothing)
+      if (cost_model && access)
+      {
+        auto bytes = access->statistics.rbytes - statistics.rbytes;
+        auto msec = access->statistics.rmsec - statistics.rmsec;
+        cost_model->addStep(query->end_resolution, (double)bytes, (double)msec);
+      }
+
       auto output = query->buffer;
 
       if (true)
@@ -323,7 +384,7 @@ public:
           "url", dataset->getUrl());
       }
 
-      doPublish(output, query);
+      doPublish(output, query, /*bFinal*/query->end_resolution == query->end_resolutions.back());
 
       //PrintInfo("Calling next query...");
       dataset->nextBoxQuery(query);
@@ -331,6 +392,24 @@ public:
     }
   }
 
+  //setLastBoxQuery
+  void setLastBoxQuery(SharedPtr<BoxQuery> query)
+  {
+    if (query->filter.dataset_filter)
+      return;
+
+    //snapshot, the buffer will not change since nextBoxQuery allocates a new one
+    auto snapshot = dataset->createBoxQuery(query->logic_box, query->field, query->time, 'r');
+    snapshot->logic_samples = query->logic_samples;
+    snapshot->buffer = query->buffer;
+    snapshot->setCurrentResolution(query->getCurrentResolution());
+
+    ScopedLock lock(node->last_query_lock);
+    node->last_query_dataset = dataset;
+    node->last_query_write_counter = write_counter;
+    node->last_query = snapshot;
+  }
+
   //runJob
   virtual void runJob() override
   {
@@ -341,7 +420,7 @@ public:
   }
 
   //doPublish
-  void doPublish(Array output, SharedPtr<BoxQuery> query)
+  void doPublish(Array output, SharedPtr<BoxQuery> query, bool bFinal)
   {
     int pdim = dataset->getPointDim();
 
@@ -374,7 +453,7 @@ public:
 #endif
 
     msg.writeValue("array", output);
-    node->publish(msg);
+    publishRefinement(node, msg, bFinal);
   }
 
   //abort
@@ -397,6 +476,12 @@ QueryNode::QueryNode()
   addInputPort("time");
 
   addOutputPort("array");
+
+  //a new query makes the running one useless
+  setLatestJobWins(true);
+
+  if (auto config = DbModule::getModuleConfig())
+    this->latency_budget = config->readInt("Configuration/QueryNode/latency_budget", 0);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -448,6 +533,14 @@ void QueryNode::execute(Archive& ar)
     return;
   }
 
+  if (ar.name == "SetLatencyBudget")
+  {
+    int value;
+    ar.read("value", value);
+    setLatencyBudget(value);
+    return;
+  }
+
   if (ar.name == "SetBounds")
   {
     Matrix T; BoxNd box;
@@ -577,7 +670,10 @@ bool QueryNode::processInput()
 
   auto dataset = getDataset();
   if (!dataset)
+  {
+    dropLastBoxQuery();
     return failed();
+  }
 
   //create (and store in my class the access)
   if (!this->access)
@@ -589,6 +685,9 @@ bool QueryNode::processInput()
     else
       setAccess(dataset->createAccess());
   }
+
+  if (!this->cost_model)
+    this->cost_model = std::make_shared<BoxQueryCostModel>();
  
   addNodeJob(std::make_shared<MyJob>(this, dataset, access));
   return true;
@@ -611,6 +710,16 @@ void QueryNode::exitFromDataflow()
 {
   Node::exitFromDataflow();
   this->access.reset();
+
+  dropLastBoxQuery();
+}
+
+//////////////////////////////////////////////////////////////////
+void QueryNode::dropLastBoxQuery()
+{
+  ScopedLock lock(this->last_query_lock);
+  this->last_query_dataset.reset();
+  this->last_query.reset();
 }
 
 //////////////////////////////////////////////////////////////////
@@ -623,6 +732,7 @@ void QueryNode::write(Archive& ar) const
   ar.write("view_dependent_enabled", view_dependent_enabled);
   ar.write("progression", progression);
   ar.write("quality", quality);
+  ar.write("latency_budget", latency_budget);
 
   ar.writeObject("node_bounds", node_bounds);
 
@@ -639,6 +749,7 @@ void QueryNode::read(Archive& ar)
   ar.read("view_dependent_enabled", view_dependent_enabled);
   ar.read("progression", progression);
   ar.read("quality", quality);
+  ar.read("latency_budget", latency_budget, latency_budget);
 
   ar.readObject("node_bounds", node_bounds);
 
@@ -46,11 +46,13 @@ class ComputeStatisticsJob : public NodeJob
 {
 public:
 
-  StatisticsNode*  node;
-  Array            data;
+  StatisticsNode*           node;
+  Array                     data;
+  SharedPtr<ReturnReceipt>  return_receipt;
 
   //constructor
-  ComputeStatisticsJob(StatisticsNode* node_,Array data_) : node(node_), data(data_){
+  ComputeStatisticsJob(StatisticsNode* node_,Array data_,SharedPtr<ReturnReceipt> return_receipt_) 
+    : node(node_), data(data_), return_receipt(return_receipt_){
   }
 
   //runJob
@@ -61,6 +63,7 @@ public:
     {
       PrintInfo("Computed statistics done i", t1.elapsedMsec());
       DataflowMessage msg;
+      msg.setReturnReceipt(return_receipt);
       msg.writeValue("statistics", stats);
       node->publish(msg);
     }
@@ -81,10 +84,14 @@ StatisticsNode::~StatisticsNode() {
 bool StatisticsNode::processInput() 
 {
   abortProcessing();
+
+  // important to do before readValue (the producer gets the credit back only when the statistics are ready)
+  auto return_receipt=createPassThroughtReceipt();
+
   auto data = readValue<Array>("array");
   if (!data) return false;
   PrintInfo("Statistics node got data",data->dims);
-  addNodeJob(std::make_shared<ComputeStatisticsJob>(this,*data));
+  addNodeJob(std::make_shared<ComputeStatisticsJob>(this,*data,return_receipt));
   return true;
 }
 
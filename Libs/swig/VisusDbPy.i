@@ -63,6 +63,27 @@ def LoadDataset(url):
 }
 %ignore Visus::DbModule::attach;
 
+// long running calls release the GIL, so that python threads can read in parallel
+// (-threads already does it for every wrapped call, here it's explicit to not depend on the build flags)
+%thread Visus::Dataset::executeBlockQuery;
+%thread Visus::Dataset::executeBlockQueryAndWait;
+%thread Visus::Dataset::executeBoxQuery;
+%thread Visus::Dataset::executeBoxQueries;
+%thread Visus::Dataset::nextBoxQuery;
+%thread Visus::Dataset::executePointQuery;
+%thread Visus::IdxDataset::executeBoxQuery;
+%thread Visus::IdxDataset::executeBoxQueries;
+%thread Visus::IdxDataset::nextBoxQuery;
+%thread Visus::IdxDataset::executePointQuery;
+%thread Visus::IdxDataset::compressDataset;
+%thread Visus::Access::beginIO;
+%thread Visus::Access::endIO;
+%thread Visus::Access::beginRead;
+%thread Visus::Access::endRead;
+%thread Visus::Access::beginWrite;
+%thread Visus::Access::endWrite;
+%thread Visus::LoadDataset;
+
 %include <Visus/Db.h>
 %include <Visus/Access.h>
 %include <Visus/LogicSamples.h>
@@ -70,6 +91,7 @@ def LoadDataset(url):
 %include <Visus/BlockQuery.h>
 %include <Visus/BoxQuery.h>
 %include <Visus/PointQuery.h>
+%template(VectorOfBoxQuery) std::vector< Visus::SharedPtr<Visus::BoxQuery> >;
 %include <Visus/Query.h>
 %include <Visus/DatasetBitmask.h>
 %include <Visus/DatasetTimesteps.h>
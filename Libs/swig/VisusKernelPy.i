@@ -7,6 +7,7 @@
 #include <Visus/Polygon.h>
 #include <Visus/File.h>
 #include <Visus/Time.h>
+#include <Visus/Trace.h>
 #include <Visus/TransferFunction.h>
 #include <Visus/Ray.h>
 #include <Visus/Frustum.h>
@@ -50,6 +51,10 @@ using namespace Visus;
 %include <Visus/Path.h>
 %include <Visus/File.h>
 %include <Visus/Time.h>
+%ignore Visus::Trace::Event;
+%ignore Visus::Trace::addEvent;
+%ignore Visus::Trace::getEvents;
+%include <Visus/Trace.h>
 %include <Visus/StringUtils.h>
 
 %include <Visus/Point.h> 
@@ -113,6 +118,13 @@ Visus::Array& operator*= (double coeff)              {*self=ArrayUtils::mul(*sel
 Visus::Array& operator/= (Visus::Array& other)       {*self=ArrayUtils::div(*self,other); return *self;} 
 Visus::Array& operator/= (double coeff)              {*self=ArrayUtils::div(*self,coeff); return *self;}
 
+//__capsule__ (owns a copy of the array sharing the same heap, numpy arrays keep it as base so the memory stays alive)
+PyObject* __capsule__() const {
+  return PyCapsule_New(new Visus::Array(*$self), "Visus::Array", [](PyObject* capsule) {
+    delete (Visus::Array*)PyCapsule_GetPointer(capsule, "Visus::Array");
+  });
+}
+
 %pythoncode %{
 
 # ////////////////////////////////////////////////////////
@@ -155,6 +167,9 @@ def toNumPy(src, bShareMem=False, bSqueeze=False):
 			pass
 
 		holder = MyNumPyHolder()
+
+		# shared memory: the numpy array keeps the holder as base, the holder keeps the heap memory alive
+		holder.capsule = src.__capsule__()
 		  
 		holder.__array_interface__ = {
 			'strides': None,
@@ -374,9 +374,14 @@ def CompressDataset(args):
 	parser = argparse.ArgumentParser(description="compress dataset")
 	parser.add_argument("--dataset"       , type=str,   help="dataset",     required=True)
 	parser.add_argument("--compression"   , type=str,   help="compression", required=True)
+	parser.add_argument("--train-dictionary", action="store_true", help="train a compression dictionary per field (zstd only)")
 	args = parser.parse_args(args)
 
 	db=LoadDataset(args.dataset);Assert(db)
+
+	if args.train_dictionary:
+		Assert(db.trainCompressionDictionary(args.compression))
+
 	Assert(db.compressDataset([args.compression]))
 
 
@@ -515,6 +520,7 @@ def Main(args):
 
 	if action=="test-idx":
 		os.chdir(this_dir)
+		SelfTestKernel()
 		SelfTestIdx(300)
 		sys.exit(0)
 		
@@ -157,7 +157,7 @@ class PyDataset(object):
 		read_block = self.db.createBlockQuery(block_id, field, time, ord('r'), aborted)
 		self.executeBlockQueryAndWait(access, read_block)
 		if not read_block.ok(): return None
-		return Array.toNumPy(read_block.buffer, bShareMem=False)
+		return Array.toNumPy(read_block.buffer, bShareMem=True)
 
 	# writeBlock
 	def writeBlock(self, block_id, time=None, field=None, access=None, data=None, aborted=Aborted()):
@@ -229,8 +229,8 @@ class PyDataset(object):
 		def NoGenerator():
 			if not self.db.executeBoxQuery(access, query):
 				raise Exception("query error {0}".format(query.errormsg))
-			# i cannot be sure how the numpy will be used outside or when the query will dealllocate the buffer
-			data=Array.toNumPy(query.buffer, bShareMem=False) 
+			# zero-copy, the numpy array keeps the heap memory alive (next resolutions get a new buffer)
+			data=Array.toNumPy(query.buffer, bShareMem=True) 
 			return data
 			
 		def WithGenerator():
@@ -239,8 +239,8 @@ class PyDataset(object):
 				if not self.db.executeBoxQuery(access, query):
 					raise Exception("query error {0}".format(query.errormsg))
 
-				# i cannot be sure how the numpy will be used outside or when the query will dealllocate the buffer
-				data=Array.toNumPy(query.buffer, bShareMem=False) 
+				# zero-copy, the numpy array keeps the heap memory alive (next resolutions get a new buffer)
+				data=Array.toNumPy(query.buffer, bShareMem=True) 
 				yield data
 				self.db.nextBoxQuery(query)	
 
@@ -248,6 +248,75 @@ class PyDataset(object):
 			
 
 
+	# readBatch
+	def readBatch(self, boxes, time=None, field=None, quality=0, max_resolution=None, disable_filters=False, access=None, batch_size=1024):
+		"""
+		db=PyDataset.Load(url)
+
+		# example of reading many small crops (blocks shared by the crops are read only once)
+		for data in db.readBatch([([x,y,z],[x+64,y+64,z+64]) for x,y,z in corners]):
+			print(data.shape)
+
+		# example of one resolution for each crop
+		for data in db.readBatch(boxes, max_resolution=[db.getMaxResolution()-3*level for level in levels]):
+			print(data.shape)
+
+		NOTE: like read(), filters are enabled by default; if the dataset has a filter the crops
+		fall back to being read one by one (no block sharing). Use disable_filters=True to batch them.
+		"""
+
+		field=self.getField() if field is None else self.getField(field)
+
+		if time is None:
+			time = self.getTime()
+
+		boxes=list(boxes)
+
+		if max_resolution is None:
+			max_resolution=self.getMaxResolution()
+
+		if not isinstance(max_resolution,(tuple,list)):
+			max_resolution=[max_resolution]*len(boxes)
+
+		Assert(len(max_resolution)==len(boxes))
+
+		# example quality -3 means not full resolution
+		Assert(quality<=0)
+
+		if not access:
+			access=self.db.createAccess()
+
+		# the outputs of a batch stay in memory until they are yielded
+		for A in range(0,len(boxes),batch_size):
+
+			queries=VectorOfBoxQuery()
+			for logic_box,res in zip(boxes[A:A+batch_size],max_resolution[A:A+batch_size]):
+
+				if isinstance(logic_box,(tuple,list)):
+					logic_box=BoxNi(PointNi(logic_box[0]),PointNi(logic_box[1]))
+
+				query = self.db.createBoxQuery(BoxNi(logic_box), field , time, ord('r'))
+
+				if disable_filters:
+					query.disableFilters()
+				else:
+					query.enableFilters()
+
+				query.end_resolutions.push_back(res+quality)
+				self.db.beginBoxQuery(query)
+
+				if not query.isRunning():
+					raise Exception("begin query failed {0}".format(query.errormsg))
+
+				queries.push_back(query)
+
+			if not self.db.executeBoxQueries(access, queries):
+				errormsg=[query.errormsg for query in queries if query.errormsg]
+				raise Exception("query error {0}".format(errormsg[0] if errormsg else ""))
+
+			for query in queries:
+				yield Array.toNumPy(query.buffer, bShareMem=True)
+
 	# write
 	# IMPORTANT: usually db.write happens without write lock and syncronously (at least in python)
 	def write(self, data, x=0, y=0, z=0,logic_box=None, time=None, field=None, access=None):
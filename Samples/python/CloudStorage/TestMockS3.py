@@ -0,0 +1,375 @@
+"""
+Test CloudStorageAccess packed=true against a local S3 stand-in (no credentials, no network).
+
+usage:
+	python3 Samples/python/CloudStorage/TestMockS3.py              # run the tests
+	python3 Samples/python/CloudStorage/TestMockS3.py --serve 9000 # only run the S3 stand-in
+
+The stand-in implements the subset of the S3 REST api used by AmazonCloudStorage (path style, url ?cloud=s3):
+	GET    /bucket/key (with Range)
+	PUT    /bucket/key
+	POST   /bucket/key?uploads, PUT /bucket/key?partNumber=N&uploadId=ID, POST /bucket/key?uploadId=ID, DELETE /bucket/key?uploadId=ID
+
+Faults can be injected to check that transient errors are retried (or not cached) and that confirmed 404 are handled as missing files.
+"""
+
+import os,sys,re,uuid,shutil,tempfile,threading
+from urllib.parse import urlparse, parse_qs
+from http.server import BaseHTTPRequestHandler, HTTPServer
+from socketserver import ThreadingMixIn
+
+# the S3 stand-in alone does not need OpenVisus
+if not "--serve" in sys.argv:
+	from OpenVisus import *
+
+# ////////////////////////////////////////////////////////////////
+class MockS3Handler(BaseHTTPRequestHandler):
+
+	protocol_version="HTTP/1.1"
+
+	def log_message(self, format, *args):
+		pass
+
+	# send
+	def send(self, status, body=b"", headers={}):
+		self.send_response(status)
+		for key,value in headers.items():
+			self.send_header(key,value)
+		self.send_header("Content-Length",str(len(body)))
+		self.end_headers()
+		if self.command!="HEAD":
+			self.wfile.write(body)
+
+	# parse
+	def parse(self):
+		url=urlparse(self.path)
+		params=parse_qs(url.query, keep_blank_values=True)
+		params={key:value[0] for key,value in params.items()}
+		nbytes=int(self.headers.get("Content-Length",0))
+		body=self.rfile.read(nbytes) if nbytes else b""
+		metadata={key.lower():value for key,value in self.headers.items() if key.lower().startswith("x-amz-meta-")}
+		self.server.log(self.command, url.path, params, self.headers.get("Range",""))
+		return url.path, params, body, metadata
+
+	def do_GET(self):
+		path, params, body, metadata=self.parse()
+		status=self.server.fault(self.command, path, params)
+		if status: return self.send(status)
+		if not path in self.server.objects: return self.send(404, b"<Error><Code>NoSuchKey</Code></Error>")
+		data, metadata=self.server.objects[path]
+		match=re.match(r"bytes=(\d+)-(\d+)", self.headers.get("Range",""))
+		if match:
+			A,B=int(match.group(1)), min(int(match.group(2)), len(data)-1)
+			return self.send(206, data[A:B+1], metadata)
+		return self.send(200, data, metadata)
+
+	def do_PUT(self):
+		path, params, body, metadata=self.parse()
+		status=self.server.fault(self.command, path, params)
+		if status: return self.send(status)
+		if "uploadId" in params:
+			upload=self.server.uploads.get(params["uploadId"])
+			if upload is None: return self.send(404, b"<Error><Code>NoSuchUpload</Code></Error>")
+			etag='"{}"'.format(uuid.uuid4().hex)
+			upload["parts"][int(params["partNumber"])]=(etag, body)
+			return self.send(200, b"", {"ETag": etag})
+		self.server.objects[path]=(body, metadata)
+		return self.send(200)
+
+	def do_POST(self):
+		path, params, body, metadata=self.parse()
+		status=self.server.fault(self.command, path, params)
+		if status: return self.send(status)
+		if "uploads" in params:
+			upload_id=uuid.uuid4().hex
+			self.server.uploads[upload_id]={"path": path, "metadata": metadata, "parts": {}}
+			return self.send(200, "<InitiateMultipartUploadResult><UploadId>{}</UploadId></InitiateMultipartUploadResult>".format(upload_id).encode())
+		if "uploadId" in params:
+			upload=self.server.uploads.pop(params["uploadId"], None)
+			if upload is None: return self.send(404, b"<Error><Code>NoSuchUpload</Code></Error>")
+			text=body.decode()
+			numbers=[int(it) for it in re.findall(r"<PartNumber>(\d+)</PartNumber>", text)]
+			etags=re.findall(r"<ETag>(.*?)</ETag>", text)
+			if numbers!=sorted(upload["parts"].keys()) or any(upload["parts"][N][0]!=etag for N,etag in zip(numbers,etags)):
+				return self.send(200, b"<Error><Code>InvalidPart</Code></Error>") # S3 can report an error inside a 200 response
+			self.server.objects[path]=(b"".join(upload["parts"][N][1] for N in numbers), upload["metadata"])
+			return self.send(200, b"<CompleteMultipartUploadResult></CompleteMultipartUploadResult>")
+		return self.send(400)
+
+	def do_DELETE(self):
+		path, params, body, metadata=self.parse()
+		if "uploadId" in params:
+			self.server.uploads.pop(params["uploadId"], None)
+		else:
+			self.server.objects.pop(path, None)
+		return self.send(204)
+
+# ////////////////////////////////////////////////////////////////
+class MockS3(ThreadingMixIn, HTTPServer):
+
+	daemon_threads=True
+
+	def __init__(self, port=0):
+		HTTPServer.__init__(self, ("127.0.0.1", port), MockS3Handler)
+		self.lock=threading.Lock()
+		self.objects={}  # path -> (body,metadata)
+		self.uploads={}  # upload_id -> {path,metadata,parts}
+		self.faults=[]   # [method,path,param,status,count]
+		self.requests=[] # (method,path,params,range)
+		self.thread=threading.Thread(target=self.serve_forever, daemon=True)
+		self.thread.start()
+
+	# getUrl
+	def getUrl(self, bucket):
+		return "http://127.0.0.1:{}/{}".format(self.server_address[1], bucket)
+
+	# log
+	def log(self, method, path, params, range):
+		with self.lock:
+			self.requests.append((method, path, params, range))
+
+	# addFault (the next <count> requests matching method/path/param fail with <status>)
+	def addFault(self, method, path, status, count=1, param=""):
+		with self.lock:
+			self.faults.append([method, path, param, status, count])
+
+	# fault
+	def fault(self, method, path, params):
+		with self.lock:
+			for it in self.faults:
+				if it[4]>0 and it[0]==method and it[1] in path and (not it[2] or it[2] in params):
+					it[4]-=1
+					return it[3]
+		return 0
+
+	# countRequests
+	def countRequests(self, method, path="", param=""):
+		with self.lock:
+			return len([it for it in self.requests if it[0]==method and path in it[1] and (not param or param in it[2])])
+
+	# resetRequests
+	def resetRequests(self):
+		with self.lock:
+			self.requests=[]
+
+# ////////////////////////////////////////////////////////////////
+def UploadDirectory(server, dir, bucket):
+	for root, dirs, files in os.walk(dir):
+		for filename in files:
+			relpath=os.path.relpath(os.path.join(root, filename), dir).replace("\\","/")
+			with open(os.path.join(root, filename),"rb") as f:
+				server.objects["/{}/{}".format(bucket, relpath)]=(f.read(), {})
+
+# ////////////////////////////////////////////////////////////////
+def CreateCloudAccess(db, server, bucket, **args):
+	url=server.getUrl(bucket) + "/visus.idx?cloud=s3"
+	attributes=" ".join('{}="{}"'.format(key,value) for key,value in args.items())
+	config='<access type="CloudStorageAccess" url="{}" packed="true" chmod="rw" nconnections="4" {} />'.format(url.replace("&","&amp;"), attributes)
+	return db.db.createAccess(StringTree.fromString(config))
+
+# ////////////////////////////////////////////////////////////////
+def CreateLocalDataset(dir, fill=True):
+	import numpy
+	shutil.rmtree(dir, ignore_errors=True)
+	db=CreateIdx(url=os.path.join(dir,"visus.idx"), dims=[64,64], fields=[Field.fromString("data uint16")], bitsperblock=8, blocksperfile=4)
+	data=numpy.random.randint(0, 65535, size=(64,64), dtype=numpy.uint16)
+	if fill:
+		db.write(data)
+	else:
+		db.write(data[0:16,0:16], x=0, y=0) # sparse, most of the binary files do not exist
+	return db, db.read()
+
+# ////////////////////////////////////////////////////////////////
+def TestRangeGet(server, tmp):
+	"""
+	reads go through the header table of each file (one range request, cached) and coalesced range requests for the blocks
+	"""
+	import numpy
+	bucket="range-get"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket))
+	UploadDirectory(server, os.path.join(tmp, bucket), bucket)
+
+	access=CreateCloudAccess(db, server, bucket)
+	server.resetRequests()
+	Assert(numpy.array_equal(db.read(access=access), expected))
+	Assert(server.countRequests("GET")>0 and all(it[3].startswith("bytes=") for it in server.requests))
+
+	# headers are cached
+	num_header_requests=server.countRequests("GET")
+	server.resetRequests()
+	Assert(numpy.array_equal(db.read(access=access), expected))
+	Assert(server.countRequests("GET")<num_header_requests)
+	print("TestRangeGet ok")
+
+# ////////////////////////////////////////////////////////////////
+def TestTransientHeaderError(server, tmp):
+	"""
+	a 5xx on the header request must not be cached as a missing file
+	"""
+	import numpy
+	bucket="transient"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket))
+	UploadDirectory(server, os.path.join(tmp, bucket), bucket)
+
+	access=CreateCloudAccess(db, server, bucket)
+	server.addFault("GET", "/{}/".format(bucket), 503, count=1000)
+	Assert(not numpy.array_equal(db.read(access=access), expected))
+	server.faults=[]
+	Assert(numpy.array_equal(db.read(access=access), expected))
+	print("TestTransientHeaderError ok")
+
+# ////////////////////////////////////////////////////////////////
+def TestMissingFiles(server, tmp):
+	"""
+	a confirmed 404 is cached (an idx dataset is usually sparse)
+	"""
+	import numpy
+	bucket="missing"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket), fill=False)
+	UploadDirectory(server, os.path.join(tmp, bucket), bucket)
+
+	missing=lambda: len([it for it in server.requests if it[0]=="GET" and it[1].startswith("/{}/".format(bucket)) and not it[1] in server.objects])
+
+	access=CreateCloudAccess(db, server, bucket)
+	server.resetRequests()
+	Assert(numpy.array_equal(db.read(access=access), expected))
+	Assert(missing()>0)
+	server.resetRequests()
+	Assert(numpy.array_equal(db.read(access=access), expected))
+	Assert(missing()==0)
+	print("TestMissingFiles ok")
+
+# ////////////////////////////////////////////////////////////////
+def WaitFor(condition, max_seconds=5.0):
+	import time
+	T1=time.time()
+	while not condition() and time.time()-T1<max_seconds:
+		time.sleep(0.1)
+	return condition()
+
+# ////////////////////////////////////////////////////////////////
+def TestMultipartUpload(server, tmp):
+	"""
+	files bigger than multipart_size are uploaded in parts, a failed part is retried (PushWithRetry)
+	"""
+	import numpy
+	bucket="multipart"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket))
+
+	access=CreateCloudAccess(db, server, bucket, multipart_size="1kb")
+	server.resetRequests()
+	server.addFault("PUT", "/{}/".format(bucket), 503, count=2, param="partNumber")
+	db.write(expected, access=access)
+	Assert(server.countRequests("POST", param="uploads")>0 and server.countRequests("POST", param="uploadId")>0)
+	Assert(all(it[4]==0 for it in server.faults)) # all the injected faults have been retried
+	server.faults=[]
+	Assert(numpy.array_equal(db.read(access=CreateCloudAccess(db, server, bucket)), expected))
+	print("TestMultipartUpload ok")
+
+# ////////////////////////////////////////////////////////////////
+def TestUploadFailure(server, tmp):
+	"""
+	an upload failing after all the retries makes the write fail, the multipart upload is aborted
+	"""
+	import numpy
+	bucket="failure"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket))
+
+	access=CreateCloudAccess(db, server, bucket, multipart_size="1kb", max_retries="1")
+	server.addFault("PUT", "/{}/".format(bucket), 503, count=1000000)
+	try:
+		db.write(expected, access=access)
+		bOk=True
+	except Exception:
+		bOk=False
+	server.faults=[]
+	Assert(not bOk)
+	Assert(not [key for key in server.objects if key.startswith("/{}/".format(bucket))])
+	Assert(WaitFor(lambda: server.countRequests("DELETE", param="uploadId")>0))
+	print("TestUploadFailure ok")
+
+# ////////////////////////////////////////////////////////////////
+def TestHeaderErrorOnWrite(server, tmp):
+	"""
+	only a confirmed 404 means a new file, a failed header request must not replace the stored blocks
+	"""
+	import numpy
+	bucket="overwrite"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket))
+	UploadDirectory(server, os.path.join(tmp, bucket), bucket)
+	stored={key:value[0] for key,value in server.objects.items() if key.startswith("/{}/".format(bucket))}
+
+	data=numpy.random.randint(0, 65535, size=(16,16), dtype=numpy.uint16)
+	server.addFault("GET", "/{}/".format(bucket), 503, count=1000000)
+	try:
+		db.write(data, x=0, y=0, access=CreateCloudAccess(db, server, bucket))
+		bOk=True
+	except Exception:
+		bOk=False
+	server.faults=[]
+	Assert(not bOk)
+	Assert(stored=={key:value[0] for key,value in server.objects.items() if key.startswith("/{}/".format(bucket))})
+
+	# read-merge-write once the storage is back
+	db.write(data, x=0, y=0, access=CreateCloudAccess(db, server, bucket))
+	expected[0:16,0:16]=data
+	Assert(numpy.array_equal(db.read(access=CreateCloudAccess(db, server, bucket)), expected))
+	print("TestHeaderErrorOnWrite ok")
+
+# ////////////////////////////////////////////////////////////////
+def TestPendingWrites(server, tmp):
+	"""
+	written blocks are uploaded as soon as their file is complete (or max_pending_size is reached), not only in endIO
+	"""
+	import numpy
+	bucket="pending"
+	db, expected=CreateLocalDataset(os.path.join(tmp, bucket))
+	stored=lambda: len([key for key in server.objects if key.startswith("/{}/".format(bucket))])
+
+	# all the files are complete
+	access=CreateCloudAccess(db, server, bucket)
+	access.beginWrite()
+	db.write(expected, access=access)
+	Assert(stored()>0)
+	access.endWrite()
+	Assert(numpy.array_equal(db.read(access=CreateCloudAccess(db, server, bucket)), expected))
+
+	# no file is complete, but the pending blocks are too many
+	for key in [key for key in server.objects if key.startswith("/{}/".format(bucket))]:
+		del server.objects[key]
+	access=CreateCloudAccess(db, server, bucket, max_pending_size="1")
+	access.beginWrite()
+	db.write(expected[0:16,0:16], x=0, y=0, access=access)
+	Assert(stored()>0)
+	access.endWrite()
+	print("TestPendingWrites ok")
+
+# ////////////////////////////////////////////////////////////////
+def Main():
+
+	if len(sys.argv)>2 and sys.argv[1]=="--serve":
+		server=MockS3(int(sys.argv[2]))
+		print("S3 stand-in listening on", server.getUrl(""))
+		server.thread.join()
+		return
+
+	server=MockS3()
+	tmp=tempfile.mkdtemp()
+	try:
+		TestRangeGet(server, tmp)
+		TestTransientHeaderError(server, tmp)
+		TestMissingFiles(server, tmp)
+		TestMultipartUpload(server, tmp)
+		TestUploadFailure(server, tmp)
+		TestHeaderErrorOnWrite(server, tmp)
+		TestPendingWrites(server, tmp)
+	finally:
+		server.shutdown()
+		shutil.rmtree(tmp, ignore_errors=True)
+
+	print("all done")
+	sys.exit(0)
+
+# ////////////////////////////////////////////////////////////////
+if __name__=="__main__":
+	Main()
@@ -0,0 +1,60 @@
+# this example measures compression ratio and encode/decode speed of the encoder pre-filters
+# usage: python3 Samples/python/TestEncoderFilters.py [dataset.idx ...]
+import os,sys
+from OpenVisus import *
+
+MB=1024*1024
+
+SPECS=[
+	"lz4",
+	"shuffle+lz4",
+	"bitshuffle+lz4",
+	"delta+shuffle+lz4",
+	"zip",
+	"shuffle+zip",
+	"delta+zip",
+	"xor+shuffle+zip",
+	"zstd",
+	"shuffle+zstd",
+	"bitshuffle+zstd",
+	"delta+bitshuffle+zstd",
+]
+
+# ////////////////////////////////////////////////////////////////
+def TimeIt(fn, max_seconds=2.0):
+	ret, NCALLS, T1=None, 0, Time.now()
+	while NCALLS==0 or T1.elapsedSec()<max_seconds:
+		ret=fn()
+		NCALLS+=1
+	return ret, T1.elapsedSec()/NCALLS
+
+# ////////////////////////////////////////////////////////////////
+def TestEncoder(name, array, specs):
+	encoded=ArrayUtils.encodeArray(specs, array)
+	if not encoded:
+		print(name, specs, "not available")
+		return
+	encoded, encode_sec=TimeIt(lambda: ArrayUtils.encodeArray(specs, array))
+	decoded, decode_sec=TimeIt(lambda: ArrayUtils.decodeArray(specs, array.dims, array.dtype, encoded))
+	Assert(decoded.c_size()==array.c_size())
+	print(name, "{:24s}".format(specs),
+		"ratio {:6.2f}".format(array.c_size()/float(encoded.c_size())),
+		"encode {:8.1f} MB/s".format(array.c_size()/(encode_sec*MB)),
+		"decode {:8.1f} MB/s".format(array.c_size()/(decode_sec*MB)))
+
+# ////////////////////////////////////////////////////////////////
+def Main():
+	filenames=sys.argv[1:] if len(sys.argv)>1 else ["datasets/cat/gray.idx", "datasets/cat/rgb.idx"]
+	for filename in filenames:
+		db=LoadDataset(filename)
+		data=db.read()
+		array=Array.fromNumPy(data, TargetDim=db.getPointDim(), bShareMem=False)
+		name="{} {} {}MB".format(os.path.basename(filename), array.dtype.toString(), "{:.2f}".format(array.c_size()/float(MB)))
+		for specs in SPECS:
+			TestEncoder(name, array, specs)
+	print("all done")
+	sys.exit(0)
+
+# ////////////////////////////////////////////////////////////////
+if __name__=="__main__":
+	Main()